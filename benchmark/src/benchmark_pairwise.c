@@ -18,12 +18,53 @@
  */
 
 #include "../../src/libssa.h"
+#include "../../src/libssa_extern_db.h"
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <sys/time.h>
 
 #include "benchmark_util.h"
 
+/*
+ * Aligns the query against the first sequence of the database, using the
+ * pairwise alignment API. All pairs are aligned in one call.
+ */
+static double run_pair_alignment_times( int type, p_query query, int bit_width, int internal_iterations ) {
+    p_alignment_list (*align_func)( p_align_pair, size_t, int, int );
+    if( type == SW ) {
+        align_func = &sw_align_pairs;
+    }
+    else {
+        align_func = &nw_align_pairs;
+    }
+
+    p_seqinfo target = ssa_db_get_sequence( 0 );
+
+    align_pair_t * pairs = malloc( internal_iterations * sizeof(align_pair_t) );
+    for( int i = 0; i < internal_iterations; ++i ) {
+        pairs[i].query = query;
+        pairs[i].target = target->seq;
+        pairs[i].target_len = target->seqlen;
+    }
+
+    struct timeval start;
+    struct timeval finish;
+
+    gettimeofday( &start, NULL );
+
+    free_alignment( align_func( pairs, internal_iterations, bit_width, COMPUTE_SCORE ) );
+
+    gettimeofday( &finish, NULL );
+
+    free( pairs );
+
+    double elapsed = (finish.tv_sec - start.tv_sec);
+    elapsed += (finish.tv_usec - start.tv_usec) / 1000000.0;
+
+    return elapsed;
+}
+
 int main( int argc, char**argv ) {
     FILE *f = open_log_file( "pairwise" );
 
@@ -70,6 +111,17 @@ int main( int argc, char**argv ) {
             log_to_file( f, ",%lf", time );
         }
         log_to_file( f, "\n" );
+
+        for( int b = 0; b < 2; ++b ) {
+            log_to_file( f, "PAIRS,%s,%d_bit", TYPE_DESC( type ), bit_width[b] );
+
+            for( int i = 0; i < iterations; i++ ) {
+                double time = run_pair_alignment_times( type, query, bit_width[b], internal_iterations );
+
+                log_to_file( f, ",%lf", time );
+            }
+            log_to_file( f, "\n" );
+        }
     }
 
     free_sequence( query );
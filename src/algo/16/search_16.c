@@ -30,9 +30,11 @@
 #include "../../matrices.h"
 #include "../../cpu_config.h"
 #include "../../db_adapter.h"
+#include "../../context.h"
 #include "../64/search_64.h"
 
-static void (*search_algo)( p_s16info, p_db_chunk, p_minheap, p_db_chunk, uint8_t );
+// the algorithm is selected for the search of the current context
+#define search_algo (ctx_current->search_16_algo)
 
 void search_16_init_algo( int search_type ) {
     if( !is_sse2_enabled() ) {
@@ -70,8 +72,8 @@ p_s16info search_16_init( p_search_data sdp ) {
 void search_16_exit( p_s16info s ) {
     if( s->hearray )
         free( s->hearray );
-    if( s->hearray_64 )
-        free( s->hearray_64 );
+    if( s->s64info )
+        search_64_exit( s->s64info );
     if( s->dprofile )
         free( s->dprofile );
 
@@ -89,23 +91,23 @@ void search_16_exit( p_s16info s ) {
     free( s );
 }
 
-size_t search_16_chunk( p_s16info s16info, p_minheap heap, p_db_chunk chunk, p_search_data sdp ) {
+size_t search_16_chunk( p_s16info s16info, p_search_result res, p_db_chunk chunk, p_search_data sdp ) {
     size_t overflown_seq_count = 0;
 
     p_db_chunk overflow_chunk = adp_alloc_chunk( chunk->size * sdp->q_count );
 
     for( uint8_t q_id = 0; q_id < sdp->q_count; q_id++ ) {
-        search_algo( s16info, chunk, heap, overflow_chunk, q_id );
+        search_algo( s16info, chunk, res, overflow_chunk, q_id );
     }
 
     if( overflow_chunk->fill_pointer ) {
-        if( !s16info->hearray_64 ) {
-            s16info->hearray_64 = search_64_alloc_hearray( sdp );
+        if( !s16info->s64info ) {
+            s16info->s64info = search_64_init( sdp );
         }
 
         overflown_seq_count = overflow_chunk->fill_pointer;
 
-        search_64_chunk( heap, overflow_chunk, sdp, s16info->hearray_64 );
+        search_64_chunk( s16info->s64info, res, overflow_chunk, sdp );
     }
 
     adp_free_chunk_no_sequences( overflow_chunk );
@@ -113,6 +115,21 @@ size_t search_16_chunk( p_s16info s16info, p_minheap heap, p_db_chunk chunk, p_s
     return overflown_seq_count;
 }
 
+void search_16_ungapped_chunk( p_s16info s16info, p_db_chunk chunk, p_search_data sdp, int64_t * scores ) {
+    for( size_t i = 0; i < chunk->fill_pointer; i++ ) {
+        scores[i] = 0;
+    }
+
+    for( uint8_t q_id = 0; q_id < sdp->q_count; q_id++ ) {
+        if( is_avx2_enabled() ) {
+            search_16_avx2_ungapped( s16info, chunk, q_id, scores );
+        }
+        else {
+            search_16_sse2_ungapped( s16info, chunk, q_id, scores );
+        }
+    }
+}
+
 void search_16( p_db_chunk chunk, p_search_data sdp, p_search_result res ) {
     assert( search_algo );
 
@@ -121,12 +138,14 @@ void search_16( p_db_chunk chunk, p_search_data sdp, p_search_result res ) {
     adp_next_chunk( chunk );
 
     while( chunk->fill_pointer ) {
-        size_t overflown_seq_count = search_16_chunk( s16info, res->heap, chunk, sdp );
+        size_t overflown_seq_count = search_16_chunk( s16info, res, chunk, sdp );
 
         res->chunk_count++;
         res->seq_count += chunk->fill_pointer;
         res->overflow_16_bit_count += overflown_seq_count;
 
+        s_chunk_finished( res );
+
         adp_next_chunk( chunk );
     }
 
@@ -37,7 +37,17 @@ void search_16_init_algo( int search_type );
 p_s16info search_16_init( p_search_data sdp );
 void search_16_exit( p_s16info s );
 
-size_t search_16_chunk( p_s16info s16info, p_minheap heap, p_db_chunk chunk, p_search_data sdp );
+size_t search_16_chunk( p_s16info s16info, p_search_result res, p_db_chunk chunk, p_search_data sdp );
 void search_16( p_db_chunk chunk, p_search_data sdp, p_search_result res );
 
+/**
+ * Computes the best ungapped local alignment score of each sequence in the
+ * chunk with any of the queries. Scores above UINT16_MAX are reported as
+ * UINT16_MAX.
+ *
+ * @param scores    receives the score of the sequence at each position of the
+ *                  chunk
+ */
+void search_16_ungapped_chunk( p_s16info s16info, p_db_chunk chunk, p_search_data sdp, int64_t * scores );
+
 #endif /* SEARCH_16_H_ */
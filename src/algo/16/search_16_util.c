@@ -89,7 +89,7 @@ p_s16info search_16_sse2_init( p_search_data sdp ) {
 #endif
     p_s16info s = (p_s16info) xmalloc( sizeof(struct s16info) );
 
-    s->hearray_64 = 0;
+    s->s64info = 0;
 
     s->q_count = 0;
     for( int i = 0; i < 6; i++ ) {
@@ -101,6 +101,8 @@ p_s16info search_16_sse2_init( p_search_data sdp ) {
     s->penalty_gap_open = gapO;
     s->penalty_gap_extension = gapE;
 
+    s->retire_max_score = ctx_current->bound_pruning ? mat_get_max_score() : -1;
+
     s->dprofile = (__mxxxi *) xmalloc( sizeof(int16_t) * CDEPTH_16_BIT * CHANNELS_16_BIT * SCORE_MATRIX_DIM );
 
     search_16_init_query( s, sdp->q_count, sdp->queries );
@@ -21,6 +21,7 @@
 #define SEARCH_16_UTIL_H_
 
 #include "search_16.h"
+#include "../64/search_64.h"
 
 #include "../../util/util.h"
 
@@ -57,10 +58,13 @@ struct s16info {
     int16_t penalty_gap_open;
     int16_t penalty_gap_extension;
 
+    // highest substitution score, if channels are retired early, otherwise -1
+    long retire_max_score;
+
     uint8_t q_count;
     p_s16query queries[6];
 
-    int64_t * hearray_64;
+    p_s64info s64info;
 };
 
 static inline uint8_t move_db_sequence_window_16( uint8_t c, uint8_t * d_begin[CHANNELS_16_BIT],
@@ -85,10 +89,13 @@ p_s16info search_16_avx2_init( p_search_data sdp );
 void dprofile_fill_16_sse2( __mxxxi * dprofile, uint16_t * dseq_search_window );
 void dprofile_fill_16_avx2( __mxxxi * dprofile, uint16_t * dseq_search_window );
 
-void search_16_sse2_sw( p_s16info s, p_db_chunk chunk, p_minheap heap, p_db_chunk overflow_chunk, uint8_t query_id );
-void search_16_sse2_nw( p_s16info s, p_db_chunk chunk, p_minheap heap, p_db_chunk overflow_chunk, uint8_t query_id );
+void search_16_sse2_sw( p_s16info s, p_db_chunk chunk, p_search_result res, p_db_chunk overflow_chunk, uint8_t query_id );
+void search_16_sse2_nw( p_s16info s, p_db_chunk chunk, p_search_result res, p_db_chunk overflow_chunk, uint8_t query_id );
+
+void search_16_avx2_sw( p_s16info s, p_db_chunk chunk, p_search_result res, p_db_chunk overflow_chunk, uint8_t query_id );
+void search_16_avx2_nw( p_s16info s, p_db_chunk chunk, p_search_result res, p_db_chunk overflow_chunk, uint8_t query_id );
 
-void search_16_avx2_sw( p_s16info s, p_db_chunk chunk, p_minheap heap, p_db_chunk overflow_chunk, uint8_t query_id );
-void search_16_avx2_nw( p_s16info s, p_db_chunk chunk, p_minheap heap, p_db_chunk overflow_chunk, uint8_t query_id );
+void search_16_sse2_ungapped( p_s16info s, p_db_chunk chunk, uint8_t query_id, int64_t * scores );
+void search_16_avx2_ungapped( p_s16info s, p_db_chunk chunk, uint8_t query_id, int64_t * scores );
 
 #endif /* SEARCH_16_UTIL_H_ */
@@ -29,27 +29,32 @@
 #include "../gap_costs.h"
 
 
-int64_t full_nw( sequence_t * dseq, sequence_t * qseq, int64_t * hearray ) {
+void nw_64_init( sequence_t * qseq, int64_t * hearray ) {
+    const int64_t gap_open = gapO;
+    const int64_t gap_extend = gapE;
+
+    for( size_t i = 0; i < qseq->len; i++ ) {
+        hearray[2 * i] = gap_open + (i + 1) * gap_extend;         // H (N) scores in previous column
+        hearray[2 * i + 1] = 2 * gap_open + (i + 2) * gap_extend; // E gap values in previous column
+    }
+}
+
+int64_t nw_64_columns( sequence_t * dseq, sequence_t * qseq, int64_t * hearray, size_t start, size_t end,
+        int64_t score ) {
     int64_t h; // current value
     int64_t n; // diagonally previous value
     int64_t e; // value in left cell
     int64_t f; // value in upper cell
     int64_t *hep;
 
-    for( size_t i = 0; i < qseq->len; i++ ) {
-        hearray[2 * i] = gapO + (i + 1) * gapE;         // H (N) scores in previous column
-        hearray[2 * i + 1] = 2 * gapO + (i + 2) * gapE; // E gap values in previous column
-    }
+    const int64_t gap_open = gapO;
+    const int64_t gap_extend = gapE;
 
-#ifdef DBG_COLLECT_MATRIX
-        dbg_init_matrix_data_collection( BIT_WIDTH_64, dseq->len, qseq->len );
-#endif
-
-    for( size_t j = 0; j < dseq->len; j++ ) {
+    for( size_t j = start; j < end; j++ ) {
         hep = hearray;
 
-        f = 2 * gapO + (j + 2) * gapE;        // value in first upper cell
-        h = (j == 0) ? 0 : (gapO + j * gapE); // value in first cell of line
+        f = 2 * gap_open + (j + 2) * gap_extend;        // value in first upper cell
+        h = (j == 0) ? 0 : (gap_open + j * gap_extend); // value in first cell of line
 
         for( size_t i = 0; i < qseq->len; i++ ) {
             n = *hep;
@@ -65,9 +70,9 @@ int64_t full_nw( sequence_t * dseq, sequence_t * qseq, int64_t * hearray ) {
             *hep = h;
 
             // test for gap extensions
-            e += gapE;
-            f += gapE;
-            h += gapO + gapE;
+            e += gap_extend;
+            f += gap_extend;
+            h += gap_open + gap_extend;
 
             if( f < h )
                 f = h;
@@ -85,6 +90,19 @@ int64_t full_nw( sequence_t * dseq, sequence_t * qseq, int64_t * hearray ) {
         }
     }
 
+    // the score is in the last cell of the last column
+    return hearray[2 * qseq->len - 2];
+}
+
+int64_t full_nw( sequence_t * dseq, sequence_t * qseq, int64_t * hearray ) {
+    nw_64_init( qseq, hearray );
+
+#ifdef DBG_COLLECT_MATRIX
+        dbg_init_matrix_data_collection( BIT_WIDTH_64, dseq->len, qseq->len );
+#endif
+
+    int64_t score = nw_64_columns( dseq, qseq, hearray, 0, dseq->len, 0 );
+
 #ifdef DBG_COLLECT_MATRIX
         sequence_t * db_sequences = xmalloc( sizeof( sequence_t ) );
         db_sequences[0] = *dseq;
@@ -94,5 +112,5 @@ int64_t full_nw( sequence_t * dseq, sequence_t * qseq, int64_t * hearray ) {
         free( db_sequences );
 #endif
 
-    return hearray[2 * qseq->len - 2];;
+    return score;
 }
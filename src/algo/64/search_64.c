@@ -20,37 +20,229 @@
 #include "../64/search_64.h"
 
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 
 #include "../../db_adapter.h"
 #include "../searcher.h"
 #include "../../util/minheap.h"
 #include "../../util/util.h"
+#include "../../context.h"
 
-static int64_t (*search_algo)( sequence_t*, sequence_t*, int64_t* );
+// the algorithm is selected for the search of the current context
+#define search_algo (ctx_current->search_64_algo)
+#define search_init (ctx_current->search_64_init)
+#define search_columns (ctx_current->search_64_columns)
+
+// maximal number of saved columns per DB sequence in a chunk
+#define MAX_CHECKPOINTS 64
+
+/** @typedef    saved DP column of a prefix of a DB sequence
+ *
+ * @field len       length of the prefix
+ * @field score     best score up to the column, only used by SW
+ * @field hearray   H and E values of the column
+ */
+typedef struct {
+    size_t len;
+    int64_t score;
+    int64_t * hearray;
+} checkpoint_t;
+
+typedef struct {
+    p_sdb_sequence seq;
+    size_t pos; // position in the chunk
+} sorted_seq_t;
 
 void search_64_init_algo( int search_type ) {
     if( search_type == SMITH_WATERMAN ) {
         search_algo = &full_sw;
+        search_init = &sw_64_init;
+        search_columns = &sw_64_columns;
     }
     else if( search_type == NEEDLEMAN_WUNSCH ) {
         search_algo = &full_nw;
+        search_init = &nw_64_init;
+        search_columns = &nw_64_columns;
     }
     else {
         fatal( "\nunknown search type: %d\n\n", search_type );
     }
 }
 
-void search_64_chunk( p_minheap heap, p_db_chunk chunk, p_search_data sdp, int64_t* hearray ) {
+static int compare_sorted_seqs( const void * a, const void * b ) {
+    const sorted_seq_t * x = a;
+    const sorted_seq_t * y = b;
+
+    size_t x_len = x->seq->seq.len;
+    size_t y_len = y->seq->seq.len;
+
+    int c = memcmp( x->seq->seq.seq, y->seq->seq.seq, (x_len < y_len) ? x_len : y_len );
+    if( c ) {
+        return c;
+    }
+    if( x_len != y_len ) {
+        return (x_len < y_len) ? -1 : 1;
+    }
+    return (x->pos < y->pos) ? -1 : 1;
+}
+
+static size_t common_prefix_length( sequence_t * a, sequence_t * b ) {
+    size_t len = (a->len < b->len) ? a->len : b->len;
+
+    size_t i = 0;
+    while( (i < len) && (a->seq[i] == b->seq[i]) ) {
+        i++;
+    }
+    return i;
+}
+
+/** @typedef    buffers of one thread, reused for all chunks of a search
+ *
+ * @field hearray       H and E values of the current column
+ * @field capacity      number of sequences, that fit into sorted, lcp and scores
+ * @field sorted        the sequences of a chunk in lexicographical order
+ * @field lcp           common prefix of each sorted sequence with the next one
+ * @field scores        scores of the sequences in the order of the chunk
+ * @field checkpoints   saved columns, allocated on first use
+ */
+struct s64info {
+    int64_t * hearray;
+
+    size_t capacity;
+    sorted_seq_t * sorted;
+    size_t * lcp;
+    int64_t * scores;
+
+    checkpoint_t checkpoints[MAX_CHECKPOINTS];
+};
+
+p_s64info search_64_init( p_search_data sdp ) {
+    p_s64info s = xmalloc( sizeof(struct s64info) );
+    memset( s, 0, sizeof(struct s64info) );
+
+    s->hearray = search_64_alloc_hearray( sdp );
+
+    return s;
+}
+
+void search_64_exit( p_s64info s ) {
+    for( size_t k = 0; k < MAX_CHECKPOINTS; k++ ) {
+        free( s->checkpoints[k].hearray );
+    }
+    free( s->scores );
+    free( s->lcp );
+    free( s->sorted );
+    free( s->hearray );
+    free( s );
+}
+
+static void ensure_capacity( p_s64info s, size_t count ) {
+    if( count <= s->capacity ) {
+        return;
+    }
+
+    s->sorted = xrealloc( s->sorted, count * sizeof(sorted_seq_t) );
+    s->lcp = xrealloc( s->lcp, count * sizeof(size_t) );
+    s->scores = xrealloc( s->scores, count * sizeof(int64_t) );
+    s->capacity = count;
+}
+
+/*
+ * Searches the chunk in lexicographical order of the DB sequences. The column
+ * at the end of the common prefix with the next sequence is saved, and the
+ * next sequences continue from the deepest saved column on their common
+ * prefix, instead of from the first column.
+ *
+ * The scores are added to the result in the order of the chunk, so that the
+ * result is the same as without the reuse.
+ */
+static void search_64_chunk_shared( p_s64info s, p_search_result res, p_db_chunk chunk, p_search_data sdp ) {
+    size_t count = chunk->fill_pointer;
+    ensure_capacity( s, count );
+
+    int64_t * hearray = s->hearray;
+    sorted_seq_t * sorted = s->sorted;
+    size_t * lcp = s->lcp;
+    int64_t * scores = s->scores;
+    checkpoint_t * checkpoints = s->checkpoints;
+
+    for( size_t i = 0; i < count; i++ ) {
+        sorted[i].seq = chunk->seq[i];
+        sorted[i].pos = i;
+    }
+    qsort( sorted, count, sizeof(sorted_seq_t), compare_sorted_seqs );
+
+    // common prefix of each sequence with the next one
+    for( size_t i = 0; i + 1 < count; i++ ) {
+        lcp[i] = common_prefix_length( &sorted[i].seq->seq, &sorted[i + 1].seq->seq );
+    }
+    lcp[count - 1] = 0;
+
+    for( uint8_t q_id = 0; q_id < sdp->q_count; q_id++ ) {
+        sequence_t * qseq = &sdp->queries[q_id].seq;
+        size_t column_size = 2 * qseq->len * sizeof(int64_t);
+
+        size_t depth = 0;
+
+        for( size_t i = 0; i < count; i++ ) {
+            sequence_t * dseq = &sorted[i].seq->seq;
+
+            // only the columns on the common prefix with the previous sequence can be reused
+            size_t shared = i ? lcp[i - 1] : 0;
+            while( depth && (checkpoints[depth - 1].len > shared) ) {
+                depth--;
+            }
+
+            size_t start = 0;
+            int64_t score = 0;
+
+            if( depth ) {
+                memcpy( hearray, checkpoints[depth - 1].hearray, column_size );
+                start = checkpoints[depth - 1].len;
+                score = checkpoints[depth - 1].score;
+            }
+            else {
+                search_init( qseq, hearray );
+            }
+
+            if( (lcp[i] > start) && (depth < MAX_CHECKPOINTS) ) {
+                score = search_columns( dseq, qseq, hearray, start, lcp[i], score );
+                start = lcp[i];
+
+                checkpoint_t * cp = &checkpoints[depth++];
+                if( !cp->hearray ) {
+                    cp->hearray = search_64_alloc_hearray( sdp );
+                }
+                memcpy( cp->hearray, hearray, column_size );
+                cp->len = start;
+                cp->score = score;
+            }
+
+            scores[sorted[i].pos] = search_columns( dseq, qseq, hearray, start, dseq->len, score );
+        }
+
+        for( size_t i = 0; i < count; i++ ) {
+            add_to_result( res, q_id, chunk->seq[i], scores[i] );
+        }
+    }
+}
+
+void search_64_chunk( p_s64info s, p_search_result res, p_db_chunk chunk, p_search_data sdp ) {
+    if( ctx_current->prefix_sharing && (chunk->fill_pointer > 1) ) {
+        search_64_chunk_shared( s, res, chunk, sdp );
+        return;
+    }
+
     for( uint8_t q_id = 0; q_id < sdp->q_count; q_id++ ) {
         seq_buffer_t query = sdp->queries[q_id];
 
         for( size_t i = 0; i < chunk->fill_pointer; i++ ) {
             p_sdb_sequence dseq = chunk->seq[i];
 
-            long score = search_algo( &dseq->seq, &query.seq, hearray );
+            long score = search_algo( &dseq->seq, &query.seq, s->hearray );
 
-            add_to_minheap( heap, q_id, dseq, score );
+            add_to_result( res, q_id, dseq, score );
         }
     }
 }
@@ -62,18 +254,20 @@ int64_t* search_64_alloc_hearray( p_search_data sdp ) {
 void search_64( p_db_chunk chunk, p_search_data sdp, p_search_result res ) {
     assert( search_algo );
 
-    int64_t* hearray = search_64_alloc_hearray( sdp );
+    p_s64info s64info = search_64_init( sdp );
 
     adp_next_chunk( chunk );
 
     while( chunk->fill_pointer ) {
-        search_64_chunk( res->heap, chunk, sdp, hearray );
+        search_64_chunk( s64info, res, chunk, sdp );
 
         res->chunk_count++;
         res->seq_count += chunk->fill_pointer;
 
+        s_chunk_finished( res );
+
         adp_next_chunk( chunk );
     }
 
-    free( hearray );
+    search_64_exit( s64info );
 }
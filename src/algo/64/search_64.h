@@ -24,8 +24,14 @@
 
 #include "../../libssa_datatypes.h"
 
+struct s64info;
+typedef struct s64info * p_s64info;
+
 void search_64_init_algo( int search_type );
 
+p_s64info search_64_init( p_search_data sdp );
+void search_64_exit( p_s64info s );
+
 int64_t* search_64_alloc_hearray( p_search_data sdp );
 
 int64_t full_sw(sequence_t * dseq, sequence_t * qseq, int64_t * hearray );
@@ -34,7 +40,29 @@ int64_t full_nw(sequence_t * dseq, sequence_t * qseq, int64_t * hearray );
 
 int64_t full_nw_sellers(sequence_t * dseq, sequence_t * qseq, int64_t * hearray );
 
-void search_64_chunk( p_minheap heap, p_db_chunk chunk, p_search_data sdp, int64_t* hearray );
+/**
+ * Parts of full_sw and full_nw, that allow to continue an alignment from a
+ * saved column.
+ *
+ * The init functions set the column before the first DB residue. The columns
+ * functions compute the columns start to end - 1 of the DB sequence, based on
+ * the column start - 1 in hearray.
+ *
+ * @param score     sw: best score of the previous columns, nw: not used
+ * @return sw: best score of all columns up to end, nw: score in the last cell
+ *         of column end - 1
+ */
+void sw_64_init( sequence_t * qseq, int64_t * hearray );
+
+int64_t sw_64_columns( sequence_t * dseq, sequence_t * qseq, int64_t * hearray, size_t start, size_t end,
+        int64_t score );
+
+void nw_64_init( sequence_t * qseq, int64_t * hearray );
+
+int64_t nw_64_columns( sequence_t * dseq, sequence_t * qseq, int64_t * hearray, size_t start, size_t end,
+        int64_t score );
+
+void search_64_chunk( p_s64info s64info, p_search_result res, p_db_chunk chunk, p_search_data sdp );
 
 void search_64( p_db_chunk chunk, p_search_data sdp, p_search_result res );
 
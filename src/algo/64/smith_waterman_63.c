@@ -29,23 +29,24 @@
 #include "../../matrices.h"
 #include "../gap_costs.h"
 
-int64_t full_sw( sequence_t * dseq, sequence_t * qseq, int64_t * hearray ) {
+void sw_64_init( sequence_t * qseq, int64_t * hearray ) {
+    memset( hearray, 0, 2 * sizeof(int64_t) * (qseq->len) );
+}
+
+int64_t sw_64_columns( sequence_t * dseq, sequence_t * qseq, int64_t * hearray, size_t start, size_t end,
+        int64_t s ) {
     int64_t h; // current value
     int64_t n; // diagonally previous value
     int64_t e; // value in left cell
     int64_t f; // value in upper cell
-    int64_t s;
 
     int64_t *hep;
 
-    s = 0;
-    memset( hearray, 0, 2 * sizeof(int64_t) * (qseq->len) );
-
-#ifdef DBG_COLLECT_MATRIX
-        dbg_init_matrix_data_collection( BIT_WIDTH_64, dseq->len, qseq->len );
-#endif
+    // read once from the context, instead of in each cell
+    const int64_t gap_open = gapO;
+    const int64_t gap_extend = gapE;
 
-    for( size_t j = 0; j < dseq->len; j++ ) {
+    for( size_t j = start; j < end; j++ ) {
         hep = hearray;
         f = 0;
         h = 0;
@@ -66,9 +67,9 @@ int64_t full_sw( sequence_t * dseq, sequence_t * qseq, int64_t * hearray ) {
                 s = h;
 
             *hep = h;
-            e += gapE;
-            f += gapE;
-            h += gapO + gapE;
+            e += gap_extend;
+            f += gap_extend;
+            h += gap_open + gap_extend;
 
             if( h > e )
                 e = h;
@@ -85,6 +86,18 @@ int64_t full_sw( sequence_t * dseq, sequence_t * qseq, int64_t * hearray ) {
         }
     }
 
+    return s;
+}
+
+int64_t full_sw( sequence_t * dseq, sequence_t * qseq, int64_t * hearray ) {
+    sw_64_init( qseq, hearray );
+
+#ifdef DBG_COLLECT_MATRIX
+        dbg_init_matrix_data_collection( BIT_WIDTH_64, dseq->len, qseq->len );
+#endif
+
+    int64_t s = sw_64_columns( dseq, qseq, hearray, 0, dseq->len, 0 );
+
 #ifdef DBG_COLLECT_MATRIX
         sequence_t * db_sequences = xmalloc( sizeof( sequence_t ) );
         db_sequences[0] = *dseq;
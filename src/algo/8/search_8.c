@@ -29,9 +29,11 @@
 #include "../../matrices.h"
 #include "../../cpu_config.h"
 #include "../../db_adapter.h"
+#include "../../context.h"
 #include "../16/search_16.h"
 
-static void (*search_algo)( p_s8info, p_db_chunk, p_minheap, p_db_chunk, uint8_t );
+// the algorithm is selected for the search of the current context
+#define search_algo (ctx_current->search_8_algo)
 
 void search_8_init_algo( int search_type ) {
     if( !is_sse2_enabled() ) {
@@ -91,11 +93,11 @@ void search_8_exit( p_s8info s ) {
     free( s );
 }
 
-static void search_8_chunk( p_s8info s8info, p_minheap heap, p_db_chunk chunk, p_search_data sdp, p_search_result res ) {
+void search_8_chunk( p_s8info s8info, p_db_chunk chunk, p_search_data sdp, p_search_result res ) {
     p_db_chunk overflow_chunk = adp_alloc_chunk( chunk->size * sdp->q_count );
 
     for( uint8_t q_id = 0; q_id < sdp->q_count; q_id++ ) {
-        search_algo( s8info, chunk, heap, overflow_chunk, q_id );
+        search_algo( s8info, chunk, res, overflow_chunk, q_id );
     }
 
     if( overflow_chunk->fill_pointer ) {
@@ -117,7 +119,7 @@ static void search_8_chunk( p_s8info s8info, p_minheap heap, p_db_chunk chunk, p
 
         res->overflow_8_bit_count += overflow_chunk->fill_pointer;
 
-        res->overflow_16_bit_count += search_16_chunk( s8info->s16info, heap, overflow_chunk, sdp );
+        res->overflow_16_bit_count += search_16_chunk( s8info->s16info, res, overflow_chunk, sdp );
     }
 
     adp_free_chunk_no_sequences( overflow_chunk );
@@ -134,11 +136,13 @@ void search_8( p_db_chunk chunk, p_search_data sdp, p_search_result res ) {
     res->overflow_16_bit_count = 0;
 
     while( chunk->fill_pointer ) {
-        search_8_chunk( s8info, res->heap, chunk, sdp, res );
+        search_8_chunk( s8info, chunk, sdp, res );
 
         res->chunk_count++;
         res->seq_count += chunk->fill_pointer;
 
+        s_chunk_finished( res );
+
         adp_next_chunk( chunk );
     }
 
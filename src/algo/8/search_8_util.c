@@ -100,6 +100,8 @@ p_s8info search_8_sse41_init( p_search_data sdp ) {
     s->penalty_gap_open = gapO;
     s->penalty_gap_extension = gapE;
 
+    s->retire_max_score = ctx_current->bound_pruning ? mat_get_max_score() : -1;
+
     s->dprofile = (__mxxxi *) xmalloc( sizeof(int8_t) * CDEPTH_8_BIT * CHANNELS_8_BIT * SCORE_MATRIX_DIM );
 
     search_8_init_query( s, sdp->q_count, sdp->queries );
@@ -51,6 +51,9 @@ struct s8info {
     int8_t penalty_gap_open;
     int8_t penalty_gap_extension;
 
+    // highest substitution score, if channels are retired early, otherwise -1
+    long retire_max_score;
+
     uint8_t q_count;
     p_s8query queries[6];
 
@@ -79,10 +82,10 @@ p_s8info search_8_avx2_init( p_search_data sdp );
 void dprofile_fill_8_sse41( __mxxxi * dprofile, uint16_t * dseq_search_window );
 void dprofile_fill_8_avx2( __mxxxi * dprofile, uint16_t * dseq_search_window );
 
-void search_8_sse41_sw( p_s8info s, p_db_chunk chunk, p_minheap heap, p_db_chunk overflow_chunk, uint8_t query_id );
-void search_8_sse41_nw( p_s8info s, p_db_chunk chunk, p_minheap heap, p_db_chunk overflow_chunk, uint8_t query_id );
+void search_8_sse41_sw( p_s8info s, p_db_chunk chunk, p_search_result res, p_db_chunk overflow_chunk, uint8_t query_id );
+void search_8_sse41_nw( p_s8info s, p_db_chunk chunk, p_search_result res, p_db_chunk overflow_chunk, uint8_t query_id );
 
-void search_8_avx2_sw( p_s8info s, p_db_chunk chunk, p_minheap heap, p_db_chunk overflow_chunk, uint8_t query_id );
-void search_8_avx2_nw( p_s8info s, p_db_chunk chunk, p_minheap heap, p_db_chunk overflow_chunk, uint8_t query_id );
+void search_8_avx2_sw( p_s8info s, p_db_chunk chunk, p_search_result res, p_db_chunk overflow_chunk, uint8_t query_id );
+void search_8_avx2_nw( p_s8info s, p_db_chunk chunk, p_search_result res, p_db_chunk overflow_chunk, uint8_t query_id );
 
 #endif /* SEARCH_8_UTIL_H_ */
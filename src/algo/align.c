@@ -27,11 +27,14 @@
 #include "align.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "../util/util.h"
+#include "../context.h"
 #include "searcher.h"
 #include "../matrices.h"
 #include "gap_costs.h"
+#include "banded/search_banded.h"
 
 /*
  * TODO merge finding region and finding directions
@@ -149,13 +152,54 @@ region_t init_region_for_global( sequence_t a_seq, sequence_t b_seq ) {
     return region;
 }
 
-static void fill_alignment( p_alignment alignment, region_t region, cigar_p cigar ) {
+static void fill_alignment( p_alignment alignment, region_t region, packed_cigar_t cigar ) {
     alignment->align_q_start = region.a_begin;
     alignment->align_q_end = region.a_end;
     alignment->align_d_start = region.b_begin;
     alignment->align_d_end = region.b_end;
-    alignment->alignment = cigar->cigar;
-    alignment->alignment_len = cigar->len;
+    if( ctx_current->cigar_format == CIGAR_FORMAT_PACKED ) {
+        alignment->cigar_ops = xmalloc( (cigar.len + 1) * sizeof(uint32_t) );
+        memcpy( alignment->cigar_ops, cigar.ops, cigar.len * sizeof(uint32_t) );
+        alignment->cigar_ops_len = cigar.len;
+    }
+    else {
+        alignment->alignment = cigar_to_string( cigar, ctx_current->cigar_format == CIGAR_FORMAT_EXTENDED,
+                &alignment->alignment_len );
+    }
+    alignment->align_matches = cigar.matches;
+    alignment->align_mismatches = cigar.mismatches;
+    alignment->align_gap_opens = cigar.gap_opens;
+    alignment->align_gap_columns = cigar.columns - cigar.matches - cigar.mismatches;
+    alignment->align_columns = cigar.columns;
+}
+
+/*
+ * Computes the CIGAR of a global alignment within the band of the context. The
+ * band is widened like in the search, while the optimum could lie outside.
+ *
+ * @return 1 if the alignment was computed, 0 if the full matrix is needed
+ */
+static int align_banded( sequence_t a_seq, sequence_t b_seq, packed_cigar_t * cigar ) {
+    if( !a_seq.len || !b_seq.len ) {
+        return 0;
+    }
+
+    int64_t max_score = mat_get_max_score();
+
+    for( long width = bd_first_width(); width; width = bd_next_width( width, a_seq.len ) ) {
+        long lo;
+        long hi;
+        bd_band_limits( width, a_seq.len, b_seq.len, b_seq.len, &lo, &hi );
+
+        int64_t score;
+        *cigar = compute_banded_packed_cigar( a_seq, b_seq, lo, hi, &score );
+
+        if( score >= bd_outside_bound( a_seq.len, b_seq.len, lo, hi, max_score ) ) {
+            return 1;
+        }
+    }
+
+    return 0;
 }
 
 void align_sequences( int search_type, p_alignment alignment ) {
@@ -173,10 +217,12 @@ void align_sequences( int search_type, p_alignment alignment ) {
         fatal( "\nUnknown search type: %d\n\n", search_type );
     }
 
-    cigar_p cigar = compute_cigar_string( search_type, a_seq, b_seq, region );
+    packed_cigar_t cigar;
+    if( (search_type != NEEDLEMAN_WUNSCH) || !ctx_current->nw_band || !align_banded( a_seq, b_seq, &cigar ) ) {
+        cigar = compute_packed_cigar( search_type, a_seq, b_seq, region );
+    }
 
     fill_alignment( alignment, region, cigar );
 
-    if( cigar )
-        free( cigar );
+    cigar_release_workspace();
 }
@@ -42,10 +42,109 @@ typedef struct {
 
 typedef cigar_t * cigar_p;
 
+/*
+ * Operations of a packed CIGAR, numbered like in BAM.
+ */
+#define CIGAR_OP_M 0
+#define CIGAR_OP_I 1
+#define CIGAR_OP_D 2
+#define CIGAR_OP_EQ 7
+#define CIGAR_OP_X 8
+
+// size in bytes, above which a buffer of the traceback is not kept for the next alignment
+#define CIGAR_WORKSPACE_MAX (16 * 1024 * 1024)
+
+// number of cells of the DP matrix, from which its tiles are filled by several threads
+#define CIGAR_SPLIT_MIN_CELLS ((size_t) 1 << 24)
+// number of rows and columns of a tile
+#define CIGAR_TILE_SIZE 512
+
+#define CIGAR_OP_SHIFT 4
+#define CIGAR_PACK(op, len) (((uint32_t) (len) << CIGAR_OP_SHIFT) | (op))
+#define CIGAR_OP(c) ((c) & 0xf)
+#define CIGAR_LEN(c) ((c) >> CIGAR_OP_SHIFT)
+
+/** @typedef    CIGAR in the packed form of BAM
+ *
+ * @field ops       the operations in forward order, each holding the length
+ *                  shifted by CIGAR_OP_SHIFT and the operation
+ * @field len       number of operations
+ * @field matches   number of '=' columns
+ * @field mismatches    number of 'X' columns
+ * @field gap_opens     number of 'I' and 'D' operations
+ * @field columns   number of columns of the alignment
+ */
+typedef struct {
+    uint32_t * ops;
+    size_t len;
+    size_t matches;
+    size_t mismatches;
+    size_t gap_opens;
+    size_t columns;
+} packed_cigar_t;
+
 region_t find_region_for_local( sequence_t a_seq, sequence_t b_seq );
 
 region_t init_region_for_global( sequence_t a_seq, sequence_t b_seq );
 
+/**
+ * Number of cells of the DP matrix, from which compute_packed_cigar fills the
+ * matrix tile by tile, so that other threads can help with cigar_help.
+ * CIGAR_SPLIT_MIN_CELLS by default.
+ */
+extern size_t cigar_split_min_cells;
+
+/**
+ * Computes the packed CIGAR of the alignment of a_seq and b_seq in region. The
+ * alignment columns are split into '=' and 'X' operations.
+ *
+ * The operations are held in a buffer of the calling thread, which is reused
+ * by its next call or freed by cigar_release_workspace.
+ */
+packed_cigar_t compute_packed_cigar( int search_type, sequence_t a_seq, sequence_t b_seq, region_t region );
+
+/**
+ * Computes the packed CIGAR of the global alignment of a_seq and b_seq, like
+ * compute_packed_cigar, but only with the cells of the DP matrix within the
+ * band of the diagonals lo to hi. Cell (i, j) of symbol i of a_seq and symbol
+ * j of b_seq lies on diagonal j - i. The band has to contain the diagonals 0
+ * and b_seq.len - a_seq.len, and both sequences must not be empty.
+ *
+ * @param score     set to the score of the alignment, which is the best
+ *                  alignment within the band
+ */
+packed_cigar_t compute_banded_packed_cigar( sequence_t a_seq, sequence_t b_seq, long lo, long hi, int64_t * score );
+
+/**
+ * Fills a tile of the DP matrix of a large alignment of another thread, so
+ * that a single long alignment does not run on one thread, while the others
+ * are idle. Called by the threads of the alignment phases before taking their
+ * next alignment.
+ *
+ * @return 1 if a tile was filled, 0 if no large alignment has tiles left
+ */
+int cigar_help();
+
+/**
+ * Frees the buffers of the traceback of the calling thread, which are larger
+ * than CIGAR_WORKSPACE_MAX, so that a single long alignment does not keep the
+ * memory of its DP matrix in every thread. Invalidates the operations of the
+ * last packed CIGAR of the thread.
+ */
+void cigar_release_workspace();
+
+/**
+ * Renders a packed CIGAR as text. If extended is 0, runs of '=' and 'X' are
+ * written as 'M'.
+ *
+ * @param len   set to the length of the text, if not 0
+ * @return the text, which has to be freed by the caller
+ */
+char * cigar_to_string( packed_cigar_t cigar, int extended, size_t * len );
+
+/**
+ * Computes the CIGAR string, with 'M' for matches and mismatches.
+ */
 cigar_p compute_cigar_string( int search_type, sequence_t a_seq, sequence_t b_seq, region_t region );
 
 void align_sequences( int search_type, p_alignment alignment );
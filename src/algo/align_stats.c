@@ -0,0 +1,150 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+
+#include "align_stats.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../context.h"
+#include "../cpu_config.h"
+#include "../util/thread_pool.h"
+#include "../util/util.h"
+#include "align.h"
+
+// number of alignments taken by a thread at once
+#define STATS_BLOCK_SIZE 64
+
+typedef struct {
+    int search_type;
+    p_alignment * alignments;
+    size_t count;
+    size_t cursor;
+} stats_job_t;
+
+/*
+ * Orders the alignments by their query, and the alignments of a query by the
+ * length of the database sequence, so that the channels of a kernel call
+ * finish at about the same time.
+ */
+static int compare_by_query( const void * a, const void * b ) {
+    p_alignment x = *(const p_alignment *) a;
+    p_alignment y = *(const p_alignment *) b;
+
+    if( x->query.seq != y->query.seq ) {
+        return (x->query.seq < y->query.seq) ? -1 : 1;
+    }
+    if( x->db_seq.len != y->db_seq.len ) {
+        return (x->db_seq.len > y->db_seq.len) ? -1 : 1;
+    }
+    return 0;
+}
+
+static void fill_stats( p_alignment a, align_stats_t s ) {
+    size_t q_len = s.matches + s.mismatches + s.q_gaps;
+    size_t d_len = s.matches + s.mismatches + s.d_gaps;
+
+    a->align_q_end = s.q_end;
+    a->align_d_end = s.d_end;
+    a->align_q_start = q_len ? s.q_end + 1 - q_len : s.q_end;
+    a->align_d_start = d_len ? s.d_end + 1 - d_len : s.d_end;
+
+    a->align_matches = s.matches;
+    a->align_mismatches = s.mismatches;
+    a->align_gap_opens = s.gap_opens;
+    a->align_gap_columns = s.q_gaps + s.d_gaps;
+    a->align_columns = s.matches + s.mismatches + s.q_gaps + s.d_gaps;
+}
+
+void st_compute( int search_type, p_alignment * alignments, size_t count ) {
+    size_t channels = is_avx2_enabled() ? STATS_CHANNELS_AVX2 : STATS_CHANNELS_SSE2;
+
+    p_alignment * sorted = xmalloc( count * sizeof(p_alignment) );
+    memcpy( sorted, alignments, count * sizeof(p_alignment) );
+    qsort( sorted, count, sizeof(p_alignment), compare_by_query );
+
+    sequence_t d_seqs[STATS_CHANNELS_AVX2];
+    align_stats_t stats[STATS_CHANNELS_AVX2];
+    p_alignment lanes[STATS_CHANNELS_AVX2];
+
+    size_t i = 0;
+    while( i < count ) {
+        sequence_t query = { sorted[i]->query.seq, sorted[i]->query.len };
+
+        size_t lane_count = 0;
+        while( (i < count) && (lane_count < channels) && (sorted[i]->query.seq == query.seq) ) {
+            p_alignment a = sorted[i++];
+
+            if( !query.len || !a->db_seq.len ) {
+                // nothing to align
+                align_stats_t empty;
+                memset( &empty, 0, sizeof(align_stats_t) );
+                fill_stats( a, empty );
+                continue;
+            }
+
+            d_seqs[lane_count].seq = a->db_seq.seq;
+            d_seqs[lane_count].len = a->db_seq.len;
+            lanes[lane_count++] = a;
+        }
+
+        if( !lane_count ) {
+            continue;
+        }
+
+        if( is_avx2_enabled() ) {
+            stats_32_avx2( search_type, query, d_seqs, lane_count, stats );
+        }
+        else {
+            stats_32_sse2( search_type, query, d_seqs, lane_count, stats );
+        }
+
+        for( size_t c = 0; c < lane_count; c++ ) {
+            fill_stats( lanes[c], stats[c] );
+        }
+    }
+
+    free( sorted );
+}
+
+static void * compute_thread( void * data ) {
+    stats_job_t * job = data;
+
+    while( !ctx_is_cancelled() ) {
+        size_t start = __atomic_fetch_add( &job->cursor, STATS_BLOCK_SIZE, __ATOMIC_RELAXED );
+        if( start >= job->count ) {
+            break;
+        }
+
+        size_t count = MIN( STATS_BLOCK_SIZE, job->count - start );
+        st_compute( job->search_type, job->alignments + start, count );
+    }
+
+    return NULL;
+}
+
+void st_compute_parallel( int search_type, p_alignment * alignments, size_t count ) {
+    stats_job_t job = { search_type, alignments, count, 0 };
+
+    start_threads( compute_thread, &job );
+
+    void * results[get_current_thread_count()];
+    wait_for_threads( results );
+}
@@ -0,0 +1,85 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+
+/*
+ * Computes the statistics of alignments, like the identity and the number of
+ * gaps, without a traceback.
+ *
+ * The DP of the search is extended by counters, which are carried along with
+ * the H, E and F values of each cell: every cell knows the number of matches,
+ * mismatches, gap openings and gap columns of the best alignment ending in it.
+ * The statistics of an alignment are the counters of its last cell, so only
+ * two columns of the DP are kept, like in the search.
+ *
+ * The kernels compare a query with several database sequences at once, one
+ * sequence per channel, like the search kernels.
+ */
+
+#ifndef ALIGN_STATS_H_
+#define ALIGN_STATS_H_
+
+#include <stddef.h>
+
+#include "../libssa_datatypes.h"
+
+#define STATS_CHANNELS_SSE2 (128 / 32)
+#define STATS_CHANNELS_AVX2 (256 / 32)
+
+/** @typedef    statistics of the alignment of a query and a database sequence
+ *
+ * @field q_gaps    gap columns consuming query symbols (deletions)
+ * @field d_gaps    gap columns consuming database symbols (insertions)
+ * @field q_end     last position of the alignment in the query
+ * @field d_end     last position of the alignment in the database sequence
+ */
+typedef struct {
+    long score;
+    size_t matches;
+    size_t mismatches;
+    size_t gap_opens;
+    size_t q_gaps;
+    size_t d_gaps;
+    size_t q_end;
+    size_t d_end;
+} align_stats_t;
+
+/**
+ * Computes the statistics of the alignments of query and up to
+ * STATS_CHANNELS_SSE2 or STATS_CHANNELS_AVX2 database sequences.
+ */
+void stats_32_sse2( int search_type, sequence_t query, sequence_t * d_seqs, size_t count, align_stats_t * stats );
+void stats_32_avx2( int search_type, sequence_t query, sequence_t * d_seqs, size_t count, align_stats_t * stats );
+
+/**
+ * Fills the coordinates and the statistics of the alignments, without
+ * computing their CIGAR strings. Alignments with the same query are computed
+ * together by the SIMD kernels.
+ *
+ * @param search_type   SMITH_WATERMAN or NEEDLEMAN_WUNSCH
+ */
+void st_compute( int search_type, p_alignment * alignments, size_t count );
+
+/**
+ * Like st_compute, but the alignments are distributed over the threads of the
+ * thread pool.
+ */
+void st_compute_parallel( int search_type, p_alignment * alignments, size_t count );
+
+#endif /* ALIGN_STATS_H_ */
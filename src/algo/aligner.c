@@ -20,26 +20,28 @@
 #include "aligner.h"
 
 #include <stdlib.h>
-#include <pthread.h>
 #include <assert.h>
 
 #include "../matrices.h"
-#include "../libssa_extern_db.h"
+#include "../context.h"
 #include "searcher.h"
 #include "align.h"
 #include "../util/util.h"
 #include "../util/util_sequence.h"
 
-static p_alignment_data adp = 0;
-static size_t chunk_counter = 0;
-
-static pthread_mutex_t chunk_mutex = PTHREAD_MUTEX_INITIALIZER;
+// the state of the alignments of the current context
+#define adp (ctx_current->search.adp)
+#define chunk_counter (ctx_current->search.align_counter)
 
 void a_init_data( int search_type ) {
     adp = xmalloc( sizeof(alignment_data_t) );
 
     adp->search_type = search_type;
 
+    adp->pair_count = 0;
+    adp->order = 0;
+    adp->alignments = 0;
+
     adp->q_count = s_get_query_count();
     for( int i = 0; i < s_get_query_count(); i++ ) {
         adp->queries[i] = s_get_query( i );
@@ -51,6 +53,9 @@ void a_free_data() {
         return;
     }
 
+    free( adp->order );
+    free( adp->alignments );
+
     adp->q_count = 0;
     adp->result_sequence_pairs = 0;
 
@@ -59,17 +64,21 @@ void a_free_data() {
     free( adp );
 }
 
-static p_alignment init_alignment( elem_t * e ) {
+/**
+ * Creates the alignment for a search result. The query sequence is taken from
+ * the buffer queries, using the query_id of the result.
+ */
+p_alignment a_init_alignment( elem_t * e, seq_buffer_t * queries ) {
     p_alignment a = xmalloc( sizeof(alignment_t) );
 
-    p_seqinfo info = ssa_db_get_sequence( e->db_id );
+    p_seqinfo info = ctx_db_get_sequence( e->db_id );
     if( !info ) {
         fatal( "Could not get sequence from DB: %ld", e->db_id );
     }
 
     sequence_t dseq = us_prepare_sequence( info->seq, info->seqlen, e->db_frame, e->db_strand );
 
-    seq_buffer_t qseq = adp->queries[e->query_id];
+    seq_buffer_t qseq = queries[e->query_id];
 
     a->db_seq.seq = dseq.seq;
     a->db_seq.len = dseq.len;
@@ -86,7 +95,15 @@ static p_alignment init_alignment( elem_t * e ) {
     a->align_d_start = 0;
     a->align_q_end = 0;
     a->align_d_end = 0;
+    a->align_matches = 0;
+    a->align_mismatches = 0;
+    a->align_gap_opens = 0;
+    a->align_gap_columns = 0;
+    a->align_columns = 0;
     a->alignment = 0;
+    a->alignment_len = 0;
+    a->cigar_ops = 0;
+    a->cigar_ops_len = 0;
     a->score = e->score;
 
     return a;
@@ -94,8 +111,50 @@ static p_alignment init_alignment( elem_t * e ) {
 
 void create_score_alignment_list( p_minheap search_results, p_alignment_list alist ) {
     for( int i = 0; i < search_results->count; ++i ) {
-        alist->alignments[i] = init_alignment( &search_results->array[i] );
+        alist->alignments[i] = a_init_alignment( &search_results->array[i], adp->queries );
+    }
+}
+
+/**
+ * Releases a single alignment of a result list.
+ */
+void a_free_alignment( p_alignment a ) {
+    if( !a ) {
+        return;
+    }
+
+    free( a->db_seq.seq );
+    a->db_seq.seq = 0;
+    a->db_seq.len = 0;
+    a->db_seq.strand = 0;
+    a->db_seq.frame = 0;
+    a->db_seq.ID = 0;
+
+    a->query.seq = 0;
+    a->query.len = 0;
+    a->query.strand = 0;
+    a->query.frame = 0;
+
+    a->align_q_start = 0;
+    a->align_d_start = 0;
+    a->align_q_end = 0;
+    a->align_d_end = 0;
+    a->align_matches = 0;
+    a->align_mismatches = 0;
+    a->align_gap_opens = 0;
+    a->align_gap_columns = 0;
+    a->align_columns = 0;
+    if( a->alignment ) {
+        free( a->alignment );
+        a->alignment = 0;
     }
+    a->alignment_len = 0;
+    free( a->cigar_ops );
+    a->cigar_ops = 0;
+    a->cigar_ops_len = 0;
+    a->score = 0;
+
+    free( a );
 }
 
 void a_free( p_alignment_list alist ) {
@@ -105,33 +164,7 @@ void a_free( p_alignment_list alist ) {
 
     if( alist->alignments ) {
         for( size_t i = 0; i < alist->len; i++ ) {
-            if( alist->alignments[i] ) {
-                p_alignment a = alist->alignments[i];
-
-                free( a->db_seq.seq );
-                a->db_seq.seq = 0;
-                a->db_seq.len = 0;
-                a->db_seq.strand = 0;
-                a->db_seq.frame = 0;
-                a->db_seq.ID = 0;
-
-                a->query.seq = 0;
-                a->query.len = 0;
-                a->query.strand = 0;
-                a->query.frame = 0;
-
-                a->align_q_start = 0;
-                a->align_d_start = 0;
-                a->align_q_end = 0;
-                a->align_d_end = 0;
-                if( a->alignment ) {
-                    free( a->alignment );
-                    a->alignment = 0;
-                }
-                a->score = 0;
-
-                free( a );
-            }
+            a_free_alignment( alist->alignments[i] );
             alist->alignments[i] = 0;
         }
         free( alist->alignments );
@@ -142,40 +175,202 @@ void a_free( p_alignment_list alist ) {
     free( alist );
 }
 
+/*
+ * Orders alignments by descending score. Equal scores are ordered by the
+ * database ID and then by strand and frame, so that the order does not depend
+ * on the order in which the alignments were found.
+ */
+static int compare_alignments( const void * a, const void * b ) {
+    p_alignment x = *(p_alignment *) a;
+    p_alignment y = *(p_alignment *) b;
+
+    if( x->score != y->score ) {
+        return (x->score > y->score) ? -1 : 1;
+    }
+    if( x->db_seq.ID != y->db_seq.ID ) {
+        return (x->db_seq.ID < y->db_seq.ID) ? -1 : 1;
+    }
+    if( x->db_seq.strand != y->db_seq.strand ) {
+        return x->db_seq.strand - y->db_seq.strand;
+    }
+    if( x->db_seq.frame != y->db_seq.frame ) {
+        return x->db_seq.frame - y->db_seq.frame;
+    }
+    if( x->query.strand != y->query.strand ) {
+        return x->query.strand - y->query.strand;
+    }
+    return x->query.frame - y->query.frame;
+}
+
+static int same_hit( p_alignment x, p_alignment y ) {
+    return (x->db_seq.ID == y->db_seq.ID) && (x->db_seq.strand == y->db_seq.strand)
+            && (x->db_seq.frame == y->db_seq.frame) && (x->query.strand == y->query.strand)
+            && (x->query.frame == y->query.frame);
+}
+
+p_alignment_list a_merge( p_alignment_list * lists, size_t list_count, size_t hit_count ) {
+    size_t total = 0;
+    for( size_t i = 0; i < list_count; i++ ) {
+        if( lists[i] ) {
+            total += lists[i]->len;
+        }
+    }
+
+    p_alignment_list alist = xmalloc( sizeof(alignment_list_t) );
+    alist->alignments = xmalloc( total * sizeof(p_alignment) );
+    alist->len = 0;
+    alist->partial = 0;
+
+    for( size_t i = 0; i < list_count; i++ ) {
+        if( !lists[i] ) {
+            continue;
+        }
+
+        for( size_t j = 0; j < lists[i]->len; j++ ) {
+            alist->alignments[alist->len++] = lists[i]->alignments[j];
+        }
+        alist->partial |= lists[i]->partial;
+
+        free( lists[i]->alignments );
+        free( lists[i] );
+        lists[i] = 0;
+    }
+
+    qsort( alist->alignments, alist->len, sizeof(p_alignment), compare_alignments );
+
+    // lists of overlapping ranges contain the same hits, which are next to each other after sorting
+    size_t len = 0;
+    for( size_t i = 0; i < alist->len; i++ ) {
+        if( len && same_hit( alist->alignments[len - 1], alist->alignments[i] ) ) {
+            a_free_alignment( alist->alignments[i] );
+        }
+        else {
+            alist->alignments[len++] = alist->alignments[i];
+        }
+    }
+    alist->len = len;
+
+    while( alist->len > hit_count ) {
+        a_free_alignment( alist->alignments[--alist->len] );
+    }
+
+    return alist;
+}
+
+double a_recall( p_alignment_list exact, p_alignment_list approx ) {
+    if( !exact || !exact->len ) {
+        return 1;
+    }
+
+    size_t found = 0;
+
+    for( size_t i = 0; i < exact->len; i++ ) {
+        for( size_t j = 0; approx && (j < approx->len); j++ ) {
+            if( same_hit( exact->alignments[i], approx->alignments[j] ) ) {
+                found++;
+                break;
+            }
+        }
+    }
+    return found / (double) exact->len;
+}
+
+typedef struct {
+    size_t idx;
+    size_t cost;
+} pair_cost_t;
+
+static int compare_costs( const void * a, const void * b ) {
+    const pair_cost_t * x = a;
+    const pair_cost_t * y = b;
+
+    if( x->cost != y->cost ) {
+        return (x->cost > y->cost) ? -1 : 1;
+    }
+    return (x->idx > y->idx) - (x->idx < y->idx);
+}
+
+/*
+ * The size of the DP matrix of a pair dominates the time of its traceback.
+ * Aligning the largest pairs first keeps the threads from waiting for a few
+ * long alignments at the end.
+ */
+void a_order_by_cost( elem_t * pairs, size_t count, seq_buffer_t * queries, size_t * order ) {
+    pair_cost_t * costs = xmalloc( (count + 1) * sizeof(pair_cost_t) );
+
+    for( size_t i = 0; i < count; i++ ) {
+        p_seqinfo info = ctx_db_get_sequence( pairs[i].db_id );
+
+        costs[i].idx = i;
+        costs[i].cost = queries[pairs[i].query_id].seq.len * (info ? info->seqlen : 0);
+    }
+
+    qsort( costs, count, sizeof(pair_cost_t), compare_costs );
+
+    for( size_t i = 0; i < count; i++ ) {
+        order[i] = costs[i].idx;
+    }
+
+    free( costs );
+}
+
 void a_set_alignment_pairs( size_t pair_count, elem_t * result_sequence_pairs ) {
     adp->pair_count = pair_count;
     adp->result_sequence_pairs = result_sequence_pairs;
+
+    free( adp->order );
+    free( adp->alignments );
+    adp->order = xmalloc( (pair_count + 1) * sizeof(size_t) );
+    adp->alignments = xmalloc( (pair_count + 1) * sizeof(p_alignment) );
+
+    for( size_t i = 0; i < pair_count; i++ ) {
+        adp->alignments[i] = 0;
+    }
+
+    a_order_by_cost( result_sequence_pairs, pair_count, adp->queries, adp->order );
+
+    chunk_counter = 0;
 }
 
-static elem_t * get_chunk() {
-    size_t next_chunk;
+p_alignment * a_get_alignments() {
+    return adp->alignments;
+}
 
-    pthread_mutex_lock( &chunk_mutex );
-    next_chunk = chunk_counter++;
-    pthread_mutex_unlock( &chunk_mutex );
+/*
+ * Returns the index of the next pair to align, or -1 if all pairs are handed
+ * out.
+ */
+static size_t next_pair() {
+    if( ctx_is_cancelled() ) {
+        return -1;
+    }
 
-    if( next_chunk >= adp->pair_count ) {
-        return 0;
+    size_t next = __atomic_fetch_add( &chunk_counter, 1, __ATOMIC_RELAXED );
+    if( next >= adp->pair_count ) {
+        return -1;
     }
-    return &adp->result_sequence_pairs[next_chunk];
+    return adp->order[next];
 }
 
 void * a_align( void * unused ) {
     assert( adp );
 
-    p_alignment_list alignment_list = xmalloc( sizeof(alignment_list_t) );
-    alignment_list->alignments = xmalloc( adp->pair_count * sizeof(alignment_t) );
-    alignment_list->len = 0;
+    size_t idx;
+    while( 1 ) {
+        // the tiles of a large alignment of another thread go first
+        while( cigar_help() ) {
+        }
+
+        if( (idx = next_pair()) == (size_t) -1 ) {
+            break;
+        }
 
-    elem_t * chunk = 0;
-    while( (chunk = get_chunk()) != 0 ) {
-        // do alignment for each pair
-        p_alignment a = init_alignment( chunk );
+        p_alignment a = a_init_alignment( &adp->result_sequence_pairs[idx], adp->queries );
 
         align_sequences( adp->search_type, a );
 
-        alignment_list->alignments[alignment_list->len++] = a;
+        adp->alignments[idx] = a;
     }
 
-    return alignment_list;
+    return NULL;
 }
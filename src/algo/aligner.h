@@ -26,12 +26,55 @@ void a_init_data( int search_type );
 
 void a_free_data();
 
+void a_free_alignment( p_alignment a );
+
 void a_free( p_alignment_list alist );
 
+/**
+ * Merges the result lists into one list of the best 'hit_count' alignments,
+ * sorted by score and database ID. Hits contained in several lists are kept
+ * once. The merged lists are released.
+ */
+p_alignment_list a_merge( p_alignment_list * lists, size_t list_count, size_t hit_count );
+
+/**
+ * Returns the fraction of the alignments in exact, that are also in approx.
+ */
+double a_recall( p_alignment_list exact, p_alignment_list approx );
+
+/**
+ * Sorts the indices of the pairs by decreasing cost of their alignment, the
+ * size of their DP matrix. Equal costs keep the order of the pairs.
+ *
+ * @param order     receives the indices of the count pairs
+ */
+void a_order_by_cost( elem_t * pairs, size_t count, seq_buffer_t * queries, size_t * order );
+
+/**
+ * Sets the hits to align with a_align. They are aligned in the order of
+ * decreasing cost, but the alignments are also kept in the order of the hits,
+ * see a_get_alignments.
+ */
 void a_set_alignment_pairs( size_t pair_count, elem_t * result_sequence_pairs );
 
+/**
+ * Returns the alignments computed by a_align at the indices of their hits.
+ * The entries of hits, that were not aligned, are 0. The array is released by
+ * a_free_data, the alignments are not.
+ */
+p_alignment * a_get_alignments();
+
+p_alignment a_init_alignment( elem_t * e, seq_buffer_t * queries );
+
 void create_score_alignment_list( p_minheap search_results, p_alignment_list alist );
 
+/**
+ * Aligns the hits set by a_set_alignment_pairs. Called by every thread of the
+ * alignment phase. The pairs are handed out with an atomic cursor, and the
+ * alignments are stored at the indices of their hits, see a_get_alignments.
+ *
+ * @return NULL
+ */
 void * a_align( void * adp );
 
 #endif /* ALIGNER_H_ */
@@ -0,0 +1,161 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+/*
+ * Implements the asynchronous search.
+ *
+ * Every submitted search gets its own coordinating thread, which enters the
+ * context of the search and runs m_run. The work itself is done by the
+ * shared thread pool. A cancelled search stops at the next chunk, or at the
+ * next alignment, and releases the state of all threads.
+ */
+
+#include "async_search.h"
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "../context.h"
+#include "../util/util.h"
+#include "aligner.h"
+#include "manager.h"
+
+struct ssa_search {
+    p_ssa_context ctx;
+    p_query query;
+    size_t hit_count;
+    int search_type;
+    int bit_width;
+    int align_type;
+
+    ssa_search_callback callback;
+    void * callback_data;
+
+    int state;
+    p_alignment_list result;
+
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t finished;
+};
+
+static void * run_search( void * data ) {
+    p_ssa_search search = data;
+
+    p_ssa_context prev = ctx_enter( search->ctx );
+
+    if( search->search_type == SMITH_WATERMAN ) {
+        init_for_sw( search->query, search->bit_width, search->align_type );
+    }
+    else {
+        init_for_nw( search->query, search->bit_width, search->align_type );
+    }
+
+    p_alignment_list alist = m_run( search->hit_count );
+
+    ctx_leave( prev );
+
+    pthread_mutex_lock( &search->mutex );
+    search->result = alist;
+    search->state = alist ? SSA_SEARCH_FINISHED : SSA_SEARCH_CANCELLED;
+    // a late cancellation must not stop the next search of the context
+    search->ctx->search.cancelled = 0;
+    pthread_mutex_unlock( &search->mutex );
+
+    if( search->callback ) {
+        search->callback( search, search->callback_data );
+    }
+
+    pthread_mutex_lock( &search->mutex );
+    search->callback = 0;
+    pthread_cond_broadcast( &search->finished );
+    pthread_mutex_unlock( &search->mutex );
+
+    return NULL;
+}
+
+p_ssa_search as_submit( p_ssa_context ctx, p_query query, size_t hit_count, int search_type, int bit_width,
+        int align_type, ssa_search_callback callback, void * callback_data ) {
+    p_ssa_search search = xmalloc( sizeof(struct ssa_search) );
+
+    search->ctx = ctx;
+    search->query = query;
+    search->hit_count = hit_count;
+    search->search_type = search_type;
+    search->bit_width = bit_width;
+    search->align_type = align_type;
+    search->callback = callback;
+    search->callback_data = callback_data;
+    search->state = SSA_SEARCH_RUNNING;
+    search->result = 0;
+
+    pthread_mutex_init( &search->mutex, NULL );
+    pthread_cond_init( &search->finished, NULL );
+
+    // reset here, so that a cancellation directly after the submit is not lost
+    ctx->search.cancelled = 0;
+
+    if( pthread_create( &search->thread, NULL, run_search, search ) ) {
+        fatal( "Could not start the thread of the search." );
+    }
+
+    return search;
+}
+
+int as_poll( p_ssa_search search ) {
+    pthread_mutex_lock( &search->mutex );
+    int state = search->state;
+    pthread_mutex_unlock( &search->mutex );
+
+    return state;
+}
+
+p_alignment_list as_wait( p_ssa_search search ) {
+    pthread_mutex_lock( &search->mutex );
+    while( (search->state == SSA_SEARCH_RUNNING) || search->callback ) {
+        pthread_cond_wait( &search->finished, &search->mutex );
+    }
+    p_alignment_list alist = search->result;
+    pthread_mutex_unlock( &search->mutex );
+
+    return alist;
+}
+
+void as_cancel( p_ssa_search search ) {
+    pthread_mutex_lock( &search->mutex );
+    if( search->state == SSA_SEARCH_RUNNING ) {
+        ctx_cancel( search->ctx );
+    }
+    pthread_mutex_unlock( &search->mutex );
+}
+
+void as_free( p_ssa_search search ) {
+    if( !search ) {
+        return;
+    }
+
+    pthread_join( search->thread, NULL );
+
+    a_free( search->result );
+
+    pthread_mutex_destroy( &search->mutex );
+    pthread_cond_destroy( &search->finished );
+
+    free( search );
+}
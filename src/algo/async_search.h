@@ -0,0 +1,41 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#ifndef ASYNC_SEARCH_H_
+#define ASYNC_SEARCH_H_
+
+#include "../libssa_datatypes.h"
+
+/**
+ * Starts a search of query in the database of ctx and returns immediately.
+ * The search is run by a separate thread, that uses the thread pool like
+ * m_run.
+ */
+p_ssa_search as_submit( p_ssa_context ctx, p_query query, size_t hit_count, int search_type, int bit_width,
+        int align_type, ssa_search_callback callback, void * callback_data );
+
+int as_poll( p_ssa_search search );
+
+p_alignment_list as_wait( p_ssa_search search );
+
+void as_cancel( p_ssa_search search );
+
+void as_free( p_ssa_search search );
+
+#endif /* ASYNC_SEARCH_H_ */
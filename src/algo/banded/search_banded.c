@@ -0,0 +1,218 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#include "search_banded.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <assert.h>
+
+#include "../../db_adapter.h"
+#include "../../context.h"
+#include "../../cpu_config.h"
+#include "../../matrices.h"
+#include "../../util/util.h"
+#include "../64/search_64.h"
+#include "../align.h"
+#include "../gap_costs.h"
+#include "../searcher.h"
+
+typedef struct {
+    p_sdb_sequence seq;
+    size_t pos; // position in the chunk
+} band_seq_t;
+
+/*
+ * Orders the sequences by decreasing length, so that the sequences of a kernel
+ * call need a narrow common band and finish at about the same time.
+ */
+static int compare_by_length( const void * a, const void * b ) {
+    const band_seq_t * x = a;
+    const band_seq_t * y = b;
+
+    if( x->seq->seq.len != y->seq->seq.len ) {
+        return (x->seq->seq.len > y->seq->seq.len) ? -1 : 1;
+    }
+    return (x->pos < y->pos) ? -1 : 1;
+}
+
+void bd_band_limits( long width, size_t qlen, size_t dlen_min, size_t dlen_max, long * lo, long * hi ) {
+    long diag_min = (long) dlen_min - (long) qlen;
+    long diag_max = (long) dlen_max - (long) qlen;
+
+    *lo = MIN( 0, diag_min ) - width;
+    *hi = MAX( 0, diag_max ) + width;
+}
+
+int64_t bd_outside_bound( size_t qlen, size_t dlen, long lo, long hi, int64_t max_score ) {
+    int64_t diag = (int64_t) dlen - (int64_t) qlen;
+    int64_t columns = qlen + dlen;
+
+    // gap columns needed to reach the diagonal above or below the band and to come back
+    int64_t above = 2 * (hi + 1) - diag;
+    int64_t below = 2 * (1 - lo) + diag;
+    int64_t gaps = MIN( above, below );
+
+    if( gaps > columns ) {
+        return INT64_MIN;
+    }
+
+    // each match consumes two of the columns, each gap column one
+    return (max_score * (columns - gaps) + 2 * (2 * gapO + gaps * gapE)) / 2;
+}
+
+long bd_first_width() {
+    return (ctx_current->nw_band == NW_BAND_ADAPTIVE) ? BAND_ADAPTIVE_START : ctx_current->nw_band;
+}
+
+long bd_next_width( long width, size_t qlen ) {
+    if( ctx_current->nw_band != NW_BAND_ADAPTIVE ) {
+        return 0;
+    }
+
+    // a band as wide as the query saves nothing compared to the full matrix
+    if( 2 * (size_t) width + 1 >= qlen ) {
+        return 0;
+    }
+    return 2 * width;
+}
+
+static void align_banded( int64_t * scores, band_seq_t * seqs, size_t count, sequence_t * qseq, long width ) {
+    sequence_t d_seqs[BAND_CHANNELS_AVX2];
+
+    for( size_t c = 0; c < count; c++ ) {
+        d_seqs[c] = seqs[c].seq->seq;
+    }
+
+    long lo;
+    long hi;
+    bd_band_limits( width, qseq->len, d_seqs[count - 1].len, d_seqs[0].len, &lo, &hi );
+
+    if( is_avx2_enabled() ) {
+        nw_band_32_avx2( *qseq, d_seqs, count, lo, hi, scores );
+    }
+    else {
+        nw_band_32_sse2( *qseq, d_seqs, count, lo, hi, scores );
+    }
+}
+
+void search_banded_chunk( p_search_result res, p_db_chunk chunk, p_search_data sdp, int64_t * hearray ) {
+    size_t count = chunk->fill_pointer;
+    size_t channels = is_avx2_enabled() ? BAND_CHANNELS_AVX2 : BAND_CHANNELS_SSE2;
+
+    int64_t max_score = mat_get_max_score();
+
+    band_seq_t * pending = xmalloc( count * sizeof(band_seq_t) );
+    int64_t * scores = xmalloc( count * sizeof(int64_t) );
+
+    size_t banded = 0;
+    size_t fallbacks = 0;
+
+    for( uint8_t q_id = 0; q_id < sdp->q_count; q_id++ ) {
+        sequence_t * qseq = &sdp->queries[q_id].seq;
+
+        size_t pending_count = 0;
+        for( size_t i = 0; i < count; i++ ) {
+            p_sdb_sequence dseq = chunk->seq[i];
+
+            if( qseq->len && dseq->seq.len ) {
+                pending[pending_count].seq = dseq;
+                pending[pending_count++].pos = i;
+            }
+            else {
+                scores[i] = ctx_current->search_64_algo( &dseq->seq, qseq, hearray );
+            }
+        }
+
+        qsort( pending, pending_count, sizeof(band_seq_t), compare_by_length );
+
+        for( long width = bd_first_width(); width && pending_count; width = bd_next_width( width, qseq->len ) ) {
+            size_t left = 0;
+
+            for( size_t k = 0; k < pending_count; k += channels ) {
+                size_t lanes = MIN( channels, pending_count - k );
+
+                int64_t lane_scores[BAND_CHANNELS_AVX2];
+                align_banded( lane_scores, pending + k, lanes, qseq, width );
+
+                long lo;
+                long hi;
+                bd_band_limits( width, qseq->len, pending[k + lanes - 1].seq->seq.len, pending[k].seq->seq.len, &lo,
+                        &hi );
+
+                for( size_t c = 0; c < lanes; c++ ) {
+                    band_seq_t s = pending[k + c];
+
+                    int64_t bound = bd_outside_bound( qseq->len, s.seq->seq.len, lo, hi, max_score );
+
+                    /*
+                     * The banded score is kept, if it is optimal, or if neither it nor
+                     * an alignment outside the band can enter the results.
+                     */
+                    if( (lane_scores[c] >= bound) || (MAX( lane_scores[c], bound ) <= result_score_floor( res )) ) {
+                        scores[s.pos] = lane_scores[c];
+                        banded++;
+                    }
+                    else {
+                        pending[left++] = s;
+                    }
+                }
+            }
+
+            pending_count = left;
+        }
+
+        // the optimum may lie outside the widest band
+        for( size_t k = 0; k < pending_count; k++ ) {
+            scores[pending[k].pos] = ctx_current->search_64_algo( &pending[k].seq->seq, qseq, hearray );
+            fallbacks++;
+        }
+
+        for( size_t i = 0; i < count; i++ ) {
+            add_to_result( res, q_id, chunk->seq[i], scores[i] );
+        }
+    }
+
+    __atomic_add_fetch( &ctx_current->band_sequences, banded, __ATOMIC_RELAXED );
+    __atomic_add_fetch( &ctx_current->band_fallbacks, fallbacks, __ATOMIC_RELAXED );
+
+    free( scores );
+    free( pending );
+}
+
+void search_banded( p_db_chunk chunk, p_search_data sdp, p_search_result res ) {
+    assert( ctx_current->search_64_algo );
+
+    int64_t * hearray = search_64_alloc_hearray( sdp );
+
+    adp_next_chunk( chunk );
+
+    while( chunk->fill_pointer ) {
+        search_banded_chunk( res, chunk, sdp, hearray );
+
+        res->chunk_count++;
+        res->seq_count += chunk->fill_pointer;
+
+        s_chunk_finished( res );
+
+        adp_next_chunk( chunk );
+    }
+
+    free( hearray );
+}
@@ -0,0 +1,95 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+/*
+ * Banded Needleman-Wunsch search for sequences of similar length.
+ *
+ * Only the cells of the DP matrix within a band of diagonals are computed:
+ * cell (i, j) of query row i and database column j is computed, if
+ * lo <= j - i <= hi. The band contains the diagonal of the first and of the
+ * last cell of the matrix, widened by a half width on both sides. For nearly
+ * identical sequences this is a small part of the matrix.
+ *
+ * The score within the band is exact, if no alignment leaving the band can
+ * score higher. Such an alignment contains gaps in both directions, which
+ * together are at least G columns long, with G the distance of the band edges
+ * to the diagonals of the first and the last cell. Its score is at most
+ *
+ *   max_score * (qlen + dlen - G) / 2 + 2 * gapO + G * gapE
+ *
+ * Sequences, for which the banded score is below this bound, are aligned
+ * again with a wider band or with the full matrix.
+ */
+
+#ifndef SEARCH_BANDED_H_
+#define SEARCH_BANDED_H_
+
+#include <stdint.h>
+
+#include "../../libssa_datatypes.h"
+
+#define BAND_CHANNELS_SSE2 (128 / 32)
+#define BAND_CHANNELS_AVX2 (256 / 32)
+
+// half width of the first band of the adaptive band
+#define BAND_ADAPTIVE_START 16
+
+/**
+ * Computes the banded global alignment scores of query and up to
+ * BAND_CHANNELS_SSE2 or BAND_CHANNELS_AVX2 database sequences. The diagonals
+ * of the last cells of all sequences have to lie within the band.
+ *
+ * @param lo        lowest diagonal of the band, at most 0
+ * @param hi        highest diagonal of the band, at least 0
+ * @param scores    receives the score of each database sequence
+ */
+void nw_band_32_sse2( sequence_t query, sequence_t * d_seqs, size_t count, long lo, long hi, int64_t * scores );
+void nw_band_32_avx2( sequence_t query, sequence_t * d_seqs, size_t count, long lo, long hi, int64_t * scores );
+
+/**
+ * Computes the band of the given half width for the alignments of a query
+ * with database sequences of the lengths dlen_min to dlen_max.
+ */
+void bd_band_limits( long width, size_t qlen, size_t dlen_min, size_t dlen_max, long * lo, long * hi );
+
+/**
+ * Returns the highest score, that an alignment leaving the band can reach, or
+ * INT64_MIN, if no alignment can leave the band.
+ *
+ * @param max_score highest substitution score
+ */
+int64_t bd_outside_bound( size_t qlen, size_t dlen, long lo, long hi, int64_t max_score );
+
+/**
+ * Returns the half width of the first band of the current context.
+ */
+long bd_first_width();
+
+/**
+ * Returns the half width of the next band, after the optimum of a sequence
+ * was not found within the band of the given width, or 0, if the sequence has
+ * to be aligned with the full matrix.
+ */
+long bd_next_width( long width, size_t qlen );
+
+void search_banded_chunk( p_search_result res, p_db_chunk chunk, p_search_data sdp, int64_t * hearray );
+
+void search_banded( p_db_chunk chunk, p_search_data sdp, p_search_result res );
+
+#endif /* SEARCH_BANDED_H_ */
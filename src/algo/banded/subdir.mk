@@ -0,0 +1,7 @@
+OBJS += \
+./src/algo/banded/search_banded.o
+
+USER_OBJS += \
+./src/algo/banded/search_banded.h
+
+TO_CLEAN +=
\ No newline at end of file
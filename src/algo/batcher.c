@@ -0,0 +1,423 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+/*
+ * Implements the query-channel mode of the database search.
+ *
+ * In the normal mode, the SIMD channels are filled with database sequences and
+ * a single query sequence forms the rows of the dynamic programming matrix.
+ * For many short queries this wastes most of the work on setting up the
+ * database chunks for each query. In the query-channel mode the roles are
+ * swapped: the frames of all queries are packed into the channels and every
+ * database sequence forms the rows. The database is therefore read and
+ * translated only once for all queries.
+ *
+ * The same SIMD kernels, including the overflow handling with 16 and 64 bit,
+ * are used for both modes. Swapping the sequences does not change the score
+ * only if the scoring matrix is symmetric. This is checked before the search,
+ * and for an asymmetric matrix every query is searched on its own instead.
+ *
+ * The chunks of the database are distributed to the threads. Every thread
+ * aligns each of its database sequences against all channels at once, so the
+ * profile of the database sequence is built only once for all groups of
+ * channels. The threads share one heap for each query, so the hits take
+ * query_count * hit_count entries for any number of threads. A heap is locked
+ * only for hits, which score above its minimum once it is full.
+ */
+
+#include "batcher.h"
+
+#include <assert.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "../db_adapter.h"
+#include "../context.h"
+#include "../matrices.h"
+#include "../util/minheap.h"
+#include "../util/thread_pool.h"
+#include "../util/util.h"
+#include "aligner.h"
+#include "align.h"
+#include "align_stats.h"
+#include "manager.h"
+#include "searcher.h"
+#include "8/search_8.h"
+#include "16/search_16.h"
+#include "64/search_64.h"
+
+typedef struct {
+    p_query * queries;
+    size_t query_count;
+    size_t hit_count;
+
+    int search_type;
+    int bit_width;
+    int align_type;
+
+    p_search_data * sdps;
+
+    /*
+     * The frames of all queries in the channels. The ID of a sequence in a
+     * channel is the index into lane_query and lane_frame.
+     */
+    p_db_chunk lanes;
+    size_t * lane_query;
+    uint8_t * lane_frame;
+
+    size_t next_chunk;
+    size_t next_query;
+
+    /*
+     * The heap of each query, its lock and the minimum of the full heap,
+     * which is LONG_MIN until the heap is full.
+     */
+    p_minheap * heaps;
+    pthread_mutex_t * heap_mutexes;
+    long * heap_floors;
+
+    p_alignment_list * results;
+    ssa_batch_callback callback;
+    void * callback_data;
+} batch_t;
+typedef batch_t * p_batch;
+
+typedef struct {
+    p_batch b;
+
+    p_sdb_sequence db_seq;
+} batch_hits_t;
+
+/*
+ * Adds the score of a channel to the heap of its query. The query is given by
+ * the channel, the rows hold a single database sequence, so query_id is 0.
+ */
+static void add_batch_hit( p_search_result res, uint8_t query_id, p_sdb_sequence lane, long score ) {
+    assert( !query_id );
+
+    batch_hits_t * hits = res->hit_data;
+    p_batch b = hits->b;
+    size_t q = b->lane_query[lane->ID];
+
+    // hits at the minimum of a full heap are ignored by minheap_add as well
+    if( score <= __atomic_load_n( &b->heap_floors[q], __ATOMIC_RELAXED ) ) {
+        return;
+    }
+
+    elem_t e;
+    e.query_id = b->lane_frame[lane->ID];
+    e.db_id = hits->db_seq->ID;
+    e.db_frame = hits->db_seq->frame;
+    e.db_strand = hits->db_seq->strand;
+    e.score = score;
+
+    pthread_mutex_lock( &b->heap_mutexes[q] );
+
+    p_minheap heap = b->heaps[q];
+    minheap_add( heap, &e );
+    if( heap->count == heap->alloc ) {
+        __atomic_store_n( &b->heap_floors[q], heap->array[0].score, __ATOMIC_RELAXED );
+    }
+
+    pthread_mutex_unlock( &b->heap_mutexes[q] );
+}
+
+/*
+ * Aligns one database sequence, used as the rows of the matrix, against the
+ * frames of all queries in the channels. The kernels build the profile of the
+ * rows once and use it for all groups of channels.
+ */
+static void search_db_sequence( p_batch b, p_sdb_sequence db_seq, p_search_result res ) {
+    search_data_t row;
+    row.maxqlen = db_seq->seq.len;
+    row.q_count = 1;
+    row.queries[0].seq = db_seq->seq;
+    row.queries[0].strand = db_seq->strand;
+    row.queries[0].frame = db_seq->frame;
+
+    s_search_chunk( b->bit_width, &row, b->lanes, res );
+}
+
+static void * b_search( void * data ) {
+    p_batch b = (p_batch) data;
+
+    batch_hits_t hits;
+    hits.b = b;
+    hits.db_seq = 0;
+
+    search_result_t res;
+    res.heap = 0;
+    res.chunk_count = 0;
+    res.seq_count = 0;
+    res.overflow_8_bit_count = 0;
+    res.overflow_16_bit_count = 0;
+    res.add_hit = &add_batch_hit;
+    res.hit_data = &hits;
+    res.shared_floor = 0;
+
+    p_db_chunk chunk = adp_init_new_chunk();
+
+    size_t db_end = ctx_db_range_end();
+
+    while( b->lanes->fill_pointer ) {
+        size_t start = __atomic_fetch_add( &b->next_chunk, max_chunk_size, __ATOMIC_RELAXED );
+        if( start >= db_end ) {
+            break;
+        }
+
+        adp_fill_chunk( chunk, start );
+
+        for( size_t j = 0; j < chunk->fill_pointer; j++ ) {
+            if( !chunk->seq[j]->seq.len ) {
+                continue;
+            }
+
+            hits.db_seq = chunk->seq[j];
+
+            search_db_sequence( b, chunk->seq[j], &res );
+        }
+
+        res.chunk_count++;
+        res.seq_count += chunk->fill_pointer;
+    }
+
+    adp_free_chunk( chunk );
+
+    if( res.overflow_8_bit_count || res.overflow_16_bit_count ) {
+        print_info( "Overflow occurred: %ld sequences were re-aligned with 16 bit, and %ld sequences with 64 bit\n",
+                res.overflow_8_bit_count, res.overflow_16_bit_count );
+    }
+
+    return NULL;
+}
+
+static p_alignment_list create_alignment_list( p_batch b, p_minheap heap, p_search_data sdp ) {
+    minheap_sort( heap );
+
+    p_alignment_list alist = xmalloc( sizeof(alignment_list_t) );
+    alist->alignments = xmalloc( heap->count * sizeof(p_alignment) );
+    alist->len = heap->count;
+    alist->partial = 0;
+
+    for( size_t i = 0; i < heap->count; i++ ) {
+        p_alignment a = a_init_alignment( &heap->array[i], sdp->queries );
+
+        if( b->align_type == COMPUTE_ALIGNMENT ) {
+            align_sequences( b->search_type, a );
+        }
+
+        alist->alignments[i] = a;
+    }
+
+    if( b->align_type == COMPUTE_STATISTICS ) {
+        st_compute( b->search_type, alist->alignments, alist->len );
+    }
+
+    return alist;
+}
+
+/*
+ * Creates the alignment lists of one query after another, which includes the
+ * alignments of the hits if requested.
+ */
+static void * b_collect( void * data ) {
+    p_batch b = (p_batch) data;
+
+    size_t i;
+    while( (i = __atomic_fetch_add( &b->next_query, 1, __ATOMIC_RELAXED )) < b->query_count ) {
+        b->results[i] = create_alignment_list( b, b->heaps[i], b->sdps[i] );
+
+        if( b->callback ) {
+            b->callback( i, b->results[i], b->callback_data );
+        }
+    }
+
+    return NULL;
+}
+
+static void init_heaps( p_batch b ) {
+    b->heaps = xmalloc( b->query_count * sizeof(p_minheap) );
+    b->heap_mutexes = xmalloc( b->query_count * sizeof(pthread_mutex_t) );
+    b->heap_floors = xmalloc( b->query_count * sizeof(long) );
+
+    for( size_t i = 0; i < b->query_count; i++ ) {
+        b->heaps[i] = minheap_init( b->hit_count );
+        pthread_mutex_init( &b->heap_mutexes[i], NULL );
+        b->heap_floors[i] = LONG_MIN;
+    }
+}
+
+static void free_heaps( p_batch b ) {
+    for( size_t i = 0; i < b->query_count; i++ ) {
+        minheap_exit( b->heaps[i] );
+        pthread_mutex_destroy( &b->heap_mutexes[i] );
+    }
+
+    free( b->heaps );
+    free( b->heap_mutexes );
+    free( b->heap_floors );
+}
+
+static void init_lanes( p_batch b ) {
+    size_t lane_count = 0;
+
+    b->sdps = xmalloc( b->query_count * sizeof(p_search_data) );
+    for( size_t i = 0; i < b->query_count; i++ ) {
+        b->sdps[i] = s_create_searchdata( b->queries[i] );
+        lane_count += b->sdps[i]->q_count;
+    }
+
+    b->lanes = adp_alloc_chunk( lane_count );
+    b->lane_query = xmalloc( lane_count * sizeof(size_t) );
+    b->lane_frame = xmalloc( lane_count * sizeof(uint8_t) );
+
+    for( size_t i = 0; i < b->query_count; i++ ) {
+        for( uint8_t f = 0; f < b->sdps[i]->q_count; f++ ) {
+            if( !b->sdps[i]->queries[f].seq.len ) {
+                continue;
+            }
+
+            p_sdb_sequence lane = xmalloc( sizeof(sdb_sequence_t) );
+            lane->ID = b->lanes->fill_pointer;
+            lane->seq = b->sdps[i]->queries[f].seq;
+            lane->strand = b->sdps[i]->queries[f].strand;
+            lane->frame = b->sdps[i]->queries[f].frame;
+
+            b->lane_query[lane->ID] = i;
+            b->lane_frame[lane->ID] = f;
+
+            b->lanes->seq[b->lanes->fill_pointer++] = lane;
+        }
+    }
+}
+
+static void free_lanes( p_batch b ) {
+    for( size_t i = 0; i < b->lanes->fill_pointer; i++ ) {
+        free( b->lanes->seq[i] );
+    }
+    adp_free_chunk_no_sequences( b->lanes );
+
+    for( size_t i = 0; i < b->query_count; i++ ) {
+        free( b->sdps[i] );
+    }
+
+    free( b->sdps );
+    free( b->lane_query );
+    free( b->lane_frame );
+}
+
+/*
+ * Swapping the queries and the database sequences is only valid for a
+ * symmetric scoring matrix. Otherwise every query is searched on its own.
+ */
+static p_alignment_list * run_single_queries( p_query * queries, size_t query_count, size_t hit_count,
+        int search_type, int bit_width, int align_type, ssa_batch_callback callback, void * data ) {
+    print_info( "Scoring matrix is not symmetric: searching %ld queries one by one\n", query_count );
+
+    p_alignment_list * results = xmalloc( query_count * sizeof(p_alignment_list) );
+
+    for( size_t i = 0; i < query_count; i++ ) {
+        if( search_type == NEEDLEMAN_WUNSCH ) {
+            init_for_nw( queries[i], bit_width, align_type );
+        }
+        else {
+            init_for_sw( queries[i], bit_width, align_type );
+        }
+
+        results[i] = m_run( hit_count );
+
+        if( callback ) {
+            callback( i, results[i], data );
+        }
+    }
+
+    return results;
+}
+
+p_alignment_list * b_run( p_query * queries, size_t query_count, size_t hit_count, int search_type, int bit_width,
+        int align_type, ssa_batch_callback callback, void * data ) {
+    if( (bit_width != BIT_WIDTH_8) && (bit_width != BIT_WIDTH_16) && (bit_width != BIT_WIDTH_64) ) {
+        fatal( "\nunknown bit width provided: %d\n\n", bit_width );
+    }
+
+    if( !mat_is_symmetric() ) {
+        return run_single_queries( queries, query_count, hit_count, search_type, bit_width, align_type, callback,
+                data );
+    }
+
+    search_64_init_algo( search_type );
+    search_16_init_algo( search_type );
+    search_8_init_algo( search_type );
+
+    batch_t b;
+    b.queries = queries;
+    b.query_count = query_count;
+    b.hit_count = hit_count;
+    b.search_type = search_type;
+    b.bit_width = bit_width;
+    b.align_type = align_type;
+    b.next_query = 0;
+    b.results = xmalloc( query_count * sizeof(p_alignment_list) );
+    b.callback = callback;
+    b.callback_data = data;
+
+    init_lanes( &b );
+    init_heaps( &b );
+
+    init_thread_pool();
+
+    ctx_pin_database();
+
+    adp_init( max_chunk_size );
+
+    b.next_chunk = ctx_db_range_start();
+
+    start_threads( b_search, &b );
+
+    void * thread_results[get_current_thread_count()];
+    wait_for_threads( thread_results );
+
+    start_threads( b_collect, &b );
+
+    void * collect_results[get_current_thread_count()];
+    wait_for_threads( collect_results );
+
+    ctx_unpin_database();
+
+    adp_exit();
+
+    free_heaps( &b );
+    free_lanes( &b );
+
+    return b.results;
+}
+
+void b_free( p_alignment_list * alists, size_t query_count ) {
+    if( !alists ) {
+        return;
+    }
+
+    for( size_t i = 0; i < query_count; i++ ) {
+        a_free( alists[i] );
+        alists[i] = 0;
+    }
+
+    free( alists );
+}
@@ -0,0 +1,37 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#ifndef BATCHER_H_
+#define BATCHER_H_
+
+#include "../libssa.h"
+
+/**
+ * Searches the database with many queries at once. Returns one list of
+ * 'hit_count' alignments for every query, in the order of the queries.
+ *
+ * If callback is set, it gets the list of each query, as soon as the list is
+ * complete.
+ */
+p_alignment_list * b_run( p_query * queries, size_t query_count, size_t hit_count, int search_type, int bit_width,
+        int align_type, ssa_batch_callback callback, void * data );
+
+void b_free( p_alignment_list * alists, size_t query_count );
+
+#endif /* BATCHER_H_ */
@@ -23,14 +23,22 @@
  * Finding the directions is based on the implementation in VSEARCH:
  * https://github.com/torognes/vsearch/blob/master/src/align.cc
  *
- * Creating the CIGAR string is based on the implementation in SSW:
- * https://github.com/mengyao/Complete-Striped-Smith-Waterman-Library/blob/master/src/ssw.c
+ * The CIGAR is built in the packed form of BAM: each operation is a uint32_t
+ * holding the length in the upper 28 bits and the operation in the lower 4
+ * bits. The traceback runs from the end of the alignment to its start, so the
+ * operations are written from the back of a buffer, which is large enough for
+ * the longest possible CIGAR, and end up in forward order. The buffers of the
+ * traceback are kept per thread and reused by the following alignments.
+ *
+ * The directions of large matrices are filled in tiles along the
+ * anti-diagonals, which the idle threads of the alignment phase fill as well.
  */
 
 #include "align.h"
 
 #include <limits.h>
-#include <stdio.h>
+#include <pthread.h>
+#include <sched.h>
 #include <string.h>
 #include <stdlib.h>
 
@@ -38,40 +46,59 @@
 #include "../matrices.h"
 #include "gap_costs.h"
 
-#define CIGAR_ALLOC_STEP_SIZE 64;
-
 #define MASK_GAP_UP 1
 #define MASK_GAP_LEFT 2
 #define MASK_GAP_EXT_UP 4
 #define MASK_GAP_EXT_LEFT 8
 
-static uint8_t * compute_directions_for_nw( sequence_t a_seq, sequence_t b_seq ) {
-    uint8_t * directions = xmalloc( a_seq.len * b_seq.len );
-    /*
-     * Holds in the first column the scores of the previous column
-     * and in the second column the gap-values of the previous column
-     */
-    int64_t * hearray = xmalloc( 2 * a_seq.len * sizeof(int64_t) );
+/*
+ * Sets the scores and gap values of the column left of the DP matrix.
+ */
+static void init_hearray( int local, sequence_t a_seq, int64_t * hearray ) {
+    for( size_t i = 0; i < a_seq.len; i++ ) {
+        hearray[2 * i] = local ? 0 : gapO + (i + 1) * gapE;             // H (N) scores in previous column
+        hearray[2 * i + 1] = local ? 0 : 2 * gapO + (i + 2) * gapE;     // E gap values in previous column
+    }
+}
 
+/*
+ * Fills the directions of the rows first_row to end_row - 1 of the columns
+ * first_col to end_col - 1 of the DP matrix of a local or a global alignment.
+ * hearray holds in the first column the scores of the previous column and in
+ * the second column the gap-values of the previous column.
+ *
+ * in_f and in_h hold for each column the gap value and the diagonal score
+ * entering from the row above first_row. Without them, first_row is the first
+ * row of the matrix. out_f and out_h receive the values leaving the row
+ * end_row - 1, if they are set.
+ */
+static void fill_directions( int local, sequence_t a_seq, sequence_t b_seq, size_t first_row, size_t end_row,
+        size_t first_col, size_t end_col, uint8_t * directions, int64_t * hearray, int64_t * in_f, int64_t * in_h,
+        int64_t * out_f, int64_t * out_h ) {
     int64_t h; // current value
     int64_t n; // diagonally previous value
     int64_t e; // value in left cell
     int64_t f; // value in upper cell
     int64_t *hep;
 
-    memset( directions, 0, a_seq.len * b_seq.len );
-
-    for( size_t i = 0; i < a_seq.len; i++ ) {
-        hearray[2 * i] = gapO + (i + 1) * gapE;         // H (N) scores in previous column
-        hearray[2 * i + 1] = 2 * gapO + (i + 2) * gapE; // E gap values in previous column
-    }
+    for( size_t j = first_col; j < end_col; j++ ) {
+        if( in_f ) {
+            f = in_f[j];
+            h = in_h[j];
+        }
+        else if( local ) {
+            f = 0;
+            h = 0;
+        }
+        else {
+            f = 2 * gapO + (j + 2) * gapE;        // value in first upper cell
+            h = (j == 0) ? 0 : (gapO + j * gapE); // value in first cell of line
+        }
 
-    for( size_t j = 0; j < b_seq.len; j++ ) {
-        hep = hearray;
-        f = 2 * gapO + (j + 2) * gapE;        // value in first upper cell
-        h = (j == 0) ? 0 : (gapO + j * gapE); // value in first cell of line
+        hep = hearray + 2 * first_row;
+        memset( directions + a_seq.len * j + first_row, 0, end_row - first_row );
 
-        for( size_t i = 0; i < a_seq.len; i++ ) {
+        for( size_t i = first_row; i < end_row; i++ ) {
             size_t index = a_seq.len * j + i;
 
             n = *hep;
@@ -87,6 +114,9 @@ static uint8_t * compute_directions_for_nw( sequence_t a_seq, sequence_t b_seq )
                 h = e;
                 directions[index] |= MASK_GAP_LEFT;
             }
+            if( local && (h < 0) ) {
+                h = 0;
+            }
 
             *hep = h;
 
@@ -115,37 +145,66 @@ static uint8_t * compute_directions_for_nw( sequence_t a_seq, sequence_t b_seq )
             h = n;
             hep += 2;
         }
-    }
 
-    free( hearray );
-
-    return directions;
+        if( out_f ) {
+            out_f[j] = f;
+            out_h[j] = h;
+        }
+    }
 }
 
-static uint8_t * compute_directions_for_sw( sequence_t a_seq, sequence_t b_seq ) {
-    uint8_t * directions = xmalloc( a_seq.len * b_seq.len );
-    /*
-     * Holds in the first column the scores of the previous column
-     * and in the second column the gap-values of the previous column
-     */
-    int64_t * hearray = xmalloc( 2 * a_seq.len * sizeof(int64_t) );
+// value of the cells outside the band
+#define UNREACHABLE (INT64_MIN / 4)
 
+/*
+ * Fills the directions of the cells of the DP matrix within the band of
+ * diagonals lo to hi, like fill_directions. The directions of column
+ * j are stored at (hi - lo) * j + i + hi, for the rows j - hi to j - lo.
+ *
+ * @return the score in the last cell of the matrix
+ */
+static int64_t compute_directions_for_banded_nw( sequence_t a_seq, sequence_t b_seq, long lo, long hi,
+        uint8_t * directions, int64_t * hearray ) {
     int64_t h; // current value
     int64_t n; // diagonally previous value
     int64_t e; // value in left cell
     int64_t f; // value in upper cell
     int64_t *hep;
 
-    memset( directions, 0, a_seq.len * b_seq.len );
-    memset( hearray, 0, 2 * a_seq.len * sizeof(int64_t) );
+    long a_len = a_seq.len;
+    size_t stride = hi - lo;
 
-    for( size_t j = 0; j < b_seq.len; j++ ) {
-        hep = hearray;
-        f = 0;   // value in first upper cell
-        h = 0;   // value in first cell of line
+    memset( directions, 0, (stride + 1) * b_seq.len );
 
-        for( size_t i = 0; i < a_seq.len; i++ ) {
-            size_t index = a_seq.len * j + i;
+    for( long i = 0; i < a_len; i++ ) {
+        if( -1 - i >= lo ) {
+            hearray[2 * i] = gapO + (i + 1) * gapE;
+            hearray[2 * i + 1] = 2 * gapO + (i + 2) * gapE;
+        }
+        else {
+            hearray[2 * i] = UNREACHABLE;
+            hearray[2 * i + 1] = UNREACHABLE;
+        }
+    }
+
+    for( long j = 0; j < (long) b_seq.len; j++ ) {
+        long first = MAX( 0, j - hi );
+        long last = MIN( a_len - 1, j - lo );
+
+        if( first == 0 ) {
+            f = (j + 1 <= hi) ? (2 * gapO + (j + 2) * gapE) : UNREACHABLE;
+            h = (j == 0) ? 0 : (gapO + j * gapE);
+        }
+        else {
+            // the upper cell lies on the diagonal above the band
+            f = UNREACHABLE;
+            h = hearray[2 * (first - 1)];
+        }
+
+        hep = hearray + 2 * first;
+
+        for( long i = first; i <= last; i++ ) {
+            size_t index = stride * j + i + hi;
 
             n = *hep;
             e = *(hep + 1);
@@ -160,14 +219,12 @@ static uint8_t * compute_directions_for_sw( sequence_t a_seq, sequence_t b_seq )
                 h = e;
                 directions[index] |= MASK_GAP_LEFT;
             }
-            if( h < 0 ) {
-                h = 0;
-            }
 
             *hep = h;
 
-            // test for gap extensions
             h += gapO + gapE;
+
+            // test for gap extensions
             e += gapE;
             f += gapE;
 
@@ -192,155 +249,458 @@ static uint8_t * compute_directions_for_sw( sequence_t a_seq, sequence_t b_seq )
         }
     }
 
-    free( hearray );
-
-    return directions;
+    return hearray[2 * (a_len - 1)];
 }
 
-static inline void check_allocated_size( cigar_p cigar ) {
-    while( cigar->len >= cigar->allocated_size ) {
-        cigar->allocated_size += CIGAR_ALLOC_STEP_SIZE;
-        cigar->cigar = xrealloc( cigar->cigar, cigar->allocated_size * sizeof(char) );
-    }
-}
+/*
+ * Buffers of the traceback, kept per thread. They grow with the alignments and
+ * are released by cigar_release_workspace, if they got larger than
+ * CIGAR_WORKSPACE_MAX.
+ */
+typedef struct {
+    uint8_t * directions;
+    size_t directions_size;
 
-// TODO implement the cigar creation, so it does not need to write number reversed ...
-char * strrev( char *str ) {
-    char *p1, *p2;
+    int64_t * hearray;
+    size_t hearray_size;
 
-    if( !str || !*str )
-        return str;
-    for( p1 = str, p2 = str + strlen( str ) - 1; p2 > p1; ++p1, --p2 ) {
-        *p1 ^= *p2;
-        *p2 ^= *p1;
-        *p1 ^= *p2;
-    }
-    return str;
+    uint32_t * ops;
+    size_t ops_size;
+} cigar_workspace_t;
+
+static pthread_key_t workspace_key;
+static pthread_once_t workspace_once = PTHREAD_ONCE_INIT;
+
+static void free_workspace( void * data ) {
+    cigar_workspace_t * ws = data;
+
+    free( ws->directions );
+    free( ws->hearray );
+    free( ws->ops );
+    free( ws );
 }
 
-static inline void add_to_cigar( char op, size_t op_count, cigar_p cigar ) {
-    if( op_count == 0 ) {
-        return;
+static void create_workspace_key() {
+    if( pthread_key_create( &workspace_key, free_workspace ) ) {
+        fatal( "Could not create the buffers of the traceback." );
     }
-    cigar->cigar[cigar->len++] = op;
+}
 
-    check_allocated_size( cigar );
+static cigar_workspace_t * get_workspace() {
+    pthread_once( &workspace_once, create_workspace_key );
 
-    if( op_count > 1 ) {
-        uint64_t insert_pos = cigar->len;
+    cigar_workspace_t * ws = pthread_getspecific( workspace_key );
+    if( !ws ) {
+        ws = xmalloc( sizeof(cigar_workspace_t) );
+        memset( ws, 0, sizeof(cigar_workspace_t) );
 
-        char counter_buf[25];
-        size_t len = sprintf( counter_buf, "%ld", op_count );
-        cigar->len += len;
+        pthread_setspecific( workspace_key, ws );
+    }
 
-        check_allocated_size( cigar );
+    return ws;
+}
 
-        // TODO replace strrev call by more intelligent code, not using it
-        strncpy( cigar->cigar + insert_pos, strrev( counter_buf ), len );
+static void * reserve( void * buffer, size_t * size, size_t needed ) {
+    if( needed > *size ) {
+        free( buffer );
+        buffer = xmalloc( needed );
+        *size = needed;
     }
+    return buffer;
 }
 
-cigar_p reverse_cigar( cigar_p rev_cigar ) {
-    /*
-     * TODO might be better to use a realloc and reverse the cigar string in
-     * place. This could possibly save a lot of memory movements.
-     */
-    cigar_p cigar = xmalloc( sizeof(cigar_t) );
-    cigar->len = rev_cigar->len;
-    cigar->allocated_size = cigar->len + 1;
-
-    cigar->cigar = xmalloc( cigar->allocated_size * sizeof(char) );
+static void * release( void * buffer, size_t * size ) {
+    if( *size > CIGAR_WORKSPACE_MAX ) {
+        free( buffer );
+        buffer = 0;
+        *size = 0;
+    }
+    return buffer;
+}
 
-    size_t cur_pos = 0;
-    while( rev_cigar->len > 0 ) {
-        cigar->cigar[cur_pos] = rev_cigar->cigar[--rev_cigar->len];
+void cigar_release_workspace() {
+    pthread_once( &workspace_once, create_workspace_key );
 
-        cur_pos++;
+    cigar_workspace_t * ws = pthread_getspecific( workspace_key );
+    if( ws ) {
+        ws->directions = release( ws->directions, &ws->directions_size );
+        ws->hearray = release( ws->hearray, &ws->hearray_size );
+        ws->ops = release( ws->ops, &ws->ops_size );
     }
-    cigar->cigar[cur_pos] = 0;
-
-    return cigar;
 }
 
-cigar_p compute_cigar_string( int search_type, sequence_t a_seq, sequence_t b_seq, region_t region ) {
-    /*
-     * cigar operation characters:
-     *
-     * 'M': alignment match (can be a sequence match or mismatch
-     * 'I': insertion to the reference
-     * 'D': deletion from the reference
-     * 'N': skipped region from the reference
-     * 'S': soft clipping (clipped sequences present in SEQ)
-     * 'H': hard clipping (clipped sequences NOT present in SEQ)
-     * 'P': padding (silent deletion from padded reference)
-     * '=': sequence match
-     * 'X': sequence mismatch
-     *
-     * TODO at the moment are only 'M', 'I' and 'D' implemented.
-     *  Do we need the rest as well?
-     */
-
-    cigar_p rev_cigar = xmalloc( sizeof(cigar_t) );
-    rev_cigar->allocated_size = CIGAR_ALLOC_STEP_SIZE;
-    rev_cigar->len = 0;
-    rev_cigar->cigar = xmalloc( rev_cigar->allocated_size * sizeof(char) );
-
-    uint8_t * directions = 0;
-    if( search_type == SMITH_WATERMAN ) {
-        directions = compute_directions_for_sw( a_seq, b_seq );
-    }
-    else if( search_type == NEEDLEMAN_WUNSCH ) {
-        directions = compute_directions_for_nw( a_seq, b_seq );
+/*
+ * Follows the directions from the end of region to its start. The directions
+ * of cell (i, j) are at stride * j + i + offset.
+ */
+static packed_cigar_t traceback( cigar_workspace_t * ws, sequence_t a_seq, sequence_t b_seq, region_t region,
+        size_t stride, size_t offset ) {
+    // every step of the traceback consumes a symbol of at least one sequence
+    size_t max_ops = 1;
+    if( (region.a_end + 1 > 0) && (region.a_end >= region.a_begin) ) {
+        max_ops += region.a_end - region.a_begin + 1;
     }
-    else {
-        fatal( "\nUnknown search type: %d\n\n", search_type  );
+    if( (region.b_end + 1 > 0) && (region.b_end >= region.b_begin) ) {
+        max_ops += region.b_end - region.b_begin + 1;
     }
+    ws->ops = reserve( ws->ops, &ws->ops_size, max_ops * sizeof(uint32_t) );
+
+    uint32_t * end = ws->ops + max_ops;
+    uint32_t * op = end;
+
+    packed_cigar_t cigar;
+    cigar.matches = 0;
+    cigar.mismatches = 0;
+    cigar.gap_opens = 0;
+    cigar.columns = 0;
 
     size_t i = region.a_end;
     size_t j = region.b_end;
 
-    char prev_op = 0, op = 0;
-    size_t op_count = 0;
-
     while( (i + 1 > 0) && (j + 1 > 0) && (i >= region.a_begin) && (j >= region.b_begin) ) {
-        uint8_t d = directions[a_seq.len * j + i];
+        uint8_t d = ws->directions[stride * j + i + offset];
+        uint32_t next;
 
         /*
          * Follows a gap to the end, before following a match or mismatch
          */
         if( (d & MASK_GAP_LEFT) || (d & MASK_GAP_EXT_LEFT) ) {
             j--;
-            op = 'I';
+            next = CIGAR_OP_I;
         }
         else if( (d & MASK_GAP_UP) || (d & MASK_GAP_EXT_UP) ) {
             i--;
-            op = 'D';
+            next = CIGAR_OP_D;
         }
         else {
+            if( a_seq.seq[i] == b_seq.seq[j] ) {
+                next = CIGAR_OP_EQ;
+                cigar.matches++;
+            }
+            else {
+                next = CIGAR_OP_X;
+                cigar.mismatches++;
+            }
             i--;
             j--;
-            op = 'M';
         }
 
-        if( op == prev_op ) {
-            op_count++;
+        if( (op < end) && (CIGAR_OP( *op ) == next) ) {
+            *op += 1 << CIGAR_OP_SHIFT;
         }
         else {
-            add_to_cigar( prev_op, op_count, rev_cigar );
+            *--op = CIGAR_PACK( next, 1 );
 
-            prev_op = op;
-            op_count = 1;
+            if( (next == CIGAR_OP_I) || (next == CIGAR_OP_D) ) {
+                cigar.gap_opens++;
+            }
         }
+        cigar.columns++;
     }
-    add_to_cigar( prev_op, op_count, rev_cigar );
 
-    cigar_p result = reverse_cigar( rev_cigar );
+    cigar.ops = op;
+    cigar.len = end - op;
+
+    return cigar;
+}
+
+size_t cigar_split_min_cells = CIGAR_SPLIT_MIN_CELLS;
+
+/*
+ * DP matrix of a large alignment, whose tiles are filled by the thread of the
+ * alignment and by the threads calling cigar_help. Tile k of the anti-diagonal
+ * order covers the rows of row block tile_rows[k] and the columns of column
+ * block tile_cols[k]. A tile can be filled, when the tile above and the tile
+ * to the left are done.
+ */
+typedef struct split_job {
+    p_ssa_context ctx;
+    int local;
+    sequence_t a_seq;
+    sequence_t b_seq;
+    uint8_t * directions;
+    int64_t * hearray;
+
+    size_t row_blocks;
+    size_t col_blocks;
+    size_t * tile_rows;
+    size_t * tile_cols;
+    int * done;
+
+    // values leaving the last row of each row block, for each column
+    int64_t * bound_f;
+    int64_t * bound_h;
+
+    size_t next_tile;
+    size_t tile_count;
+    size_t done_count;
+
+    struct split_job * next;
+} split_job_t;
+
+// the jobs with tiles, that were not taken yet
+static split_job_t * open_jobs = 0;
+static pthread_mutex_t jobs_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void wait_for_tile( split_job_t * job, size_t row_block, size_t col_block ) {
+    while( !__atomic_load_n( &job->done[row_block * job->col_blocks + col_block], __ATOMIC_ACQUIRE ) ) {
+        sched_yield();
+    }
+}
+
+static void fill_tile( split_job_t * job, size_t k ) {
+    size_t r = job->tile_rows[k];
+    size_t c = job->tile_cols[k];
+
+    if( r ) {
+        wait_for_tile( job, r - 1, c );
+    }
+    if( c ) {
+        wait_for_tile( job, r, c - 1 );
+    }
 
-    free( rev_cigar->cigar );
-    free( rev_cigar );
+    size_t b_len = job->b_seq.len;
+    size_t first_row = r * CIGAR_TILE_SIZE;
+    size_t end_row = MIN( first_row + CIGAR_TILE_SIZE, job->a_seq.len );
+    size_t first_col = c * CIGAR_TILE_SIZE;
+    size_t end_col = MIN( first_col + CIGAR_TILE_SIZE, b_len );
 
-    if( directions )
-        free( directions );
+    int64_t * in_f = r ? job->bound_f + (r - 1) * b_len : 0;
+    int64_t * in_h = r ? job->bound_h + (r - 1) * b_len : 0;
+    int64_t * out_f = (r + 1 < job->row_blocks) ? job->bound_f + r * b_len : 0;
+    int64_t * out_h = (r + 1 < job->row_blocks) ? job->bound_h + r * b_len : 0;
 
-    return result;
+    // the scores and gap penalties are those of the context of the alignment
+    p_ssa_context prev = ctx_enter( job->ctx );
+    fill_directions( job->local, job->a_seq, job->b_seq, first_row, end_row, first_col, end_col, job->directions,
+            job->hearray, in_f, in_h, out_f, out_h );
+    ctx_leave( prev );
+
+    __atomic_store_n( &job->done[r * job->col_blocks + c], 1, __ATOMIC_RELEASE );
+
+    // the last access of a helper, the job is freed after all tiles are done
+    __atomic_add_fetch( &job->done_count, 1, __ATOMIC_RELEASE );
+}
+
+/*
+ * Takes the next tile of an open job and removes the job from the open jobs,
+ * if it was its last tile.
+ *
+ * @return 1 if a tile was taken
+ */
+static int take_tile( split_job_t * job, split_job_t ** taken, size_t * k ) {
+    pthread_mutex_lock( &jobs_mutex );
+
+    if( !job ) {
+        job = open_jobs;
+    }
+    else if( job->next_tile == job->tile_count ) {
+        job = 0;
+    }
+
+    if( job ) {
+        *k = job->next_tile++;
+        *taken = job;
+
+        if( job->next_tile == job->tile_count ) {
+            split_job_t ** p = &open_jobs;
+            while( *p != job ) {
+                p = &(*p)->next;
+            }
+            __atomic_store_n( p, job->next, __ATOMIC_RELAXED );
+        }
+    }
+
+    pthread_mutex_unlock( &jobs_mutex );
+
+    return job != 0;
+}
+
+int cigar_help() {
+    // without a lock, a job published meanwhile is found by the next call
+    if( !__atomic_load_n( &open_jobs, __ATOMIC_RELAXED ) ) {
+        return 0;
+    }
+
+    split_job_t * job;
+    size_t k;
+    if( !take_tile( 0, &job, &k ) ) {
+        return 0;
+    }
+
+    fill_tile( job, k );
+
+    return 1;
+}
+
+/*
+ * Fills the directions of a large matrix tile by tile, in the order of the
+ * anti-diagonals of the tiles, so that the threads calling cigar_help can fill
+ * the tiles of an anti-diagonal at the same time. The directions are the same
+ * as with a single call of fill_directions.
+ */
+static void fill_directions_split( int local, sequence_t a_seq, sequence_t b_seq, uint8_t * directions,
+        int64_t * hearray ) {
+    split_job_t job;
+    job.ctx = ctx_current;
+    job.local = local;
+    job.a_seq = a_seq;
+    job.b_seq = b_seq;
+    job.directions = directions;
+    job.hearray = hearray;
+    job.row_blocks = (a_seq.len + CIGAR_TILE_SIZE - 1) / CIGAR_TILE_SIZE;
+    job.col_blocks = (b_seq.len + CIGAR_TILE_SIZE - 1) / CIGAR_TILE_SIZE;
+    job.tile_count = job.row_blocks * job.col_blocks;
+    job.next_tile = 0;
+    job.done_count = 0;
+
+    job.tile_rows = xmalloc( job.tile_count * sizeof(size_t) );
+    job.tile_cols = xmalloc( job.tile_count * sizeof(size_t) );
+    job.done = xmalloc( job.tile_count * sizeof(int) );
+    memset( job.done, 0, job.tile_count * sizeof(int) );
+    job.bound_f = xmalloc( job.row_blocks * b_seq.len * sizeof(int64_t) );
+    job.bound_h = xmalloc( job.row_blocks * b_seq.len * sizeof(int64_t) );
+
+    size_t k = 0;
+    for( size_t d = 0; d < job.row_blocks + job.col_blocks - 1; d++ ) {
+        for( size_t r = (d < job.col_blocks) ? 0 : d - job.col_blocks + 1; (r < job.row_blocks) && (r <= d); r++ ) {
+            job.tile_rows[k] = r;
+            job.tile_cols[k] = d - r;
+            k++;
+        }
+    }
+
+    pthread_mutex_lock( &jobs_mutex );
+    job.next = open_jobs;
+    __atomic_store_n( &open_jobs, &job, __ATOMIC_RELAXED );
+    pthread_mutex_unlock( &jobs_mutex );
+
+    split_job_t * taken;
+    while( take_tile( &job, &taken, &k ) ) {
+        fill_tile( &job, k );
+    }
+
+    while( __atomic_load_n( &job.done_count, __ATOMIC_ACQUIRE ) != job.tile_count ) {
+        sched_yield();
+    }
+
+    free( job.tile_rows );
+    free( job.tile_cols );
+    free( job.done );
+    free( job.bound_f );
+    free( job.bound_h );
+}
+
+packed_cigar_t compute_packed_cigar( int search_type, sequence_t a_seq, sequence_t b_seq, region_t region ) {
+    if( (search_type != SMITH_WATERMAN) && (search_type != NEEDLEMAN_WUNSCH) ) {
+        fatal( "\nUnknown search type: %d\n\n", search_type );
+    }
+    int local = (search_type == SMITH_WATERMAN);
+
+    cigar_workspace_t * ws = get_workspace();
+
+    ws->directions = reserve( ws->directions, &ws->directions_size, a_seq.len * b_seq.len + 1 );
+    ws->hearray = reserve( ws->hearray, &ws->hearray_size, (2 * a_seq.len + 1) * sizeof(int64_t) );
+
+    init_hearray( local, a_seq, ws->hearray );
+
+    if( a_seq.len && b_seq.len && (a_seq.len * b_seq.len >= cigar_split_min_cells) ) {
+        fill_directions_split( local, a_seq, b_seq, ws->directions, ws->hearray );
+    }
+    else {
+        fill_directions( local, a_seq, b_seq, 0, a_seq.len, 0, b_seq.len, ws->directions, ws->hearray, 0, 0, 0, 0 );
+    }
+
+    return traceback( ws, a_seq, b_seq, region, a_seq.len, 0 );
+}
+
+packed_cigar_t compute_banded_packed_cigar( sequence_t a_seq, sequence_t b_seq, long lo, long hi, int64_t * score ) {
+    cigar_workspace_t * ws = get_workspace();
+
+    ws->directions = reserve( ws->directions, &ws->directions_size, (hi - lo + 1) * b_seq.len + 1 );
+    ws->hearray = reserve( ws->hearray, &ws->hearray_size, (2 * a_seq.len + 1) * sizeof(int64_t) );
+
+    *score = compute_directions_for_banded_nw( a_seq, b_seq, lo, hi, ws->directions, ws->hearray );
+
+    return traceback( ws, a_seq, b_seq, init_region_for_global( a_seq, b_seq ), hi - lo, hi );
+}
+
+static const char cigar_symbols[] = "MIDNSHP=X";
+
+/*
+ * Returns the length of the run of operations starting at ops[*k] and moves k
+ * behind it. Without extended operations, runs of '=' and 'X' are merged into
+ * a single 'M'.
+ */
+static size_t next_run( packed_cigar_t cigar, int extended, size_t * k, char * symbol ) {
+    uint32_t op = CIGAR_OP( cigar.ops[*k] );
+    size_t len = CIGAR_LEN( cigar.ops[*k] );
+    (*k)++;
+
+    if( extended || ((op != CIGAR_OP_EQ) && (op != CIGAR_OP_X)) ) {
+        *symbol = cigar_symbols[op];
+        return len;
+    }
+
+    while( (*k < cigar.len)
+            && ((CIGAR_OP( cigar.ops[*k] ) == CIGAR_OP_EQ) || (CIGAR_OP( cigar.ops[*k] ) == CIGAR_OP_X)) ) {
+        len += CIGAR_LEN( cigar.ops[*k] );
+        (*k)++;
+    }
+
+    *symbol = 'M';
+    return len;
+}
+
+static size_t count_digits( size_t n ) {
+    size_t digits = 1;
+    while( n >= 10 ) {
+        n /= 10;
+        digits++;
+    }
+    return digits;
+}
+
+char * cigar_to_string( packed_cigar_t cigar, int extended, size_t * len ) {
+    char symbol;
+
+    size_t text_len = 0;
+    for( size_t k = 0; k < cigar.len; ) {
+        size_t run = next_run( cigar, extended, &k, &symbol );
+        text_len += (run > 1 ? count_digits( run ) : 0) + 1;
+    }
+
+    char * text = xmalloc( text_len + 1 );
+    char * p = text;
+
+    for( size_t k = 0; k < cigar.len; ) {
+        size_t run = next_run( cigar, extended, &k, &symbol );
+
+        if( run > 1 ) {
+            size_t digits = count_digits( run );
+            for( size_t d = digits; d > 0; d-- ) {
+                p[d - 1] = '0' + (run % 10);
+                run /= 10;
+            }
+            p += digits;
+        }
+        *p++ = symbol;
+    }
+    *p = 0;
+
+    if( len ) {
+        *len = text_len;
+    }
+
+    return text;
+}
+
+cigar_p compute_cigar_string( int search_type, sequence_t a_seq, sequence_t b_seq, region_t region ) {
+    packed_cigar_t packed = compute_packed_cigar( search_type, a_seq, b_seq, region );
+
+    cigar_p cigar = xmalloc( sizeof(cigar_t) );
+    cigar->cigar = cigar_to_string( packed, 0, &cigar->len );
+    cigar->allocated_size = cigar->len + 1;
+
+    return cigar;
 }
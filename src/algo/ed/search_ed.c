@@ -0,0 +1,240 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#include "search_ed.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "../../db_adapter.h"
+#include "../../context.h"
+#include "../../cpu_config.h"
+#include "../../matrices.h"
+#include "../../util/util.h"
+#include "../searcher.h"
+
+#define HIGH_BIT (ED_WORD_SIZE - 1)
+
+// number of columns between the checks, if a sequence can still enter the results
+#define ED_CHECK_INTERVAL 64
+
+void ed_init_query( ed_query_t * q, sequence_t * qseq ) {
+    q->len = qseq->len;
+    q->words = (qseq->len + ED_WORD_SIZE - 1) / ED_WORD_SIZE;
+    q->last_row = q->len ? (q->len - 1) % ED_WORD_SIZE : 0;
+
+    size_t size = SCORE_MATRIX_DIM * q->words * sizeof(uint64_t);
+    q->peq = xmalloc( size ? size : sizeof(uint64_t) );
+    memset( q->peq, 0, size );
+
+    for( size_t i = 0; i < q->len; i++ ) {
+        uint8_t c = qseq->seq[i];
+        q->peq[c * q->words + i / ED_WORD_SIZE] |= (uint64_t) 1 << (i % ED_WORD_SIZE);
+    }
+}
+
+void ed_free_query( ed_query_t * q ) {
+    free( q->peq );
+    q->peq = 0;
+}
+
+/*
+ * Computes the next column of a block of 64 rows.
+ *
+ * pv, mv:  positive and negative vertical deltas of the rows, updated
+ * eq:      rows, whose query symbol is the symbol of the column
+ * hin:     horizontal delta above the block, -1, 0 or 1
+ * out_row: row, whose horizontal delta is returned
+ */
+static inline int advance_block( uint64_t * pv, uint64_t * mv, uint64_t eq, int hin, int out_row ) {
+    uint64_t hin_neg = (hin < 0);
+    uint64_t hin_pos = (hin > 0);
+
+    uint64_t xv = eq | *mv;
+    eq |= hin_neg;
+    uint64_t xh = (((eq & *pv) + *pv) ^ *pv) | eq;
+
+    uint64_t ph = *mv | ~(xh | *pv);
+    uint64_t mh = *pv & xh;
+
+    int hout = (int) ((ph >> out_row) & 1) - (int) ((mh >> out_row) & 1);
+
+    ph = (ph << 1) | hin_pos;
+    mh = (mh << 1) | hin_neg;
+
+    *pv = mh | ~(xv | ph);
+    *mv = ph & xv;
+
+    return hout;
+}
+
+int64_t ed_distance( ed_query_t * q, sequence_t * dseq, int mode, uint64_t * work, int64_t max_distance ) {
+    if( !q->len ) {
+        return (mode == ED_GLOBAL) ? (int64_t) dseq->len : 0;
+    }
+
+    size_t words = q->words;
+    uint64_t * pv = work;
+    uint64_t * mv = work + words;
+
+    for( size_t w = 0; w < words; w++ ) {
+        pv[w] = ~(uint64_t) 0;
+        mv[w] = 0;
+    }
+
+    // the first row is free in a semi-global alignment, in the others it grows by one per column
+    int hin_top = (mode == ED_SEMI_GLOBAL) ? 0 : 1;
+
+    // value of the last row of the current column
+    int64_t score = q->len;
+    int64_t best = score;
+
+    for( size_t j = 0; j < dseq->len; j++ ) {
+        uint64_t * eq = q->peq + (uint8_t) dseq->seq[j] * words;
+
+        int h = hin_top;
+        for( size_t w = 0; w + 1 < words; w++ ) {
+            h = advance_block( &pv[w], &mv[w], eq[w], h, HIGH_BIT );
+        }
+        score += advance_block( &pv[words - 1], &mv[words - 1], eq[words - 1], h, q->last_row );
+
+        if( score < best ) {
+            best = score;
+
+            if( !best && (mode != ED_GLOBAL) ) {
+                // the query was found without an edit
+                return 0;
+            }
+        }
+
+        if( (j % ED_CHECK_INTERVAL) == 0 ) {
+            // the last row changes by at most one per column
+            int64_t bound = score - (int64_t) (dseq->len - j - 1);
+            if( (mode != ED_GLOBAL) && (best < bound) ) {
+                bound = best;
+            }
+            if( bound > max_distance ) {
+                return bound;
+            }
+        }
+    }
+
+    return (mode == ED_GLOBAL) ? score : best;
+}
+
+typedef struct {
+    p_sdb_sequence seq;
+    size_t pos; // position in the chunk
+} sorted_seq_t;
+
+static int compare_by_length( const void * a, const void * b ) {
+    const sorted_seq_t * x = a;
+    const sorted_seq_t * y = b;
+
+    if( x->seq->seq.len != y->seq->seq.len ) {
+        return (x->seq->seq.len > y->seq->seq.len) ? -1 : 1;
+    }
+    return (x->pos < y->pos) ? -1 : 1;
+}
+
+/*
+ * Computes the distances of the sequences of the chunk with the AVX2 kernel.
+ * The sequences are ordered by length, so that the sequences in the channels
+ * of a call end at about the same column.
+ */
+static void distances_avx2( ed_query_t * q, p_db_chunk chunk, int mode, int64_t * distances ) {
+    size_t count = chunk->fill_pointer;
+
+    sorted_seq_t * sorted = xmalloc( count * sizeof(sorted_seq_t) );
+    for( size_t i = 0; i < count; i++ ) {
+        sorted[i].seq = chunk->seq[i];
+        sorted[i].pos = i;
+    }
+    qsort( sorted, count, sizeof(sorted_seq_t), compare_by_length );
+
+    for( size_t i = 0; i < count; i += ED_CHANNELS_AVX2 ) {
+        size_t n = (count - i < ED_CHANNELS_AVX2) ? (count - i) : ED_CHANNELS_AVX2;
+
+        sequence_t * dseqs[ED_CHANNELS_AVX2];
+        int64_t d[ED_CHANNELS_AVX2];
+
+        for( size_t c = 0; c < n; c++ ) {
+            dseqs[c] = &sorted[i + c].seq->seq;
+        }
+
+        ed_distance_avx2( q, dseqs, n, mode, d );
+
+        for( size_t c = 0; c < n; c++ ) {
+            distances[sorted[i + c].pos] = d[c];
+        }
+    }
+
+    free( sorted );
+}
+
+void search_ed_chunk( p_search_result res, p_db_chunk chunk, p_search_data sdp, int mode ) {
+    int64_t * distances = xmalloc( chunk->fill_pointer * sizeof(int64_t) );
+    uint64_t * work = xmalloc( 2 * ((sdp->maxqlen + ED_WORD_SIZE - 1) / ED_WORD_SIZE + 1) * sizeof(uint64_t) );
+
+    for( uint8_t q_id = 0; q_id < sdp->q_count; q_id++ ) {
+        ed_query_t q;
+        ed_init_query( &q, &sdp->queries[q_id].seq );
+
+        if( (q.words == 1) && is_avx2_enabled() ) {
+            distances_avx2( &q, chunk, mode, distances );
+        }
+        else {
+            for( size_t i = 0; i < chunk->fill_pointer; i++ ) {
+                // a hit has to score above the floor of the result to be added
+                long floor = result_score_floor( res );
+                int64_t max_distance = (floor == LONG_MIN) ? INT64_MAX : -(int64_t) floor - 1;
+
+                distances[i] = ed_distance( &q, &chunk->seq[i]->seq, mode, work, max_distance );
+            }
+        }
+
+        for( size_t i = 0; i < chunk->fill_pointer; i++ ) {
+            add_to_result( res, q_id, chunk->seq[i], -distances[i] );
+        }
+
+        ed_free_query( &q );
+    }
+
+    free( work );
+    free( distances );
+}
+
+void search_ed( p_db_chunk chunk, p_search_data sdp, p_search_result res ) {
+    int mode = ctx_current->search.adp->search_type - EDIT_DISTANCE;
+
+    adp_next_chunk( chunk );
+
+    while( chunk->fill_pointer ) {
+        search_ed_chunk( res, chunk, sdp, mode );
+
+        res->chunk_count++;
+        res->seq_count += chunk->fill_pointer;
+
+        s_chunk_finished( res );
+
+        adp_next_chunk( chunk );
+    }
+}
@@ -0,0 +1,86 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+/*
+ * Unit cost edit distance search with the bit-vector algorithm of Myers, in
+ * the block formulation of Hyyrö, like in Edlib:
+ *
+ * G. Myers. A fast bit-vector algorithm for approximate string matching based
+ * on dynamic programming. J. ACM 46(3), 1999.
+ *
+ * The query forms the rows of the DP matrix and is packed into 64 bit words,
+ * one bit per row. A column of the matrix is computed with a few bit
+ * operations per word. Symbols are compared for identity, the scoring of the
+ * context is not used.
+ *
+ * The distance d of a hit is reported as the score -d, so that the hits with
+ * the lowest distances are kept.
+ */
+
+#ifndef SEARCH_ED_H_
+#define SEARCH_ED_H_
+
+#include <stdint.h>
+
+#include "../../libssa_datatypes.h"
+
+#define ED_WORD_SIZE 64
+
+// number of database sequences compared at once by the AVX2 kernel
+#define ED_CHANNELS_AVX2 4
+
+/** @typedef    bit masks of the positions of each symbol in a query
+ *
+ * @field peq       word w of the mask of symbol c at peq[c * words + w]
+ * @field words     number of 64 bit words per symbol
+ * @field last_row  position of the last row of the query in its last word
+ */
+typedef struct {
+    uint64_t * peq;
+    size_t words;
+    size_t len;
+    int last_row;
+} ed_query_t;
+
+void ed_init_query( ed_query_t * q, sequence_t * qseq );
+
+void ed_free_query( ed_query_t * q );
+
+/**
+ * Computes the edit distance of a database sequence and a query.
+ *
+ * @param mode  ED_GLOBAL, ED_SEMI_GLOBAL or ED_PREFIX
+ * @param work  2 * q->words words used for the vertical deltas
+ * @param max_distance  the computation stops early, if the distance is
+ *                      certainly above it
+ * @return the distance, or a lower bound above max_distance
+ */
+int64_t ed_distance( ed_query_t * q, sequence_t * dseq, int mode, uint64_t * work, int64_t max_distance );
+
+/**
+ * Computes the edit distances of up to ED_CHANNELS_AVX2 database sequences and
+ * a query of at most ED_WORD_SIZE symbols.
+ */
+void ed_distance_avx2( ed_query_t * q, sequence_t ** dseqs, size_t count, int mode, int64_t * distances );
+
+void search_ed_chunk( p_search_result res, p_db_chunk chunk, p_search_data sdp, int mode );
+
+void search_ed( p_db_chunk chunk, p_search_data sdp, p_search_result res );
+
+#endif /* SEARCH_ED_H_ */
@@ -0,0 +1,7 @@
+OBJS += \
+./src/algo/ed/search_ed.o
+
+USER_OBJS += \
+./src/algo/ed/search_ed.h
+
+TO_CLEAN +=
\ No newline at end of file
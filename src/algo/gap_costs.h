@@ -22,8 +22,10 @@
 
 #include <stdint.h>
 
-// both are filled in libssa.c
-extern int8_t gapO;
-extern int8_t gapE;
+#include "../context.h"
+
+// both are set in the current context
+#define gapO (ctx_current->gap_open)
+#define gapE (ctx_current->gap_extend)
 
 #endif /* GAP_COSTS_H_ */
@@ -0,0 +1,225 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+
+/*
+ * Implements the delivery of the hits of a streaming search.
+ *
+ * Every thread of the search gets its own ring buffer. The thread is the only
+ * writer of the head and the calling thread the only writer of the tail, so
+ * that the buffers need no locks. A hit with a score of at least min_score is
+ * passed on as soon as the search algorithm reports it.
+ */
+
+#define _POSIX_C_SOURCE 199309L // nanosleep
+
+#include "hit_stream.h"
+
+#include <stdlib.h>
+#include <limits.h>
+#include <sched.h>
+#include <time.h>
+
+#include "../context.h"
+#include "../db_dedup.h"
+#include "../util/util.h"
+#include "../util/thread_pool.h"
+
+// number of hits of a ring buffer, has to be a power of two
+#define HS_RING_SIZE 1024
+
+// time the calling thread sleeps, if no ring buffer held a hit
+#define HS_IDLE_NANOSECONDS 50000
+
+typedef struct {
+    p_hit_stream stream;
+    ssa_hit_t * slots;
+
+    size_t head;
+    size_t tail;
+} hit_ring_t;
+
+struct hit_stream {
+    long min_score;
+    int delivery;
+    ssa_hit_callback callback;
+    void * data;
+
+    // the kernels skip channels and sequences, that cannot score above it
+    long floor;
+
+    p_search_data sdp;
+    p_dedup_index dedup;
+    size_t range_end;
+
+    hit_ring_t * rings;
+    size_t ring_count;
+    size_t attached;
+};
+
+p_hit_stream hs_create( long min_score, int delivery, ssa_hit_callback callback, void * data,
+        size_t thread_count ) {
+    p_hit_stream stream = xmalloc( sizeof(struct hit_stream) );
+
+    stream->min_score = min_score;
+    stream->delivery = delivery;
+    stream->callback = callback;
+    stream->data = data;
+    stream->floor = (min_score == LONG_MIN) ? LONG_MIN : min_score - 1;
+
+    stream->sdp = ctx_current->search.sdp;
+    stream->dedup = ctx_current->search.dedup_active;
+    stream->range_end = ctx_db_range_end();
+
+    stream->rings = xmalloc( thread_count * sizeof(hit_ring_t) );
+    stream->ring_count = thread_count;
+    stream->attached = 0;
+
+    for( size_t i = 0; i < thread_count; i++ ) {
+        stream->rings[i].stream = stream;
+        stream->rings[i].slots = 0;
+        if( delivery == STREAM_FROM_CALLER ) {
+            stream->rings[i].slots = xmalloc( HS_RING_SIZE * sizeof(ssa_hit_t) );
+        }
+        stream->rings[i].head = 0;
+        stream->rings[i].tail = 0;
+    }
+
+    return stream;
+}
+
+void hs_free( p_hit_stream stream ) {
+    if( !stream ) {
+        return;
+    }
+
+    for( size_t i = 0; i < stream->ring_count; i++ ) {
+        free( stream->rings[i].slots );
+    }
+    free( stream->rings );
+    free( stream );
+}
+
+static void push_hit( hit_ring_t * ring, const ssa_hit_t * hit ) {
+    p_hit_stream stream = ring->stream;
+
+    if( stream->delivery == STREAM_FROM_WORKERS ) {
+        stream->callback( hit, stream->data );
+        return;
+    }
+
+    size_t head = ring->head;
+
+    // wait for the calling thread to make room
+    while( head - __atomic_load_n( &ring->tail, __ATOMIC_ACQUIRE ) == HS_RING_SIZE ) {
+        sched_yield();
+    }
+
+    ring->slots[head & (HS_RING_SIZE - 1)] = *hit;
+    __atomic_store_n( &ring->head, head + 1, __ATOMIC_RELEASE );
+}
+
+static void add_stream_hit( p_search_result res, uint8_t query_id, p_sdb_sequence db_seq, long score ) {
+    hit_ring_t * ring = res->hit_data;
+    p_hit_stream stream = ring->stream;
+
+    if( score < stream->min_score ) {
+        return;
+    }
+
+    seq_buffer_t query = stream->sdp->queries[query_id];
+
+    ssa_hit_t hit;
+    hit.db_id = db_seq->ID;
+    hit.score = score;
+    hit.db_strand = db_seq->strand;
+    hit.db_frame = db_seq->frame;
+    hit.query_strand = query.strand;
+    hit.query_frame = query.frame;
+
+    push_hit( ring, &hit );
+
+    if( !stream->dedup ) {
+        return;
+    }
+
+    // the hit counts for all identical sequences
+    for( size_t id = stream->dedup->next[db_seq->ID]; (id != DD_NO_MEMBER) && (id < stream->range_end);
+            id = stream->dedup->next[id] ) {
+        hit.db_id = id;
+        push_hit( ring, &hit );
+    }
+}
+
+void hs_attach( p_hit_stream stream, p_search_result res ) {
+    size_t idx = __atomic_fetch_add( &stream->attached, 1, __ATOMIC_RELAXED );
+    if( idx >= stream->ring_count ) {
+        fatal( "More threads than ring buffers in the streaming search." );
+    }
+
+    res->add_hit = &add_stream_hit;
+    res->hit_data = &stream->rings[idx];
+    res->shared_floor = &stream->floor;
+}
+
+/*
+ * Passes the hits of a ring buffer to the callback.
+ *
+ * @return the number of hits
+ */
+static size_t drain_ring( hit_ring_t * ring ) {
+    p_hit_stream stream = ring->stream;
+
+    size_t tail = ring->tail;
+    size_t head = __atomic_load_n( &ring->head, __ATOMIC_ACQUIRE );
+
+    for( size_t i = tail; i < head; i++ ) {
+        stream->callback( &ring->slots[i & (HS_RING_SIZE - 1)], stream->data );
+    }
+
+    __atomic_store_n( &ring->tail, head, __ATOMIC_RELEASE );
+
+    return head - tail;
+}
+
+void hs_deliver( p_hit_stream stream ) {
+    if( stream->delivery != STREAM_FROM_CALLER ) {
+        return;
+    }
+
+    struct timespec idle = { 0, HS_IDLE_NANOSECONDS };
+
+    while( 1 ) {
+        // checked before draining, so that the last hits of finished threads are not missed
+        int running = count_running_threads() > 0;
+
+        size_t drained = 0;
+        for( size_t i = 0; i < stream->ring_count; i++ ) {
+            drained += drain_ring( &stream->rings[i] );
+        }
+
+        if( !running ) {
+            break;
+        }
+
+        if( !drained ) {
+            nanosleep( &idle, NULL );
+        }
+    }
+}
@@ -0,0 +1,62 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+
+/*
+ * State of a streaming search, that passes its hits to a callback instead of
+ * keeping them in a heap.
+ */
+
+#ifndef HIT_STREAM_H_
+#define HIT_STREAM_H_
+
+#include <stddef.h>
+
+#include "../libssa.h"
+#include "../libssa_datatypes.h"
+
+struct hit_stream;
+typedef struct hit_stream * p_hit_stream;
+
+/**
+ * Creates the state of a streaming search of the current context with
+ * thread_count threads. The search has to be initialised before.
+ *
+ * @param delivery  STREAM_FROM_WORKERS or STREAM_FROM_CALLER
+ */
+p_hit_stream hs_create( long min_score, int delivery, ssa_hit_callback callback, void * data,
+        size_t thread_count );
+
+void hs_free( p_hit_stream stream );
+
+/**
+ * Makes the search result of a thread pass its hits to the stream. Called
+ * once by each thread of the search.
+ */
+void hs_attach( p_hit_stream stream, p_search_result res );
+
+/**
+ * Called by the thread, that started the threads of the search. With
+ * STREAM_FROM_CALLER the hits of the ring buffers of the threads are passed
+ * to the callback, until all threads are finished and the buffers are empty.
+ * Otherwise it returns immediately.
+ */
+void hs_deliver( p_hit_stream stream );
+
+#endif /* HIT_STREAM_H_ */
@@ -22,28 +22,32 @@
 #include <stdlib.h>
 #include <pthread.h>
 #include <math.h>
+#include <limits.h>
 
 #include <assert.h>
 
 #include "../db_adapter.h"
+#include "../db_dedup.h"
+#include "../kmer_index.h"
 #include "../util/minheap.h"
 #include "../util/thread_pool.h"
 #include "../util/util.h"
+#include "../util/util_sequence.h"
 #include "../libssa_datatypes.h"
 #include "aligner.h"
+#include "align_stats.h"
+#include "hit_stream.h"
+#include "result_table.h"
 #include "searcher.h"
-
-#define MNGR_NOT_INITIALIZED -1
-
-static int align_type = MNGR_NOT_INITIALIZED;
-
-size_t max_chunk_size = DEFAULT_CHUNK_SIZE;
+#include "ungapped_filter.h"
 
 static void init( p_query query, int search_type, int bit_width, int al_type ) {
-    align_type = al_type;
+    ctx_current->align_type = al_type;
 
     s_init( search_type, bit_width, query );
 
+    ctx_start_budget();
+
     a_init_data( search_type );
 
     adp_init( max_chunk_size );
@@ -53,7 +57,7 @@ static void init( p_query query, int search_type, int bit_width, int al_type ) {
     sprintf( desc,"%d_bit_type_%d", bit_width, search_type );
 
     // TODO works only for non translated sequences
-    dbg_init_aligned_sequence_collecting( desc, ssa_db_get_sequence_count() );
+    dbg_init_aligned_sequence_collecting( desc, ctx_db_get_sequence_count() );
 #endif
 }
 
@@ -65,83 +69,157 @@ void init_for_nw( p_query query, int bit_width, int align_type ) {
     init( query, NEEDLEMAN_WUNSCH, bit_width, align_type );
 }
 
-static int alignment_compare( const void * a, const void * b ) {
-    p_alignment * x = (p_alignment *) a;
-    p_alignment * y = (p_alignment *) b;
-
-    int cmp = CMP_ASC( (*x)->score, (*y)->score );
-    if( !cmp ) {
-        cmp = CMP_ASC( (*x)->db_seq.ID, (*y)->db_seq.ID );
-    }
-    return cmp;
-}
-
-static void sort_alignment_list( p_alignment_list alist ) {
-    qsort( alist->alignments, alist->len, sizeof(p_alignment), alignment_compare );
+void init_for_ed( p_query query, int mode ) {
+    init( query, EDIT_DISTANCE + mode, BIT_WIDTH_64, COMPUTE_SCORE );
 }
 
+/*
+ * Creates the alignments of the sorted hits. The alignments keep the order of
+ * the hits.
+ */
 static p_alignment_list do_align( p_minheap search_results ) {
     p_alignment_list alist = xmalloc( sizeof(alignment_list_t) );
     alist->alignments = xmalloc( search_results->count * sizeof(alignment_t) );
     alist->len = search_results->count;
+    alist->partial = 0;
 
-    if( align_type == COMPUTE_SCORE ) {
+    if( ctx_current->align_type == COMPUTE_SCORE ) {
         create_score_alignment_list( search_results, alist );
     }
+    else if( ctx_current->align_type == COMPUTE_STATISTICS ) {
+        create_score_alignment_list( search_results, alist );
+
+        st_compute_parallel( ctx_current->search.adp->search_type, alist->alignments, alist->len );
+    }
     else {
         a_set_alignment_pairs( search_results->count, search_results->array );
 
         start_threads( a_align, NULL );
 
-        p_alignment_list align_result_list[get_current_thread_count()];
+        void * results[get_current_thread_count()];
+        wait_for_threads( results );
 
-        wait_for_threads( (void **) &align_result_list );
+        // a cancelled alignment phase leaves gaps, which are closed
+        p_alignment * alignments = a_get_alignments();
 
-        int alist_ptr = 0;
-        for( size_t i = 0; i < get_current_thread_count(); i++ ) {
-            for( size_t j = 0; j < align_result_list[i]->len; j++ ) {
-                alist->alignments[alist_ptr++] = align_result_list[i]->alignments[j];
+        size_t len = 0;
+        for( size_t i = 0; i < search_results->count; i++ ) {
+            if( alignments[i] ) {
+                alist->alignments[len++] = alignments[i];
             }
-
-            free( align_result_list[i]->alignments );
-            free( align_result_list[i] );
         }
+        alist->len = len;
     }
-    sort_alignment_list( alist );
 
     return alist;
 }
 
 /**
- * Run a search for query in the database. Aligns the query sequence against
- * each sequence in the DB and returns 'hit_count' alignments. The search is
- * configured through set bits in 'flags'.
+ * Releases the state of a search, whose hits are not aligned: a cancelled
+ * search, or a search, that does not keep hits.
  */
-p_alignment_list m_run( size_t hit_count ) {
-    assert( align_type != MNGR_NOT_INITIALIZED );
+static void release_search( p_search_result * search_result_list, size_t thread_count ) {
+    ctx_current->search.dedup_active = 0;
+    adp_free_candidates();
+    adp_exit();
+    a_free_data();
+    for( size_t i = 0; i < thread_count; i++ ) {
+        s_free( search_result_list[i] );
+    }
+}
+
+/*
+ * Selects the sequences, that share the most k-mers with the query, if the
+ * k-mer prefilter is enabled.
+ */
+static void run_kmer_prefilter() {
+    if( !ctx_current->prefilter_min_shared && !ctx_current->prefilter_max_candidates ) {
+        return;
+    }
+
+    if( (symtype != NUCLEOTIDE) && (symtype != AMINOACID) ) {
+        print_warning( "The k-mer prefilter does not support translated searches. Searching all sequences.\n" );
+        return;
+    }
+
+    ki_select_candidates( ki_get_index(), ctx_current->search.sdp, ctx_current->prefilter_min_shared,
+            ctx_current->prefilter_max_candidates );
+}
+
+/*
+ * Runs the enabled prefilters. The ungapped prefilter ranks the candidates of
+ * the k-mer prefilter.
+ */
+static void run_prefilter() {
+    run_kmer_prefilter();
+
+    if( (ctx_current->ungapped_min_score >= 0) || ctx_current->ungapped_max_candidates ) {
+        uf_select_candidates( ctx_current->ungapped_min_score, ctx_current->ungapped_max_candidates );
+    }
+}
+
+/*
+ * Searches the database and returns the best hits, sorted by score. The
+ * alignment data of the search is kept for the hits and has to be released
+ * with a_free_data.
+ *
+ * Returns 0, if the search was cancelled.
+ */
+static p_minheap collect_hits( size_t hit_count ) {
+    assert( ctx_current->align_type != MNGR_NOT_INITIALIZED );
 
     init_thread_pool();
 
+    // only one of each group of identical sequences is searched
+    ctx_current->search.dedup_active = ctx_current->deduplicate ? dd_get_index() : 0;
+
+    run_prefilter();
+
+    adp_init_bound_pruning();
+
+    ctx_current->search.score_floor = LONG_MIN;
+
+    s_init_progress( get_current_thread_count(), hit_count );
+
     start_threads( s_search, &hit_count );
 
-    p_search_result search_result_list[max_thread_count];
+    p_search_result search_result_list[get_current_thread_count()];
 
     size_t chunks_processed = 0;
     size_t db_sequences_processed = 0;
 
-    wait_for_threads( (void **) &search_result_list );
+    size_t thread_count = wait_for_threads( (void **) &search_result_list );
+
+    s_free_progress();
 
 #ifdef DBG_COLLECT_ALIGNED_DB_SEQUENCES
     dbg_print_aligned_sequences();
 #endif
 
+    if( ctx_is_cancelled() ) {
+        release_search( search_result_list, thread_count );
+        return 0;
+    }
+
     size_t overflow_8_bit_count = 0;
     size_t overflow_16_bit_count = 0;
 
+    p_dedup_index dedup = ctx_current->search.dedup_active;
+    size_t range_end = ctx_db_range_end();
+
     p_minheap search_results = minheap_init( hit_count );
-    for( size_t i = 0; i < get_current_thread_count(); i++ ) {
+
+    // the hits of a previous search come first, so they win ties like older hits in a full search
+    if( ctx_current->search.seed_hits ) {
+        for( size_t j = 0; j < ctx_current->search.seed_hits->count; j++ ) {
+            minheap_add( search_results, &ctx_current->search.seed_hits->array[j] );
+        }
+    }
+
+    for( size_t i = 0; i < thread_count; i++ ) {
         for( size_t j = 0; j < search_result_list[i]->heap->count; j++ ) {
-            minheap_add( search_results, &search_result_list[i]->heap->array[j] );
+            // the hits of the searched sequences count for all identical sequences
+            dd_add_hit( dedup, search_results, &search_result_list[i]->heap->array[j], range_end );
         }
 
         print_info( "Thread %ld - Processed chunks: %ld and sequences: %ld\n", i, search_result_list[i]->chunk_count,
@@ -158,28 +236,337 @@ p_alignment_list m_run( size_t hit_count ) {
         print_info( "Overflow occurred: %ld sequences were re-aligned with 16 bit, and %ld sequences with 64 bit\n",
                 overflow_8_bit_count, overflow_16_bit_count );
     }
+    if( ctx_current->band_fallbacks ) {
+        print_info( "Band too narrow for %ld sequences, they were aligned with the full matrix\n",
+                ctx_current->band_fallbacks );
+    }
+
+    int partial = ctx_current->search.budget_exceeded;
+    if( partial ) {
+        print_info( "Search budget exceeded after %ld chunks\n", chunks_processed );
+    }
+
+    // the threads count every strand and frame of a sequence
+    db_sequences_processed /= ctx_current->buffer_max;
 
-    size_t sequence_count = ssa_db_get_sequence_count();
-    if( sequence_count != db_sequences_processed ) {
+    // only the sequences of the searched ID range are processed, of identical sequences only one
+    size_t sequence_count = adp_count_searched( ctx_db_range_start(), ctx_search_end() );
+    size_t pruned = ctx_current->pruned_sequences;
+    if( pruned ) {
+        print_info( "Bound pruning skipped %ld sequences\n", pruned );
+    }
+
+    if( !partial && (sequence_count != db_sequences_processed + pruned) ) {
         print_warning( "# Number of processed sequences differs! Expected: %ld - Actual: %ld\n", sequence_count,
                 db_sequences_processed );
     }
-    if( ceil( ssa_db_get_sequence_count() / (double) max_chunk_size ) != chunks_processed ) {
+    // chunks without searched sequences are skipped, if identical or pruned sequences are left out
+    if( !partial && !dedup && !pruned && (ceil( sequence_count / (double) max_chunk_size ) != chunks_processed) ) {
         print_warning( "# Number of chunks differs! Expected: %ld - Actual: %ld\n",
-                ceil( ssa_db_get_sequence_count() / (double) max_chunk_size ), chunks_processed );
+                ceil( sequence_count / (double) max_chunk_size ), chunks_processed );
     }
 
     minheap_sort( search_results );
     adp_exit();
+    ctx_current->search.dedup_active = 0;
+    adp_free_candidates();
 
-    p_alignment_list alist = do_align( search_results );
+    for( size_t i = 0; i < thread_count; i++ ) {
+        s_free( search_result_list[i] );
+    }
 
-    minheap_exit( search_results );
+    return search_results;
+}
+
+/*
+ * Searches the database and computes the alignments of the best hits.
+ */
+static p_alignment_list run_search( size_t hit_count ) {
+    p_minheap hits = collect_hits( hit_count );
+    if( !hits ) {
+        return 0;
+    }
+
+    p_alignment_list alist = do_align( hits );
+    alist->partial = ctx_current->search.budget_exceeded;
+
+    minheap_exit( hits );
 
     a_free_data();
-    for( size_t i = 0; i < max_thread_count; i++ ) {
-        s_free( search_result_list[i] );
+
+    if( ctx_is_cancelled() ) {
+        // cancelled while computing the alignments
+        a_free( alist );
+        return 0;
     }
 
     return alist;
 }
+
+/**
+ * Run a search for query in the database. Aligns the query sequence against
+ * each sequence in the DB and returns 'hit_count' alignments. The search is
+ * configured through set bits in 'flags'.
+ *
+ * Returns 0, if the search was cancelled. If the budget of the search was
+ * used up, the best alignments found so far are returned and flagged as
+ * partial.
+ */
+p_alignment_list m_run( size_t hit_count ) {
+    // the database can not change, while it is searched
+    ctx_pin_database();
+
+    p_alignment_list alist = run_search( hit_count );
+
+    ctx_unpin_database();
+
+    return alist;
+}
+
+/*
+ * Searches the database and stores the best hits in a result table.
+ */
+static p_ssa_result_table run_table_search( size_t hit_count ) {
+    p_minheap hits = collect_hits( hit_count );
+    if( !hits ) {
+        return 0;
+    }
+
+    p_alignment_data data = ctx_current->search.adp;
+    p_ssa_result_table table = rt_create( hits, data->queries, data->q_count, data->search_type,
+            ctx_current->search.budget_exceeded );
+
+    minheap_exit( hits );
+
+    if( ctx_current->align_type == COMPUTE_ALIGNMENT ) {
+        rt_align_rows( table, 0, table->len );
+    }
+
+    a_free_data();
+
+    if( ctx_is_cancelled() ) {
+        // cancelled while computing the alignments
+        rt_free( table );
+        return 0;
+    }
+
+    return table;
+}
+
+p_ssa_result_table m_run_table( size_t hit_count ) {
+    ctx_pin_database();
+
+    p_ssa_result_table table = run_table_search( hit_count );
+
+    ctx_unpin_database();
+
+    return table;
+}
+
+/*
+ * Scores all sequences of the database. The threads write the scores directly
+ * into the array, no hits are kept.
+ */
+static int run_score_search( int32_t * scores ) {
+    assert( ctx_current->align_type != MNGR_NOT_INITIALIZED );
+
+    init_thread_pool();
+
+    ctx_current->search.dedup_active = ctx_current->deduplicate ? dd_get_index() : 0;
+
+    run_prefilter();
+
+    // without a heap there is no floor, and so nothing to prune
+    ctx_current->pruned_sequences = 0;
+
+    for( size_t i = 0; i < ctx_db_get_sequence_count(); i++ ) {
+        scores[i] = INT32_MIN;
+    }
+
+    ctx_current->search.dense_scores = scores;
+
+    size_t hit_count = 1;
+    start_threads( s_search, &hit_count );
+
+    p_search_result search_result_list[get_current_thread_count()];
+
+    size_t thread_count = wait_for_threads( (void **) &search_result_list );
+
+    ctx_current->search.dense_scores = 0;
+
+    if( ctx_is_cancelled() ) {
+        release_search( search_result_list, thread_count );
+        return 0;
+    }
+
+    if( ctx_current->search.dedup_active ) {
+        dd_copy_scores( ctx_current->search.dedup_active, scores, ctx_db_range_start(), ctx_db_range_end() );
+    }
+
+    if( ctx_current->search.budget_exceeded ) {
+        print_info( "Search budget exceeded, not all sequences were scored\n" );
+    }
+
+    release_search( search_result_list, thread_count );
+
+    return 1;
+}
+
+int m_run_scores( int32_t * scores ) {
+    ctx_pin_database();
+
+    int finished = run_score_search( scores );
+
+    ctx_unpin_database();
+
+    return finished;
+}
+
+/*
+ * Searches the database and passes the hits to the callback, while the
+ * threads are running.
+ */
+static int run_stream_search( long min_score, int delivery, ssa_hit_callback callback, void * data ) {
+    assert( ctx_current->align_type != MNGR_NOT_INITIALIZED );
+
+    init_thread_pool();
+
+    ctx_current->search.dedup_active = ctx_current->deduplicate ? dd_get_index() : 0;
+
+    run_prefilter();
+
+    // the sequences are pruned against min_score
+    adp_init_bound_pruning();
+
+    p_hit_stream stream = hs_create( min_score, delivery, callback, data, get_current_thread_count() );
+    ctx_current->search.hit_stream = stream;
+
+    size_t hit_count = 1;
+    start_threads( s_search, &hit_count );
+
+    hs_deliver( stream );
+
+    p_search_result search_result_list[get_current_thread_count()];
+
+    size_t thread_count = wait_for_threads( (void **) &search_result_list );
+
+    ctx_current->search.hit_stream = 0;
+    hs_free( stream );
+
+    if( ctx_is_cancelled() ) {
+        release_search( search_result_list, thread_count );
+        return 0;
+    }
+
+    if( ctx_current->pruned_sequences ) {
+        print_info( "Bound pruning skipped %ld sequences\n", ctx_current->pruned_sequences );
+    }
+    if( ctx_current->search.budget_exceeded ) {
+        print_info( "Search budget exceeded, not all sequences were searched\n" );
+    }
+
+    release_search( search_result_list, thread_count );
+
+    return 1;
+}
+
+int m_run_stream( long min_score, int delivery, ssa_hit_callback callback, void * data ) {
+    ctx_pin_database();
+
+    int finished = run_stream_search( min_score, delivery, callback, data );
+
+    ctx_unpin_database();
+
+    return finished;
+}
+
+/*
+ * Returns the index of the query sequence with the given strand and frame in
+ * the search data, or -1 if the current search does not use it.
+ */
+static int find_query_id( int strand, int frame ) {
+    for( int i = 0; i < s_get_query_count(); i++ ) {
+        seq_buffer_t q = s_get_query( i );
+
+        if( (q.strand == strand) && (q.frame == frame) ) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/*
+ * Converts the alignments of a previous search back into search hits. Hits of
+ * sequences at or after db_end are left out, because they are searched again.
+ */
+static p_minheap create_seed_hits( p_alignment_list previous, size_t hit_count, size_t db_end ) {
+    p_minheap seed = minheap_init( hit_count );
+
+    size_t db_count = ctx_db_get_sequence_count();
+
+    for( size_t i = 0; previous && (i < previous->len); i++ ) {
+        p_alignment a = previous->alignments[i];
+
+        int query_id = find_query_id( a->query.strand, a->query.frame );
+        if( (a->db_seq.ID >= db_count) || (query_id < 0) ) {
+            // the sequence was removed from the database or the configuration changed
+            continue;
+        }
+        if( a->db_seq.ID >= db_end ) {
+            // found by a partial search, which did not advance the high-water mark
+            continue;
+        }
+
+        elem_t e;
+        e.db_id = a->db_seq.ID;
+        // the strand of the DB sequence holds its frame and vice versa, see a_init_alignment
+        e.db_frame = a->db_seq.strand;
+        e.db_strand = a->db_seq.frame;
+        e.query_id = query_id;
+        e.score = a->score;
+
+        minheap_add( seed, &e );
+    }
+
+    return seed;
+}
+
+p_alignment_list m_run_incremental( p_query query, int search_type, int bit_width, int align_type,
+        size_t hit_count, p_alignment_list previous, size_t * db_end ) {
+    p_ssa_context ctx = ctx_current;
+
+    size_t range_start = ctx->range_start;
+    size_t range_end = ctx->range_end;
+
+    // the high-water mark has to match the searched version of the database
+    ctx_pin_database();
+
+    ctx->range_start = *db_end;
+    ctx->range_end = 0;
+
+    if( search_type == SMITH_WATERMAN ) {
+        init_for_sw( query, bit_width, align_type );
+    }
+    else {
+        init_for_nw( query, bit_width, align_type );
+    }
+
+    ctx->search.seed_hits = create_seed_hits( previous, hit_count, *db_end );
+
+    p_alignment_list alist = m_run( hit_count );
+
+    minheap_exit( ctx->search.seed_hits );
+    ctx->search.seed_hits = 0;
+
+    // the sequences skipped by an exceeded budget are searched by the next call
+    if( alist && !alist->partial ) {
+        *db_end = ctx_db_get_sequence_count();
+    }
+
+    ctx->range_start = range_start;
+    ctx->range_end = range_end;
+
+    ctx_unpin_database();
+
+    return alist;
+}
@@ -21,18 +21,77 @@
 #define MANAGER_H_
 
 #include "../libssa_datatypes.h"
+#include "../context.h"
 
-extern size_t max_chunk_size;
+#define MNGR_NOT_INITIALIZED -1
+
+// maximum number of DB sequences in a chunk, set in the current context
+#define max_chunk_size (ctx_current->chunk_size)
 
 void init_for_sw( p_query query, int bit_width, int align_type );
 
 void init_for_nw( p_query query, int bit_width, int align_type );
 
+/**
+ * Prepares a unit cost edit distance search. Only the scores are computed.
+ *
+ * @param mode  ED_GLOBAL, ED_SEMI_GLOBAL or ED_PREFIX
+ */
+void init_for_ed( p_query query, int mode );
+
 /**
  * Run a search for query in the database. Aligns the query sequence against
  * each sequence in the DB and returns 'hit_count' alignments. The search is
  * configured through set bits in 'flags'.
+ *
+ * Returns 0, if the search was cancelled. If the budget of the search was
+ * used up, the best alignments found so far are returned and flagged as
+ * partial.
  */
 p_alignment_list m_run( size_t hit_count );
 
+/**
+ * Runs a search like m_run, but returns the hits as a result table. The
+ * database sequences are not copied, and with COMPUTE_SCORE no alignments are
+ * created at all.
+ *
+ * Returns 0, if the search was cancelled.
+ */
+p_ssa_result_table m_run_table( size_t hit_count );
+
+/**
+ * Computes the score of every sequence of the database, without selecting
+ * hits. The best score of all frames of the sequence with the ID i is written
+ * to scores[i]. The array has to hold a score for each sequence of the
+ * database. Sequences, that were not searched, because they are outside of the
+ * search range, were rejected by a prefilter or the budget was used up, get
+ * the score INT32_MIN.
+ *
+ * @return 0 if the search was cancelled, 1 otherwise
+ */
+int m_run_scores( int32_t * scores );
+
+/**
+ * Searches the database and passes every hit with a score of at least
+ * min_score to the callback, without keeping hits.
+ *
+ * @param delivery  STREAM_FROM_WORKERS or STREAM_FROM_CALLER
+ * @return 0 if the search was cancelled, 1 otherwise
+ * @see sw_stream
+ */
+int m_run_stream( long min_score, int delivery, ssa_hit_callback callback, void * data );
+
+/**
+ * Updates the result of a previous search of query, after sequences were
+ * appended to the database. Only the sequences from the ID db_end up to the
+ * end of the database are searched. Their hits are merged with the hits of
+ * the previous result.
+ *
+ * @param previous  result of the previous search, is not changed
+ * @param db_end    number of sequences in the database at the time of the
+ *                  previous search. Is set to the current number.
+ */
+p_alignment_list m_run_incremental( p_query query, int search_type, int bit_width, int align_type,
+        size_t hit_count, p_alignment_list previous, size_t * db_end );
+
 #endif /* MANAGER_H_ */
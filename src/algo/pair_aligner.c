@@ -0,0 +1,273 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+/*
+ * Implements the alignment of explicitly given pairs of sequences.
+ *
+ * The pairs are grouped by their query. The targets of a group are packed into
+ * the SIMD channels and aligned with the inter-sequence kernels, that are also
+ * used for the database search. The database adapter, the thread pool and the
+ * heap are not used: every pair keeps the best score of all frames of its
+ * query, and the results are returned in the order of the pairs.
+ *
+ * The work is done in the calling thread.
+ */
+
+#include "pair_aligner.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+
+#include "../db_adapter.h"
+#include "../util/util.h"
+#include "../util/util_sequence.h"
+#include "align.h"
+#include "align_stats.h"
+#include "gap_costs.h"
+#include "searcher.h"
+#include "8/search_8.h"
+#include "16/search_16.h"
+#include "64/search_64.h"
+
+typedef struct {
+    p_query query;
+    size_t idx;
+} pair_ref_t;
+
+static int pair_ref_compare( const void * a, const void * b ) {
+    pair_ref_t * x = (pair_ref_t *) a;
+    pair_ref_t * y = (pair_ref_t *) b;
+
+    int cmp = CMP_ASC( (uintptr_t ) x->query, (uintptr_t ) y->query );
+    if( !cmp ) {
+        cmp = -CMP_ASC( x->idx, y->idx );
+    }
+    return cmp;
+}
+
+/*
+ * Keeps the best score of a pair. The ID of a target sequence is the index of
+ * its pair.
+ */
+static void add_pair_hit( p_search_result res, uint8_t query_id, p_sdb_sequence target, long score ) {
+    elem_t * best = (elem_t *) res->hit_data + target->ID;
+
+    if( score > best->score ) {
+        best->score = score;
+        best->query_id = query_id;
+    }
+}
+
+/*
+ * Scores a pair, of which at least one sequence is empty. The local alignment
+ * is empty, while the global alignment consists of a single gap over the other
+ * sequence. For a query with several frames, the shortest frame is chosen.
+ */
+static long score_empty_pair( elem_t * e, sequence_t target, p_search_data sdp, int search_type ) {
+    if( search_type != NEEDLEMAN_WUNSCH ) {
+        return 0;
+    }
+
+    if( target.len ) {
+        return gapO + (long) target.len * gapE;
+    }
+
+    long score = 0;
+    int found = 0;
+    for( uint8_t f = 0; f < sdp->q_count; f++ ) {
+        size_t len = sdp->queries[f].seq.len;
+        if( !len ) {
+            continue;
+        }
+
+        long frame_score = gapO + (long) len * gapE;
+        if( !found || (frame_score > score) ) {
+            score = frame_score;
+            e->query_id = f;
+            found = 1;
+        }
+    }
+    return score;
+}
+
+static p_alignment create_pair_alignment( elem_t * e, sequence_t target, p_search_data sdp, int search_type,
+        int align_type ) {
+    p_alignment a = xmalloc( sizeof(alignment_t) );
+
+    long empty_score = 0;
+    if( e->score == LONG_MIN ) {
+        empty_score = score_empty_pair( e, target, sdp, search_type );
+    }
+
+    a->db_seq.seq = target.seq;
+    a->db_seq.len = target.len;
+    a->db_seq.ID = e->db_id;
+    a->db_seq.strand = 0;
+    a->db_seq.frame = 0;
+
+    seq_buffer_t qseq = sdp->queries[e->query_id];
+    a->query.seq = qseq.seq.seq;
+    a->query.len = qseq.seq.len;
+    a->query.strand = qseq.strand;
+    a->query.frame = qseq.frame;
+
+    a->align_q_start = 0;
+    a->align_d_start = 0;
+    a->align_q_end = 0;
+    a->align_d_end = 0;
+    a->align_matches = 0;
+    a->align_mismatches = 0;
+    a->align_gap_opens = 0;
+    a->align_gap_columns = 0;
+    a->align_columns = 0;
+    a->alignment = 0;
+    a->alignment_len = 0;
+    a->cigar_ops = 0;
+    a->cigar_ops_len = 0;
+
+    if( e->score == LONG_MIN ) {
+        /* an empty sequence was part of the pair */
+        a->score = empty_score;
+    }
+    else {
+        a->score = e->score;
+
+        if( align_type == COMPUTE_ALIGNMENT ) {
+            align_sequences( search_type, a );
+        }
+        else if( align_type == COMPUTE_STATISTICS ) {
+            st_compute( search_type, &a, 1 );
+        }
+    }
+
+    return a;
+}
+
+/*
+ * Aligns the targets of all pairs in refs, which share the same query.
+ */
+static void align_group( pair_ref_t * refs, size_t count, p_align_pair pairs, elem_t * best,
+        p_alignment_list alist, int search_type, int bit_width, int align_type ) {
+    const char * map = (symtype == NUCLEOTIDE) ? map_ncbi_nt16 : map_ncbi_aa;
+
+    p_search_data sdp = s_create_searchdata( refs[0].query );
+
+    p_db_chunk lanes = adp_alloc_chunk( count );
+    sequence_t * targets = xmalloc( count * sizeof(sequence_t) );
+
+    for( size_t i = 0; i < count; i++ ) {
+        p_align_pair pair = &pairs[refs[i].idx];
+
+        sequence_t orig = { pair->target, pair->target_len };
+        targets[i] = (sequence_t ) { xmalloc( orig.len + 1 ), orig.len };
+        us_map_sequence( orig, targets[i], map );
+
+        if( targets[i].len ) {
+            p_sdb_sequence lane = xmalloc( sizeof(sdb_sequence_t) );
+            lane->ID = refs[i].idx;
+            lane->seq = targets[i];
+            lane->strand = 0;
+            lane->frame = 0;
+
+            lanes->seq[lanes->fill_pointer++] = lane;
+        }
+    }
+
+    if( lanes->fill_pointer && sdp->maxqlen ) {
+        search_result_t res;
+        res.heap = 0;
+        res.chunk_count = 0;
+        res.seq_count = 0;
+        res.overflow_8_bit_count = 0;
+        res.overflow_16_bit_count = 0;
+        res.add_hit = &add_pair_hit;
+        res.hit_data = best;
+        res.shared_floor = 0;
+
+        s_search_chunk( bit_width, sdp, lanes, &res );
+    }
+
+    for( size_t i = 0; i < count; i++ ) {
+        size_t idx = refs[i].idx;
+
+        alist->alignments[idx] = create_pair_alignment( &best[idx], targets[i], sdp, search_type, align_type );
+    }
+
+    for( size_t i = 0; i < lanes->fill_pointer; i++ ) {
+        free( lanes->seq[i] );
+    }
+    adp_free_chunk_no_sequences( lanes );
+
+    free( targets );
+    free( sdp );
+}
+
+p_alignment_list pa_align_pairs( p_align_pair pairs, size_t pair_count, int search_type, int bit_width,
+        int align_type ) {
+    if( (symtype == TRANS_DB) || (symtype == TRANS_BOTH) ) {
+        fatal( "Pairwise alignments of translated target sequences are not supported." );
+    }
+
+    search_64_init_algo( search_type );
+    search_16_init_algo( search_type );
+    search_8_init_algo( search_type );
+
+    p_alignment_list alist = xmalloc( sizeof(alignment_list_t) );
+    alist->alignments = xmalloc( pair_count * sizeof(p_alignment) );
+    alist->len = pair_count;
+    alist->partial = 0;
+
+    elem_t * best = xmalloc( pair_count * sizeof(elem_t) );
+    pair_ref_t * refs = xmalloc( pair_count * sizeof(pair_ref_t) );
+
+    for( size_t i = 0; i < pair_count; i++ ) {
+        if( !pairs[i].query ) {
+            fatal( "Query of pair %ld not initialized.", i );
+        }
+
+        best[i].db_id = i;
+        best[i].db_frame = 0;
+        best[i].db_strand = 0;
+        best[i].query_id = 0;
+        best[i].score = LONG_MIN;
+
+        refs[i].query = pairs[i].query;
+        refs[i].idx = i;
+    }
+
+    qsort( refs, pair_count, sizeof(pair_ref_t), pair_ref_compare );
+
+    size_t start = 0;
+    while( start < pair_count ) {
+        size_t end = start + 1;
+        while( (end < pair_count) && (refs[end].query == refs[start].query) ) {
+            end++;
+        }
+
+        align_group( refs + start, end - start, pairs, best, alist, search_type, bit_width, align_type );
+
+        start = end;
+    }
+
+    free( refs );
+    free( best );
+
+    return alist;
+}
@@ -0,0 +1,32 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#ifndef PAIR_ALIGNER_H_
+#define PAIR_ALIGNER_H_
+
+#include "../libssa_datatypes.h"
+
+/**
+ * Aligns each pair of sequences. The results are returned in the order of
+ * the pairs.
+ */
+p_alignment_list pa_align_pairs( p_align_pair pairs, size_t pair_count, int search_type, int bit_width,
+        int align_type );
+
+#endif /* PAIR_ALIGNER_H_ */
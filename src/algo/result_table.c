@@ -0,0 +1,368 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+
+/*
+ * Implements the columnar result tables.
+ *
+ * All columns of a table are carved out of one allocation. The CIGAR strings
+ * are appended to a single pool in the order in which they are computed, so
+ * that the alignments of the rows can be computed in any order and only when
+ * they are needed.
+ *
+ * One computation of alignments runs at a time per table. A background
+ * computation runs in its own thread, which uses the thread pool like a
+ * search. All other functions wait for it to finish first. The table works in
+ * a copy of the context of its search, so that its threads do not form a
+ * group of the search context, which might run the next search meanwhile.
+ */
+
+#include "result_table.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "../context.h"
+#include "../util/util.h"
+#include "../util/util_sequence.h"
+#include "../util/thread_pool.h"
+#include "align.h"
+#include "aligner.h"
+
+#define RT_POOL_MIN_SIZE 256
+
+struct ssa_result_data {
+    p_ssa_context ctx;
+    // copy of ctx, which keeps the database snapshot of the search
+    p_ssa_context align_ctx;
+    int search_type;
+    seq_buffer_t queries[6];
+    size_t q_count;
+
+    uint8_t * query_ids;
+
+    size_t pool_alloc;
+    pthread_mutex_t pool_mutex;
+
+    // rows handed out to the threads of rt_align_rows, by decreasing cost
+    size_t * row_order;
+    size_t next_row;
+    size_t end_row;
+
+    // background computation of the rows [async_first, async_first + async_count)
+    int async_active;
+    pthread_t async_thread;
+    size_t async_first;
+    size_t async_count;
+};
+
+p_ssa_result_table rt_create( p_minheap hits, seq_buffer_t * queries, size_t q_count, int search_type,
+        int partial ) {
+    p_ssa_result_table table = xmalloc( sizeof(ssa_result_table_t) );
+    struct ssa_result_data * data = xmalloc( sizeof(struct ssa_result_data) );
+
+    size_t len = hits->count;
+
+    // the 8 byte columns first, so that all columns are aligned
+    size_t row_size = 7 * sizeof(size_t) + sizeof(long) + 5 * sizeof(uint8_t);
+    char * block = xmalloc( len * row_size + 1 );
+
+    table->db_ids = (size_t *) block;
+    table->q_starts = table->db_ids + len;
+    table->q_ends = table->q_starts + len;
+    table->d_starts = table->q_ends + len;
+    table->d_ends = table->d_starts + len;
+    table->cigar_offsets = table->d_ends + len;
+    table->cigar_lengths = table->cigar_offsets + len;
+    table->scores = (long *) (table->cigar_lengths + len);
+    table->d_strands = (uint8_t *) (table->scores + len);
+    table->d_frames = table->d_strands + len;
+    table->q_strands = table->d_frames + len;
+    table->q_frames = table->q_strands + len;
+    data->query_ids = table->q_frames + len;
+
+    for( size_t i = 0; i < len; i++ ) {
+        elem_t * e = &hits->array[i];
+
+        table->db_ids[i] = e->db_id;
+        table->scores[i] = e->score;
+        table->d_strands[i] = e->db_strand;
+        table->d_frames[i] = e->db_frame;
+        table->q_strands[i] = queries[e->query_id].strand;
+        table->q_frames[i] = queries[e->query_id].frame;
+        data->query_ids[i] = e->query_id;
+
+        table->q_starts[i] = 0;
+        table->q_ends[i] = 0;
+        table->d_starts[i] = 0;
+        table->d_ends[i] = 0;
+        table->cigar_offsets[i] = SSA_NO_CIGAR;
+        table->cigar_lengths[i] = 0;
+    }
+
+    table->len = len;
+    table->partial = partial;
+    table->cigar_pool = 0;
+    table->cigar_pool_size = 0;
+    table->data = data;
+
+    data->ctx = ctx_current;
+    data->align_ctx = ctx_create_copy();
+    data->search_type = search_type;
+    data->q_count = q_count;
+    for( size_t i = 0; i < q_count; i++ ) {
+        data->queries[i] = queries[i];
+    }
+    data->pool_alloc = 0;
+    pthread_mutex_init( &data->pool_mutex, NULL );
+    data->row_order = 0;
+    data->next_row = 0;
+    data->end_row = 0;
+    data->async_active = 0;
+
+    return table;
+}
+
+void rt_free( p_ssa_result_table table ) {
+    if( !table ) {
+        return;
+    }
+
+    rt_wait( table );
+
+    ctx_free_copy( table->data->align_ctx );
+    pthread_mutex_destroy( &table->data->pool_mutex );
+    free( table->data );
+
+    free( table->cigar_pool );
+    free( table->db_ids );
+    free( table );
+}
+
+/*
+ * Appends the CIGAR string of a row to the pool.
+ */
+static void add_cigar( p_ssa_result_table table, size_t row, char * cigar, size_t len ) {
+    struct ssa_result_data * data = table->data;
+
+    pthread_mutex_lock( &data->pool_mutex );
+
+    if( table->cigar_pool_size + len + 1 > data->pool_alloc ) {
+        size_t alloc = data->pool_alloc ? 2 * data->pool_alloc : RT_POOL_MIN_SIZE;
+        while( table->cigar_pool_size + len + 1 > alloc ) {
+            alloc *= 2;
+        }
+
+        table->cigar_pool = xrealloc( table->cigar_pool, alloc );
+        data->pool_alloc = alloc;
+    }
+
+    char * dest = table->cigar_pool + table->cigar_pool_size;
+    memcpy( dest, cigar, len );
+    dest[len] = 0;
+
+    table->cigar_lengths[row] = len;
+    table->cigar_offsets[row] = table->cigar_pool_size;
+    table->cigar_pool_size += len + 1;
+
+    pthread_mutex_unlock( &data->pool_mutex );
+}
+
+static elem_t row_hit( p_ssa_result_table table, size_t row ) {
+    elem_t e;
+    e.db_id = table->db_ids[row];
+    e.db_strand = table->d_strands[row];
+    e.db_frame = table->d_frames[row];
+    e.query_id = table->data->query_ids[row];
+    e.score = table->scores[row];
+
+    return e;
+}
+
+static void align_row( p_ssa_result_table table, size_t row ) {
+    elem_t e = row_hit( table, row );
+
+    p_alignment a = a_init_alignment( &e, table->data->queries );
+
+    align_sequences( table->data->search_type, a );
+
+    table->q_starts[row] = a->align_q_start;
+    table->q_ends[row] = a->align_q_end;
+    table->d_starts[row] = a->align_d_start;
+    table->d_ends[row] = a->align_d_end;
+
+    if( a->cigar_ops ) {
+        // the packed CIGAR of CIGAR_FORMAT_PACKED is rendered like CIGAR_FORMAT_TEXT
+        char * text = alignment_cigar_string( a, 0 );
+        add_cigar( table, row, text, strlen( text ) );
+        free( text );
+    }
+    else {
+        add_cigar( table, row, a->alignment, a->alignment_len );
+    }
+
+    a_free_alignment( a );
+}
+
+static void * align_rows_worker( void * arg ) {
+    p_ssa_result_table table = arg;
+    struct ssa_result_data * data = table->data;
+
+    // a cancel of the search context stops the alignments of its tables
+    while( !__atomic_load_n( &data->ctx->search.cancelled, __ATOMIC_RELAXED ) ) {
+        // the tiles of a large alignment of another thread go first
+        while( cigar_help() ) {
+        }
+
+        size_t next = __atomic_fetch_add( &data->next_row, 1, __ATOMIC_RELAXED );
+        if( next >= data->end_row ) {
+            break;
+        }
+
+        size_t row = data->row_order[next];
+
+        if( table->cigar_offsets[row] == SSA_NO_CIGAR ) {
+            align_row( table, row );
+        }
+    }
+
+    return NULL;
+}
+
+/*
+ * Computes the alignments of the rows with the thread pool. The caller has
+ * made sure, that no other computation runs for the table.
+ */
+static void align_rows( p_ssa_result_table table, size_t first, size_t count ) {
+    if( first >= table->len ) {
+        return;
+    }
+    if( count > table->len - first ) {
+        count = table->len - first;
+    }
+
+    struct ssa_result_data * data = table->data;
+
+    p_ssa_context prev = ctx_enter( data->align_ctx );
+
+    elem_t * hits = xmalloc( (count + 1) * sizeof(elem_t) );
+    for( size_t i = 0; i < count; i++ ) {
+        hits[i] = row_hit( table, first + i );
+    }
+
+    data->row_order = xmalloc( (count + 1) * sizeof(size_t) );
+    a_order_by_cost( hits, count, data->queries, data->row_order );
+    for( size_t i = 0; i < count; i++ ) {
+        data->row_order[i] += first;
+    }
+    free( hits );
+
+    data->next_row = 0;
+    data->end_row = count;
+
+    init_thread_pool();
+
+    start_threads( align_rows_worker, table );
+
+    void * results[get_current_thread_count()];
+    wait_for_threads( results );
+
+    free( data->row_order );
+    data->row_order = 0;
+
+    ctx_leave( prev );
+}
+
+void rt_align_rows( p_ssa_result_table table, size_t first, size_t count ) {
+    rt_wait( table );
+
+    align_rows( table, first, count );
+}
+
+void rt_align_row( p_ssa_result_table table, size_t row ) {
+    if( row >= table->len ) {
+        fatal( "Row %ld is not part of the result table.", row );
+    }
+
+    rt_wait( table );
+
+    if( table->cigar_offsets[row] != SSA_NO_CIGAR ) {
+        return;
+    }
+
+    p_ssa_context prev = ctx_enter( table->data->align_ctx );
+    align_row( table, row );
+    ctx_leave( prev );
+}
+
+static void * run_async_alignment( void * arg ) {
+    p_ssa_result_table table = arg;
+
+    align_rows( table, table->data->async_first, table->data->async_count );
+
+    return NULL;
+}
+
+void rt_align_rows_async( p_ssa_result_table table, size_t first, size_t count ) {
+    struct ssa_result_data * data = table->data;
+
+    rt_wait( table );
+
+    data->async_first = first;
+    data->async_count = count;
+
+    if( pthread_create( &data->async_thread, NULL, run_async_alignment, table ) ) {
+        fatal( "Could not start the thread of the alignments." );
+    }
+    data->async_active = 1;
+}
+
+void rt_wait( p_ssa_result_table table ) {
+    struct ssa_result_data * data = table->data;
+
+    if( data->async_active ) {
+        pthread_join( data->async_thread, NULL );
+        data->async_active = 0;
+    }
+}
+
+char * rt_get_db_sequence( p_ssa_result_table table, size_t row, size_t * len ) {
+    if( row >= table->len ) {
+        fatal( "Row %ld is not part of the result table.", row );
+    }
+
+    rt_wait( table );
+
+    p_ssa_context prev = ctx_enter( table->data->align_ctx );
+
+    p_seqinfo info = ctx_db_get_sequence( table->db_ids[row] );
+    if( !info ) {
+        fatal( "Could not get sequence from DB: %ld", table->db_ids[row] );
+    }
+
+    sequence_t seq = us_prepare_sequence( info->seq, info->seqlen, table->d_frames[row], table->d_strands[row] );
+
+    ctx_leave( prev );
+
+    if( len ) {
+        *len = seq.len;
+    }
+    return seq.seq;
+}
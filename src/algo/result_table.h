@@ -0,0 +1,84 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+
+/*
+ * Columnar result tables of searches.
+ */
+
+#ifndef RESULT_TABLE_H_
+#define RESULT_TABLE_H_
+
+#include <stddef.h>
+
+#include "../libssa.h"
+#include "../libssa_datatypes.h"
+
+/**
+ * Creates the table of the sorted hits of a search of the current context.
+ * The database sequences are not fetched and no alignments are computed. The
+ * table keeps a copy of the context for the later access to the database and
+ * the alignments, which holds a reference to the database snapshot of the
+ * search, see ctx_create_copy.
+ *
+ * @param queries   query sequences of the search, referenced by the query_id
+ *                  of the hits. They have to stay valid as long as alignments
+ *                  of the table are computed.
+ */
+p_ssa_result_table rt_create( p_minheap hits, seq_buffer_t * queries, size_t q_count, int search_type,
+        int partial );
+
+void rt_free( p_ssa_result_table table );
+
+/**
+ * Computes the alignments of the rows [first, first + count) of the table,
+ * which were not computed before, with the threads of the pool. The threads
+ * form a group of the copy of the context, so searches can run in the context
+ * of the table at the same time.
+ */
+void rt_align_rows( p_ssa_result_table table, size_t first, size_t count );
+
+/**
+ * Computes the alignment of a single row in the calling thread, if it was not
+ * computed before.
+ */
+void rt_align_row( p_ssa_result_table table, size_t row );
+
+/**
+ * Like rt_align_rows, but returns immediately. The alignments are computed in
+ * the background, until rt_wait returns. Until then, the coordinates and the
+ * CIGAR strings of the table must not be read.
+ */
+void rt_align_rows_async( p_ssa_result_table table, size_t first, size_t count );
+
+/**
+ * Waits for the background computation of alignments of the table, if one is
+ * running.
+ */
+void rt_wait( p_ssa_result_table table );
+
+/**
+ * Returns a copy of the database sequence of a row, in the form in which it
+ * was searched: mapped to the internal alphabet and, for translated databases,
+ * translated. A snapshot database is read in the version of the search, other
+ * databases must not have changed since the search.
+ */
+char * rt_get_db_sequence( p_ssa_result_table table, size_t row, size_t * len );
+
+#endif /* RESULT_TABLE_H_ */
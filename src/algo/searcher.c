@@ -18,20 +18,25 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
 #include <assert.h>
 
 #include "../db_adapter.h"
+#include "../db_dedup.h"
 #include "../util/util.h"
 #include "../util/minheap.h"
 #include "../matrices.h"
 #include "../util/util_sequence.h"
+#include "../context.h"
+#include "aligner.h"
+#include "hit_stream.h"
 
 #include "16/search_16.h"
 #include "64/search_64.h"
 #include "8/search_8.h"
-
-static p_search_data sdp = 0;
-static void (*search_func)( p_db_chunk, p_search_data, p_search_result );
+#include "ed/search_ed.h"
+#include "banded/search_banded.h"
 
 static void add_to_buffer( seq_buffer_t* buf, sequence_t seq, int strand, int frame ) {
     buf->seq = seq;
@@ -90,27 +95,34 @@ p_search_data s_create_searchdata( p_query query ) {
 }
 
 int s_get_query_count() {
-    return sdp->q_count;
+    return ctx_current->search.sdp->q_count;
 }
 
 seq_buffer_t s_get_query( int idx ) {
-    return sdp->queries[idx];
+    return ctx_current->search.sdp->queries[idx];
 }
 
 void s_init( int search_type, int bit_width, p_query query ) {
+    if( IS_EDIT_DISTANCE( search_type ) ) {
+        // the bit-vector search does not depend on the bit width
+        ctx_current->search_func = &search_ed;
+        ctx_current->search.sdp = s_create_searchdata( query );
+        return;
+    }
+
     /*
      * Here we initialize all algorithms, to use them as fallbacks if one overflows.
      *
      * Although all are initialized, the main algorithm is the one specified.
      */
     if( bit_width == BIT_WIDTH_64 ) {
-        search_func = &search_64;
+        ctx_current->search_func = &search_64;
     }
     else if( bit_width == BIT_WIDTH_16 ) {
-        search_func = &search_16;
+        ctx_current->search_func = &search_16;
     }
     else if( bit_width == BIT_WIDTH_8 ) {
-        search_func = &search_8;
+        ctx_current->search_func = &search_8;
     }
     else {
         fatal( "\nunknown bit width provided: %d\n\n", bit_width );
@@ -120,7 +132,15 @@ void s_init( int search_type, int bit_width, p_query query ) {
     search_16_init_algo( search_type );
     search_8_init_algo( search_type );
 
-    sdp = s_create_searchdata( query );
+    ctx_current->band_sequences = 0;
+    ctx_current->band_fallbacks = 0;
+
+    if( (search_type == NEEDLEMAN_WUNSCH) && ctx_current->nw_band ) {
+        // the banded search computes 32 bit scores for all bit widths
+        ctx_current->search_func = &search_banded;
+    }
+
+    ctx_current->search.sdp = s_create_searchdata( query );
 }
 
 static void s_free_search_data( p_search_data sdp ) {
@@ -136,8 +156,8 @@ void s_free( p_search_result res ) {
         return;
     }
 
-    s_free_search_data( sdp );
-    sdp = 0;
+    s_free_search_data( ctx_current->search.sdp );
+    ctx_current->search.sdp = 0;
 
     minheap_exit( res->heap );
 
@@ -147,14 +167,297 @@ void s_free( p_search_result res ) {
     res = 0;
 }
 
+/**
+ * Aligns all sequences of the chunk against the sequences in sdp, without
+ * using the database adapter. The scores are passed to the result via
+ * add_to_result. Overflowing alignments are re-aligned with a higher bit
+ * width.
+ *
+ * The search algorithms have to be initialised before, using the init_algo
+ * functions of the used bit widths.
+ *
+ * @param bit_width the bit width to start with
+ * @param sdp       the sequences forming the rows of the matrices
+ * @param chunk     the sequences, that are packed into the SIMD channels
+ * @param res       receives the scores
+ */
+void s_search_chunk( int bit_width, p_search_data sdp, p_db_chunk chunk, p_search_result res ) {
+    if( bit_width == BIT_WIDTH_8 ) {
+        p_s8info s8info = search_8_init( sdp );
+
+        search_8_chunk( s8info, chunk, sdp, res );
+
+        search_8_exit( s8info );
+    }
+    else if( bit_width == BIT_WIDTH_16 ) {
+        p_s16info s16info = search_16_init( sdp );
+
+        res->overflow_16_bit_count += search_16_chunk( s16info, res, chunk, sdp );
+
+        search_16_exit( s16info );
+    }
+    else if( bit_width == BIT_WIDTH_64 ) {
+        p_s64info s64info = search_64_init( sdp );
+
+        search_64_chunk( s64info, res, chunk, sdp );
+
+        search_64_exit( s64info );
+    }
+    else {
+        fatal( "\nunknown bit width provided: %d\n\n", bit_width );
+    }
+}
+
+/**
+ * Prepares the publishing of the progress of a search in the current context.
+ * Does nothing, if no progress callback is set.
+ *
+ * @param thread_count  number of threads searching the database
+ * @param hit_count     size of the heaps of the threads
+ */
+void s_init_progress( size_t thread_count, size_t hit_count ) {
+    p_ssa_context ctx = ctx_current;
+
+    ctx->search.progress_chunks = 0;
+    ctx->search.progress_reported = 0;
+    ctx->search.progress_slot_count = 0;
+
+    if( !ctx->progress_callback ) {
+        return;
+    }
+
+    ctx->search.progress_owners = xmalloc( thread_count * sizeof(p_search_result) );
+    ctx->search.progress_heaps = xmalloc( thread_count * sizeof(p_minheap) );
+
+    for( size_t i = 0; i < thread_count; i++ ) {
+        ctx->search.progress_owners[i] = 0;
+        ctx->search.progress_heaps[i] = minheap_init( hit_count );
+    }
+    ctx->search.progress_slot_count = thread_count;
+}
+
+void s_free_progress() {
+    p_ssa_context ctx = ctx_current;
+
+    for( size_t i = 0; i < ctx->search.progress_slot_count; i++ ) {
+        minheap_exit( ctx->search.progress_heaps[i] );
+    }
+
+    if( ctx->search.progress_slot_count ) {
+        free( ctx->search.progress_owners );
+        free( ctx->search.progress_heaps );
+    }
+
+    ctx->search.progress_owners = 0;
+    ctx->search.progress_heaps = 0;
+    ctx->search.progress_slot_count = 0;
+}
+
+/*
+ * Merges the copies of the heaps of all threads into the best hits found so
+ * far. Only the hits are published, the sequences are fetched on request by
+ * s_get_progress_alignments.
+ */
+static void create_snapshot( p_ssa_context ctx, elem_t * hits, size_t hit_count, size_t heap_size,
+        p_ssa_progress progress ) {
+    p_minheap merged = minheap_init( heap_size );
+
+    for( size_t i = 0; i < hit_count; i++ ) {
+        dd_add_hit( ctx->search.dedup_active, merged, &hits[i], ctx_db_range_end() );
+    }
+
+    minheap_sort( merged );
+
+    progress->hits = xmalloc( (merged->count + 1) * sizeof(ssa_hit_t) );
+    progress->len = merged->count;
+    progress->ctx = ctx;
+
+    for( size_t i = 0; i < merged->count; i++ ) {
+        elem_t * e = &merged->array[i];
+        seq_buffer_t query = ctx->search.sdp->queries[e->query_id];
+
+        ssa_hit_t * hit = &progress->hits[i];
+        hit->db_id = e->db_id;
+        hit->score = e->score;
+        hit->db_strand = e->db_strand;
+        hit->db_frame = e->db_frame;
+        hit->query_strand = query.strand;
+        hit->query_frame = query.frame;
+    }
+
+    minheap_exit( merged );
+}
+
+p_alignment_list s_get_progress_alignments( p_ssa_progress progress ) {
+    p_ssa_context prev = ctx_enter( progress->ctx );
+    p_search_data sdp = ctx_current->search.sdp;
+
+    p_alignment_list alist = xmalloc( sizeof(alignment_list_t) );
+    alist->alignments = xmalloc( (progress->len + 1) * sizeof(p_alignment) );
+    alist->len = progress->len;
+    alist->partial = 1;
+
+    for( size_t i = 0; i < progress->len; i++ ) {
+        ssa_hit_t * hit = &progress->hits[i];
+
+        elem_t e;
+        e.db_id = hit->db_id;
+        e.score = hit->score;
+        e.db_strand = hit->db_strand;
+        e.db_frame = hit->db_frame;
+        e.query_id = 0;
+
+        // the strand and frame select the query sequence, see create_snapshot
+        for( uint8_t q = 0; q < sdp->q_count; q++ ) {
+            if( (sdp->queries[q].strand == hit->query_strand) && (sdp->queries[q].frame == hit->query_frame) ) {
+                e.query_id = q;
+                break;
+            }
+        }
+
+        alist->alignments[i] = a_init_alignment( &e, sdp->queries );
+    }
+
+    ctx_leave( prev );
+
+    return alist;
+}
+
+/*
+ * Passes the latest published hits to the progress callback, until no chunk
+ * is left, that was finished after the last call. The caller holds
+ * progress_callback_mutex.
+ */
+static void report_progress( p_ssa_context ctx ) {
+    size_t heap_size = ctx->search.progress_heaps[0]->alloc;
+    elem_t * hits = xmalloc( ctx->search.progress_slot_count * heap_size * sizeof(elem_t) );
+
+    pthread_mutex_lock( &ctx->progress_mutex );
+
+    while( ctx->search.progress_reported != ctx->search.progress_chunks ) {
+        size_t chunks = ctx->search.progress_chunks;
+
+        size_t hit_count = 0;
+        for( size_t i = 0; i < ctx->search.progress_slot_count; i++ ) {
+            p_minheap copy = ctx->search.progress_heaps[i];
+            memcpy( hits + hit_count, copy->array, copy->count * sizeof(elem_t) );
+            hit_count += copy->count;
+        }
+
+        ctx->search.progress_reported = chunks;
+
+        pthread_mutex_unlock( &ctx->progress_mutex );
+
+        double fraction = 1;
+        size_t db_count = ctx_search_end() - ctx_db_range_start();
+        if( chunks * ctx->chunk_db_seq_count < db_count ) {
+            fraction = (chunks * ctx->chunk_db_seq_count) / (double) db_count;
+        }
+
+        ssa_progress_t progress;
+        create_snapshot( ctx, hits, hit_count, heap_size, &progress );
+
+        ctx->progress_callback( &progress, fraction, ctx->progress_data );
+
+        free( progress.hits );
+
+        pthread_mutex_lock( &ctx->progress_mutex );
+    }
+
+    pthread_mutex_unlock( &ctx->progress_mutex );
+
+    free( hits );
+}
+
+/**
+ * Called by a thread of the search, after it finished a chunk. Publishes a
+ * copy of the heap of the thread and passes the best hits of all threads to
+ * the progress callback of the current context.
+ *
+ * Only the copy is made under the lock. The callback is called by one thread
+ * at a time, without blocking the other threads: if it is busy, the chunk is
+ * reported by its next call. The last chunk of a search is always reported.
+ */
+void s_chunk_finished( p_search_result res ) {
+    p_ssa_context ctx = ctx_current;
+
+    if( !ctx->search.progress_slot_count ) {
+        return;
+    }
+
+    pthread_mutex_lock( &ctx->progress_mutex );
+
+    size_t slot = 0;
+    while( (slot < ctx->search.progress_slot_count) && ctx->search.progress_owners[slot]
+            && (ctx->search.progress_owners[slot] != res) ) {
+        slot++;
+    }
+
+    if( slot < ctx->search.progress_slot_count ) {
+        ctx->search.progress_owners[slot] = res;
+
+        p_minheap copy = ctx->search.progress_heaps[slot];
+        copy->count = res->heap->count;
+        memcpy( copy->array, res->heap->array, res->heap->count * sizeof(elem_t) );
+    }
+
+    ctx->search.progress_chunks++;
+
+    pthread_mutex_unlock( &ctx->progress_mutex );
+
+    int pending = 1;
+    while( pending && !pthread_mutex_trylock( &ctx->progress_callback_mutex ) ) {
+        report_progress( ctx );
+
+        pthread_mutex_unlock( &ctx->progress_callback_mutex );
+
+        // a chunk might have been finished after the last check, while the callback was still busy
+        pthread_mutex_lock( &ctx->progress_mutex );
+        pending = (ctx->search.progress_reported != ctx->search.progress_chunks);
+        pthread_mutex_unlock( &ctx->progress_mutex );
+    }
+}
+
+/*
+ * Keeps the best score of all frames of a sequence in the dense score array.
+ * All frames of a sequence are searched by the same thread, so the array needs
+ * no locking.
+ */
+static void add_dense_hit( p_search_result res, uint8_t query_id, p_sdb_sequence db_seq, long score ) {
+    int32_t * scores = res->hit_data;
+
+    // INT32_MIN marks the sequences, that were not searched
+    if( score > INT32_MAX ) {
+        score = INT32_MAX;
+    }
+    else if( score <= INT32_MIN ) {
+        score = INT32_MIN + 1;
+    }
+
+    if( score > scores[db_seq->ID] ) {
+        scores[db_seq->ID] = (int32_t) score;
+    }
+}
+
+/*
+ * Returns 1, if the search reads the floor shared by its threads: to prune and
+ * retire sequences, to limit the edit distances or to keep banded scores.
+ * Without a reader, sharing the floor only adds atomic operations per hit.
+ */
+static int reads_shared_floor( p_ssa_context ctx ) {
+    return ctx->bound_pruning || (ctx->search_func == &search_ed) || (ctx->search_func == &search_banded);
+}
+
 /*
  * Performs a database search.
  *
  * @param hit_count (type: size_t) number of expected results
  */
 void * s_search( void * hit_count ) {
-    assert( search_func );
-    assert( sdp );
+    p_ssa_context ctx = ctx_current;
+
+    assert( ctx->search_func );
+    assert( ctx->search.sdp );
     assert( hit_count );
 
     p_search_result res = xmalloc( sizeof(search_result_t) );
@@ -163,10 +466,25 @@ void * s_search( void * hit_count ) {
     res->seq_count = 0;
     res->overflow_8_bit_count = 0;
     res->overflow_16_bit_count = 0;
+    res->add_hit = 0;
+    res->hit_data = 0;
+    res->shared_floor = reads_shared_floor( ctx ) ? &ctx->search.score_floor : 0;
+
+    if( ctx->search.dense_scores ) {
+        res->add_hit = &add_dense_hit;
+        res->hit_data = ctx->search.dense_scores;
+        res->shared_floor = 0;
+    }
+    else if( ctx->search.hit_stream ) {
+        hs_attach( ctx->search.hit_stream, res );
+    }
 
     p_db_chunk chunk = adp_init_new_chunk();
+    if( ctx->bound_pruning && !ctx->search.dense_scores ) {
+        chunk->bound_result = res;
+    }
 
-    search_func( chunk, sdp, res );
+    ctx->search_func( chunk, ctx->search.sdp, res );
 
     adp_free_chunk( chunk );
 
@@ -34,6 +34,20 @@ seq_buffer_t s_get_query( int idx );
 
 void s_free();
 
+void s_search_chunk( int bit_width, p_search_data sdp, p_db_chunk chunk, p_search_result res );
+
+void s_init_progress( size_t thread_count, size_t hit_count );
+
+void s_free_progress();
+
+/**
+ * Creates the alignments of the hits, that were passed to the progress
+ * callback of a search.
+ */
+p_alignment_list s_get_progress_alignments( p_ssa_progress progress );
+
+void s_chunk_finished( p_search_result res );
+
 void * s_search( void * hit_count );
 
 #endif /* SEARCHER_H_ */
@@ -0,0 +1,356 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+/*
+ * Implements the search of a database, that is split into shards.
+ *
+ * The coordinator forks one worker process per shard. A worker restricts the
+ * search to the ID range of its shard and sends the found alignments through
+ * a pipe back to the coordinator, which merges them into one list.
+ *
+ * The same scheme works across hosts: every host searches its own range with
+ * set_search_range and the lists are combined with merge_alignment_lists.
+ */
+
+#define _POSIX_C_SOURCE 200809L // fork and waitpid
+
+#include "sharded_search.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "../context.h"
+#include "../util/util.h"
+#include "../util/util_sequence.h"
+#include "../util/thread_pool.h"
+#include "aligner.h"
+#include "manager.h"
+
+/*
+ * Fixed part of an alignment, as it is sent from a worker to the coordinator.
+ * The alignment string follows, if alignment_len is not zero, and then the
+ * packed CIGAR, if cigar_ops_len is not zero.
+ */
+typedef struct {
+    long score;
+    size_t id;
+    int db_strand;
+    int db_frame;
+    int q_strand;
+    int q_frame;
+    size_t align_q_start;
+    size_t align_q_end;
+    size_t align_d_start;
+    size_t align_d_end;
+    size_t align_matches;
+    size_t align_mismatches;
+    size_t align_gap_opens;
+    size_t align_gap_columns;
+    size_t align_columns;
+    size_t alignment_len;
+    size_t cigar_ops_len;
+} alignment_record_t;
+
+typedef struct {
+    size_t len;
+    int partial;
+} list_record_t;
+
+static void write_all( int fd, const void * data, size_t len ) {
+    const char * p = data;
+
+    while( len ) {
+        ssize_t written = write( fd, p, len );
+        if( written < 0 ) {
+            if( errno == EINTR ) {
+                continue;
+            }
+            fatal( "Could not send the results of a shard: %s", strerror( errno ) );
+        }
+        p += written;
+        len -= written;
+    }
+}
+
+/*
+ * Returns 0, if the pipe was closed before len bytes were read.
+ */
+static int read_all( int fd, void * data, size_t len ) {
+    char * p = data;
+
+    while( len ) {
+        ssize_t got = read( fd, p, len );
+        if( got < 0 ) {
+            if( errno == EINTR ) {
+                continue;
+            }
+            return 0;
+        }
+        if( got == 0 ) {
+            return 0;
+        }
+        p += got;
+        len -= got;
+    }
+    return 1;
+}
+
+static void write_list( int fd, p_alignment_list alist ) {
+    list_record_t header = { alist->len, alist->partial };
+    write_all( fd, &header, sizeof(header) );
+
+    for( size_t i = 0; i < alist->len; i++ ) {
+        p_alignment a = alist->alignments[i];
+
+        alignment_record_t r;
+        memset( &r, 0, sizeof(r) );
+        r.score = a->score;
+        r.id = a->db_seq.ID;
+        r.db_strand = a->db_seq.strand;
+        r.db_frame = a->db_seq.frame;
+        r.q_strand = a->query.strand;
+        r.q_frame = a->query.frame;
+        r.align_q_start = a->align_q_start;
+        r.align_q_end = a->align_q_end;
+        r.align_d_start = a->align_d_start;
+        r.align_d_end = a->align_d_end;
+        r.align_matches = a->align_matches;
+        r.align_mismatches = a->align_mismatches;
+        r.align_gap_opens = a->align_gap_opens;
+        r.align_gap_columns = a->align_gap_columns;
+        r.align_columns = a->align_columns;
+        r.alignment_len = a->alignment ? strlen( a->alignment ) + 1 : 0;
+        r.cigar_ops_len = a->cigar_ops_len;
+
+        write_all( fd, &r, sizeof(r) );
+        if( r.alignment_len ) {
+            write_all( fd, a->alignment, r.alignment_len );
+        }
+        if( r.cigar_ops_len ) {
+            write_all( fd, a->cigar_ops, r.cigar_ops_len * sizeof(uint32_t) );
+        }
+    }
+}
+
+/*
+ * Returns the sequence of the query, that was used for the given strand and
+ * frame, like s_create_searchdata selects it.
+ */
+static sequence_t get_query_sequence( p_query query, int strand, int frame ) {
+    if( symtype == NUCLEOTIDE ) {
+        return query->nt[strand];
+    }
+    if( (symtype == TRANS_QUERY) || (symtype == TRANS_BOTH) ) {
+        return query->aa[3 * strand + frame];
+    }
+    return query->aa[0];
+}
+
+/*
+ * Reads the list of a worker and recreates the sequences of the alignments
+ * from the database and the query of the coordinator.
+ */
+static p_alignment_list read_list( int fd, p_query query ) {
+    list_record_t header;
+    if( !read_all( fd, &header, sizeof(header) ) ) {
+        return 0;
+    }
+
+    p_alignment_list alist = xmalloc( sizeof(alignment_list_t) );
+    alist->alignments = xmalloc( header.len * sizeof(p_alignment) );
+    alist->len = 0;
+    alist->partial = header.partial;
+
+    for( size_t i = 0; i < header.len; i++ ) {
+        alignment_record_t r;
+        if( !read_all( fd, &r, sizeof(r) ) ) {
+            a_free( alist );
+            return 0;
+        }
+
+        p_seqinfo info = ctx_db_get_sequence( r.id );
+        if( !info ) {
+            fatal( "Could not get sequence from DB: %ld", r.id );
+        }
+
+        p_alignment a = xmalloc( sizeof(alignment_t) );
+
+        // the strand of the DB sequence holds its frame and vice versa, see a_init_alignment
+        sequence_t dseq = us_prepare_sequence( info->seq, info->seqlen, r.db_strand, r.db_frame );
+        a->db_seq.seq = dseq.seq;
+        a->db_seq.len = dseq.len;
+        a->db_seq.strand = r.db_strand;
+        a->db_seq.frame = r.db_frame;
+        a->db_seq.ID = info->ID;
+
+        sequence_t qseq = get_query_sequence( query, r.q_strand, r.q_frame );
+        a->query.seq = qseq.seq;
+        a->query.len = qseq.len;
+        a->query.strand = r.q_strand;
+        a->query.frame = r.q_frame;
+
+        a->score = r.score;
+        a->align_q_start = r.align_q_start;
+        a->align_q_end = r.align_q_end;
+        a->align_d_start = r.align_d_start;
+        a->align_d_end = r.align_d_end;
+        a->align_matches = r.align_matches;
+        a->align_mismatches = r.align_mismatches;
+        a->align_gap_opens = r.align_gap_opens;
+        a->align_gap_columns = r.align_gap_columns;
+        a->align_columns = r.align_columns;
+        a->alignment = 0;
+        a->alignment_len = 0;
+        a->cigar_ops = 0;
+        a->cigar_ops_len = 0;
+
+        alist->alignments[alist->len++] = a;
+
+        if( r.alignment_len ) {
+            a->alignment = xmalloc( r.alignment_len );
+            a->alignment_len = r.alignment_len - 1;
+            if( !read_all( fd, a->alignment, r.alignment_len ) ) {
+                a_free( alist );
+                return 0;
+            }
+        }
+        if( r.cigar_ops_len ) {
+            a->cigar_ops = xmalloc( r.cigar_ops_len * sizeof(uint32_t) );
+            a->cigar_ops_len = r.cigar_ops_len;
+            if( !read_all( fd, a->cigar_ops, r.cigar_ops_len * sizeof(uint32_t) ) ) {
+                a_free( alist );
+                return 0;
+            }
+        }
+    }
+
+    return alist;
+}
+
+static void run_worker( int fd, p_query query, size_t hit_count, int search_type, int bit_width, int align_type,
+        size_t start, size_t end, size_t thread_count ) {
+    // the workers of the thread pool were not copied into this process
+    reset_thread_pool();
+    max_thread_count = thread_count;
+
+    ctx_current->range_start = start;
+    ctx_current->range_end = end;
+
+    if( search_type == SMITH_WATERMAN ) {
+        init_for_sw( query, bit_width, align_type );
+    }
+    else {
+        init_for_nw( query, bit_width, align_type );
+    }
+
+    p_alignment_list alist = m_run( hit_count );
+
+    write_list( fd, alist );
+    close( fd );
+
+    _exit( EXIT_SUCCESS );
+}
+
+p_alignment_list sh_run( p_query query, size_t hit_count, int search_type, int bit_width, int align_type,
+        size_t shard_count ) {
+    if( !shard_count ) {
+        shard_count = 1;
+    }
+
+    // the workers and the coordinator have to see the same version of the database
+    ctx_pin_database();
+
+    size_t start = ctx_db_range_start();
+    size_t count = ctx_db_range_end() - start;
+
+    // an empty shard would search the whole database, as its range end is 0
+    if( shard_count > count ) {
+        shard_count = count;
+    }
+    if( !shard_count ) {
+        ctx_unpin_database();
+        return a_merge( 0, 0, hit_count );
+    }
+
+    size_t thread_count = get_max_thread_count();
+    thread_count /= shard_count;
+    if( !thread_count ) {
+        thread_count = 1;
+    }
+
+    pid_t workers[shard_count];
+    int pipes[shard_count];
+
+    for( size_t i = 0; i < shard_count; i++ ) {
+        int fds[2];
+        if( pipe( fds ) ) {
+            fatal( "Could not create the pipe of a shard: %s", strerror( errno ) );
+        }
+
+        workers[i] = fork();
+        if( workers[i] < 0 ) {
+            fatal( "Could not start the worker of a shard: %s", strerror( errno ) );
+        }
+
+        if( !workers[i] ) {
+            close( fds[0] );
+            // the pipes of the previous workers belong to the coordinator
+            for( size_t j = 0; j < i; j++ ) {
+                close( pipes[j] );
+            }
+
+            run_worker( fds[1], query, hit_count, search_type, bit_width, align_type,
+                    start + i * count / shard_count, start + (i + 1) * count / shard_count, thread_count );
+        }
+
+        close( fds[1] );
+        pipes[i] = fds[0];
+    }
+
+    p_alignment_list lists[shard_count];
+    int failed = 0;
+
+    for( size_t i = 0; i < shard_count; i++ ) {
+        lists[i] = read_list( pipes[i], query );
+        close( pipes[i] );
+
+        int status;
+        while( (waitpid( workers[i], &status, 0 ) < 0) && (errno == EINTR) ) {
+        }
+
+        if( !lists[i] || !WIFEXITED( status ) || (WEXITSTATUS( status ) != EXIT_SUCCESS) ) {
+            print_error( "The worker of shard %ld failed.", i );
+            failed = 1;
+        }
+    }
+
+    ctx_unpin_database();
+
+    if( failed ) {
+        for( size_t i = 0; i < shard_count; i++ ) {
+            a_free( lists[i] );
+        }
+        fatal( "Sharded search failed." );
+    }
+
+    return a_merge( lists, shard_count, hit_count );
+}
@@ -0,0 +1,35 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#ifndef SHARDED_SEARCH_H_
+#define SHARDED_SEARCH_H_
+
+#include "../libssa_datatypes.h"
+
+/**
+ * Splits the ID range of the database of the current context into
+ * 'shard_count' parts and searches each part in its own worker process. The
+ * results of the workers are merged into the best 'hit_count' alignments.
+ *
+ * The threads of the current process are split among the workers.
+ */
+p_alignment_list sh_run( p_query query, size_t hit_count, int search_type, int bit_width, int align_type,
+        size_t shard_count );
+
+#endif /* SHARDED_SEARCH_H_ */
@@ -0,0 +1,176 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+/*
+ * Computes the banded global alignment scores of a query and multiple database
+ * sequences, see search_banded.h.
+ *
+ * Each channel holds one database sequence. The DP runs over the columns of
+ * the database sequences, like the full search, but in column j only the rows
+ * j - hi to j - lo are computed. All channels share the band, so the sequences
+ * of a call should have similar lengths. Cells outside the band are treated as
+ * unreachable. The borders of the matrix are scored like in full_nw, so that
+ * the scores are the same, if the optimum lies within the band.
+ *
+ * The scores need 32 bit, so that long alignments do not overflow.
+ *
+ * This file is compiled to 2 versions: 32 bit SSE2 and 32 bit AVX2. SSE2 has
+ * no maximum of signed 32 bit values, it is replaced by a combination of masks.
+ */
+
+#include "../banded/search_banded.h"
+
+#include <immintrin.h>
+#include <limits.h>
+
+#include "../../util/util.h"
+#include "../../matrices.h"
+#include "../align.h"
+#include "../gap_costs.h"
+
+#ifdef __AVX2__
+
+typedef __m256i __mxxxi;
+
+#define _mmxxx_add_epi32 _mm256_add_epi32
+#define _mmxxx_set1_epi32 _mm256_set1_epi32
+#define _mmxxx_max_epi32 _mm256_max_epi32
+
+#define CHANNELS BAND_CHANNELS_AVX2
+#define nw_band_32_XXX nw_band_32_avx2
+
+#else // SSE2
+
+typedef __m128i __mxxxi;
+
+#define _mmxxx_add_epi32 _mm_add_epi32
+#define _mmxxx_set1_epi32 _mm_set1_epi32
+
+#define CHANNELS BAND_CHANNELS_SSE2
+#define nw_band_32_XXX nw_band_32_sse2
+
+static inline __m128i _mmxxx_max_epi32( __m128i a, __m128i b ) {
+    __m128i mask = _mm_cmpgt_epi32( a, b );
+    return _mm_or_si128( _mm_and_si128( mask, a ), _mm_andnot_si128( mask, b ) );
+}
+
+#endif /* __AVX2__ */
+
+// value of the cells outside the band, and substitution score of the channels
+// behind the end of their sequence
+#define UNREACHABLE (INT32_MIN / 4)
+
+typedef union {
+    __mxxxi v;
+    int32_t a[CHANNELS];
+} vector_t;
+
+void nw_band_32_XXX( sequence_t query, sequence_t * d_seqs, size_t count, long lo, long hi, int64_t * scores ) {
+    long qlen = query.len;
+    size_t dlen_max = 0;
+    for( size_t c = 0; c < count; c++ ) {
+        dlen_max = MAX( dlen_max, d_seqs[c].len );
+    }
+
+    // only the symbols of the query need a profile line
+    int sym_count = 0;
+    for( long i = 0; i < qlen; i++ ) {
+        sym_count = MAX( sym_count, (uint8_t) query.seq[i] + 1 );
+    }
+
+    __mxxxi gap_extend = _mmxxx_set1_epi32( gapE );
+    __mxxxi gap_open_extend = _mmxxx_set1_epi32( gapO + gapE );
+    __mxxxi unreachable = _mmxxx_set1_epi32( UNREACHABLE );
+
+    vector_t * profile = xmalloc( sym_count * sizeof(vector_t) );
+
+    // H and E values of the previous column
+    __mxxxi * hearray = xmalloc( 2 * qlen * sizeof(__mxxxi) );
+
+    for( long i = 0; i < qlen; i++ ) {
+        if( -1 - i >= lo ) {
+            // the border column lies within the band
+            hearray[2 * i] = _mmxxx_set1_epi32( gapO + (i + 1) * gapE );
+            hearray[2 * i + 1] = _mmxxx_set1_epi32( 2 * gapO + (i + 2) * gapE );
+        }
+        else {
+            hearray[2 * i] = unreachable;
+            hearray[2 * i + 1] = unreachable;
+        }
+    }
+
+    for( long j = 0; j < (long) dlen_max; j++ ) {
+        for( int s = 0; s < sym_count; s++ ) {
+            for( int c = 0; c < CHANNELS; c++ ) {
+                profile[s].a[c] =
+                        ((c < count) && (j < d_seqs[c].len)) ?
+                                SCORE_MATRIX_64( (uint8_t ) d_seqs[c].seq[j], s ) : UNREACHABLE;
+            }
+        }
+
+        long first = MAX( 0, j - hi );
+        long last = MIN( qlen - 1, j - lo );
+
+        __mxxxi h; // diagonally previous value
+        __mxxxi f; // value in upper cell
+
+        if( first == 0 ) {
+            h = _mmxxx_set1_epi32( (j == 0) ? 0 : (gapO + j * gapE) );
+            f = (j + 1 <= hi) ? _mmxxx_set1_epi32( 2 * gapO + (j + 2) * gapE ) : unreachable;
+        }
+        else {
+            // the upper cell lies on the diagonal above the band
+            h = hearray[2 * (first - 1)];
+            f = unreachable;
+        }
+
+        __mxxxi * hep = hearray + 2 * first;
+
+        for( long i = first; i <= last; i++ ) {
+            __mxxxi n = hep[0];
+            __mxxxi e = hep[1];
+
+            h = _mmxxx_add_epi32( h, profile[(uint8_t) query.seq[i]].v );
+            h = _mmxxx_max_epi32( h, f );
+            h = _mmxxx_max_epi32( h, e );
+
+            hep[0] = h;
+
+            h = _mmxxx_add_epi32( h, gap_open_extend );
+            hep[1] = _mmxxx_max_epi32( _mmxxx_add_epi32( e, gap_extend ), h );
+            f = _mmxxx_max_epi32( _mmxxx_add_epi32( f, gap_extend ), h );
+
+            h = n;
+            hep += 2;
+        }
+
+        // the score of a channel is in the last cell of its last column
+        vector_t last_cell;
+        last_cell.v = hearray[2 * (qlen - 1)];
+
+        for( size_t c = 0; c < count; c++ ) {
+            if( d_seqs[c].len == j + 1 ) {
+                scores[c] = last_cell.a[c];
+            }
+        }
+    }
+
+    free( hearray );
+    free( profile );
+}
@@ -0,0 +1,106 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+/*
+ * Computes the edit distances of a query of at most 64 symbols and up to four
+ * database sequences at once, see search_ed.h.
+ *
+ * Each 64 bit channel holds the vertical deltas of one database sequence, so
+ * the bit-vector algorithm runs unchanged in all channels. Only the masks of
+ * the symbols have to be looked up per channel. The value of the last row is
+ * kept per channel as well, and is taken for the result at the end of the
+ * sequence of the channel.
+ *
+ * This file is compiled only for AVX2.
+ */
+
+#include "../ed/search_ed.h"
+
+#include <immintrin.h>
+
+#include "../../util/util.h"
+
+void ed_distance_avx2( ed_query_t * q, sequence_t ** dseqs, size_t count, int mode, int64_t * distances ) {
+    union {
+        __m256i v;
+        int64_t a[ED_CHANNELS_AVX2];
+    } lens, result;
+
+    size_t dlen_max = 0;
+    for( int c = 0; c < ED_CHANNELS_AVX2; c++ ) {
+        lens.a[c] = (c < count) ? dseqs[c]->len : 0;
+        if( lens.a[c] > dlen_max ) {
+            dlen_max = lens.a[c];
+        }
+    }
+
+    __m256i ones = _mm256_set1_epi64x( -1 );
+    __m256i one = _mm256_set1_epi64x( 1 );
+    __m256i hin = _mm256_set1_epi64x( (mode == ED_SEMI_GLOBAL) ? 0 : 1 );
+    __m128i last_row = _mm_cvtsi32_si128( q->last_row );
+
+    __m256i pv = ones;
+    __m256i mv = _mm256_setzero_si256();
+
+    __m256i score = _mm256_set1_epi64x( q->len );
+    __m256i best = score;
+    __m256i last = score;
+
+    uint64_t eq_of[ED_CHANNELS_AVX2];
+
+    for( size_t j = 0; j < dlen_max; j++ ) {
+        for( int c = 0; c < ED_CHANNELS_AVX2; c++ ) {
+            eq_of[c] = (j < lens.a[c]) ? q->peq[(uint8_t) dseqs[c]->seq[j]] : 0;
+        }
+        __m256i eq = _mm256_loadu_si256( (__m256i *) eq_of );
+
+        __m256i xv = _mm256_or_si256( eq, mv );
+        __m256i xh = _mm256_or_si256(
+                _mm256_xor_si256( _mm256_add_epi64( _mm256_and_si256( eq, pv ), pv ), pv ), eq );
+
+        __m256i ph = _mm256_or_si256( mv, _mm256_xor_si256( _mm256_or_si256( xh, pv ), ones ) );
+        __m256i mh = _mm256_and_si256( pv, xh );
+
+        __m256i h = _mm256_sub_epi64( _mm256_and_si256( _mm256_srl_epi64( ph, last_row ), one ),
+                _mm256_and_si256( _mm256_srl_epi64( mh, last_row ), one ) );
+
+        ph = _mm256_or_si256( _mm256_slli_epi64( ph, 1 ), hin );
+        mh = _mm256_slli_epi64( mh, 1 );
+
+        pv = _mm256_or_si256( mh, _mm256_xor_si256( _mm256_or_si256( xv, ph ), ones ) );
+        mv = _mm256_and_si256( ph, xv );
+
+        score = _mm256_add_epi64( score, h );
+
+        __m256i column = _mm256_set1_epi64x( j );
+        __m256i active = _mm256_cmpgt_epi64( lens.v, column );
+
+        __m256i better = _mm256_and_si256( active, _mm256_cmpgt_epi64( best, score ) );
+        best = _mm256_blendv_epi8( best, score, better );
+
+        __m256i ends = _mm256_cmpeq_epi64( lens.v, _mm256_add_epi64( column, one ) );
+        last = _mm256_blendv_epi8( last, score, ends );
+    }
+
+    result.v = (mode == ED_GLOBAL) ? last : best;
+
+    for( size_t c = 0; c < count; c++ ) {
+        distances[c] = result.a[c];
+    }
+}
@@ -164,6 +164,51 @@ typedef int16_t intYY_t;
 static int d_idx;
 #endif
 
+/*
+ * Sets the value of one channel of a vector. The vector is accessed through a
+ * union, because a store through an intYY_t pointer may be dropped by the
+ * optimiser.
+ */
+static inline void set_channel( __mxxxi * v, int c, intYY_t value ) {
+    union {
+        __mxxxi v;
+        intYY_t a[CHANNELS];
+    } u;
+
+    u.v = *v;
+    u.a[c] = value;
+    *v = u.v;
+}
+
+// number of column blocks between two checks for channels to retire
+#define RETIRE_INTERVAL 16
+
+/*
+ * Marks the channels as retired, whose sequence cannot score above floor any
+ * more. Every global alignment passes a cell of the last computed column,
+ * none of which scores above h_max, and gains at most max_score per remaining
+ * column.
+ *
+ * @return 1 if a channel was retired, 0 otherwise
+ */
+static int retire_channels( intYY_t * h_max, uint8_t * retired, uint8_t * d_begin[CHANNELS],
+        uint8_t * d_end[CHANNELS], p_sdb_sequence * d_seq_ptr, long max_score, long floor ) {
+    int retire = 0;
+
+    for( int c = 0; c < CHANNELS; c++ ) {
+        if( !d_seq_ptr[c] || retired[c] || (h_max[c] == I_MAX) ) {
+            continue;
+        }
+
+        long bound = h_max[c] + (long) (d_end[c] - d_begin[c]) * max_score;
+        if( bound <= floor ) {
+            retired[c] = 1;
+            retire = 1;
+        }
+    }
+    return retire;
+}
+
 /*
  * All parameters are vectors of the type __mxxxi
  *
@@ -311,7 +356,7 @@ static void aligncolumns_rest( __mxxxi * Sm, __mxxxi * hep, __mxxxi ** qp, __mxx
     Sm[3] = hep[2 * (ql - 1) + 0];
 }
 
-void search_YY_XXX_nw( p_sYYinfo s, p_db_chunk chunk, p_minheap heap, p_db_chunk overflow_chunk, uint8_t q_id ) {
+void search_YY_XXX_nw( p_sYYinfo s, p_db_chunk chunk, p_search_result res, p_db_chunk overflow_chunk, uint8_t q_id ) {
 
 #ifdef DBG_COLLECT_MATRIX
     size_t maxdlen =  0;
@@ -336,6 +381,7 @@ void search_YY_XXX_nw( p_sYYinfo s, p_db_chunk chunk, p_minheap heap, p_db_chunk
     uint8_t * d_end[CHANNELS];
     size_t d_length[CHANNELS];
     p_sdb_sequence d_seq_ptr[CHANNELS];
+    uint8_t retired[CHANNELS];
 
     union {
         __mxxxi v[CDEPTH];
@@ -367,8 +413,11 @@ void search_YY_XXX_nw( p_sYYinfo s, p_db_chunk chunk, p_minheap heap, p_db_chunk
         d_end[c] = d_begin[c];
         d_length[c] = 0;
         d_seq_ptr[c] = 0;
+        retired[c] = 0;
     }
 
+    size_t blocks = 0;
+
     __mxxxi score_min = _mmxxx_set1_epiYY( I_MIN - s->penalty_gap_open - s->penalty_gap_extension -1 ); // TODO why + Q + R ???
     __mxxxi score_max = _mmxxx_set1_epiYY( I_MAX );
 
@@ -407,7 +456,7 @@ void search_YY_XXX_nw( p_sYYinfo s, p_db_chunk chunk, p_minheap heap, p_db_chunk
 
             M.v = _mmxxx_setzero_si();
             for( int c = 0; c < CHANNELS; c++ ) {
-                if( !overflow.a[c] && (d_begin[c] < d_end[c]) ) {
+                if( !overflow.a[c] && !retired[c] && (d_begin[c] < d_end[c]) ) {
                     /* the sequence in this channel is not finished yet */
 
                     change_sequences |= move_db_sequence_window_YY( c, d_begin, d_end, dseq_search_window );
@@ -417,14 +466,20 @@ void search_YY_XXX_nw( p_sYYinfo s, p_db_chunk chunk, p_minheap heap, p_db_chunk
 
                     M.a[c] = UI_MAX;
 
-                    if( d_seq_ptr[c] ) {
+                    if( d_seq_ptr[c] && retired[c] ) {
+                        /* the score cannot enter the results */
+
+                        retired[c] = 0;
+                        done++;
+                    }
+                    else if( d_seq_ptr[c] ) {
                         /* save score */
 
                         long z = (d_length[c] + 3) % 4;
                         long score = S.a[z * CHANNELS + c];
 
                         if( !overflow.a[c] && (score > I_MIN) && (score < I_MAX) ) {
-                            add_to_minheap( heap, q_id, d_seq_ptr[c], score );
+                            add_to_result( res, q_id, d_seq_ptr[c], score );
                         }
                         else {
                             overflow_chunk->seq[overflow_chunk->fill_pointer++] = d_seq_ptr[c];
@@ -442,15 +497,15 @@ void search_YY_XXX_nw( p_sYYinfo s, p_db_chunk chunk, p_minheap heap, p_db_chunk
                         d_begin[c] = (unsigned char*) d_seq_ptr[c]->seq.seq;
                         d_end[c] = (unsigned char*) d_seq_ptr[c]->seq.seq + d_seq_ptr[c]->seq.len;
 
-                        ((intYY_t*) &H0)[c] = 0;
-                        ((intYY_t*) &H1)[c] = s->penalty_gap_open + 1 * s->penalty_gap_extension;
-                        ((intYY_t*) &H2)[c] = s->penalty_gap_open + 2 * s->penalty_gap_extension;
-                        ((intYY_t*) &H3)[c] = s->penalty_gap_open + 3 * s->penalty_gap_extension;
+                        set_channel( &H0, c, 0 );
+                        set_channel( &H1, c, s->penalty_gap_open + 1 * s->penalty_gap_extension );
+                        set_channel( &H2, c, s->penalty_gap_open + 2 * s->penalty_gap_extension );
+                        set_channel( &H3, c, s->penalty_gap_open + 3 * s->penalty_gap_extension );
 
-                        ((intYY_t*) &F0)[c] = s->penalty_gap_open + 1 * s->penalty_gap_extension;
-                        ((intYY_t*) &F1)[c] = s->penalty_gap_open + 2 * s->penalty_gap_extension;
-                        ((intYY_t*) &F2)[c] = s->penalty_gap_open + 3 * s->penalty_gap_extension;
-                        ((intYY_t*) &F3)[c] = s->penalty_gap_open + 4 * s->penalty_gap_extension;
+                        set_channel( &F0, c, s->penalty_gap_open + 1 * s->penalty_gap_extension );
+                        set_channel( &F1, c, s->penalty_gap_open + 2 * s->penalty_gap_extension );
+                        set_channel( &F2, c, s->penalty_gap_open + 3 * s->penalty_gap_extension );
+                        set_channel( &F3, c, s->penalty_gap_open + 4 * s->penalty_gap_extension );
 
                         change_sequences |= move_db_sequence_window_YY( c, d_begin, d_end, dseq_search_window );
                     }
@@ -484,6 +539,21 @@ void search_YY_XXX_nw( p_sYYinfo s, p_db_chunk chunk, p_minheap heap, p_db_chunk
         overflow.v = _mmxxx_or_si( _mmxxx_cmpeq_epiYY( h_max, score_max ), overflow.v );
         change_sequences |= _mmxxx_movemask_epi8( overflow.v );
 
+        /*
+         * Channels, whose sequence cannot reach the results any more, are
+         * refilled like overflowing channels.
+         */
+        if( (s->retire_max_score >= 0) && !(++blocks % RETIRE_INTERVAL) ) {
+            union {
+                __mxxxi v;
+                intYY_t a[CHANNELS];
+            } block_max;
+            block_max.v = h_max;
+
+            change_sequences |= retire_channels( block_max.a, retired, d_begin, d_end, d_seq_ptr,
+                    s->retire_max_score, result_score_floor( res ) );
+        }
+
 #ifdef DBG_COLLECT_MATRIX
         d_idx += 4;
 #endif
@@ -0,0 +1,317 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+
+/*
+ * Computes the statistics of the alignments of a query and multiple database
+ * sequences, see align_stats.h.
+ *
+ * Each channel holds one database sequence. The DP runs over the columns of
+ * the database sequences and the rows of the query, like the search, but each
+ * H, E and F value is a cell_t, which carries the counters of the alignment
+ * ending in it. Whenever a value is selected from several candidates, the
+ * counters are selected with the same mask. Ties are broken like in the
+ * traceback: a gap is only taken, if it is strictly better.
+ *
+ * The counters need the full 32 bit of a channel, so that long alignments do
+ * not overflow.
+ *
+ * This file is compiled to 2 versions: 32 bit SSE2 and 32 bit AVX2. SSE2 has
+ * no blend instruction, it is replaced by a combination of masks.
+ */
+
+#include "../align_stats.h"
+#include "../align.h"
+
+#include <immintrin.h>
+#include <limits.h>
+#include <string.h>
+
+#include "../../util/util.h"
+#include "../../matrices.h"
+#include "../gap_costs.h"
+
+#ifdef __AVX2__
+
+typedef __m256i __mxxxi;
+
+#define _mmxxx_add_epi32 _mm256_add_epi32
+#define _mmxxx_sub_epi32 _mm256_sub_epi32
+#define _mmxxx_set1_epi32 _mm256_set1_epi32
+#define _mmxxx_setzero_si _mm256_setzero_si256
+#define _mmxxx_cmpgt_epi32 _mm256_cmpgt_epi32
+#define _mmxxx_cmpeq_epi32 _mm256_cmpeq_epi32
+#define _mmxxx_blendv_epi8 _mm256_blendv_epi8
+
+#define CHANNELS STATS_CHANNELS_AVX2
+#define stats_32_XXX stats_32_avx2
+
+#else // SSE2
+
+typedef __m128i __mxxxi;
+
+#define _mmxxx_add_epi32 _mm_add_epi32
+#define _mmxxx_sub_epi32 _mm_sub_epi32
+#define _mmxxx_set1_epi32 _mm_set1_epi32
+#define _mmxxx_setzero_si _mm_setzero_si128
+#define _mmxxx_cmpgt_epi32 _mm_cmpgt_epi32
+#define _mmxxx_cmpeq_epi32 _mm_cmpeq_epi32
+#define CHANNELS STATS_CHANNELS_SSE2
+#define stats_32_XXX stats_32_sse2
+
+static inline __m128i _mmxxx_blendv_epi8( __m128i a, __m128i b, __m128i mask ) {
+    return _mm_or_si128( _mm_and_si128( mask, b ), _mm_andnot_si128( mask, a ) );
+}
+
+#endif /* __AVX2__ */
+
+// substitution score of the channels behind the end of their sequence
+#define PADDING_SCORE (INT32_MIN / 4)
+
+/*
+ * Score and counters of the alignment ending in a cell.
+ *
+ * h:   score
+ * m:   matches
+ * x:   mismatches
+ * o:   gap openings
+ * qg:  gap columns consuming query symbols
+ * dg:  gap columns consuming database symbols
+ */
+typedef struct {
+    __mxxxi h;
+    __mxxxi m;
+    __mxxxi x;
+    __mxxxi o;
+    __mxxxi qg;
+    __mxxxi dg;
+} cell_t;
+
+typedef union {
+    __mxxxi v;
+    int32_t a[CHANNELS];
+} vector_t;
+
+/*
+ * Selects a in the channels set in mask and b in the others.
+ */
+static inline cell_t select_cell( __mxxxi mask, cell_t a, cell_t b ) {
+    cell_t r;
+    r.h = _mmxxx_blendv_epi8( b.h, a.h, mask );
+    r.m = _mmxxx_blendv_epi8( b.m, a.m, mask );
+    r.x = _mmxxx_blendv_epi8( b.x, a.x, mask );
+    r.o = _mmxxx_blendv_epi8( b.o, a.o, mask );
+    r.qg = _mmxxx_blendv_epi8( b.qg, a.qg, mask );
+    r.dg = _mmxxx_blendv_epi8( b.dg, a.dg, mask );
+    return r;
+}
+
+static inline cell_t zero_cell() {
+    cell_t r;
+    r.h = r.m = r.x = r.o = r.qg = r.dg = _mmxxx_setzero_si();
+    return r;
+}
+
+/*
+ * A cell at the border of the global DP matrix, which is reached by one or two
+ * gaps.
+ */
+static inline cell_t border_cell( long score, int opens, size_t q_gaps, size_t d_gaps ) {
+    cell_t r = zero_cell();
+    r.h = _mmxxx_set1_epi32( score );
+    r.o = _mmxxx_set1_epi32( opens );
+    r.qg = _mmxxx_set1_epi32( q_gaps );
+    r.dg = _mmxxx_set1_epi32( d_gaps );
+    return r;
+}
+
+/*
+ * Computes the gap value of the next cell: the gap of c is extended, or a new
+ * gap is opened after h. The gap consumes a query symbol, if q_gap is set,
+ * otherwise a database symbol.
+ */
+static inline cell_t next_gap( cell_t c, cell_t h, __mxxxi gap_open_extend, __mxxxi gap_extend, __mxxxi one,
+        int q_gap ) {
+    __mxxxi extended = _mmxxx_add_epi32( c.h, gap_extend );
+    __mxxxi opened = _mmxxx_add_epi32( h.h, gap_open_extend );
+
+    __mxxxi mask = _mmxxx_cmpgt_epi32( extended, opened );
+
+    cell_t r = select_cell( mask, c, h );
+    r.h = _mmxxx_blendv_epi8( opened, extended, mask );
+
+    // the mask is -1 in the extended channels, so these get no new opening
+    r.o = _mmxxx_add_epi32( _mmxxx_add_epi32( r.o, one ), mask );
+
+    if( q_gap ) {
+        r.qg = _mmxxx_add_epi32( r.qg, one );
+    }
+    else {
+        r.dg = _mmxxx_add_epi32( r.dg, one );
+    }
+
+    return r;
+}
+
+static void store_channel( align_stats_t * s, cell_t c, int channel, size_t q_end, size_t d_end ) {
+    vector_t v;
+
+    v.v = c.h;
+    s->score = v.a[channel];
+    v.v = c.m;
+    s->matches = v.a[channel];
+    v.v = c.x;
+    s->mismatches = v.a[channel];
+    v.v = c.o;
+    s->gap_opens = v.a[channel];
+    v.v = c.qg;
+    s->q_gaps = v.a[channel];
+    v.v = c.dg;
+    s->d_gaps = v.a[channel];
+
+    s->q_end = q_end;
+    s->d_end = d_end;
+}
+
+void stats_32_XXX( int search_type, sequence_t query, sequence_t * d_seqs, size_t count, align_stats_t * stats ) {
+    int global = (search_type == NEEDLEMAN_WUNSCH);
+
+    size_t qlen = query.len;
+    size_t dlen_max = 0;
+    for( size_t c = 0; c < count; c++ ) {
+        dlen_max = MAX( dlen_max, d_seqs[c].len );
+    }
+
+    // only the symbols of the query need a profile line
+    int sym_count = 0;
+    for( size_t i = 0; i < qlen; i++ ) {
+        sym_count = MAX( sym_count, (uint8_t) query.seq[i] + 1 );
+    }
+
+    __mxxxi one = _mmxxx_set1_epi32( 1 );
+    __mxxxi gap_extend = _mmxxx_set1_epi32( gapE );
+    __mxxxi gap_open_extend = _mmxxx_set1_epi32( gapO + gapE );
+
+    vector_t * profile = xmalloc( sym_count * sizeof(vector_t) );
+    vector_t d_sym;
+
+    // H and E cells of the previous column
+    cell_t * hearray = xmalloc( 2 * qlen * sizeof(cell_t) );
+
+    for( size_t i = 0; i < qlen; i++ ) {
+        if( global ) {
+            hearray[2 * i] = border_cell( gapO + (i + 1) * gapE, 1, i + 1, 0 );
+            hearray[2 * i + 1] = border_cell( 2 * gapO + (i + 2) * gapE, 2, i + 1, 1 );
+        }
+        else {
+            hearray[2 * i] = zero_cell();
+            hearray[2 * i + 1] = zero_cell();
+        }
+    }
+
+    // best cell of each channel in the local alignment, and its position
+    cell_t best = zero_cell();
+    __mxxxi best_i = _mmxxx_setzero_si();
+    __mxxxi best_j = _mmxxx_setzero_si();
+
+    for( size_t j = 0; j < dlen_max; j++ ) {
+        for( int c = 0; c < CHANNELS; c++ ) {
+            d_sym.a[c] = ((c < count) && (j < d_seqs[c].len)) ? (uint8_t) d_seqs[c].seq[j] : -1;
+        }
+        for( int s = 0; s < sym_count; s++ ) {
+            for( int c = 0; c < CHANNELS; c++ ) {
+                profile[s].a[c] = (d_sym.a[c] >= 0) ? SCORE_MATRIX_64( d_sym.a[c], s ) : PADDING_SCORE;
+            }
+        }
+
+        cell_t diag;
+        cell_t f;
+        if( global ) {
+            diag = (j == 0) ? zero_cell() : border_cell( gapO + j * gapE, 1, 0, j );
+            f = border_cell( 2 * gapO + (j + 2) * gapE, 2, 1, j + 1 );
+        }
+        else {
+            diag = zero_cell();
+            f = zero_cell();
+        }
+
+        __mxxxi col = _mmxxx_set1_epi32( j );
+
+        cell_t h = diag;
+        cell_t * hep = hearray;
+
+        for( size_t i = 0; i < qlen; i++ ) {
+            cell_t n = hep[0];
+            cell_t e = hep[1];
+
+            uint8_t q_sym = query.seq[i];
+
+            // diagonal step: a match or a mismatch
+            __mxxxi match = _mmxxx_cmpeq_epi32( d_sym.v, _mmxxx_set1_epi32( q_sym ) );
+
+            h = diag;
+            h.h = _mmxxx_add_epi32( h.h, profile[q_sym].v );
+            h.m = _mmxxx_sub_epi32( h.m, match );
+            h.x = _mmxxx_add_epi32( _mmxxx_add_epi32( h.x, one ), match );
+
+            h = select_cell( _mmxxx_cmpgt_epi32( f.h, h.h ), f, h );
+            h = select_cell( _mmxxx_cmpgt_epi32( e.h, h.h ), e, h );
+
+            if( !global ) {
+                // a local alignment starts again after a cell without a positive score
+                h = select_cell( _mmxxx_cmpgt_epi32( h.h, _mmxxx_setzero_si() ), h, zero_cell() );
+
+                __mxxxi better = _mmxxx_cmpgt_epi32( h.h, best.h );
+                best = select_cell( better, h, best );
+                best_i = _mmxxx_blendv_epi8( best_i, _mmxxx_set1_epi32( i ), better );
+                best_j = _mmxxx_blendv_epi8( best_j, col, better );
+            }
+
+            hep[0] = h;
+            hep[1] = next_gap( e, h, gap_open_extend, gap_extend, one, 0 );
+            f = next_gap( f, h, gap_open_extend, gap_extend, one, 1 );
+
+            diag = n;
+            hep += 2;
+        }
+
+        if( global && qlen ) {
+            // the global alignment of a channel ends in the last cell of its last column
+            for( int c = 0; c < count; c++ ) {
+                if( d_seqs[c].len == j + 1 ) {
+                    store_channel( &stats[c], h, c, qlen - 1, j );
+                }
+            }
+        }
+    }
+
+    if( !global ) {
+        vector_t bi;
+        vector_t bj;
+        bi.v = best_i;
+        bj.v = best_j;
+
+        for( int c = 0; c < count; c++ ) {
+            store_channel( &stats[c], best, c, bi.a[c], bj.a[c] );
+        }
+    }
+
+    free( hearray );
+    free( profile );
+}
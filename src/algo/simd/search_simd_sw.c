@@ -157,6 +157,34 @@ typedef int16_t intYY_t;
 static int d_idx;
 #endif
 
+// number of column blocks between two checks for channels to retire
+#define RETIRE_INTERVAL 16
+
+/*
+ * Marks the channels as retired, whose sequence cannot score above floor any
+ * more. A local alignment ending in a later column can gain at most
+ * max_score per remaining column on top of the best cell so far.
+ *
+ * @return 1 if a channel was retired, 0 otherwise
+ */
+static int retire_channels( intYY_t * S, uint8_t * retired, uint8_t * d_begin[CHANNELS], uint8_t * d_end[CHANNELS],
+        p_sdb_sequence * d_seq_ptr, long max_score, long floor ) {
+    int retire = 0;
+
+    for( int c = 0; c < CHANNELS; c++ ) {
+        if( !d_seq_ptr[c] || retired[c] || (S[c] == I_MAX) ) {
+            continue;
+        }
+
+        long bound = S[c] + -I_MIN + (long) (d_end[c] - d_begin[c]) * max_score;
+        if( bound <= floor ) {
+            retired[c] = 1;
+            retire = 1;
+        }
+    }
+    return retire;
+}
+
 /*
  * All parameters are vectors of the type __mxxxi
  *
@@ -276,7 +304,7 @@ static void aligncolumns_rest( __mxxxi * S, __mxxxi * hep, __mxxxi ** qp, __mxxx
     }
 }
 
-void search_YY_XXX_sw( p_sYYinfo s, p_db_chunk chunk, p_minheap heap, p_db_chunk overflow_chunk, uint8_t q_id ) {
+void search_YY_XXX_sw( p_sYYinfo s, p_db_chunk chunk, p_search_result res, p_db_chunk overflow_chunk, uint8_t q_id ) {
 
 #ifdef DBG_COLLECT_MATRIX
     size_t maxdlen = 0;
@@ -300,6 +328,7 @@ void search_YY_XXX_sw( p_sYYinfo s, p_db_chunk chunk, p_minheap heap, p_db_chunk
     uint8_t * d_begin[CHANNELS];
     uint8_t * d_end[CHANNELS];
     p_sdb_sequence d_seq_ptr[CHANNELS];
+    uint8_t retired[CHANNELS];
 
     union {
         __mxxxi v;
@@ -330,10 +359,13 @@ void search_YY_XXX_sw( p_sYYinfo s, p_db_chunk chunk, p_minheap heap, p_db_chunk
         d_begin[c] = 0;
         d_end[c] = d_begin[c];
         d_seq_ptr[c] = 0;
+        retired[c] = 0;
     }
 
     __mxxxi score_max = _mmxxx_set1_epiYY( I_MAX );
 
+    size_t blocks = 0;
+
     int change_sequences = 1;
     while( 1 ) {
         if( !change_sequences ) {
@@ -356,7 +388,7 @@ void search_YY_XXX_sw( p_sYYinfo s, p_db_chunk chunk, p_minheap heap, p_db_chunk
             M.v = _mmxxx_set1_epiYY( I_MAX );
             for( int c = 0; c < CHANNELS; c++ ) {
 
-                if( !overflow.a[c] && (d_begin[c] < d_end[c]) ) {
+                if( !overflow.a[c] && !retired[c] && (d_begin[c] < d_end[c]) ) {
                     /* the sequence in this channel is not finished yet */
 
                     change_sequences |= move_db_sequence_window_YY( c, d_begin, d_end, dseq_search_window );
@@ -366,13 +398,19 @@ void search_YY_XXX_sw( p_sYYinfo s, p_db_chunk chunk, p_minheap heap, p_db_chunk
 
                     M.a[c] = I_MIN;
 
-                    if( d_seq_ptr[c] ) {
+                    if( d_seq_ptr[c] && retired[c] ) {
+                        /* the score cannot enter the results */
+
+                        retired[c] = 0;
+                        done++;
+                    }
+                    else if( d_seq_ptr[c] ) {
                         /* save score */
 
                         long score = S.a[c] + -I_MIN; // convert score back to range from 0 - I_MAX
 
                         if( !overflow.a[c] && (score < UI_MAX) ) {
-                            add_to_minheap( heap, q_id, d_seq_ptr[c], score );
+                            add_to_result( res, q_id, d_seq_ptr[c], score );
                         }
                         else {
                             overflow_chunk->seq[overflow_chunk->fill_pointer++] = d_seq_ptr[c];
@@ -422,6 +460,15 @@ void search_YY_XXX_sw( p_sYYinfo s, p_db_chunk chunk, p_minheap heap, p_db_chunk
         overflow.v = _mmxxx_cmpeq_epiYY( S.v, score_max );
         change_sequences |= _mmxxx_movemask_epi8( overflow.v );
 
+        /*
+         * Channels, whose sequence cannot reach the results any more, are
+         * refilled like overflowing channels.
+         */
+        if( (s->retire_max_score >= 0) && !(++blocks % RETIRE_INTERVAL) ) {
+            change_sequences |= retire_channels( S.a, retired, d_begin, d_end, d_seq_ptr, s->retire_max_score,
+                    result_score_floor( res ) );
+        }
+
 #ifdef DBG_COLLECT_MATRIX
         d_idx += 4;
 #endif
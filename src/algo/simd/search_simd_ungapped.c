@@ -0,0 +1,198 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+/*
+ * Computes the best ungapped local alignment score of the query and multiple
+ * database sequences, as the first stage of a search.
+ *
+ * The database sequences are processed in the channels and with the database
+ * profile of the 16 bit Smith-Waterman search in search_simd_sw.c. Without
+ * gaps only the diagonal predecessor of a cell is needed, so each cell costs
+ * one addition and one maximum.
+ *
+ * Scores are biased by INT16_MIN like in the Smith-Waterman search, so that
+ * the saturated addition keeps them from falling below zero.
+ *
+ * This file is compiled to 2 versions: 16 bit SSE2 and 16 bit AVX2.
+ */
+
+#include "../16/search_16.h"
+#include "../16/search_16_util.h"
+
+#include <limits.h>
+#include <string.h>
+
+#include "../../util/util.h"
+
+#ifdef __AVX2__
+
+#define _mmxxx_adds_epi16 _mm256_adds_epi16
+#define _mmxxx_max_epi16 _mm256_max_epi16
+#define _mmxxx_min_epi16 _mm256_min_epi16
+#define _mmxxx_set1_epi16 _mm256_set1_epi16
+
+#define search_16_XXX_ungapped search_16_avx2_ungapped
+#define dprofile_fill_16_xxx dprofile_fill_16_avx2
+
+#else // SSE2
+
+#define _mmxxx_adds_epi16 _mm_adds_epi16
+#define _mmxxx_max_epi16 _mm_max_epi16
+#define _mmxxx_min_epi16 _mm_min_epi16
+#define _mmxxx_set1_epi16 _mm_set1_epi16
+
+#define search_16_XXX_ungapped search_16_sse2_ungapped
+#define dprofile_fill_16_xxx dprofile_fill_16_sse2
+
+#endif /* __AVX2__ */
+
+#define CHANNELS CHANNELS_16_BIT
+#define CDEPTH CDEPTH_16_BIT
+
+/*
+ * H: diagonal score, becomes the score of the current cell
+ * N: score of the current cell, saved for the next row
+ * V: substitution scores from the db profile
+ * S: max score of this alignment
+ */
+#define UNGAPPEDCORE(H, N, V, S)                                                   \
+ H = _mmxxx_adds_epi16(H, V);         /* add value of scoring profile */       \
+ S = _mmxxx_max_epi16(H, S);          /* save max score */                     \
+ N = H;
+
+/*
+ * Computes the next CDEPTH columns. The column before them is read from hep.
+ * M is INT16_MIN in channels, in which a new database sequence starts, and
+ * INT16_MAX in the others.
+ */
+static void ungapped_columns( __mxxxi * S, __mxxxi * hep, __mxxxi ** qp, __mxxxi M, size_t ql ) {
+    __mxxxi h4, h5, h6, h7, h8;
+    __mxxxi * vp;
+
+    __mxxxi h0, h1, h2, h3;
+
+    h0 = h1 = h2 = h3 = _mmxxx_set1_epi16( INT16_MIN );
+
+    for( size_t i = 0; i < ql; i++ ) {
+        vp = qp[i];
+
+        h4 = _mmxxx_min_epi16( hep[2 * i], M );
+
+        UNGAPPEDCORE( h0, h5, vp[0], *S );
+        UNGAPPEDCORE( h1, h6, vp[1], *S );
+        UNGAPPEDCORE( h2, h7, vp[2], *S );
+        UNGAPPEDCORE( h3, h8, vp[3], *S );
+
+        hep[2 * i] = h8;
+
+        h0 = h4;
+        h1 = h5;
+        h2 = h6;
+        h3 = h7;
+    }
+}
+
+void search_16_XXX_ungapped( p_s16info s, p_db_chunk chunk, uint8_t q_id, int64_t * scores ) {
+    size_t qlen = s->queries[q_id]->q_len;
+
+    __mxxxi * hep = s->hearray;
+
+    uint8_t * d_begin[CHANNELS];
+    uint8_t * d_end[CHANNELS];
+    size_t d_pos[CHANNELS]; // position of the sequence in the chunk
+
+    union {
+        __mxxxi v;
+        int16_t a[CHANNELS];
+    } S;
+    union {
+        __mxxxi v;
+        int16_t a[CHANNELS];
+    } M;
+
+    uint16_t dseq_search_window[CDEPTH * CHANNELS];
+
+    size_t next_id = 0;
+    size_t done = 0;
+
+    for( int c = 0; c < CHANNELS; c++ ) {
+        d_begin[c] = 0;
+        d_end[c] = 0;
+        d_pos[c] = SIZE_MAX;
+    }
+
+    S.v = _mmxxx_set1_epi16( INT16_MIN );
+
+    int change_sequences = 1;
+    while( 1 ) {
+        M.v = _mmxxx_set1_epi16( INT16_MAX );
+
+        if( change_sequences ) {
+            change_sequences = 0;
+
+            for( int c = 0; c < CHANNELS; c++ ) {
+                if( d_begin[c] < d_end[c] ) {
+                    continue;
+                }
+
+                /* sequence in channel c ended */
+
+                M.a[c] = INT16_MIN;
+
+                if( d_pos[c] != SIZE_MAX ) {
+                    long score = S.a[c] + -INT16_MIN; // convert score back to range from 0 - UINT16_MAX
+
+                    if( score > scores[d_pos[c]] ) {
+                        scores[d_pos[c]] = score;
+                    }
+
+                    done++;
+                }
+
+                S.a[c] = INT16_MIN;
+
+                if( next_id < chunk->fill_pointer ) {
+                    d_pos[c] = next_id;
+                    d_begin[c] = (uint8_t *) chunk->seq[next_id]->seq.seq;
+                    d_end[c] = d_begin[c] + chunk->seq[next_id]->seq.len;
+
+                    next_id++;
+                }
+                else {
+                    d_pos[c] = SIZE_MAX;
+                    d_begin[c] = 0;
+                    d_end[c] = 0;
+                }
+            }
+
+            if( done == chunk->fill_pointer ) {
+                break;
+            }
+        }
+
+        /* fill all channels with symbols from the database sequences */
+        for( int c = 0; c < CHANNELS; c++ ) {
+            change_sequences |= move_db_sequence_window_16( c, d_begin, d_end, dseq_search_window );
+        }
+
+        dprofile_fill_16_xxx( s->dprofile, dseq_search_window );
+
+        ungapped_columns( &S.v, hep, s->queries[q_id]->q_table, M.v, qlen );
+    }
+}
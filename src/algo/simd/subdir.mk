@@ -6,7 +6,14 @@ OBJS_COMPILE_SEPARATE += \
 ./src/algo/simd/16_simd_nw_sse2.o \
 ./src/algo/simd/16_simd_sw_sse2.o \
 ./src/algo/simd/16_simd_nw_avx2.o \
-./src/algo/simd/16_simd_sw_avx2.o
+./src/algo/simd/16_simd_sw_avx2.o \
+./src/algo/simd/16_simd_ungapped_sse2.o \
+./src/algo/simd/16_simd_ungapped_avx2.o \
+./src/algo/simd/32_simd_stats_sse2.o \
+./src/algo/simd/32_simd_stats_avx2.o \
+./src/algo/simd/64_simd_ed_avx2.o \
+./src/algo/simd/32_simd_banded_sse2.o \
+./src/algo/simd/32_simd_banded_avx2.o
 
 src/algo/simd/8_simd_nw_sse41.o: src/algo/simd/search_simd_nw.c $(DEPS)
 	$(CXX) $(CXXFLAGS) -msse4.1 -DSEARCH_8_BIT -c -o $@ $<
@@ -31,3 +38,24 @@ src/algo/simd/16_simd_nw_avx2.o: src/algo/simd/search_simd_nw.c $(DEPS)
 	
 src/algo/simd/16_simd_sw_avx2.o: src/algo/simd/search_simd_sw.c $(DEPS)
 	$(CXX) $(CXXFLAGS) -mavx2 -c -o $@ $<
+
+src/algo/simd/16_simd_ungapped_sse2.o: src/algo/simd/search_simd_ungapped.c $(DEPS)
+	$(CXX) $(CXXFLAGS) -msse2 -c -o $@ $<
+
+src/algo/simd/16_simd_ungapped_avx2.o: src/algo/simd/search_simd_ungapped.c $(DEPS)
+	$(CXX) $(CXXFLAGS) -mavx2 -c -o $@ $<
+
+src/algo/simd/32_simd_stats_sse2.o: src/algo/simd/search_simd_stats.c $(DEPS)
+	$(CXX) $(CXXFLAGS) -msse2 -c -o $@ $<
+
+src/algo/simd/32_simd_stats_avx2.o: src/algo/simd/search_simd_stats.c $(DEPS)
+	$(CXX) $(CXXFLAGS) -mavx2 -c -o $@ $<
+
+src/algo/simd/64_simd_ed_avx2.o: src/algo/simd/search_simd_ed.c $(DEPS)
+	$(CXX) $(CXXFLAGS) -mavx2 -c -o $@ $<
+
+src/algo/simd/32_simd_banded_sse2.o: src/algo/simd/search_simd_banded.c $(DEPS)
+	$(CXX) $(CXXFLAGS) -msse2 -c -o $@ $<
+
+src/algo/simd/32_simd_banded_avx2.o: src/algo/simd/search_simd_banded.c $(DEPS)
+	$(CXX) $(CXXFLAGS) -mavx2 -c -o $@ $<
@@ -2,7 +2,15 @@ OBJS += \
 ./src/algo/aligner.o \
 ./src/algo/searcher.o \
 ./src/algo/manager.o \
+./src/algo/batcher.o \
+./src/algo/pair_aligner.o \
+./src/algo/async_search.o \
+./src/algo/sharded_search.o \
+./src/algo/ungapped_filter.o \
+./src/algo/hit_stream.o \
+./src/algo/result_table.o \
 ./src/algo/align.o \
+./src/algo/align_stats.o \
 ./src/algo/cigar.o
 
 USER_OBJS += \
@@ -10,7 +18,15 @@ USER_OBJS += \
 ./src/algo/searcher.h \
 ./src/algo/search.h \
 ./src/algo/manager.h \
+./src/algo/batcher.h \
+./src/algo/pair_aligner.h \
+./src/algo/async_search.h \
+./src/algo/sharded_search.h \
+./src/algo/ungapped_filter.h \
+./src/algo/hit_stream.h \
+./src/algo/result_table.h \
 ./src/algo/align.h \
+./src/algo/align_stats.h \
 ./src/algo/align_simd.h
 
 TO_CLEAN +=
\ No newline at end of file
@@ -0,0 +1,97 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+/*
+ * Implements the ungapped prefilter.
+ *
+ * The threads of the pool scan the database in chunks, like in a search, and
+ * write the ungapped score of each sequence into a shared array. As every
+ * sequence is part of exactly one chunk, no locking is needed. Sequences, that
+ * were not scanned because the search was cancelled or ran out of budget, keep
+ * a score of -1 and are never selected.
+ */
+
+#include "ungapped_filter.h"
+
+#include <stdlib.h>
+
+#include "../context.h"
+#include "../db_adapter.h"
+#include "../util/thread_pool.h"
+#include "../util/util.h"
+#include "16/search_16.h"
+
+static void * uf_scan( void * data ) {
+    int64_t * scores = data;
+    size_t range_start = ctx_db_range_start();
+
+    p_s16info s16info = search_16_init( ctx_current->search.sdp );
+
+    p_db_chunk chunk = adp_init_new_chunk();
+    int64_t * chunk_scores = 0;
+    size_t chunk_scores_size = 0;
+
+    adp_next_chunk( chunk );
+
+    while( chunk->fill_pointer ) {
+        if( chunk_scores_size < chunk->fill_pointer ) {
+            free( chunk_scores );
+            chunk_scores_size = chunk->fill_pointer;
+            chunk_scores = xmalloc( chunk_scores_size * sizeof(int64_t) );
+        }
+
+        search_16_ungapped_chunk( s16info, chunk, ctx_current->search.sdp, chunk_scores );
+
+        // strands and frames of a sequence share its score
+        for( size_t i = 0; i < chunk->fill_pointer; i++ ) {
+            size_t j = chunk->seq[i]->ID - range_start;
+
+            if( chunk_scores[i] > scores[j] ) {
+                scores[j] = chunk_scores[i];
+            }
+        }
+
+        adp_next_chunk( chunk );
+    }
+
+    free( chunk_scores );
+    adp_free_chunk( chunk );
+    search_16_exit( s16info );
+
+    return NULL;
+}
+
+void uf_select_candidates( int64_t min_score, size_t max_candidates ) {
+    size_t range_start = ctx_db_range_start();
+    size_t range_len = ctx_db_range_end() - range_start;
+
+    int64_t * scores = xmalloc( (range_len + 1) * sizeof(int64_t) );
+    for( size_t i = 0; i < range_len; i++ ) {
+        scores[i] = -1;
+    }
+
+    start_threads( uf_scan, scores );
+
+    void * thread_results[get_current_thread_count()];
+    wait_for_threads( thread_results );
+
+    adp_select_candidates( scores, min_score, max_candidates );
+
+    free( scores );
+}
@@ -0,0 +1,37 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#ifndef UNGAPPED_FILTER_H_
+#define UNGAPPED_FILTER_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Computes the best ungapped alignment score of each sequence of the running
+ * search with the queries and keeps the sequences with a score of at least
+ * min_score as candidates. If max_candidates is not 0, at most
+ * max_candidates sequences with the highest scores are kept.
+ *
+ * The scores are computed with the 16 bit SIMD layout, independent of the bit
+ * width of the search. The search has to be initialised before.
+ */
+void uf_select_candidates( int64_t min_score, size_t max_candidates );
+
+#endif /* UNGAPPED_FILTER_H_ */
@@ -0,0 +1,289 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#define _POSIX_C_SOURCE 200112L // clock_gettime
+
+#include "context.h"
+
+#include <stdlib.h>
+#include <limits.h>
+#include <string.h>
+#include <time.h>
+
+#include "matrices.h"
+#include "db_snapshot.h"
+#include "db_dedup.h"
+#include "kmer_index.h"
+#include "util/util.h"
+#include "algo/manager.h"
+
+/*
+ * The context used by the functions of libssa.h, which do not take a context.
+ */
+static ssa_context_t default_context = {
+    .sym_type = DEFAULT_SYMTYPE,
+    .strands = DEFAULT_STRAND,
+    .chunk_size = DEFAULT_CHUNK_SIZE,
+    .chunk_mutex = PTHREAD_MUTEX_INITIALIZER,
+    .align_type = MNGR_NOT_INITIALIZED,
+    .ungapped_min_score = -1,
+    .progress_mutex = PTHREAD_MUTEX_INITIALIZER,
+    .progress_callback_mutex = PTHREAD_MUTEX_INITIALIZER,
+    .search = { .score_floor = LONG_MIN } };
+
+__thread p_ssa_context ctx_current = &default_context;
+
+p_ssa_context ctx_create() {
+    p_ssa_context ctx = xmalloc( sizeof(ssa_context_t) );
+    memset( ctx, 0, sizeof(ssa_context_t) );
+
+    ctx->sym_type = DEFAULT_SYMTYPE;
+    ctx->strands = DEFAULT_STRAND;
+    ctx->chunk_size = DEFAULT_CHUNK_SIZE;
+    ctx->align_type = MNGR_NOT_INITIALIZED;
+    ctx->ungapped_min_score = -1;
+    ctx_reset_search_state( &ctx->search );
+
+    pthread_mutex_init( &ctx->chunk_mutex, NULL );
+    pthread_mutex_init( &ctx->progress_mutex, NULL );
+    pthread_mutex_init( &ctx->progress_callback_mutex, NULL );
+
+    return ctx;
+}
+
+void ctx_free( p_ssa_context ctx ) {
+    if( !ctx || (ctx == &default_context) ) {
+        return;
+    }
+
+    p_ssa_context prev = ctx_enter( ctx );
+    mat_free();
+    ctx_leave( prev );
+
+    dd_free( ctx->dedup_cache );
+    ki_free( ctx->kmer_cache );
+    free( ctx->search.candidates );
+
+    pthread_mutex_destroy( &ctx->chunk_mutex );
+    pthread_mutex_destroy( &ctx->progress_mutex );
+    pthread_mutex_destroy( &ctx->progress_callback_mutex );
+
+    free( ctx );
+}
+
+p_ssa_context ctx_create_copy() {
+    p_ssa_context copy = xmalloc( sizeof(ssa_context_t) );
+    *copy = *ctx_current;
+
+    // the caches and the state of the searches of the original are not shared
+    copy->dedup_cache = 0;
+    copy->kmer_cache = 0;
+    copy->progress_callback = 0;
+    ctx_reset_search_state( &copy->search );
+
+    if( copy->database ) {
+        // the copy keeps the snapshot, even if it is empty
+        if( copy->snapshot ) {
+            dbs_retain( copy->database, copy->snapshot );
+        }
+        copy->snapshot_pins = 1;
+    }
+
+    pthread_mutex_init( &copy->chunk_mutex, NULL );
+    pthread_mutex_init( &copy->progress_mutex, NULL );
+    pthread_mutex_init( &copy->progress_callback_mutex, NULL );
+
+    return copy;
+}
+
+void ctx_free_copy( p_ssa_context copy ) {
+    if( !copy ) {
+        return;
+    }
+
+    if( copy->database && copy->snapshot ) {
+        dbs_release( copy->database, copy->snapshot );
+    }
+
+    pthread_mutex_destroy( &copy->chunk_mutex );
+    pthread_mutex_destroy( &copy->progress_mutex );
+    pthread_mutex_destroy( &copy->progress_callback_mutex );
+
+    free( copy );
+}
+
+void ctx_reset_search_state( struct ssa_search_state * search ) {
+    memset( search, 0, sizeof(struct ssa_search_state) );
+    search->score_floor = LONG_MIN;
+}
+
+p_ssa_context ctx_enter( p_ssa_context ctx ) {
+    p_ssa_context prev = ctx_current;
+    ctx_current = ctx ? ctx : &default_context;
+    return prev;
+}
+
+void ctx_leave( p_ssa_context prev ) {
+    ctx_current = prev;
+}
+
+void ctx_cancel( p_ssa_context ctx ) {
+    __atomic_store_n( &ctx->search.cancelled, 1, __ATOMIC_RELAXED );
+}
+
+int ctx_is_cancelled() {
+    return __atomic_load_n( &ctx_current->search.cancelled, __ATOMIC_RELAXED );
+}
+
+/*
+ * Returns the time of a monotonic clock in seconds.
+ */
+static double get_time() {
+    struct timespec now;
+    clock_gettime( CLOCK_MONOTONIC, &now );
+
+    return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+void ctx_start_budget() {
+    ctx_current->search.budget_exceeded = 0;
+
+    if( ctx_current->time_budget > 0 ) {
+        ctx_current->search.deadline = get_time() + ctx_current->time_budget;
+    }
+}
+
+int ctx_check_budget( size_t next_start ) {
+    p_ssa_context ctx = ctx_current;
+
+    size_t start = ctx_db_range_start();
+    if( (next_start == start) || (next_start >= ctx_search_end()) ) {
+        // the first chunk is always searched, and at the end nothing is missed
+        return 0;
+    }
+
+    if( (ctx->max_sequences && (next_start - start >= ctx->max_sequences))
+            || ((ctx->time_budget > 0) && (get_time() >= ctx->search.deadline)) ) {
+        __atomic_store_n( &ctx->search.budget_exceeded, 1, __ATOMIC_RELAXED );
+        return 1;
+    }
+    return 0;
+}
+
+// version of the external database, incremented when it is replaced
+static size_t extern_db_version = 1;
+
+void ctx_extern_db_changed() {
+    __atomic_add_fetch( &extern_db_version, 1, __ATOMIC_SEQ_CST );
+}
+
+const void * ctx_db_identity( size_t * version ) {
+    if( ctx_current->database ) {
+        *version = ctx_current->snapshot ? ctx_current->snapshot->version : 0;
+        return ctx_current->database;
+    }
+    if( ctx_current->db_sequences ) {
+        *version = 0;
+        return ctx_current->db_sequences;
+    }
+    *version = __atomic_load_n( &extern_db_version, __ATOMIC_SEQ_CST );
+    return 0;
+}
+
+void ctx_pin_database() {
+    p_ssa_context ctx = ctx_current;
+
+    if( ctx->database && !ctx->snapshot_pins++ ) {
+        ctx->snapshot = dbs_acquire( ctx->database );
+    }
+}
+
+void ctx_unpin_database() {
+    p_ssa_context ctx = ctx_current;
+
+    if( ctx->database && !--ctx->snapshot_pins ) {
+        if( ctx->snapshot ) {
+            dbs_release( ctx->database, ctx->snapshot );
+        }
+        ctx->snapshot = 0;
+    }
+}
+
+size_t ctx_db_get_sequence_count() {
+    if( ctx_current->database ) {
+        if( ctx_current->snapshot ) {
+            return ctx_current->snapshot->count;
+        }
+        return ctx_current->snapshot_pins ? 0 : dbs_get_sequence_count( ctx_current->database );
+    }
+    if( !ctx_current->db_sequences ) {
+        return ssa_db_get_sequence_count();
+    }
+    return ctx_current->db_sequence_count;
+}
+
+p_seqinfo ctx_db_get_sequence( size_t id ) {
+    if( ctx_current->database ) {
+        // the sequences can only be accessed by a search, that pinned the snapshot
+        p_db_snapshot snapshot = ctx_current->snapshot;
+        if( !snapshot || (id >= snapshot->count) ) {
+            return 0;
+        }
+        return &snapshot->sequences[id];
+    }
+    if( !ctx_current->db_sequences ) {
+        return ssa_db_get_sequence( id );
+    }
+    if( id >= ctx_current->db_sequence_count ) {
+        return 0;
+    }
+    return &ctx_current->db_sequences[id];
+}
+
+size_t ctx_db_range_end() {
+    size_t count = ctx_db_get_sequence_count();
+
+    if( ctx_current->range_end && (ctx_current->range_end < count) ) {
+        return ctx_current->range_end;
+    }
+    return count;
+}
+
+size_t ctx_db_range_start() {
+    size_t end = ctx_db_range_end();
+
+    if( ctx_current->range_start < end ) {
+        return ctx_current->range_start;
+    }
+    return end;
+}
+
+size_t ctx_search_end() {
+    if( ctx_current->search.candidates ) {
+        return ctx_db_range_start() + ctx_current->search.candidate_count;
+    }
+    return ctx_db_range_end();
+}
+
+size_t ctx_search_id( size_t position ) {
+    if( ctx_current->search.candidates ) {
+        return ctx_current->search.candidates[position - ctx_db_range_start()];
+    }
+    return position;
+}
@@ -0,0 +1,371 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#ifndef CONTEXT_H_
+#define CONTEXT_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "libssa_datatypes.h"
+
+struct s8info;
+struct s16info;
+struct db_snapshot;
+struct dedup_index;
+struct kmer_index;
+struct hit_stream;
+struct thread_group;
+
+/** @typedef    state of the running search of a context
+ *
+ * Set up and released by each search. A copy of a context starts with a reset
+ * state, see ctx_reset_search_state.
+ *
+ * @field dedup_active      index used by the running search, 0 if the search
+ *                          scores all sequences
+ * @field candidates        IDs of the sequences selected by the prefilters of
+ *                          the running search, in the order in which they are
+ *                          searched. If set, only these sequences are searched.
+ * @field score_floor       highest minimum of the full heaps of the threads of
+ *                          the running search. Hits, which do not score above
+ *                          it, cannot be part of the results. Only kept by
+ *                          the searches, which prune, retire or limit their
+ *                          sequences with it.
+ * @field dense_scores      if set, the running search keeps no hits, but writes
+ *                          the best score of each sequence into this array,
+ *                          indexed by the ID of the sequence
+ * @field hit_stream        if set, the running search keeps no hits, but passes
+ *                          them to the callback of this streaming search
+ * @field threads           threads started by this context, which have not
+ *                          been waited for
+ * @field cancelled         read with ctx_is_cancelled
+ * @field budget_exceeded   set, if the search stopped early, because its time
+ *                          or work budget was used up
+ * @field progress_heaps    copies of the heaps of the threads, published after
+ *                          each chunk for the progress callback
+ * @field progress_reported number of finished chunks, that the last call of the
+ *                          progress callback reported
+ */
+struct ssa_search_state {
+    struct dedup_index * dedup_active;
+
+    size_t * candidates;
+    size_t candidate_count;
+
+    p_search_data sdp;
+
+    // highest heap minimum of the threads of the running search
+    long score_floor;
+
+    // if set, the search writes the score of every sequence into this array
+    int32_t * dense_scores;
+
+    // if set, the search passes its hits to this stream
+    struct hit_stream * hit_stream;
+
+    // hits of a previous search, merged into the result of an incremental search
+    p_minheap seed_hits;
+
+    // aligner
+    p_alignment_data adp;
+    size_t align_counter;
+
+    struct thread_group * threads;
+
+    // set to stop the running search at the next chunk
+    int cancelled;
+
+    double deadline;
+    int budget_exceeded;
+
+    p_search_result * progress_owners;
+    p_minheap * progress_heaps;
+    size_t progress_slot_count;
+    size_t progress_chunks;
+    size_t progress_reported;
+};
+
+/** @typedef    configuration and state of a search
+ *
+ * Everything a search depends on is stored in a context: the scoring, the
+ * symbol translation, the database and the state of the running search. The
+ * context of the current thread is accessed through ctx_current. The old
+ * global names, like gapO or symtype, are macros for the fields of the current
+ * context.
+ *
+ * The threads of the thread pool run with the context of the thread, that
+ * started them.
+ *
+ * @field db_sequences      sequences of the database. If not set, the external
+ *                          database library is used.
+ * @field database          if set, searches use the snapshot of this database,
+ *                          which was current when they started
+ * @field snapshot_pins     nesting depth of ctx_pin_database
+ * @field deduplicate       if set, searches score identical sequences only once
+ * @field dedup_cache       index of the identical sequences of the database,
+ *                          kept for the following searches
+ * @field kmer_k            length of the k-mers of the prefilter, 0 for the
+ *                          default length
+ * @field kmer_cache        k-mer index of the database, kept for the following
+ *                          searches
+ * @field ungapped_min_score  minimal ungapped score of the sequences passed to
+ *                          the search, -1 if the ungapped prefilter is disabled
+ * @field prefilter_sequences   number of sequences ranked by the last prefilter
+ * @field prefilter_candidates  number of sequences it passed to the search
+ * @field bound_pruning     if set, the sequences are searched from the longest
+ *                          to the shortest, and sequences, whose score bound is
+ *                          not above the hits of a thread, are skipped
+ * @field bound_max_score   highest substitution score, used for the bounds
+ * @field pruned_sequences  number of sequences skipped in the last search
+ * @field nw_band           half width of the band of the global searches and
+ *                          alignments, NW_BAND_ADAPTIVE or 0 for the full
+ *                          matrix
+ * @field cigar_format      form of the CIGAR of the computed alignments, one of
+ *                          the CIGAR_FORMAT_* constants
+ * @field band_sequences    number of sequences scored within the band in the
+ *                          last search
+ * @field band_fallbacks    number of sequences of the last search, whose
+ *                          optimum could lie outside the band, and which were
+ *                          aligned with the full matrix
+ * @field range_start       first ID of the searched part of the database
+ * @field range_end         ID after the searched part of the database. If 0,
+ *                          the search goes up to the last sequence.
+ * @field thread_count      number of threads, that the next start_threads of
+ *                          this context uses. Set by init_thread_pool.
+ * @field search            state of the running search, which a copy of the
+ *                          context does not share
+ */
+struct ssa_context {
+    // scoring
+    int8_t gap_open;
+    int8_t gap_extend;
+
+    int8_t * matrix_8;
+    int16_t * matrix_16;
+    int64_t * matrix_64;
+    int constant_scoring;
+
+    // symbol translation
+    int sym_type;
+    int strands;
+
+    char q_translate[16 * 16 * 16];
+    char d_translate[16 * 16 * 16];
+
+    // database
+    p_seqinfo db_sequences;
+    size_t db_sequence_count;
+
+    // replaceable database and the snapshot pinned by the running search
+    p_ssa_database database;
+    struct db_snapshot * snapshot;
+    int snapshot_pins;
+
+    // groups of identical sequences
+    int deduplicate;
+    struct dedup_index * dedup_cache;
+
+    // k-mer prefilter
+    size_t kmer_k;
+    size_t prefilter_min_shared;
+    size_t prefilter_max_candidates;
+    struct kmer_index * kmer_cache;
+
+    // ungapped prefilter, a min_score below 0 disables it
+    int64_t ungapped_min_score;
+    size_t ungapped_max_candidates;
+
+    size_t prefilter_sequences;
+    size_t prefilter_candidates;
+
+    // IDs of the searched part of the database, 0 as end means all sequences
+    size_t range_start;
+    size_t range_end;
+
+    // database adapter
+    size_t chunk_size;
+    size_t chunk_db_seq_count;
+    size_t next_chunk_start;
+    int buffer_max;
+    pthread_mutex_t chunk_mutex;
+
+    // searcher
+    int align_type;
+    void (*search_func)( p_db_chunk, p_search_data, p_search_result );
+
+    void (*search_8_algo)( struct s8info *, p_db_chunk, p_search_result, p_db_chunk, uint8_t );
+    void (*search_16_algo)( struct s16info *, p_db_chunk, p_search_result, p_db_chunk, uint8_t );
+    int64_t (*search_64_algo)( sequence_t *, sequence_t *, int64_t * );
+    void (*search_64_init)( sequence_t *, int64_t * );
+    int64_t (*search_64_columns)( sequence_t *, sequence_t *, int64_t *, size_t, size_t, int64_t );
+
+    // reuse the DP columns of common prefixes in the 64 bit search
+    int prefix_sharing;
+
+    // skip sequences, whose score bound cannot reach the results
+    int bound_pruning;
+    int64_t bound_max_score;
+    size_t pruned_sequences;
+
+    // banded global alignment, 0 for the full matrix
+    long nw_band;
+    size_t band_sequences;
+    size_t band_fallbacks;
+
+    int cigar_format;
+
+    size_t thread_count;
+
+    // budget of a search, 0 means unlimited
+    double time_budget;
+    size_t max_sequences;
+
+    // progress of the running search
+    ssa_progress_callback progress_callback;
+    void * progress_data;
+    pthread_mutex_t progress_mutex;
+    // held by the thread, that calls the progress callback
+    pthread_mutex_t progress_callback_mutex;
+
+    struct ssa_search_state search;
+};
+
+/**
+ * The context of the calling thread. Points to the default context, if no
+ * other context was entered.
+ */
+extern __thread p_ssa_context ctx_current;
+
+/**
+ * Creates a new context with the default configuration.
+ */
+p_ssa_context ctx_create();
+
+/**
+ * Releases a context created by ctx_create, including its scoring matrices.
+ */
+void ctx_free( p_ssa_context ctx );
+
+/**
+ * Creates a context with the configuration of the current context, which
+ * keeps the snapshot of the database pinned by the running search. It is used
+ * to work on the results of the search after the search has ended, and it
+ * starts its own threads.
+ *
+ * The scoring matrices are shared, so the current context has to stay valid
+ * and its scoring unchanged, until the copy is released with ctx_free_copy.
+ */
+p_ssa_context ctx_create_copy();
+
+void ctx_free_copy( p_ssa_context copy );
+
+/**
+ * Resets the state of the running search, before a context starts its first
+ * search.
+ */
+void ctx_reset_search_state( struct ssa_search_state * search );
+
+/**
+ * Makes ctx the context of the calling thread.
+ *
+ * @return the previous context of the thread, which has to be passed to
+ *         ctx_leave
+ */
+p_ssa_context ctx_enter( p_ssa_context ctx );
+
+void ctx_leave( p_ssa_context prev );
+
+/**
+ * Stops the search running in ctx. The workers stop at the next chunk.
+ */
+void ctx_cancel( p_ssa_context ctx );
+
+/**
+ * Returns 1, if the search of the current context was cancelled.
+ */
+int ctx_is_cancelled();
+
+/**
+ * Starts the time budget of a search in the current context.
+ */
+void ctx_start_budget();
+
+/**
+ * Checks the budget of the current context, before the database sequences
+ * starting at next_start are searched. Sets budget_exceeded, if the budget is
+ * used up. The first chunk of a search is always searched.
+ *
+ * @return 1 if the search has to stop, 0 otherwise
+ */
+int ctx_check_budget( size_t next_start );
+
+/**
+ * Accessors for the database of the current context.
+ */
+size_t ctx_db_get_sequence_count();
+
+p_seqinfo ctx_db_get_sequence( size_t id );
+
+/**
+ * Identifies the database of the current context, for data computed from it,
+ * like indices. The database is unchanged, as long as the returned pointer and
+ * version are the same.
+ */
+const void * ctx_db_identity( size_t * version );
+
+/**
+ * Has to be called, when the external database is replaced.
+ */
+void ctx_extern_db_changed();
+
+/**
+ * Makes the running search of the current context use the current snapshot of
+ * its database, until ctx_unpin_database is called. Calls can be nested.
+ */
+void ctx_pin_database();
+
+void ctx_unpin_database();
+
+/**
+ * Returns the searched ID range [start, end) of the database of the current
+ * context, limited to the sequences of the database.
+ */
+size_t ctx_db_range_start();
+
+size_t ctx_db_range_end();
+
+/**
+ * Returns the end of the positions handed out to the searching threads. The
+ * positions start at ctx_db_range_start. Without prefilter candidates they
+ * are the IDs of the searched range, with candidates position p stands for
+ * the candidate p - ctx_db_range_start.
+ */
+size_t ctx_search_end();
+
+/**
+ * Returns the ID of the sequence at a position handed out to the searching
+ * threads.
+ *
+ * @see ctx_search_end
+ */
+size_t ctx_search_id( size_t position );
+
+#endif /* CONTEXT_H_ */
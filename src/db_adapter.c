@@ -20,20 +20,26 @@
 #include "db_adapter.h"
 
 #include <stdlib.h>
+#include <limits.h>
+#include <stdint.h>
 #include <pthread.h>
 #include <assert.h>
 
 #include "util/util_sequence.h"
-#include "libssa_extern_db.h"
+#include "context.h"
+#include "matrices.h"
+#include "algo/gap_costs.h"
+#include "db_dedup.h"
 #include "util/util.h"
 #include "query.h"
 #include "util/thread_pool.h"
 
-static size_t chunk_db_seq_count = 0;
-static size_t next_chunk_start = 0;
+// the state of the adapter is kept in the current context
+#define chunk_db_seq_count (ctx_current->chunk_db_seq_count)
+#define next_chunk_start (ctx_current->next_chunk_start)
 
-static int buffer_max = 0;
-static pthread_mutex_t chunk_mutex = PTHREAD_MUTEX_INITIALIZER; // TODO change to non static initialisation
+#define buffer_max (ctx_current->buffer_max)
+#define chunk_mutex (ctx_current->chunk_mutex)
 
 static void realloc_sequence( sequence_t * seq, size_t len ) {
     seq->seq = xrealloc( seq->seq, len + 1 );
@@ -116,7 +122,10 @@ void adp_exit() {
 }
 
 void adp_init( size_t size ) {
-    next_chunk_start = 0;
+    next_chunk_start = ctx_db_range_start();
+
+    // no thread has a full heap yet
+    ctx_current->search.score_floor = LONG_MIN;
 
     chunk_db_seq_count = size;
 
@@ -187,6 +196,7 @@ void adp_free_chunk( p_db_chunk chunk ) {
 p_db_chunk adp_alloc_chunk( size_t size ) {
     p_db_chunk chunk = xmalloc( sizeof(db_chunk_t) );
     chunk->fill_pointer = 0;
+    chunk->bound_result = 0;
     chunk->size = size;
     chunk->seq = xmalloc( chunk->size * sizeof(p_sdb_sequence) );
 
@@ -209,20 +219,161 @@ p_db_chunk adp_init_new_chunk() {
     return chunk;
 }
 
-void adp_next_chunk( p_db_chunk chunk ) {
+/*
+ * Returns the highest score, that a database sequence of length dlen can
+ * reach with one of the queries. A local alignment has at most as many
+ * aligned pairs as the shorter sequence. A global alignment needs a gap of at
+ * least the length difference in addition.
+ *
+ * The score of an edit distance search is the negative distance. It is at
+ * least the number of query symbols, that do not fit into the sequence, and
+ * for a global alignment at least the length difference.
+ */
+static long score_bound( size_t dlen ) {
+    p_search_data sdp = ctx_current->search.sdp;
+    int search_type = ctx_current->search.adp->search_type;
+    int global = (search_type == NEEDLEMAN_WUNSCH) || (search_type == EDIT_DISTANCE + ED_GLOBAL);
+
+    long best = LONG_MIN;
+
+    for( size_t q = 0; q < sdp->q_count; q++ ) {
+        size_t qlen = sdp->queries[q].seq.len;
+        size_t diff = (qlen < dlen) ? (dlen - qlen) : (qlen - dlen);
+
+        long bound;
+        if( IS_EDIT_DISTANCE( search_type ) ) {
+            bound = (global || (qlen > dlen)) ? -(long) diff : 0;
+        }
+        else {
+            bound = ctx_current->bound_max_score * (long) ((qlen < dlen) ? qlen : dlen);
+
+            if( global && (qlen != dlen) ) {
+                bound += gapO + (long) diff * gapE;
+            }
+        }
+
+        if( bound > best ) {
+            best = bound;
+        }
+    }
+    return best;
+}
+
+static int is_translated_db() {
+    return (symtype == TRANS_DB) || (symtype == TRANS_BOTH);
+}
+
+/*
+ * Returns the length of the longest part of a DB sequence, that is scored:
+ * the sequence itself, or its longest frame for translated databases.
+ */
+static size_t scored_length( size_t seqlen ) {
+    return is_translated_db() ? seqlen / 3 : seqlen;
+}
+
+/*
+ * Returns the highest score bound of the scored parts of a DB sequence of
+ * length seqlen. The frames of a translated sequence are scored on their own.
+ */
+static long sequence_bound( size_t seqlen ) {
+    if( !is_translated_db() ) {
+        return score_bound( seqlen );
+    }
+
+    long best = LONG_MIN;
+    for( size_t frame = 0; (frame < 3) && (frame <= seqlen); frame++ ) {
+        long bound = score_bound( (seqlen - frame) / 3 );
+        if( bound > best ) {
+            best = bound;
+        }
+    }
+    return best;
+}
+
+/*
+ * Returns 1, if a sequence of length seqlen cannot enter the results of the
+ * search. A score equal to the floor of the result is not added.
+ */
+static int is_pruned( p_db_chunk chunk, size_t seqlen ) {
+    if( !chunk->bound_result ) {
+        return 0;
+    }
+
+    long floor = result_score_floor( chunk->bound_result );
+    return (floor != LONG_MIN) && (sequence_bound( seqlen ) <= floor);
+}
+
+/*
+ * Returns the first position at or after start, from which on all sequences
+ * are pruned. The sequences are ordered by decreasing length and the bound
+ * grows with the scored length up to the length of the shortest query, so
+ * that a binary search suffices.
+ */
+static size_t find_pruned_positions( p_db_chunk chunk, size_t start ) {
+    size_t end = ctx_search_end();
+
+    size_t monotone_len = SIZE_MAX;
+    int search_type = ctx_current->search.adp->search_type;
+    if( (search_type == NEEDLEMAN_WUNSCH) || (search_type == EDIT_DISTANCE + ED_GLOBAL) ) {
+        monotone_len = ctx_current->search.sdp->maxqlen;
+        for( size_t q = 0; q < ctx_current->search.sdp->q_count; q++ ) {
+            if( ctx_current->search.sdp->queries[q].seq.len < monotone_len ) {
+                monotone_len = ctx_current->search.sdp->queries[q].seq.len;
+            }
+        }
+    }
+
+    while( start < end ) {
+        size_t mid = start + (end - start) / 2;
+        size_t seqlen = ctx_db_get_sequence( ctx_search_id( mid ) )->seqlen;
+
+        if( (scored_length( seqlen ) <= monotone_len) && is_pruned( chunk, seqlen ) ) {
+            end = mid;
+        }
+        else {
+            start = mid + 1;
+        }
+    }
+    return start;
+}
+
+size_t adp_count_searched( size_t start, size_t end ) {
+    if( !ctx_current->search.dedup_active ) {
+        return end - start;
+    }
+
+    size_t count = 0;
+    for( size_t i = start; i < end; i++ ) {
+        count += dd_is_searched( ctx_current->search.dedup_active, ctx_search_id( i ), ctx_db_range_start() );
+    }
+    return count;
+}
+
+/**
+ * Fills the chunk with the DB sequences starting at the sequence with the ID
+ * start. Sequences of length zero and sequences outside of the searched ID
+ * range are skipped. If the prefilter selected candidates, start is a position
+ * in the candidates instead, see ctx_search_id.
+ *
+ * In contrast to adp_next_chunk, this function does not use the shared chunk
+ * counter. It can be used by threads, that have to process the whole database.
+ */
+void adp_fill_chunk( p_db_chunk chunk, size_t start ) {
     assert( chunk );
 
     chunk->fill_pointer = 0;
 
-    size_t next_chunk;
-
-    pthread_mutex_lock( &chunk_mutex );
-    next_chunk = next_chunk_start;
-    next_chunk_start += chunk_db_seq_count;
-    pthread_mutex_unlock( &chunk_mutex );
+    size_t end = start + chunk_db_seq_count;
+    if( end > ctx_search_end() ) {
+        end = ctx_search_end();
+    }
+    if( start < ctx_db_range_start() ) {
+        start = ctx_db_range_start();
+    }
 
-    for( size_t i = next_chunk; i < (next_chunk + chunk_db_seq_count); i++ ) {
-        p_seqinfo db_seq = ssa_db_get_sequence( i );
+    for( size_t i = start; i < end; i++ ) {
+        size_t id = ctx_search_id( i );
+        p_seqinfo db_seq = ctx_db_get_sequence( id );
 
         if( !db_seq ) {
             break;
@@ -232,8 +383,180 @@ void adp_next_chunk( p_db_chunk chunk ) {
             continue;
         }
 
+        if( ctx_current->search.dedup_active && !dd_is_searched( ctx_current->search.dedup_active, id, ctx_db_range_start() ) ) {
+            // an identical sequence is searched instead
+            continue;
+        }
+
+        if( is_pruned( chunk, db_seq->seqlen ) ) {
+            __atomic_add_fetch( &ctx_current->pruned_sequences, 1, __ATOMIC_RELAXED );
+            continue;
+        }
+
         set_translated_sequences( db_seq, chunk->seq + chunk->fill_pointer );
 
         chunk->fill_pointer += buffer_max;
     }
 }
+
+void adp_next_chunk( p_db_chunk chunk ) {
+    assert( chunk );
+
+    if( ctx_is_cancelled() ) {
+        chunk->fill_pointer = 0;
+        return;
+    }
+
+    size_t next_chunk;
+
+    do {
+        pthread_mutex_lock( &chunk_mutex );
+        next_chunk = next_chunk_start;
+        int stop = ctx_check_budget( next_chunk );
+
+        if( !stop && chunk->bound_result && (next_chunk < ctx_search_end())
+                && (find_pruned_positions( chunk, next_chunk ) == next_chunk) ) {
+            // none of the remaining sequences can score above the shared floor, so none reaches the results
+            __atomic_add_fetch( &ctx_current->pruned_sequences, adp_count_searched( next_chunk, ctx_search_end() ),
+                    __ATOMIC_RELAXED );
+            next_chunk_start = ctx_search_end();
+            stop = 1;
+        }
+
+        if( !stop ) {
+            next_chunk_start += chunk_db_seq_count;
+        }
+        pthread_mutex_unlock( &chunk_mutex );
+
+        if( stop ) {
+            chunk->fill_pointer = 0;
+            return;
+        }
+
+        adp_fill_chunk( chunk, next_chunk );
+
+        // an empty chunk ends the search, so chunks without searched sequences are skipped
+    } while( !chunk->fill_pointer && (next_chunk + chunk_db_seq_count < ctx_search_end()) );
+}
+
+typedef struct {
+    size_t id;
+    int64_t score;
+} candidate_t;
+
+static int compare_candidates( const void * a, const void * b ) {
+    const candidate_t * x = a;
+    const candidate_t * y = b;
+
+    if( x->score != y->score ) {
+        return (x->score > y->score) ? -1 : 1;
+    }
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+static int compare_ids( const void * a, const void * b ) {
+    size_t x = *(const size_t *) a;
+    size_t y = *(const size_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+void adp_select_candidates( int64_t * scores, int64_t min_score, size_t max_candidates ) {
+    size_t range_start = ctx_db_range_start();
+    size_t source_count = ctx_search_end() - range_start;
+
+    candidate_t * candidates = xmalloc( (source_count + 1) * sizeof(candidate_t) );
+    size_t count = 0;
+
+    for( size_t p = range_start; p < ctx_search_end(); p++ ) {
+        size_t id = ctx_search_id( p );
+
+        if( scores[id - range_start] >= min_score ) {
+            candidates[count].id = id;
+            candidates[count].score = scores[id - range_start];
+            count++;
+        }
+    }
+
+    if( max_candidates && (count > max_candidates) ) {
+        qsort( candidates, count, sizeof(candidate_t), compare_candidates );
+        count = max_candidates;
+    }
+
+    size_t * ids = xmalloc( (count + 1) * sizeof(size_t) );
+    for( size_t i = 0; i < count; i++ ) {
+        ids[i] = candidates[i].id;
+    }
+
+    // the candidates are searched in the order of the database
+    qsort( ids, count, sizeof(size_t), compare_ids );
+
+    free( candidates );
+
+    adp_free_candidates();
+
+    ctx_current->search.candidates = ids;
+    ctx_current->search.candidate_count = count;
+
+    ctx_current->prefilter_sequences = source_count;
+    ctx_current->prefilter_candidates = count;
+
+    next_chunk_start = range_start;
+
+    print_info( "Prefilter: %ld of %ld sequences are candidates\n", count, source_count );
+}
+
+void adp_free_candidates() {
+    free( ctx_current->search.candidates );
+    ctx_current->search.candidates = 0;
+    ctx_current->search.candidate_count = 0;
+}
+
+typedef struct {
+    size_t id;
+    size_t len;
+} length_entry_t;
+
+static int compare_lengths( const void * a, const void * b ) {
+    const length_entry_t * x = a;
+    const length_entry_t * y = b;
+
+    if( x->len != y->len ) {
+        return (x->len > y->len) ? -1 : 1;
+    }
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+void adp_init_bound_pruning() {
+    ctx_current->pruned_sequences = 0;
+
+    if( !ctx_current->bound_pruning ) {
+        return;
+    }
+
+    ctx_current->bound_max_score = mat_get_max_score();
+
+    size_t range_start = ctx_db_range_start();
+    size_t count = ctx_search_end() - range_start;
+
+    length_entry_t * entries = xmalloc( (count + 1) * sizeof(length_entry_t) );
+    for( size_t i = 0; i < count; i++ ) {
+        entries[i].id = ctx_search_id( range_start + i );
+        entries[i].len = ctx_db_get_sequence( entries[i].id )->seqlen;
+    }
+
+    qsort( entries, count, sizeof(length_entry_t), compare_lengths );
+
+    size_t * ids = xmalloc( (count + 1) * sizeof(size_t) );
+    for( size_t i = 0; i < count; i++ ) {
+        ids[i] = entries[i].id;
+    }
+    free( entries );
+
+    adp_free_candidates();
+
+    ctx_current->search.candidates = ids;
+    ctx_current->search.candidate_count = count;
+
+    next_chunk_start = range_start;
+}
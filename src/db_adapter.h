@@ -32,8 +32,47 @@ p_db_chunk adp_alloc_chunk( size_t size );
 p_db_chunk adp_init_new_chunk();
 
 void adp_next_chunk( p_db_chunk chunk );
+void adp_fill_chunk( p_db_chunk chunk, size_t start );
+
+/**
+ * Returns the number of sequences at the search positions [start, end), that
+ * are searched and not represented by an identical sequence. See
+ * ctx_search_id.
+ */
+size_t adp_count_searched( size_t start, size_t end );
 
 void adp_free_chunk_no_sequences( p_db_chunk chunk );
 void adp_free_chunk( p_db_chunk chunk );
 
+/**
+ * Restricts the running search to candidates selected by a prefilter. Of the
+ * sequences, that would be searched next, those with a score of at least
+ * min_score are kept. If max_candidates is not 0, only the max_candidates
+ * sequences with the highest scores are kept.
+ *
+ * Prefilters can be chained: a second call selects among the candidates of
+ * the first one. The chunks start again at the first candidate.
+ *
+ * @param scores    score of each sequence of the searched ID range, indexed
+ *                  by ID - ctx_db_range_start()
+ */
+void adp_select_candidates( int64_t * scores, int64_t min_score, size_t max_candidates );
+
+/**
+ * Releases the candidates of the running search.
+ */
+void adp_free_candidates();
+
+/**
+ * Prepares the bound pruning of the running search, if it is enabled in the
+ * current context. The sequences, that would be searched, are ordered by
+ * decreasing length. Afterwards adp_next_chunk leaves out the sequences,
+ * whose highest possible score is not above the score floor of the
+ * bound_result of the chunk, and stops at the first position, after which all
+ * sequences are left out.
+ *
+ * Has to be called after the prefilters.
+ */
+void adp_init_bound_pruning();
+
 #endif /* DB_ADAPTER_H_ */
@@ -0,0 +1,193 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#include "db_dedup.h"
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "context.h"
+#include "util/util.h"
+#include "util/util_sequence.h"
+
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+/*
+ * Hashes the encoded residues, so that sequences differing only in the case
+ * of their letters end up in the same group.
+ */
+static uint64_t hash_sequence( p_seqinfo info, const char * map ) {
+    uint64_t hash = FNV_OFFSET;
+
+    for( size_t i = 0; i < info->seqlen; i++ ) {
+        hash ^= (uint8_t) map[(uint8_t) info->seq[i]];
+        hash *= FNV_PRIME;
+    }
+    return hash;
+}
+
+static int equal_sequences( p_seqinfo a, p_seqinfo b, const char * map ) {
+    if( a->seqlen != b->seqlen ) {
+        return 0;
+    }
+    for( size_t i = 0; i < a->seqlen; i++ ) {
+        if( map[(uint8_t) a->seq[i]] != map[(uint8_t) b->seq[i]] ) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+/*
+ * Groups the sequences of the database of the current context with an open
+ * addressing hash table. Each slot holds the first and the last member of a
+ * group.
+ */
+static p_dedup_index build_index( const void * source, size_t version, int protein ) {
+    size_t count = ctx_db_get_sequence_count();
+
+    p_dedup_index index = xmalloc( sizeof(dedup_index_t) );
+    index->source = source;
+    index->version = version;
+    index->protein = protein;
+    index->count = count;
+    index->group_count = 0;
+    index->prev = xmalloc( (count + 1) * sizeof(size_t) );
+    index->next = xmalloc( (count + 1) * sizeof(size_t) );
+
+    const char * map = protein ? map_ncbi_aa : map_ncbi_nt16;
+
+    size_t slot_count = 16;
+    while( slot_count < 2 * count ) {
+        slot_count *= 2;
+    }
+
+    size_t * first = xmalloc( slot_count * sizeof(size_t) );
+    size_t * last = xmalloc( slot_count * sizeof(size_t) );
+    for( size_t i = 0; i < slot_count; i++ ) {
+        first[i] = DD_NO_MEMBER;
+    }
+
+    for( size_t id = 0; id < count; id++ ) {
+        index->prev[id] = DD_NO_MEMBER;
+        index->next[id] = DD_NO_MEMBER;
+
+        p_seqinfo info = ctx_db_get_sequence( id );
+        if( !info || (info->seqlen == 0) ) {
+            // empty sequences are never searched
+            continue;
+        }
+
+        size_t slot = hash_sequence( info, map ) & (slot_count - 1);
+
+        while( (first[slot] != DD_NO_MEMBER)
+                && !equal_sequences( ctx_db_get_sequence( first[slot] ), info, map ) ) {
+            slot = (slot + 1) & (slot_count - 1);
+        }
+
+        if( first[slot] == DD_NO_MEMBER ) {
+            first[slot] = id;
+            index->group_count++;
+        }
+        else {
+            index->prev[id] = last[slot];
+            index->next[last[slot]] = id;
+        }
+        last[slot] = id;
+    }
+
+    free( first );
+    free( last );
+
+    print_info( "Deduplication: %ld unique of %ld sequences\n", index->group_count, count );
+
+    return index;
+}
+
+p_dedup_index dd_get_index() {
+    size_t version;
+    const void * source = ctx_db_identity( &version );
+    int protein = (symtype == AMINOACID) || (symtype == TRANS_QUERY);
+
+    p_dedup_index index = ctx_current->dedup_cache;
+
+    if( index && (index->source == source) && (index->version == version) && (index->protein == protein)
+            && (index->count == ctx_db_get_sequence_count()) ) {
+        return index;
+    }
+
+    dd_free( index );
+    ctx_current->dedup_cache = build_index( source, version, protein );
+
+    return ctx_current->dedup_cache;
+}
+
+void dd_free( p_dedup_index index ) {
+    if( !index ) {
+        return;
+    }
+
+    free( index->prev );
+    free( index->next );
+    free( index );
+}
+
+int dd_is_searched( p_dedup_index index, size_t id, size_t range_start ) {
+    size_t prev = index->prev[id];
+
+    return (prev == DD_NO_MEMBER) || (prev < range_start);
+}
+
+size_t dd_count_searched( p_dedup_index index, size_t range_start, size_t range_end ) {
+    size_t count = 0;
+
+    for( size_t id = range_start; id < range_end; id++ ) {
+        count += dd_is_searched( index, id, range_start );
+    }
+    return count;
+}
+
+void dd_add_hit( p_dedup_index index, p_minheap heap, elem_t * e, size_t range_end ) {
+    minheap_add( heap, e );
+
+    if( !index ) {
+        return;
+    }
+
+    elem_t copy = *e;
+    for( size_t id = index->next[e->db_id]; (id != DD_NO_MEMBER) && (id < range_end); id = index->next[id] ) {
+        copy.db_id = id;
+        minheap_add( heap, &copy );
+    }
+}
+
+void dd_copy_scores( p_dedup_index index, int32_t * scores, size_t range_start, size_t range_end ) {
+    for( size_t id = range_start; id < range_end; id++ ) {
+        if( !dd_is_searched( index, id, range_start ) ) {
+            continue;
+        }
+
+        for( size_t member = index->next[id]; (member != DD_NO_MEMBER) && (member < range_end);
+                member = index->next[member] ) {
+            scores[member] = scores[id];
+        }
+    }
+}
@@ -0,0 +1,103 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+/*
+ * Index of identical database sequences.
+ *
+ * Sequences with the same residues are grouped. A search scores only one
+ * sequence of each group and copies its hits to the other members of the
+ * group, before the best hits are selected.
+ */
+
+#ifndef DB_DEDUP_H_
+#define DB_DEDUP_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libssa_datatypes.h"
+
+#define DD_NO_MEMBER ((size_t) -1)
+
+/** @typedef    groups of identical sequences of a database
+ *
+ * The members of a group are linked in ascending order of their IDs.
+ *
+ * @field source    database, for which the index was built
+ * @field version   version of the database
+ * @field protein   1 if the residues were compared as amino acids, 0 if they
+ *                  were compared as nucleotides
+ * @field prev      ID of the previous member of the group of each sequence, or
+ *                  DD_NO_MEMBER
+ * @field next      ID of the next member of the group of each sequence, or
+ *                  DD_NO_MEMBER
+ */
+typedef struct dedup_index {
+    const void * source;
+    size_t version;
+    int protein;
+
+    size_t count;
+    size_t group_count;
+
+    size_t * prev;
+    size_t * next;
+} dedup_index_t;
+typedef dedup_index_t * p_dedup_index;
+
+/**
+ * Returns the index of the database of the current context. It is built at
+ * the first call and cached in the context, until the database changes.
+ *
+ * The database has to be pinned by the caller.
+ */
+p_dedup_index dd_get_index();
+
+void dd_free( p_dedup_index index );
+
+/**
+ * Returns 1, if the sequence with the ID id is searched in the ID range
+ * [range_start, range_end). That is the first member of its group in the
+ * range.
+ */
+int dd_is_searched( p_dedup_index index, size_t id, size_t range_start );
+
+/**
+ * Returns the number of sequences searched in the ID range
+ * [range_start, range_end).
+ */
+size_t dd_count_searched( p_dedup_index index, size_t range_start, size_t range_end );
+
+/**
+ * Adds the hit e and copies of it for the other members of its group with IDs
+ * below range_end to the heap. The ID of e has to be the first member of its
+ * group in the searched range.
+ *
+ * If index is 0, only e is added.
+ */
+void dd_add_hit( p_dedup_index index, p_minheap heap, elem_t * e, size_t range_end );
+
+/**
+ * Copies the score of each searched sequence of the ID range
+ * [range_start, range_end) to the other members of its group in the range.
+ * The scores are indexed by ID.
+ */
+void dd_copy_scores( p_dedup_index index, int32_t * scores, size_t range_start, size_t range_end );
+
+#endif /* DB_DEDUP_H_ */
@@ -0,0 +1,280 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#include "db_snapshot.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <pthread.h>
+
+#include "util/util.h"
+
+#define READ_BUFFER_SIZE 65536
+
+struct ssa_database {
+    pthread_mutex_t mutex;
+
+    p_db_snapshot current;
+    size_t last_version;
+
+    // background loading
+    pthread_t loader;
+    int loading;
+    char * load_file;
+    int load_result;
+};
+
+static void free_snapshot( p_db_snapshot snapshot ) {
+    free( snapshot->sequences );
+    free( snapshot->residues );
+    free( snapshot );
+}
+
+/*
+ * Reads all sequences of a FASTA file into a new snapshot. The residues of all
+ * sequences are stored in one block of memory, the ID of a sequence is its
+ * position in the file.
+ *
+ * The residues are kept as characters, like in the databases of libsdb. They
+ * are mapped to symbols, and translated, by the searches, because the contexts
+ * sharing a database might use different symbol types.
+ */
+static p_db_snapshot read_fasta( const char * fasta_file ) {
+    FILE * fp = fopen( fasta_file, "r" );
+    if( !fp ) {
+        print_error( "Could not open the database file: %s", fasta_file );
+        return 0;
+    }
+
+    size_t seq_alloc = 1024;
+    size_t res_alloc = READ_BUFFER_SIZE;
+
+    // the sequences first store the offset of their residues, as the block might move
+    size_t * offsets = xmalloc( seq_alloc * sizeof(size_t) );
+    size_t * lengths = xmalloc( seq_alloc * sizeof(size_t) );
+    char * residues = xmalloc( res_alloc );
+
+    size_t count = 0;
+    size_t res_len = 0;
+    int in_header = 0;
+    int line_start = 1;
+
+    char buffer[READ_BUFFER_SIZE];
+    size_t read;
+    while( (read = fread( buffer, 1, READ_BUFFER_SIZE, fp )) > 0 ) {
+        for( size_t i = 0; i < read; i++ ) {
+            char c = buffer[i];
+
+            if( line_start && (c == '>') ) {
+                if( count == seq_alloc ) {
+                    seq_alloc *= 2;
+                    offsets = xrealloc( offsets, seq_alloc * sizeof(size_t) );
+                    lengths = xrealloc( lengths, seq_alloc * sizeof(size_t) );
+                }
+                // terminate the previous sequence
+                if( count ) {
+                    if( res_len + 2 > res_alloc ) {
+                        res_alloc *= 2;
+                        residues = xrealloc( residues, res_alloc );
+                    }
+                    residues[res_len++] = 0;
+                }
+                offsets[count] = res_len;
+                lengths[count] = 0;
+                count++;
+
+                in_header = 1;
+            }
+
+            line_start = (c == '\n');
+            if( line_start ) {
+                in_header = 0;
+                continue;
+            }
+
+            if( in_header || !count || isspace( (unsigned char) c ) ) {
+                continue;
+            }
+
+            // room for the residue and the terminating zero
+            if( res_len + 2 > res_alloc ) {
+                res_alloc *= 2;
+                residues = xrealloc( residues, res_alloc );
+            }
+            residues[res_len++] = c;
+            lengths[count - 1]++;
+        }
+    }
+    residues[res_len++] = 0;
+
+    fclose( fp );
+
+    p_db_snapshot snapshot = xmalloc( sizeof(db_snapshot_t) );
+    snapshot->version = 0;
+    snapshot->refcount = 1;
+    snapshot->count = count;
+    snapshot->residues = xrealloc( residues, res_len );
+    snapshot->sequences = xmalloc( (count ? count : 1) * sizeof(seqinfo_t) );
+
+    for( size_t i = 0; i < count; i++ ) {
+        snapshot->sequences[i].ID = i;
+        snapshot->sequences[i].seq = snapshot->residues + offsets[i];
+        snapshot->sequences[i].seqlen = lengths[i];
+    }
+
+    free( offsets );
+    free( lengths );
+
+    return snapshot;
+}
+
+p_ssa_database dbs_create() {
+    p_ssa_database db = xmalloc( sizeof(struct ssa_database) );
+
+    pthread_mutex_init( &db->mutex, NULL );
+    db->current = 0;
+    db->last_version = 0;
+    db->loading = 0;
+    db->load_file = 0;
+    db->load_result = 1;
+
+    return db;
+}
+
+void dbs_free( p_ssa_database db ) {
+    if( !db ) {
+        return;
+    }
+
+    dbs_wait( db );
+
+    if( db->current ) {
+        dbs_release( db, db->current );
+        db->current = 0;
+    }
+
+    pthread_mutex_destroy( &db->mutex );
+    free( db );
+}
+
+int dbs_load( p_ssa_database db, const char * fasta_file ) {
+    // reading the file happens without holding the lock
+    p_db_snapshot snapshot = read_fasta( fasta_file );
+    if( !snapshot ) {
+        return 0;
+    }
+
+    pthread_mutex_lock( &db->mutex );
+
+    snapshot->version = ++db->last_version;
+    p_db_snapshot old = db->current;
+    db->current = snapshot;
+
+    pthread_mutex_unlock( &db->mutex );
+
+    print_info( "DB version %ld read %lu sequences\n", snapshot->version, snapshot->count );
+
+    // searches, that still use the old snapshot, keep it alive
+    if( old ) {
+        dbs_release( db, old );
+    }
+
+    return 1;
+}
+
+static void * load_in_background( void * data ) {
+    p_ssa_database db = data;
+
+    db->load_result = dbs_load( db, db->load_file );
+
+    return NULL;
+}
+
+void dbs_load_async( p_ssa_database db, const char * fasta_file ) {
+    dbs_wait( db );
+
+    db->load_file = xmalloc( strlen( fasta_file ) + 1 );
+    strcpy( db->load_file, fasta_file );
+
+    if( pthread_create( &db->loader, NULL, load_in_background, db ) ) {
+        fatal( "Could not start the thread loading the database." );
+    }
+    db->loading = 1;
+}
+
+int dbs_wait( p_ssa_database db ) {
+    if( db->loading ) {
+        pthread_join( db->loader, NULL );
+        db->loading = 0;
+
+        free( db->load_file );
+        db->load_file = 0;
+    }
+
+    return db->load_result;
+}
+
+p_db_snapshot dbs_acquire( p_ssa_database db ) {
+    pthread_mutex_lock( &db->mutex );
+
+    p_db_snapshot snapshot = db->current;
+    if( snapshot ) {
+        snapshot->refcount++;
+    }
+
+    pthread_mutex_unlock( &db->mutex );
+
+    return snapshot;
+}
+
+void dbs_retain( p_ssa_database db, p_db_snapshot snapshot ) {
+    pthread_mutex_lock( &db->mutex );
+    snapshot->refcount++;
+    pthread_mutex_unlock( &db->mutex );
+}
+
+void dbs_release( p_ssa_database db, p_db_snapshot snapshot ) {
+    pthread_mutex_lock( &db->mutex );
+    size_t refcount = --snapshot->refcount;
+    pthread_mutex_unlock( &db->mutex );
+
+    if( !refcount ) {
+        print_info( "DB version %ld released\n", snapshot->version );
+
+        free_snapshot( snapshot );
+    }
+}
+
+size_t dbs_get_version( p_ssa_database db ) {
+    pthread_mutex_lock( &db->mutex );
+    size_t version = db->current ? db->current->version : 0;
+    pthread_mutex_unlock( &db->mutex );
+
+    return version;
+}
+
+size_t dbs_get_sequence_count( p_ssa_database db ) {
+    pthread_mutex_lock( &db->mutex );
+    size_t count = db->current ? db->current->count : 0;
+    pthread_mutex_unlock( &db->mutex );
+
+    return count;
+}
@@ -0,0 +1,105 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+/*
+ * Databases, that can be replaced while searches are running.
+ *
+ * A database holds its sequences in immutable, reference counted snapshots.
+ * A search acquires the current snapshot when it starts and releases it when
+ * it ends. Loading a new version replaces the current snapshot, the old one is
+ * freed as soon as the last search using it has released it.
+ */
+
+#ifndef DB_SNAPSHOT_H_
+#define DB_SNAPSHOT_H_
+
+#include <stddef.h>
+
+#include "libssa_datatypes.h"
+
+/** @typedef    immutable version of a database
+ *
+ * @field version   number of the version, starting with 1
+ * @field refcount  number of searches using the snapshot, plus one while it is
+ *                  the current snapshot of its database
+ * @field residues  memory holding the residues of all sequences
+ */
+typedef struct db_snapshot {
+    size_t version;
+    size_t refcount;
+
+    seqinfo_t * sequences;
+    size_t count;
+
+    char * residues;
+} db_snapshot_t;
+typedef db_snapshot_t * p_db_snapshot;
+
+p_ssa_database dbs_create();
+
+/**
+ * Releases the database and its current snapshot. No search may use it
+ * anymore.
+ */
+void dbs_free( p_ssa_database db );
+
+/**
+ * Reads the FASTA file and makes it the current snapshot of db.
+ *
+ * @return 1 on success, 0 if the file could not be read
+ */
+int dbs_load( p_ssa_database db, const char * fasta_file );
+
+/**
+ * Starts dbs_load in a background thread. A load started before is finished
+ * first.
+ */
+void dbs_load_async( p_ssa_database db, const char * fasta_file );
+
+/**
+ * Waits for the background load of db.
+ *
+ * @return the result of the last load
+ */
+int dbs_wait( p_ssa_database db );
+
+/**
+ * Returns the current snapshot of db and increments its reference count, or 0
+ * if no database was loaded yet.
+ */
+p_db_snapshot dbs_acquire( p_ssa_database db );
+
+/**
+ * Adds a reference to a snapshot, which the caller already holds, like the
+ * snapshot pinned by a running search. The reference is released with
+ * dbs_release.
+ */
+void dbs_retain( p_ssa_database db, p_db_snapshot snapshot );
+
+/**
+ * Releases a snapshot returned by dbs_acquire. Frees it, if it was the last
+ * reference to an outdated snapshot.
+ */
+void dbs_release( p_ssa_database db, p_db_snapshot snapshot );
+
+size_t dbs_get_version( p_ssa_database db );
+
+size_t dbs_get_sequence_count( p_ssa_database db );
+
+#endif /* DB_SNAPSHOT_H_ */
@@ -0,0 +1,406 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#include "kmer_index.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "context.h"
+#include "db_adapter.h"
+#include "util/util.h"
+#include "util/util_sequence.h"
+
+#define KI_FILE_MAGIC "SSAKMER1"
+
+/*
+ * Returns the k-mer code of an encoded residue, or -1 for residues, that are
+ * not part of k-mers.
+ */
+static int residue_code( char residue, int protein ) {
+    if( protein ) {
+        return (residue > 0) ? residue : -1;
+    }
+
+    switch( residue ) {
+    case 1: // A
+        return 0;
+    case 2: // C
+        return 1;
+    case 4: // G
+        return 2;
+    case 8: // T, U
+        return 3;
+    default:
+        return -1;
+    }
+}
+
+/*
+ * Writes the k-mers of the sequence to kmers, which has to hold len values.
+ * If map is not 0, the residues are encoded with it first.
+ *
+ * @return the number of k-mers
+ */
+static size_t extract_kmers( const char * seq, size_t len, const char * map, int protein, size_t k,
+        uint32_t * kmers ) {
+    const int bits = protein ? 5 : 2;
+    const uint32_t mask = (uint32_t) ((1ULL << (bits * k)) - 1);
+
+    uint32_t kmer = 0;
+    size_t valid = 0;
+    size_t count = 0;
+
+    for( size_t i = 0; i < len; i++ ) {
+        char residue = map ? map[(uint8_t) seq[i]] : seq[i];
+        int code = residue_code( residue, protein );
+
+        if( code < 0 ) {
+            valid = 0;
+            continue;
+        }
+
+        kmer = ((kmer << bits) | code) & mask;
+
+        if( ++valid >= k ) {
+            kmers[count++] = kmer;
+        }
+    }
+    return count;
+}
+
+static int compare_kmers( const void * a, const void * b ) {
+    uint32_t x = *(const uint32_t *) a;
+    uint32_t y = *(const uint32_t *) b;
+
+    return (x > y) - (x < y);
+}
+
+/*
+ * Returns the k for the current configuration.
+ */
+static size_t get_k( int protein ) {
+    size_t k = ctx_current->kmer_k;
+
+    if( !k ) {
+        return protein ? KI_DEFAULT_K_AMINOACID : KI_DEFAULT_K_NUCLEOTIDE;
+    }
+    if( protein && (k > KI_MAX_K_AMINOACID) ) {
+        return KI_MAX_K_AMINOACID;
+    }
+    return k;
+}
+
+static size_t get_residue_count() {
+    size_t residues = 0;
+
+    for( size_t id = 0; id < ctx_db_get_sequence_count(); id++ ) {
+        residues += ctx_db_get_sequence( id )->seqlen;
+    }
+    return residues;
+}
+
+static size_t get_max_length() {
+    size_t max = 0;
+
+    for( size_t id = 0; id < ctx_db_get_sequence_count(); id++ ) {
+        if( ctx_db_get_sequence( id )->seqlen > max ) {
+            max = ctx_db_get_sequence( id )->seqlen;
+        }
+    }
+    return max;
+}
+
+static p_kmer_index alloc_index( int protein, size_t k ) {
+    p_kmer_index index = xmalloc( sizeof(kmer_index_t) );
+
+    index->source = ctx_db_identity( &index->version );
+    index->protein = protein;
+    index->k = k;
+    index->kmer_count = (size_t) 1 << ((protein ? 5 : 2) * k);
+    index->seq_count = ctx_db_get_sequence_count();
+    index->residues = 0;
+    index->offsets = xmalloc( (index->kmer_count + 1) * sizeof(uint64_t) );
+    index->ids = 0;
+
+    return index;
+}
+
+/*
+ * Builds the index in two passes over the database. The first pass counts the
+ * sequences of each k-mer, the second one stores their IDs. A k-mer occurring
+ * several times in a sequence is stored once.
+ */
+static p_kmer_index build_index( int protein, size_t k ) {
+    p_kmer_index index = alloc_index( protein, k );
+
+    const char * map = protein ? map_ncbi_aa : map_ncbi_nt16;
+
+    uint32_t * kmers = xmalloc( (get_max_length() + 1) * sizeof(uint32_t) );
+    // ID + 1 of the last sequence, in which a k-mer was seen
+    uint32_t * last_seen = xmalloc( index->kmer_count * sizeof(uint32_t) );
+
+    memset( index->offsets, 0, (index->kmer_count + 1) * sizeof(uint64_t) );
+    memset( last_seen, 0, index->kmer_count * sizeof(uint32_t) );
+
+    for( size_t id = 0; id < index->seq_count; id++ ) {
+        p_seqinfo info = ctx_db_get_sequence( id );
+        index->residues += info->seqlen;
+
+        size_t count = extract_kmers( info->seq, info->seqlen, map, protein, k, kmers );
+
+        for( size_t i = 0; i < count; i++ ) {
+            if( last_seen[kmers[i]] != id + 1 ) {
+                last_seen[kmers[i]] = id + 1;
+                index->offsets[kmers[i] + 1]++;
+            }
+        }
+    }
+
+    for( size_t i = 0; i < index->kmer_count; i++ ) {
+        index->offsets[i + 1] += index->offsets[i];
+    }
+
+    index->ids = xmalloc( (index->offsets[index->kmer_count] + 1) * sizeof(uint32_t) );
+
+    uint64_t * fill = xmalloc( index->kmer_count * sizeof(uint64_t) );
+    memcpy( fill, index->offsets, index->kmer_count * sizeof(uint64_t) );
+    memset( last_seen, 0, index->kmer_count * sizeof(uint32_t) );
+
+    for( size_t id = 0; id < index->seq_count; id++ ) {
+        p_seqinfo info = ctx_db_get_sequence( id );
+
+        size_t count = extract_kmers( info->seq, info->seqlen, map, protein, k, kmers );
+
+        for( size_t i = 0; i < count; i++ ) {
+            if( last_seen[kmers[i]] != id + 1 ) {
+                last_seen[kmers[i]] = id + 1;
+                index->ids[fill[kmers[i]]++] = id;
+            }
+        }
+    }
+
+    free( fill );
+    free( last_seen );
+    free( kmers );
+
+    print_info( "K-mer index: %ld entries for %ld sequences\n", index->offsets[index->kmer_count], index->seq_count );
+
+    return index;
+}
+
+p_kmer_index ki_get_index() {
+    int protein = (symtype == AMINOACID);
+    size_t k = get_k( protein );
+
+    size_t version;
+    const void * source = ctx_db_identity( &version );
+
+    p_kmer_index index = ctx_current->kmer_cache;
+
+    if( index && (index->source == source) && (index->version == version) && (index->protein == protein)
+            && (index->k == k) && (index->seq_count == ctx_db_get_sequence_count()) ) {
+        return index;
+    }
+
+    ki_free( index );
+    ctx_current->kmer_cache = build_index( protein, k );
+
+    return ctx_current->kmer_cache;
+}
+
+void ki_free( p_kmer_index index ) {
+    if( !index ) {
+        return;
+    }
+
+    free( index->offsets );
+    free( index->ids );
+    free( index );
+}
+
+int ki_save( const char * file ) {
+    ctx_pin_database();
+    p_kmer_index index = ki_get_index();
+    ctx_unpin_database();
+
+    FILE * fp = fopen( file, "wb" );
+    if( !fp ) {
+        print_error( "Could not open the k-mer index file: %s", file );
+        return 0;
+    }
+
+    uint64_t header[5] = { index->protein, index->k, index->kmer_count, index->seq_count, index->residues };
+
+    size_t entries = index->offsets[index->kmer_count];
+
+    int ok = (fwrite( KI_FILE_MAGIC, 1, 8, fp ) == 8) && (fwrite( header, sizeof(uint64_t), 5, fp ) == 5)
+            && (fwrite( index->offsets, sizeof(uint64_t), index->kmer_count + 1, fp ) == index->kmer_count + 1)
+            && (fwrite( index->ids, sizeof(uint32_t), entries, fp ) == entries);
+
+    if( fclose( fp ) || !ok ) {
+        print_error( "Could not write the k-mer index file: %s", file );
+        return 0;
+    }
+    return 1;
+}
+
+int ki_load( const char * file ) {
+    FILE * fp = fopen( file, "rb" );
+    if( !fp ) {
+        print_error( "Could not open the k-mer index file: %s", file );
+        return 0;
+    }
+
+    char magic[8];
+    uint64_t header[5];
+
+    if( (fread( magic, 1, 8, fp ) != 8) || memcmp( magic, KI_FILE_MAGIC, 8 )
+            || (fread( header, sizeof(uint64_t), 5, fp ) != 5) ) {
+        print_error( "Not a k-mer index file: %s", file );
+        fclose( fp );
+        return 0;
+    }
+
+    int protein = header[0] ? 1 : 0;
+    size_t k = header[1];
+
+    if( (k == 0) || (k > (protein ? KI_MAX_K_AMINOACID : KI_MAX_K_NUCLEOTIDE)) ) {
+        print_error( "Not a k-mer index file: %s", file );
+        fclose( fp );
+        return 0;
+    }
+
+    ctx_pin_database();
+
+    p_kmer_index index = alloc_index( protein, k );
+
+    int ok = (header[2] == index->kmer_count) && (header[3] == index->seq_count)
+            && (header[4] == get_residue_count());
+
+    ctx_unpin_database();
+
+    if( !ok ) {
+        print_error( "The k-mer index file %s belongs to another database.", file );
+        ki_free( index );
+        fclose( fp );
+        return 0;
+    }
+
+    index->residues = header[4];
+
+    ok = (fread( index->offsets, sizeof(uint64_t), index->kmer_count + 1, fp ) == index->kmer_count + 1);
+
+    if( ok ) {
+        size_t entries = index->offsets[index->kmer_count];
+        index->ids = xmalloc( (entries + 1) * sizeof(uint32_t) );
+
+        ok = (fread( index->ids, sizeof(uint32_t), entries, fp ) == entries);
+    }
+
+    fclose( fp );
+
+    if( !ok ) {
+        print_error( "Could not read the k-mer index file: %s", file );
+        ki_free( index );
+        return 0;
+    }
+
+    ki_free( ctx_current->kmer_cache );
+    ctx_current->kmer_cache = index;
+    ctx_current->kmer_k = k;
+
+    return 1;
+}
+
+/*
+ * Returns the position of the first ID in the sorted array, that is not
+ * smaller than id.
+ */
+static uint64_t lower_bound( uint32_t * ids, uint64_t start, uint64_t end, size_t id ) {
+    while( start < end ) {
+        uint64_t mid = start + (end - start) / 2;
+
+        if( ids[mid] < id ) {
+            start = mid + 1;
+        }
+        else {
+            end = mid;
+        }
+    }
+    return start;
+}
+
+void ki_select_candidates( p_kmer_index index, p_search_data sdp, size_t min_shared, size_t max_candidates ) {
+    size_t range_start = ctx_db_range_start();
+    size_t range_end = ctx_db_range_end();
+    size_t range_len = range_end - range_start;
+
+    uint32_t * shared = xmalloc( (range_len + 1) * sizeof(uint32_t) );
+    uint32_t * best = xmalloc( (range_len + 1) * sizeof(uint32_t) );
+    memset( best, 0, range_len * sizeof(uint32_t) );
+
+    uint32_t * kmers = xmalloc( (sdp->maxqlen + 1) * sizeof(uint32_t) );
+
+    // a sequence is ranked by the query strand or frame, with which it shares the most k-mers
+    for( size_t q = 0; q < sdp->q_count; q++ ) {
+        sequence_t qseq = sdp->queries[q].seq;
+
+        size_t count = extract_kmers( qseq.seq, qseq.len, 0, index->protein, index->k, kmers );
+        qsort( kmers, count, sizeof(uint32_t), compare_kmers );
+
+        memset( shared, 0, range_len * sizeof(uint32_t) );
+
+        for( size_t i = 0; i < count; i++ ) {
+            if( i && (kmers[i] == kmers[i - 1]) ) {
+                continue;
+            }
+
+            uint64_t end = index->offsets[kmers[i] + 1];
+            uint64_t pos = lower_bound( index->ids, index->offsets[kmers[i]], end, range_start );
+
+            for( ; (pos < end) && (index->ids[pos] < range_end); pos++ ) {
+                shared[index->ids[pos] - range_start]++;
+            }
+        }
+
+        for( size_t j = 0; j < range_len; j++ ) {
+            if( shared[j] > best[j] ) {
+                best[j] = shared[j];
+            }
+        }
+    }
+
+    if( min_shared == 0 ) {
+        min_shared = 1;
+    }
+
+    int64_t * scores = xmalloc( (range_len + 1) * sizeof(int64_t) );
+    for( size_t j = 0; j < range_len; j++ ) {
+        scores[j] = best[j];
+    }
+
+    adp_select_candidates( scores, min_shared, max_candidates );
+
+    free( scores );
+    free( kmers );
+    free( best );
+    free( shared );
+}
@@ -0,0 +1,110 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+/*
+ * Index of the k-mers of the database sequences, used by the prefilter of a
+ * search.
+ *
+ * For each k-mer the index holds the IDs of the sequences containing it. The
+ * prefilter counts the k-mers a sequence shares with the query and passes only
+ * the best ranked sequences to the alignment kernels.
+ *
+ * Nucleotides are encoded with 2 bits, k-mers with ambiguous nucleotides are
+ * left out. Amino acids are encoded with 5 bits.
+ */
+
+#ifndef KMER_INDEX_H_
+#define KMER_INDEX_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "libssa_datatypes.h"
+
+#define KI_DEFAULT_K_NUCLEOTIDE 8
+#define KI_DEFAULT_K_AMINOACID 3
+
+#define KI_MAX_K_NUCLEOTIDE 12
+#define KI_MAX_K_AMINOACID 4
+
+/** @typedef    k-mer index of a database
+ *
+ * @field source        database, for which the index was built
+ * @field version       version of the database
+ * @field residues      number of residues of all sequences, to recognise
+ *                      loaded indices of other databases
+ * @field offsets       start of the IDs of each k-mer in ids. The IDs of k-mer
+ *                      i are ids[offsets[i]] up to ids[offsets[i + 1] - 1], in
+ *                      ascending order.
+ */
+typedef struct kmer_index {
+    const void * source;
+    size_t version;
+
+    int protein;
+    size_t k;
+    size_t kmer_count;
+
+    size_t seq_count;
+    size_t residues;
+
+    uint64_t * offsets;
+    uint32_t * ids;
+} kmer_index_t;
+typedef kmer_index_t * p_kmer_index;
+
+/**
+ * Returns the k-mer index of the database of the current context, using the
+ * configured k. It is built at the first call and cached in the context, until
+ * the database changes or another index is loaded.
+ *
+ * The database has to be pinned by the caller.
+ */
+p_kmer_index ki_get_index();
+
+void ki_free( p_kmer_index index );
+
+/**
+ * Writes the index of the database of the current context to a file.
+ *
+ * @return 1 on success, 0 if the file could not be written
+ */
+int ki_save( const char * file );
+
+/**
+ * Reads an index written by ki_save and makes it the index of the database of
+ * the current context.
+ *
+ * @return 1 on success, 0 if the file could not be read or does not belong to
+ *         the database
+ */
+int ki_load( const char * file );
+
+/**
+ * Selects the sequences of the searched ID range, that share the most k-mers
+ * with one of the queries of the search data. The candidates are searched
+ * instead of the whole range, see adp_select_candidates.
+ *
+ * A sequence is a candidate, if it shares at least min_shared k-mers with a
+ * query. If max_candidates is not 0, only the max_candidates best ranked
+ * sequences are kept.
+ */
+void ki_select_candidates( p_kmer_index index, p_search_data sdp, size_t min_shared, size_t max_candidates );
+
+#endif /* KMER_INDEX_H_ */
@@ -24,16 +24,21 @@
 #include "matrices.h"
 #include "algo/manager.h"
 #include "algo/aligner.h"
+#include "algo/batcher.h"
+#include "algo/pair_aligner.h"
+#include "algo/async_search.h"
+#include "algo/sharded_search.h"
+#include "algo/result_table.h"
 #include "query.h"
 #include "util/thread_pool.h"
 #include "cpu_config.h"
 #include "db_adapter.h"
-
-// #############################################################################
-// Alignment data
-// ##################
-int8_t gapO = 0;
-int8_t gapE = 0;
+#include "context.h"
+#include "db_snapshot.h"
+#include "kmer_index.h"
+#include "algo/gap_costs.h"
+#include "algo/align.h"
+#include "algo/searcher.h"
 
 // #############################################################################
 // Technical initialisation
@@ -59,6 +64,113 @@ void set_thread_count( size_t nr ) {
     max_thread_count = nr;
 }
 
+void set_search_budget( double seconds, size_t max_sequences ) {
+    if( seconds < 0 ) {
+        print_error( "Negative time budgets are not allowed. Using no time limit." );
+
+        seconds = 0;
+    }
+    ctx_current->time_budget = seconds;
+    ctx_current->max_sequences = max_sequences;
+}
+
+void set_progress_callback( ssa_progress_callback callback, void * data ) {
+    ctx_current->progress_callback = callback;
+    ctx_current->progress_data = data;
+}
+
+p_alignment_list ssa_progress_get_alignments( p_ssa_progress progress ) {
+    return s_get_progress_alignments( progress );
+}
+
+void set_search_range( size_t first_id, size_t end_id ) {
+    if( end_id && (end_id <= first_id) ) {
+        fatal( "Empty search range: %ld to %ld.", first_id, end_id );
+    }
+    ctx_current->range_start = first_id;
+    ctx_current->range_end = end_id;
+}
+
+void set_deduplication( int enabled ) {
+    ctx_current->deduplicate = enabled ? 1 : 0;
+}
+
+void set_prefix_sharing( int enabled ) {
+    ctx_current->prefix_sharing = enabled ? 1 : 0;
+}
+
+void set_bound_pruning( int enabled ) {
+    ctx_current->bound_pruning = enabled ? 1 : 0;
+}
+
+size_t get_pruned_sequence_count() {
+    return ctx_current->pruned_sequences;
+}
+
+void set_nw_band( long width ) {
+    if( width < NW_BAND_ADAPTIVE ) {
+        print_error( "Invalid band width: %ld. Using the full matrix.", width );
+
+        width = 0;
+    }
+    ctx_current->nw_band = width;
+}
+
+void set_cigar_format( int format ) {
+    if( (format < CIGAR_FORMAT_TEXT) || (format > CIGAR_FORMAT_PACKED) ) {
+        fatal( "Unknown CIGAR format: %d", format );
+    }
+    ctx_current->cigar_format = format;
+}
+
+char * alignment_cigar_string( p_alignment a, int extended ) {
+    if( !a->cigar_ops ) {
+        return 0;
+    }
+
+    packed_cigar_t cigar = { .ops = a->cigar_ops, .len = a->cigar_ops_len };
+
+    return cigar_to_string( cigar, extended, 0 );
+}
+
+void get_band_stats( size_t * banded, size_t * fallbacks ) {
+    *banded = ctx_current->band_sequences;
+    *fallbacks = ctx_current->band_fallbacks;
+}
+
+void set_kmer_prefilter( size_t k, size_t min_shared, size_t max_candidates ) {
+    if( k > KI_MAX_K_NUCLEOTIDE ) {
+        print_error( "K-mers can have at most %d residues. Using the default length.", KI_MAX_K_NUCLEOTIDE );
+
+        k = 0;
+    }
+    ctx_current->kmer_k = k;
+    ctx_current->prefilter_min_shared = min_shared;
+    ctx_current->prefilter_max_candidates = max_candidates;
+}
+
+int save_kmer_index( const char * file ) {
+    return ki_save( file );
+}
+
+int load_kmer_index( const char * file ) {
+    return ki_load( file );
+}
+
+void set_ungapped_prefilter( long min_score, size_t max_candidates ) {
+    ctx_current->ungapped_min_score = min_score;
+    ctx_current->ungapped_max_candidates = max_candidates;
+}
+
+void get_prefilter_stats( size_t * sequences, size_t * candidates ) {
+    *sequences = ctx_current->prefilter_sequences;
+    *candidates = ctx_current->prefilter_candidates;
+}
+
+double alignment_list_recall( p_alignment_list exact, p_alignment_list approx ) {
+    return a_recall( exact, approx );
+}
+
 // #############################################################################
 // Initialisations
 // ################
@@ -96,8 +208,8 @@ void init_score_matrix( int mode, const char* matrix ) {
 /**
  * Initialises gap penalties used for the alignments.
  *
- * @param  gapO  penalty for opening a gap
- * @param  gapE  penalty for extending a gap
+ * @param  gap_open    penalty for opening a gap
+ * @param  gap_extend  penalty for extending a gap
  */
 void init_gap_penalties( const int8_t gap_open, const int8_t gap_extend ) {
     gapO = gap_open;
@@ -127,10 +239,46 @@ void init_db( const char* fasta_db_file ) {
     ssa_db_close();
 
     ssa_db_init( fasta_db_file );
+    ctx_extern_db_changed();
 
     print_info( "DB read %lu sequences\n", ssa_db_get_sequence_count() );
 }
 
+p_ssa_database ssa_database_create() {
+    return dbs_create();
+}
+
+int ssa_database_load( p_ssa_database db, const char * fasta_file ) {
+    return dbs_load( db, fasta_file );
+}
+
+void ssa_database_load_async( p_ssa_database db, const char * fasta_file ) {
+    dbs_load_async( db, fasta_file );
+}
+
+int ssa_database_wait( p_ssa_database db ) {
+    return dbs_wait( db );
+}
+
+size_t ssa_database_get_version( p_ssa_database db ) {
+    return dbs_get_version( db );
+}
+
+size_t ssa_database_get_sequence_count( p_ssa_database db ) {
+    return dbs_get_sequence_count( db );
+}
+
+void ssa_database_free( p_ssa_database db ) {
+    dbs_free( db );
+}
+
+void use_database( p_ssa_database db ) {
+    if( ctx_current->snapshot_pins ) {
+        fatal( "The database can not be changed during a search." );
+    }
+    ctx_current->database = db;
+}
+
 /**
  * Default is DEFAULT_SYMTYPE = AMINOACID (1)
  *
@@ -143,10 +291,10 @@ void init_symbol_translation( int type, int strands, int d_gencode, int q_gencod
     if( (d_gencode < 1) || (d_gencode > 23) || !gencode_names[d_gencode - 1] ) {
         fatal( "Illegal database genetic code specified." );
     }
-    if( (symtype < 0) || (symtype > 4) ) {
+    if( (type < NUCLEOTIDE) || (type > TRANS_BOTH) ) {
         fatal( "Illegal symbol type specified." );
     }
-    if( (symtype < 0) || (symtype > 2) ) {
+    if( (strands < FORWARD_STRAND) || (strands > BOTH_STRANDS) ) {
         fatal( "Illegal strands specified." );
     }
 
@@ -207,7 +355,7 @@ static void test_configuration( p_query query ) {
         fatal( "Query not initialized." );
     }
 
-    if( ssa_db_get_sequence_count() == 0 ) {
+    if( ctx_db_get_sequence_count() == 0 ) {
         print_warning( "Database contains zero sequences. Possible error." );
     }
 
@@ -250,9 +398,292 @@ p_alignment_list nw_align( p_query query, size_t hitcount, int bit_width, int al
     return m_run( hitcount );
 }
 
+p_alignment_list ed_align( p_query query, size_t hitcount, int mode ) {
+    test_cpu_features();
+
+    if( !query ) {
+        fatal( "Query not initialized." );
+    }
+    if( (mode != ED_GLOBAL) && (mode != ED_SEMI_GLOBAL) && (mode != ED_PREFIX) ) {
+        fatal( "Unknown edit distance mode: %d", mode );
+    }
+
+    init_for_ed( query, mode );
+
+    return m_run( hitcount );
+}
+
+/**
+ * Aligns the query sequence against all sequences in the database using the
+ * Smith-Waterman Algorithm and returns the hits as a result table.
+ *
+ * @see m_run_table
+ */
+p_ssa_result_table sw_align_table( p_query query, size_t hitcount, int bit_width, int align_type ) {
+    test_configuration( query );
+
+    init_for_sw( query, bit_width, align_type );
+
+    return m_run_table( hitcount );
+}
+
+/**
+ * Aligns the query sequence against all sequences in the database using the
+ * Needleman-Wunsch Algorithm and returns the hits as a result table.
+ *
+ * @see m_run_table
+ */
+p_ssa_result_table nw_align_table( p_query query, size_t hitcount, int bit_width, int align_type ) {
+    test_configuration( query );
+
+    init_for_nw( query, bit_width, align_type );
+
+    return m_run_table( hitcount );
+}
+
+char * ssa_result_get_db_sequence( p_ssa_result_table table, size_t row, size_t * len ) {
+    return rt_get_db_sequence( table, row, len );
+}
+
+void ssa_result_compute_alignment( p_ssa_result_table table, size_t row ) {
+    rt_align_row( table, row );
+}
+
+void ssa_result_compute_alignments( p_ssa_result_table table, size_t first, size_t count ) {
+    rt_align_rows( table, first, count );
+}
+
+void ssa_result_compute_alignments_async( p_ssa_result_table table, size_t first, size_t count ) {
+    rt_align_rows_async( table, first, count );
+}
+
+void ssa_result_wait( p_ssa_result_table table ) {
+    rt_wait( table );
+}
+
+/**
+ * Computes the Smith-Waterman score of the query against every sequence in the
+ * database.
+ *
+ * @see m_run_scores
+ */
+int sw_scores( p_query query, int bit_width, int32_t * scores ) {
+    test_configuration( query );
+
+    init_for_sw( query, bit_width, COMPUTE_SCORE );
+
+    return m_run_scores( scores );
+}
+
+/**
+ * Computes the Needleman-Wunsch score of the query against every sequence in
+ * the database.
+ *
+ * @see m_run_scores
+ */
+int nw_scores( p_query query, int bit_width, int32_t * scores ) {
+    test_configuration( query );
+
+    init_for_nw( query, bit_width, COMPUTE_SCORE );
+
+    return m_run_scores( scores );
+}
+
+/**
+ * Searches the database with the Smith-Waterman Algorithm and streams the hits
+ * with a score of at least min_score to the callback.
+ *
+ * @see m_run_stream
+ */
+int sw_stream( p_query query, int bit_width, long min_score, int delivery, ssa_hit_callback callback, void * data ) {
+    test_configuration( query );
+
+    if( !callback ) {
+        fatal( "Hit callback not set." );
+    }
+
+    init_for_sw( query, bit_width, COMPUTE_SCORE );
+
+    return m_run_stream( min_score, delivery, callback, data );
+}
+
+/**
+ * Searches the database with the Needleman-Wunsch Algorithm and streams the
+ * hits with a score of at least min_score to the callback.
+ *
+ * @see m_run_stream
+ */
+int nw_stream( p_query query, int bit_width, long min_score, int delivery, ssa_hit_callback callback, void * data ) {
+    test_configuration( query );
+
+    if( !callback ) {
+        fatal( "Hit callback not set." );
+    }
+
+    init_for_nw( query, bit_width, COMPUTE_SCORE );
+
+    return m_run_stream( min_score, delivery, callback, data );
+}
+
+static void test_batch_configuration( p_query * queries, size_t query_count ) {
+    if( !queries ) {
+        fatal( "Queries not initialized." );
+    }
+
+    for( size_t i = 0; i < query_count; i++ ) {
+        test_configuration( queries[i] );
+    }
+}
+
+/**
+ * Aligns many query sequences against all sequences in the database using the
+ * Smith-Waterman Algorithm.
+ *
+ * @see b_run
+ */
+p_alignment_list * sw_align_batch( p_query * queries, size_t query_count, size_t hitcount, int bit_width,
+        int align_type ) {
+    test_batch_configuration( queries, query_count );
+
+    return b_run( queries, query_count, hitcount, SMITH_WATERMAN, bit_width, align_type, 0, 0 );
+}
+
+/**
+ * Aligns many query sequences against all sequences in the database using the
+ * Needleman-Wunsch Algorithm.
+ *
+ * @see b_run
+ */
+p_alignment_list * nw_align_batch( p_query * queries, size_t query_count, size_t hitcount, int bit_width,
+        int align_type ) {
+    test_batch_configuration( queries, query_count );
+
+    return b_run( queries, query_count, hitcount, NEEDLEMAN_WUNSCH, bit_width, align_type, 0, 0 );
+}
+
+/**
+ * Aligns many query sequences like sw_align_batch and reports each query as
+ * soon as its alignments are complete.
+ *
+ * @see b_run
+ */
+p_alignment_list * sw_align_batch_callback( p_query * queries, size_t query_count, size_t hitcount, int bit_width,
+        int align_type, ssa_batch_callback callback, void * data ) {
+    test_batch_configuration( queries, query_count );
+
+    return b_run( queries, query_count, hitcount, SMITH_WATERMAN, bit_width, align_type, callback, data );
+}
+
+/**
+ * Aligns many query sequences like nw_align_batch and reports each query as
+ * soon as its alignments are complete.
+ *
+ * @see b_run
+ */
+p_alignment_list * nw_align_batch_callback( p_query * queries, size_t query_count, size_t hitcount, int bit_width,
+        int align_type, ssa_batch_callback callback, void * data ) {
+    test_batch_configuration( queries, query_count );
+
+    return b_run( queries, query_count, hitcount, NEEDLEMAN_WUNSCH, bit_width, align_type, callback, data );
+}
+
+/**
+ * Aligns the query sequence against all sequences in the database using the
+ * Smith-Waterman Algorithm and several worker processes.
+ *
+ * @see sh_run
+ */
+p_alignment_list sw_align_sharded( p_query query, size_t hitcount, int bit_width, int align_type,
+        size_t shard_count ) {
+    test_configuration( query );
+
+    return sh_run( query, hitcount, SMITH_WATERMAN, bit_width, align_type, shard_count );
+}
+
+/**
+ * Aligns the query sequence against all sequences in the database using the
+ * Needleman-Wunsch Algorithm and several worker processes.
+ *
+ * @see sh_run
+ */
+p_alignment_list nw_align_sharded( p_query query, size_t hitcount, int bit_width, int align_type,
+        size_t shard_count ) {
+    test_configuration( query );
+
+    return sh_run( query, hitcount, NEEDLEMAN_WUNSCH, bit_width, align_type, shard_count );
+}
+
+/**
+ * Updates the result of a previous search with the Smith-Waterman Algorithm,
+ * after sequences were appended to the database.
+ *
+ * @see m_run_incremental
+ */
+p_alignment_list sw_align_incremental( p_query query, p_alignment_list previous, size_t * db_end, size_t hitcount,
+        int bit_width, int align_type ) {
+    test_configuration( query );
+
+    return m_run_incremental( query, SMITH_WATERMAN, bit_width, align_type, hitcount, previous, db_end );
+}
+
+/**
+ * Updates the result of a previous search with the Needleman-Wunsch Algorithm,
+ * after sequences were appended to the database.
+ *
+ * @see m_run_incremental
+ */
+p_alignment_list nw_align_incremental( p_query query, p_alignment_list previous, size_t * db_end, size_t hitcount,
+        int bit_width, int align_type ) {
+    test_configuration( query );
+
+    return m_run_incremental( query, NEEDLEMAN_WUNSCH, bit_width, align_type, hitcount, previous, db_end );
+}
+
+p_alignment_list merge_alignment_lists( p_alignment_list * lists, size_t list_count, size_t hitcount ) {
+    return a_merge( lists, list_count, hitcount );
+}
+
+static void test_pair_configuration( p_align_pair pairs, size_t pair_count ) {
+    test_cpu_features();
+
+    if( !score_matrix_64 ) {
+        fatal( "Scoring not initialized." );
+    }
+    if( !pairs && pair_count ) {
+        fatal( "Pairs not initialized." );
+    }
+    if( !is_constant_scoring() && (symtype == NUCLEOTIDE) ) {
+        fatal( "Nucleotide sequences can only be aligned using constant scores." );
+    }
+}
+
+/**
+ * Aligns the query and target sequence of each pair using the Smith-Waterman
+ * Algorithm.
+ *
+ * @see pa_align_pairs
+ */
+p_alignment_list sw_align_pairs( p_align_pair pairs, size_t pair_count, int bit_width, int align_type ) {
+    test_pair_configuration( pairs, pair_count );
+
+    return pa_align_pairs( pairs, pair_count, SMITH_WATERMAN, bit_width, align_type );
+}
+
+/**
+ * Aligns the query and target sequence of each pair using the
+ * Needleman-Wunsch Algorithm.
+ *
+ * @see pa_align_pairs
+ */
+p_alignment_list nw_align_pairs( p_align_pair pairs, size_t pair_count, int bit_width, int align_type ) {
+    test_pair_configuration( pairs, pair_count );
+
+    return pa_align_pairs( pairs, pair_count, NEEDLEMAN_WUNSCH, bit_width, align_type );
+}
+
 /**
  * Release the memory allocated by the functions sw_align, nw_align,
- * nw_sellers_align and nw_ignore_gaps_align.
+ * sw_align_pairs and nw_align_pairs.
  *
  * @param  a   pointer to the alignment structure
  *
@@ -263,9 +694,387 @@ void free_alignment( p_alignment_list alist ) {
     a_free( alist );
 }
 
+void free_alignment_batch( p_alignment_list * alists, size_t query_count ) {
+    b_free( alists, query_count );
+}
+
+void ssa_result_free( p_ssa_result_table table ) {
+    rt_free( table );
+}
+
 void ssa_exit() {
     mat_free();
     ssa_db_close();
 
     exit_thread_pool();
 }
+
+// #############################################################################
+// Search contexts
+// ###############
+p_ssa_context ssa_ctx_create() {
+    return ctx_create();
+}
+
+void ssa_ctx_free( p_ssa_context ctx ) {
+    ctx_free( ctx );
+}
+
+void ssa_ctx_set_chunk_size( p_ssa_context ctx, size_t size ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    set_chunk_size( size );
+    ctx_leave( prev );
+}
+
+void ssa_ctx_set_search_budget( p_ssa_context ctx, double seconds, size_t max_sequences ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    set_search_budget( seconds, max_sequences );
+    ctx_leave( prev );
+}
+
+void ssa_ctx_set_progress_callback( p_ssa_context ctx, ssa_progress_callback callback, void * data ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    set_progress_callback( callback, data );
+    ctx_leave( prev );
+}
+
+void ssa_ctx_set_search_range( p_ssa_context ctx, size_t first_id, size_t end_id ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    set_search_range( first_id, end_id );
+    ctx_leave( prev );
+}
+
+void ssa_ctx_set_deduplication( p_ssa_context ctx, int enabled ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    set_deduplication( enabled );
+    ctx_leave( prev );
+}
+
+void ssa_ctx_set_prefix_sharing( p_ssa_context ctx, int enabled ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    set_prefix_sharing( enabled );
+    ctx_leave( prev );
+}
+
+void ssa_ctx_set_bound_pruning( p_ssa_context ctx, int enabled ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    set_bound_pruning( enabled );
+    ctx_leave( prev );
+}
+
+size_t ssa_ctx_get_pruned_sequence_count( p_ssa_context ctx ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    size_t count = get_pruned_sequence_count();
+    ctx_leave( prev );
+
+    return count;
+}
+
+void ssa_ctx_set_nw_band( p_ssa_context ctx, long width ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    set_nw_band( width );
+    ctx_leave( prev );
+}
+
+void ssa_ctx_set_cigar_format( p_ssa_context ctx, int format ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    set_cigar_format( format );
+    ctx_leave( prev );
+}
+
+void ssa_ctx_get_band_stats( p_ssa_context ctx, size_t * banded, size_t * fallbacks ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    get_band_stats( banded, fallbacks );
+    ctx_leave( prev );
+}
+
+void ssa_ctx_set_kmer_prefilter( p_ssa_context ctx, size_t k, size_t min_shared, size_t max_candidates ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    set_kmer_prefilter( k, min_shared, max_candidates );
+    ctx_leave( prev );
+}
+
+int ssa_ctx_save_kmer_index( p_ssa_context ctx, const char * file ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    int result = save_kmer_index( file );
+    ctx_leave( prev );
+
+    return result;
+}
+
+int ssa_ctx_load_kmer_index( p_ssa_context ctx, const char * file ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    int result = load_kmer_index( file );
+    ctx_leave( prev );
+
+    return result;
+}
+
+void ssa_ctx_set_ungapped_prefilter( p_ssa_context ctx, long min_score, size_t max_candidates ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    set_ungapped_prefilter( min_score, max_candidates );
+    ctx_leave( prev );
+}
+
+void ssa_ctx_get_prefilter_stats( p_ssa_context ctx, size_t * sequences, size_t * candidates ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    get_prefilter_stats( sequences, candidates );
+    ctx_leave( prev );
+}
+
+void ssa_ctx_init_score_matrix( p_ssa_context ctx, int mode, const char* matrix ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    init_score_matrix( mode, matrix );
+    ctx_leave( prev );
+}
+
+void ssa_ctx_init_constant_scores( p_ssa_context ctx, const int8_t p, const int8_t m ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    init_constant_scores( p, m );
+    ctx_leave( prev );
+}
+
+void ssa_ctx_init_gap_penalties( p_ssa_context ctx, const int8_t gap_open, const int8_t gap_extend ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    init_gap_penalties( gap_open, gap_extend );
+    ctx_leave( prev );
+}
+
+void ssa_ctx_init_symbol_translation( p_ssa_context ctx, int type, int strands, int db_gencode, int q_gencode ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    init_symbol_translation( type, strands, db_gencode, q_gencode );
+    ctx_leave( prev );
+}
+
+void ssa_ctx_init_db( p_ssa_context ctx, p_seqinfo sequences, size_t count ) {
+    if( !sequences && count ) {
+        fatal( "Database sequences not initialized." );
+    }
+
+    ctx->db_sequences = sequences;
+    ctx->db_sequence_count = count;
+}
+
+void ssa_ctx_use_database( p_ssa_context ctx, p_ssa_database db ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    use_database( db );
+    ctx_leave( prev );
+}
+
+p_query ssa_ctx_init_sequence_fasta( p_ssa_context ctx, int mode, const char* fasta_sequence ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    p_query query = init_sequence_fasta( mode, fasta_sequence );
+    ctx_leave( prev );
+
+    return query;
+}
+
+p_alignment_list ssa_ctx_sw_align( p_ssa_context ctx, p_query query, size_t hitcount, int bit_width, int align_type ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    p_alignment_list alist = sw_align( query, hitcount, bit_width, align_type );
+    ctx_leave( prev );
+
+    return alist;
+}
+
+p_alignment_list ssa_ctx_nw_align( p_ssa_context ctx, p_query query, size_t hitcount, int bit_width, int align_type ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    p_alignment_list alist = nw_align( query, hitcount, bit_width, align_type );
+    ctx_leave( prev );
+
+    return alist;
+}
+
+p_alignment_list ssa_ctx_ed_align( p_ssa_context ctx, p_query query, size_t hitcount, int mode ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    p_alignment_list alist = ed_align( query, hitcount, mode );
+    ctx_leave( prev );
+
+    return alist;
+}
+
+int ssa_ctx_sw_scores( p_ssa_context ctx, p_query query, int bit_width, int32_t * scores ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    int finished = sw_scores( query, bit_width, scores );
+    ctx_leave( prev );
+
+    return finished;
+}
+
+int ssa_ctx_nw_scores( p_ssa_context ctx, p_query query, int bit_width, int32_t * scores ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    int finished = nw_scores( query, bit_width, scores );
+    ctx_leave( prev );
+
+    return finished;
+}
+
+int ssa_ctx_sw_stream( p_ssa_context ctx, p_query query, int bit_width, long min_score, int delivery,
+        ssa_hit_callback callback, void * data ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    int finished = sw_stream( query, bit_width, min_score, delivery, callback, data );
+    ctx_leave( prev );
+
+    return finished;
+}
+
+int ssa_ctx_nw_stream( p_ssa_context ctx, p_query query, int bit_width, long min_score, int delivery,
+        ssa_hit_callback callback, void * data ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    int finished = nw_stream( query, bit_width, min_score, delivery, callback, data );
+    ctx_leave( prev );
+
+    return finished;
+}
+
+p_ssa_result_table ssa_ctx_sw_align_table( p_ssa_context ctx, p_query query, size_t hitcount, int bit_width,
+        int align_type ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    p_ssa_result_table table = sw_align_table( query, hitcount, bit_width, align_type );
+    ctx_leave( prev );
+
+    return table;
+}
+
+p_ssa_result_table ssa_ctx_nw_align_table( p_ssa_context ctx, p_query query, size_t hitcount, int bit_width,
+        int align_type ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    p_ssa_result_table table = nw_align_table( query, hitcount, bit_width, align_type );
+    ctx_leave( prev );
+
+    return table;
+}
+
+p_alignment_list * ssa_ctx_sw_align_batch( p_ssa_context ctx, p_query * queries, size_t query_count,
+        size_t hitcount, int bit_width, int align_type ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    p_alignment_list * alists = sw_align_batch( queries, query_count, hitcount, bit_width, align_type );
+    ctx_leave( prev );
+
+    return alists;
+}
+
+p_alignment_list * ssa_ctx_nw_align_batch( p_ssa_context ctx, p_query * queries, size_t query_count,
+        size_t hitcount, int bit_width, int align_type ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    p_alignment_list * alists = nw_align_batch( queries, query_count, hitcount, bit_width, align_type );
+    ctx_leave( prev );
+
+    return alists;
+}
+
+p_alignment_list * ssa_ctx_sw_align_batch_callback( p_ssa_context ctx, p_query * queries, size_t query_count,
+        size_t hitcount, int bit_width, int align_type, ssa_batch_callback callback, void * data ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    p_alignment_list * alists = sw_align_batch_callback( queries, query_count, hitcount, bit_width, align_type,
+            callback, data );
+    ctx_leave( prev );
+
+    return alists;
+}
+
+p_alignment_list * ssa_ctx_nw_align_batch_callback( p_ssa_context ctx, p_query * queries, size_t query_count,
+        size_t hitcount, int bit_width, int align_type, ssa_batch_callback callback, void * data ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    p_alignment_list * alists = nw_align_batch_callback( queries, query_count, hitcount, bit_width, align_type,
+            callback, data );
+    ctx_leave( prev );
+
+    return alists;
+}
+
+p_alignment_list ssa_ctx_sw_align_pairs( p_ssa_context ctx, p_align_pair pairs, size_t pair_count, int bit_width,
+        int align_type ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    p_alignment_list alist = sw_align_pairs( pairs, pair_count, bit_width, align_type );
+    ctx_leave( prev );
+
+    return alist;
+}
+
+p_alignment_list ssa_ctx_nw_align_pairs( p_ssa_context ctx, p_align_pair pairs, size_t pair_count, int bit_width,
+        int align_type ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    p_alignment_list alist = nw_align_pairs( pairs, pair_count, bit_width, align_type );
+    ctx_leave( prev );
+
+    return alist;
+}
+
+p_alignment_list ssa_ctx_sw_align_sharded( p_ssa_context ctx, p_query query, size_t hitcount, int bit_width,
+        int align_type, size_t shard_count ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    p_alignment_list alist = sw_align_sharded( query, hitcount, bit_width, align_type, shard_count );
+    ctx_leave( prev );
+
+    return alist;
+}
+
+p_alignment_list ssa_ctx_nw_align_sharded( p_ssa_context ctx, p_query query, size_t hitcount, int bit_width,
+        int align_type, size_t shard_count ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    p_alignment_list alist = nw_align_sharded( query, hitcount, bit_width, align_type, shard_count );
+    ctx_leave( prev );
+
+    return alist;
+}
+
+p_alignment_list ssa_ctx_sw_align_incremental( p_ssa_context ctx, p_query query, p_alignment_list previous,
+        size_t * db_end, size_t hitcount, int bit_width, int align_type ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    p_alignment_list alist = sw_align_incremental( query, previous, db_end, hitcount, bit_width, align_type );
+    ctx_leave( prev );
+
+    return alist;
+}
+
+p_alignment_list ssa_ctx_nw_align_incremental( p_ssa_context ctx, p_query query, p_alignment_list previous,
+        size_t * db_end, size_t hitcount, int bit_width, int align_type ) {
+    p_ssa_context prev = ctx_enter( ctx );
+    p_alignment_list alist = nw_align_incremental( query, previous, db_end, hitcount, bit_width, align_type );
+    ctx_leave( prev );
+
+    return alist;
+}
+
+// #############################################################################
+// Asynchronous searches
+// #####################
+static p_ssa_search submit_search( p_ssa_context ctx, p_query query, size_t hitcount, int search_type,
+        int bit_width, int align_type, ssa_search_callback callback, void * callback_data ) {
+    if( !ctx ) {
+        fatal( "Context not initialized." );
+    }
+
+    p_ssa_context prev = ctx_enter( ctx );
+    test_configuration( query );
+    ctx_leave( prev );
+
+    return as_submit( ctx, query, hitcount, search_type, bit_width, align_type, callback, callback_data );
+}
+
+p_ssa_search ssa_ctx_sw_align_async( p_ssa_context ctx, p_query query, size_t hitcount, int bit_width,
+        int align_type, ssa_search_callback callback, void * callback_data ) {
+    return submit_search( ctx, query, hitcount, SMITH_WATERMAN, bit_width, align_type, callback, callback_data );
+}
+
+p_ssa_search ssa_ctx_nw_align_async( p_ssa_context ctx, p_query query, size_t hitcount, int bit_width,
+        int align_type, ssa_search_callback callback, void * callback_data ) {
+    return submit_search( ctx, query, hitcount, NEEDLEMAN_WUNSCH, bit_width, align_type, callback, callback_data );
+}
+
+int ssa_search_poll( p_ssa_search search ) {
+    return as_poll( search );
+}
+
+p_alignment_list ssa_search_wait( p_ssa_search search ) {
+    return as_wait( search );
+}
+
+void ssa_search_cancel( p_ssa_search search ) {
+    as_cancel( search );
+}
+
+void ssa_search_free( p_ssa_search search ) {
+    as_free( search );
+}
@@ -23,6 +23,8 @@
 #include <stdint.h>
 #include <stddef.h>
 
+#include "libssa_extern_db.h"
+
 // #############################################################################
 // Constants
 // #########
@@ -55,6 +57,12 @@
 #define BIT_WIDTH_16 16
 #define BIT_WIDTH_64 64
 
+#define ED_GLOBAL 0 // the whole query against the whole database sequence
+#define ED_SEMI_GLOBAL 1 // the whole query against any part of the database sequence
+#define ED_PREFIX 2 // the whole query against a prefix of the database sequence
+
+#define NW_BAND_ADAPTIVE -1 // start with a narrow band and widen it, until it contains the optimum
+
 #define OUTPUT_SILENT 0
 #define OUTPUT_ERROR 1
 #define OUTPUT_WARNING 2
@@ -62,11 +70,32 @@
 
 #define COMPUTE_SCORE 0
 #define COMPUTE_ALIGNMENT 1
+// coordinates, identity and gap counts of the alignments, without CIGAR strings
+#define COMPUTE_STATISTICS 2
+
+#define CIGAR_FORMAT_TEXT 0 // CIGAR string with 'M' for matches and mismatches
+#define CIGAR_FORMAT_EXTENDED 1 // CIGAR string with '=' for matches and 'X' for mismatches
+#define CIGAR_FORMAT_PACKED 2 // only the packed operations, rendered by alignment_cigar_string
+
+/*
+ * Operation and length of an entry of alignment_t.cigar_ops, which are packed
+ * like in BAM: the length in the upper 28 bits, the operation in the lower 4
+ * bits, numbered 0 to 8 like the symbols "MIDNSHP=X".
+ */
+#define SSA_CIGAR_OP(c) ((c) & 0xf)
+#define SSA_CIGAR_LEN(c) ((c) >> 4)
 
 #define READ_FROM_FILE 0
 #define READ_FROM_STRING 1
 #define MATRIX_BUILDIN 2
 
+#define SSA_SEARCH_RUNNING 0
+#define SSA_SEARCH_FINISHED 1
+#define SSA_SEARCH_CANCELLED 2
+
+#define STREAM_FROM_WORKERS 0
+#define STREAM_FROM_CALLER 1
+
 #define COMPUTE_ON_SSE2 0
 #define COMPUTE_ON_SSE41 1
 #define COMPUTE_ON_AVX2 2
@@ -97,6 +126,24 @@ typedef struct {
     int frame;
 } q_seq_t;
 
+/** @typedef    alignment of a query and a database sequence
+ *
+ * @field align_matches     number of identical columns of the alignment, 0 if
+ *                          neither the alignment nor its statistics were
+ *                          computed
+ * @field align_mismatches  number of columns with different symbols
+ * @field align_gap_opens   number of gaps
+ * @field align_gap_columns number of columns of all gaps
+ * @field align_columns     number of columns of the alignment, including gaps.
+ *                          The identity of the alignment is
+ *                          align_matches / align_columns.
+ * @field alignment         CIGAR string of the alignment, if it was computed
+ *                          with CIGAR_FORMAT_TEXT or CIGAR_FORMAT_EXTENDED
+ * @field cigar_ops         operations of the CIGAR with '=' and 'X', if the
+ *                          alignment was computed with CIGAR_FORMAT_PACKED.
+ *                          See SSA_CIGAR_OP and SSA_CIGAR_LEN.
+ * @field cigar_ops_len     number of operations in cigar_ops
+ */
 typedef struct {
     db_seq_t db_seq;
     q_seq_t query;
@@ -107,15 +154,185 @@ typedef struct {
     size_t align_q_end;
     size_t align_d_start;
     size_t align_d_end;
+    size_t align_matches;
+    size_t align_mismatches;
+    size_t align_gap_opens;
+    size_t align_gap_columns;
+    size_t align_columns;
+    uint32_t * cigar_ops;
+    size_t cigar_ops_len;
 } alignment_t;
 typedef alignment_t * p_alignment;
 
+/** @typedef    result list of a search
+ *
+ * @field partial   1, if the search stopped early, because its budget was used
+ *                  up. The list then holds the best alignments of the searched
+ *                  part of the database.
+ */
 typedef struct {
     p_alignment* alignments;
     size_t len;
+    int partial;
 } alignment_list_t;
 typedef alignment_list_t * p_alignment_list;
 
+#define SSA_NO_CIGAR ((size_t) -1)
+
+struct ssa_result_data;
+
+/** @typedef    result of a search as a table with one column per field
+ *
+ * Row i of each column describes the i-th best hit. The rows are sorted like
+ * the alignments of an alignment list. All columns are held in one block of
+ * memory. The database sequences are not copied, see
+ * ssa_result_get_db_sequence.
+ *
+ * @field partial           1, if the search stopped early, because its budget
+ *                          was used up
+ * @field d_strands         strand and frame of the database sequence of each hit
+ * @field q_strands         strand and frame of the query sequence of each hit
+ * @field q_starts          alignment coordinates of each hit, 0 if its
+ *                          alignment was not computed
+ * @field cigar_offsets     position of the CIGAR string of each hit in
+ *                          cigar_pool, or SSA_NO_CIGAR if its alignment was
+ *                          not computed. The strings end with a 0 byte.
+ * @field cigar_lengths     length of the CIGAR string of each hit
+ * @field cigar_pool        the CIGAR strings of all hits
+ */
+typedef struct {
+    size_t len;
+    int partial;
+
+    size_t * db_ids;
+    long * scores;
+    uint8_t * d_strands;
+    uint8_t * d_frames;
+    uint8_t * q_strands;
+    uint8_t * q_frames;
+
+    size_t * q_starts;
+    size_t * q_ends;
+    size_t * d_starts;
+    size_t * d_ends;
+
+    size_t * cigar_offsets;
+    size_t * cigar_lengths;
+    char * cigar_pool;
+    size_t cigar_pool_size;
+
+    struct ssa_result_data * data;
+} ssa_result_table_t;
+typedef ssa_result_table_t * p_ssa_result_table;
+
+/**
+ * A pair of sequences for the pairwise alignment.
+ *
+ * The target sequence is given as a string of residues, like the sequences
+ * of the database.
+ */
+typedef struct {
+    p_query query;
+    char * target;
+    size_t target_len;
+} align_pair_t;
+typedef align_pair_t * p_align_pair;
+
+/**
+ * A search context holds the complete configuration of searches: the scoring,
+ * the symbol translation, the chunk size and optionally its own database.
+ *
+ * The functions without a context use a default context. Searches in
+ * different contexts can run at the same time, in different threads of the
+ * caller, and share the thread pool. A single context must not be used by
+ * more than one thread at the same time.
+ *
+ * The output mode, the SIMD compute mode and the number of threads are set
+ * for the whole process.
+ */
+struct ssa_context;
+typedef struct ssa_context ssa_context_t;
+typedef ssa_context_t * p_ssa_context;
+
+/**
+ * A database, that can be reloaded while searches are running. Every search
+ * uses the version of the database, that was current when it started.
+ */
+struct ssa_database;
+typedef struct ssa_database * p_ssa_database;
+
+/** @typedef    handle of an asynchronous search */
+struct ssa_search;
+typedef struct ssa_search * p_ssa_search;
+
+/**
+ * Called by the thread of an asynchronous search, when the search is finished
+ * or cancelled. The callback must not call ssa_search_wait or
+ * ssa_search_free for this search.
+ */
+typedef void (*ssa_search_callback)( p_ssa_search search, void * data );
+
+/**
+ * Called by a batch search for each query, as soon as its alignments are
+ * complete. The calls come from the worker threads, possibly at the same time
+ * and not in the order of the queries. The list is part of the result of the
+ * batch search and must not be freed by the callback.
+ *
+ * @param query_index   index of the query in the array of queries
+ */
+typedef void (*ssa_batch_callback)( size_t query_index, p_alignment_list alist, void * data );
+
+/** @typedef    hit of a streaming search
+ *
+ * @field db_id         ID of the database sequence
+ * @field db_strand     strand and frame of the database sequence
+ * @field query_strand  strand and frame of the query sequence
+ */
+typedef struct {
+    size_t db_id;
+    long score;
+    int db_strand;
+    int db_frame;
+    int query_strand;
+    int query_frame;
+} ssa_hit_t;
+
+/**
+ * Called by a streaming search for every hit, that reaches the minimum score.
+ * The hit is only valid during the call.
+ */
+typedef void (*ssa_hit_callback)( const ssa_hit_t * hit, void * data );
+
+/** @typedef    best hits of a running search, as passed to the progress callback
+ *
+ * @field hits  current top hits, sorted by score
+ * @field len   number of hits
+ * @field ctx   context of the search
+ *
+ * @see ssa_progress_get_alignments
+ */
+typedef struct {
+    ssa_hit_t * hits;
+    size_t len;
+    p_ssa_context ctx;
+} ssa_progress_t;
+typedef ssa_progress_t * p_ssa_progress;
+
+/**
+ * Called by the worker threads during a search with the best hits found so
+ * far. The hits are only valid during the call. Their database sequences are
+ * only fetched, if the callback asks for them with
+ * ssa_progress_get_alignments.
+ *
+ * The callback is called by one thread at a time. The other threads keep
+ * searching meanwhile, and the chunks they finish are reported together by the
+ * next call. The state after the last chunk is always reported.
+ *
+ * @param progress  current top hits
+ * @param fraction  estimated part of the database, that was searched
+ */
+typedef void (*ssa_progress_callback)( p_ssa_progress progress, double fraction, void * data );
+
 // #############################################################################
 // Technical initialisation
 // ########################
@@ -127,6 +344,235 @@ void set_chunk_size( size_t size );
 
 void set_thread_count( size_t count );
 
+/**
+ * Limits the following searches with sw_align, nw_align and the asynchronous
+ * searches. If the limit is reached, the search stops at the next chunk and
+ * returns the best alignments found so far, with the partial flag set.
+ *
+ * @param seconds           time limit in seconds, 0 for no limit
+ * @param max_sequences     maximum number of database sequences to search,
+ *                          0 for no limit
+ */
+void set_search_budget( double seconds, size_t max_sequences );
+
+/**
+ * Sets a callback, which reports the intermediate results of the following
+ * searches with sw_align, nw_align and the asynchronous searches after every
+ * chunk. Pass 0 to disable it.
+ */
+void set_progress_callback( ssa_progress_callback callback, void * data );
+
+/**
+ * Creates the alignments of the hits passed to a progress callback. Only the
+ * scores and the database sequences of the alignments are set. Must be called
+ * during the callback.
+ *
+ * @return the alignments in the order of the hits, which have to be freed
+ *         with free_alignment
+ */
+p_alignment_list ssa_progress_get_alignments( p_ssa_progress progress );
+
+/**
+ * Restricts the following searches to the database sequences with the IDs
+ * first_id up to, but not including, end_id. With set_search_range( 0, 0 ) the
+ * whole database is searched again.
+ *
+ * Databases, that are too big for one process or host, can be split into ID
+ * ranges, which are searched independently. The results are combined with
+ * merge_alignment_lists.
+ *
+ * @param first_id  ID of the first searched sequence
+ * @param end_id    ID after the last searched sequence, 0 for the end of the
+ *                  database. Otherwise it has to be greater than first_id.
+ */
+void set_search_range( size_t first_id, size_t end_id );
+
+/**
+ * Enables or disables the deduplication of the database for the following
+ * searches with sw_align and nw_align. If enabled, only one sequence of each
+ * group of identical database sequences is aligned. Its score is reported for
+ * all sequences of the group.
+ *
+ * The groups are computed at the first search and reused, until the database
+ * changes. Disabled by default.
+ *
+ * @param enabled   1 to enable, 0 to disable the deduplication
+ */
+void set_deduplication( int enabled );
+
+/**
+ * Enables or disables the reuse of DP columns in the following searches with
+ * 64 bit. The sequences of each chunk are searched in lexicographical order,
+ * and sequences with a common prefix continue from the saved column at the end
+ * of the prefix, instead of aligning the prefix again.
+ *
+ * This pays off for databases, in which many sequences share a long prefix,
+ * like amplicon databases. Bigger chunks, see set_chunk_size, contain more
+ * sequences with common prefixes. The results are not changed. Disabled by
+ * default.
+ *
+ * @param enabled   1 to enable, 0 to disable the reuse
+ */
+void set_prefix_sharing( int enabled );
+
+/**
+ * Enables or disables the bound pruning of the following searches with
+ * sw_align and nw_align. The sequences are searched from the longest to the
+ * shortest. Once a thread has found hit_count hits, sequences, which cannot
+ * score higher than the worst of them, are skipped without being aligned. A
+ * local alignment scores at most the highest substitution score times the
+ * length of the shorter sequence; a global alignment additionally pays for a
+ * gap of the length difference.
+ *
+ * The 8 and 16 bit searches also stop aligning a sequence midway, once its
+ * best score so far plus the highest score of the remaining columns cannot
+ * reach the hits any more.
+ *
+ * This pays off for small hit counts and databases with very different
+ * sequence lengths. The scores of the results are not changed, but of hits
+ * with the same score other sequences can be reported. Disabled by default.
+ *
+ * @param enabled   1 to enable, 0 to disable the pruning
+ *
+ * @see get_pruned_sequence_count
+ */
+void set_bound_pruning( int enabled );
+
+/**
+ * Returns the number of sequences skipped by the bound pruning in the last
+ * search.
+ */
+size_t get_pruned_sequence_count();
+
+/**
+ * Restricts the following searches and alignments with nw_align to a band of
+ * diagonals of the DP matrix. The band contains the diagonals of the first and
+ * of the last cell of the matrix, widened by width diagonals on both sides.
+ * For sequences, which differ only by a few substitutions and short gaps, like
+ * in dereplication and clustering, this computes a small part of the matrix.
+ * The scores are computed with 32 bit for any bit width.
+ *
+ * If a score computed within the band is so low, that the optimum could lie
+ * outside of it, the sequence is aligned again with the full matrix. The
+ * results are not changed, but of alignments with the same score another one
+ * can be reported.
+ *
+ * With NW_BAND_ADAPTIVE the first band is narrow, and is doubled for the
+ * sequences, whose optimum could lie outside, until it is as wide as the
+ * query. 0 disables the band, which is the default.
+ *
+ * @param width     half width of the band, NW_BAND_ADAPTIVE or 0
+ *
+ * @see get_band_stats
+ */
+void set_nw_band( long width );
+
+/**
+ * Sets the form, in which the CIGAR of the computed alignments is kept.
+ *
+ * The default CIGAR_FORMAT_TEXT writes a string with 'M' for the aligned
+ * columns into alignment_t.alignment, CIGAR_FORMAT_EXTENDED one with '=' and
+ * 'X'. With CIGAR_FORMAT_PACKED no text is rendered, but the operations are
+ * kept in alignment_t.cigar_ops, and alignment_cigar_string renders them on
+ * demand. The CIGAR strings of a result table are always rendered as text,
+ * with CIGAR_FORMAT_PACKED like with CIGAR_FORMAT_TEXT.
+ *
+ * @param format    CIGAR_FORMAT_TEXT, CIGAR_FORMAT_EXTENDED or
+ *                  CIGAR_FORMAT_PACKED
+ */
+void set_cigar_format( int format );
+
+/**
+ * Renders the packed CIGAR of an alignment, which was computed with
+ * CIGAR_FORMAT_PACKED, as text.
+ *
+ * @param extended  if 0, the aligned columns are written as 'M', else as '='
+ *                  and 'X'
+ * @return the text, which has to be freed by the caller, or 0 if the
+ *         alignment has no packed CIGAR
+ */
+char * alignment_cigar_string( p_alignment a, int extended );
+
+/**
+ * Returns the number of sequences of the last search, whose score was
+ * computed within the band, and of those, whose optimum could lie outside the
+ * band and which were aligned with the full matrix.
+ */
+void get_band_stats( size_t * banded, size_t * fallbacks );
+
+/**
+ * Configures the k-mer prefilter of the following searches with sw_align and
+ * nw_align. The prefilter counts the k-mers, that each database sequence
+ * shares with the query, and aligns only the best ranked sequences. This is a
+ * heuristic: alignments of sequences sharing few k-mers can be missed.
+ *
+ * The k-mer index of the database is built at the first search and kept until
+ * the database changes. It can be stored with save_kmer_index. The prefilter
+ * supports only NUCLEOTIDE and AMINOACID searches.
+ *
+ * With min_shared and max_candidates both 0, the prefilter is disabled, which
+ * is the default.
+ *
+ * @param k                 length of the k-mers, 0 for the default of 8 for
+ *                          nucleotides and 3 for amino acids. Up to 12 for
+ *                          nucleotides and 4 for amino acids.
+ * @param min_shared        minimal number of k-mers shared with the query
+ * @param max_candidates    maximal number of aligned sequences, 0 for no limit
+ *
+ * @see get_prefilter_stats
+ */
+void set_kmer_prefilter( size_t k, size_t min_shared, size_t max_candidates );
+
+/**
+ * Writes the k-mer index of the database to a file, building it first, if
+ * necessary. The index is built for the current symbol type and k.
+ *
+ * @return 1 on success, 0 on error
+ */
+int save_kmer_index( const char * file );
+
+/**
+ * Reads a k-mer index written by save_kmer_index, so that it does not have to
+ * be built again. The k of the prefilter is set to the k of the index.
+ *
+ * @return 1 on success, 0 if the file could not be read or belongs to another
+ *         database
+ */
+int load_kmer_index( const char * file );
+
+/**
+ * Configures the ungapped prefilter of the following searches with sw_align
+ * and nw_align, for a fast but sensitive search. The prefilter computes the
+ * best ungapped local alignment score of each database sequence with the
+ * query, which is much cheaper than the gapped alignment, and aligns only the
+ * best ranked sequences. Alignments, whose score depends on gaps, can be
+ * missed.
+ *
+ * If the k-mer prefilter is enabled as well, the ungapped prefilter ranks its
+ * candidates.
+ *
+ * With min_score -1 and max_candidates 0, the prefilter is disabled, which is
+ * the default.
+ *
+ * @param min_score         minimal ungapped score of the aligned sequences
+ * @param max_candidates    maximal number of aligned sequences, 0 for no limit
+ *
+ * @see get_prefilter_stats
+ */
+void set_ungapped_prefilter( long min_score, size_t max_candidates );
+
+/**
+ * Returns the number of sequences ranked by the prefilter in the last search,
+ * and the number of candidates it passed to the alignment.
+ */
+void get_prefilter_stats( size_t * sequences, size_t * candidates );
+
+/**
+ * Returns the recall of a heuristic search: the fraction of the alignments of
+ * an exact search, that were also found by the heuristic search.
+ */
+double alignment_list_recall( p_alignment_list exact, p_alignment_list approx );
+
 // #############################################################################
 // Initialisations
 // ################
@@ -166,10 +612,10 @@ void init_constant_scores( const int8_t p, const int8_t m );
 /**
  * Initialises gap penalties used for the alignments.
  *
- * @param  gapO  penalty for opening a gap
- * @param  gapE  penalty for extending a gap
+ * @param  gap_open    penalty for opening a gap
+ * @param  gap_extend  penalty for extending a gap
  */
-void init_gap_penalties( const int8_t gapO, const int8_t gapE );
+void init_gap_penalties( const int8_t gap_open, const int8_t gap_extend );
 
 /**
  * Initialises the symbol type translation for the alignment. Depending on the
@@ -209,6 +655,58 @@ void init_symbol_translation( int type, int strands, int db_gencode, int q_genco
  */
 void init_db( const char* db_file );
 
+/**
+ * Creates an empty database, that can be reloaded while searches are running.
+ *
+ * The sequences are read from FASTA files. Each load creates a new version of
+ * the database. Searches, that start after a load, use the new version, while
+ * running searches finish with the version they started with. An old version
+ * is freed, when the last search using it has finished.
+ *
+ * @see use_database
+ */
+p_ssa_database ssa_database_create();
+
+/**
+ * Reads the database from a FASTA file and makes it the current version.
+ *
+ * @return 1 on success, 0 if the file could not be read. On failure the
+ *         current version stays in use.
+ */
+int ssa_database_load( p_ssa_database db, const char * fasta_file );
+
+/**
+ * Loads the database in a background thread, like ssa_database_load. Searches
+ * continue with the current version, until the new one is loaded.
+ */
+void ssa_database_load_async( p_ssa_database db, const char * fasta_file );
+
+/**
+ * Waits for a load started by ssa_database_load_async.
+ *
+ * @return the result of the load
+ */
+int ssa_database_wait( p_ssa_database db );
+
+/**
+ * Returns the number of the current version, starting with 1, or 0 if the
+ * database was not loaded yet.
+ */
+size_t ssa_database_get_version( p_ssa_database db );
+
+size_t ssa_database_get_sequence_count( p_ssa_database db );
+
+/**
+ * Releases the database. It must not be used by any context anymore.
+ */
+void ssa_database_free( p_ssa_database db );
+
+/**
+ * Uses db for the following searches, instead of the external database. Pass
+ * 0 to use the external database again.
+ */
+void use_database( p_ssa_database db );
+
 /**
  * Reads a FASTA file containing the query sequence.
  *
@@ -233,8 +731,13 @@ void free_sequence( p_query p );
  * Aligns the query sequence against all sequences in the database using the
  * Smith-Waterman Algorithm.
  *
+ * With COMPUTE_STATISTICS the coordinates, the number of matches, mismatches
+ * and gaps of the alignments are computed without a traceback, which is much
+ * faster than COMPUTE_ALIGNMENT. The alignment strings are not set.
+ *
  * @param  p   pointer to the query profile structure
  * ...
+ * @param  align_type   COMPUTE_SCORE, COMPUTE_ALIGNMENT or COMPUTE_STATISTICS
  * @return pointer to the alignment structure
  */
 p_alignment_list sw_align( p_query p, size_t hitcount, int bit_width, int align_type /* TODO ...*/);
@@ -249,9 +752,302 @@ p_alignment_list sw_align( p_query p, size_t hitcount, int bit_width, int align_
  */
 p_alignment_list nw_align( p_query p, size_t hitcount, int bit_width, int align_type /* TODO ...*/);
 
+/**
+ * Searches the sequences of the database with the lowest unit cost edit
+ * distance to the query, using a bit-vector algorithm. Symbols are compared
+ * for identity, the scoring is not used. The score of a hit is its negative
+ * edit distance, so the list starts with the closest sequence. No alignments
+ * are computed.
+ *
+ * There is no local mode, as a local unit cost alignment is degenerate. To
+ * find the query anywhere in the database sequences use ED_SEMI_GLOBAL.
+ * ED_PREFIX anchors the query at the start of the database sequences.
+ *
+ * @param  p        pointer to the query profile structure
+ * @param  hitcount number of hits returned
+ * @param  mode     ED_GLOBAL, ED_SEMI_GLOBAL or ED_PREFIX
+ * @return pointer to the alignment structure, or 0 if the search was
+ *         cancelled
+ */
+p_alignment_list ed_align( p_query p, size_t hitcount, int mode );
+
+/**
+ * Aligns the query sequence against all sequences in the database using the
+ * Smith-Waterman Algorithm, like sw_align, but returns the hits as a result
+ * table. The database sequences are not copied into the result, and with
+ * COMPUTE_SCORE no alignments are allocated. The table has no columns for the
+ * statistics of COMPUTE_STATISTICS, which is treated like COMPUTE_SCORE.
+ *
+ * The table refers to the query and the search context, which have to stay
+ * valid, as long as sequences or alignments of the table are accessed.
+ *
+ * @return the result table, or 0 if the search was cancelled
+ */
+p_ssa_result_table sw_align_table( p_query p, size_t hitcount, int bit_width, int align_type );
+
+/**
+ * Aligns the query sequence against all sequences in the database using the
+ * Needleman-Wunsch Algorithm, and returns the hits as a result table.
+ *
+ * @see sw_align_table
+ */
+p_ssa_result_table nw_align_table( p_query p, size_t hitcount, int bit_width, int align_type );
+
+/**
+ * Returns the database sequence of a row of a result table, in the form in
+ * which it was aligned: mapped to the internal alphabet, and for translated
+ * databases translated into the frame of the hit. The sequence has to be
+ * freed by the caller. A database of ssa_database_create is read in the
+ * version, that the search used, even if it was reloaded since. Other
+ * databases must not have changed since the search.
+ *
+ * @param len   if not 0, set to the length of the sequence
+ */
+char * ssa_result_get_db_sequence( p_ssa_result_table table, size_t row, size_t * len );
+
+/**
+ * Computes the alignment of a row of a result table in the calling thread,
+ * if it was not computed yet. A table of a search with COMPUTE_SCORE is
+ * returned without any traceback, so that the alignments of the rows, that
+ * are actually shown, can be computed when they are needed.
+ *
+ * The query and the scoring of the context of the search must not have
+ * changed since the search.
+ */
+void ssa_result_compute_alignment( p_ssa_result_table table, size_t row );
+
+/**
+ * Computes the alignments of the rows [first, first + count) of a result
+ * table with the threads of the thread pool. Rows, that are already aligned,
+ * are skipped. The alignments of a table run in their own group of threads,
+ * so searches in the context of the table can run at the same time.
+ */
+void ssa_result_compute_alignments( p_ssa_result_table table, size_t first, size_t count );
+
+/**
+ * Starts the computation of the alignments of the rows [first, first + count)
+ * in the background and returns immediately. The scores and IDs of the table
+ * can be read meanwhile, the coordinates and CIGAR strings only after
+ * ssa_result_wait. All other functions on the table wait for the computation
+ * to finish.
+ *
+ * The context of the search can be used for other searches meanwhile, but its
+ * scoring must not change. Cancelling the context also stops the alignments.
+ */
+void ssa_result_compute_alignments_async( p_ssa_result_table table, size_t first, size_t count );
+
+/**
+ * Waits for the background computation of alignments of a result table.
+ */
+void ssa_result_wait( p_ssa_result_table table );
+
+/**
+ * Computes the Smith-Waterman score of the query against every sequence in
+ * the database, without selecting hits or creating alignments. The best score
+ * of all frames of the sequence with the ID i is written to scores[i].
+ *
+ * Sequences, that were not searched, because they are outside of the search
+ * range, were rejected by a prefilter or the search budget was used up, get
+ * the score INT32_MIN. Bound pruning and the progress callback are not used.
+ *
+ * @param  scores   array with one score for each sequence of the database
+ * @return 0 if the search was cancelled, 1 otherwise
+ */
+int sw_scores( p_query p, int bit_width, int32_t * scores );
+
+/**
+ * Computes the Needleman-Wunsch score of the query against every sequence in
+ * the database.
+ *
+ * @see sw_scores
+ */
+int nw_scores( p_query p, int bit_width, int32_t * scores );
+
+/**
+ * Searches the database with the Smith-Waterman Algorithm and passes every
+ * hit with a score of at least min_score to the callback, as soon as it is
+ * found. No hits are kept and nothing is sorted. A sequence can be passed
+ * once for each of its frames.
+ *
+ * With STREAM_FROM_WORKERS the callback is called by the worker threads, at
+ * the same time by several threads. With STREAM_FROM_CALLER the workers pass
+ * the hits through a ring buffer per thread to the calling thread, which
+ * calls the callback. A worker waits, while its ring buffer is full.
+ *
+ * If bound pruning is enabled, sequences and SIMD channels, that cannot reach
+ * min_score, are skipped.
+ *
+ * @param  delivery     STREAM_FROM_WORKERS or STREAM_FROM_CALLER
+ * @return 0 if the search was cancelled, 1 otherwise
+ */
+int sw_stream( p_query p, int bit_width, long min_score, int delivery, ssa_hit_callback callback, void * data );
+
+/**
+ * Searches the database with the Needleman-Wunsch Algorithm and passes every
+ * hit with a score of at least min_score to the callback.
+ *
+ * @see sw_stream
+ */
+int nw_stream( p_query p, int bit_width, long min_score, int delivery, ssa_hit_callback callback, void * data );
+
+/**
+ * Aligns many query sequences against all sequences in the database using the
+ * Smith-Waterman Algorithm.
+ *
+ * The query sequences are packed into the SIMD channels and each database
+ * sequence is compared against all queries at once. This is much faster than
+ * calling sw_align for each query, if the queries are short. Packing the
+ * queries requires a symmetric scoring matrix. With an asymmetric matrix the
+ * queries are searched one after the other. The threads share the hits of
+ * each query, so the search keeps query_count * hitcount hits for any number
+ * of threads.
+ *
+ * @param  queries      array of pointers to the query profile structures
+ * @param  query_count  number of queries
+ * @param  hitcount     number of alignments returned for each query
+ * @param  bit_width    bit width used for the search: BIT_WIDTH_8, BIT_WIDTH_16 or BIT_WIDTH_64
+ * @param  align_type   COMPUTE_SCORE, COMPUTE_ALIGNMENT or COMPUTE_STATISTICS
+ * @return array of query_count pointers to the alignment structures, in the
+ *         order of the queries
+ *
+ * @see free_alignment_batch
+ */
+p_alignment_list * sw_align_batch( p_query * queries, size_t query_count, size_t hitcount, int bit_width,
+        int align_type );
+
+/**
+ * Aligns many query sequences against all sequences in the database using the
+ * Needleman-Wunsch Algorithm.
+ *
+ * @see sw_align_batch
+ */
+p_alignment_list * nw_align_batch( p_query * queries, size_t query_count, size_t hitcount, int bit_width,
+        int align_type );
+
+/**
+ * Runs sw_align_batch and passes the alignments of each query to the callback,
+ * as soon as they are complete.
+ *
+ * @see sw_align_batch
+ * @see ssa_batch_callback
+ */
+p_alignment_list * sw_align_batch_callback( p_query * queries, size_t query_count, size_t hitcount, int bit_width,
+        int align_type, ssa_batch_callback callback, void * data );
+
+/**
+ * Runs nw_align_batch and passes the alignments of each query to the callback,
+ * as soon as they are complete.
+ *
+ * @see sw_align_batch_callback
+ */
+p_alignment_list * nw_align_batch_callback( p_query * queries, size_t query_count, size_t hitcount, int bit_width,
+        int align_type, ssa_batch_callback callback, void * data );
+
+/**
+ * Aligns the query sequence against all sequences in the database using the
+ * Smith-Waterman Algorithm. The database is split into 'shard_count' ID ranges,
+ * which are searched by separate worker processes. The threads set with
+ * set_thread_count are divided among the workers.
+ *
+ * The result is the same as of sw_align, but alignments with equal scores are
+ * always ordered by their database ID.
+ *
+ * @see sw_align
+ * @see merge_alignment_lists
+ */
+p_alignment_list sw_align_sharded( p_query p, size_t hitcount, int bit_width, int align_type, size_t shard_count );
+
+/**
+ * Aligns the query sequence against all sequences in the database using the
+ * Needleman-Wunsch Algorithm and several worker processes.
+ *
+ * @see sw_align_sharded
+ */
+p_alignment_list nw_align_sharded( p_query p, size_t hitcount, int bit_width, int align_type, size_t shard_count );
+
+/**
+ * Updates the result of a previous search with the Smith-Waterman Algorithm,
+ * after sequences were appended to the database. Only the new sequences are
+ * searched and their hits are merged with the previous hits. The result is the
+ * same as of sw_align on the whole database.
+ *
+ * The configuration of the search must be the same as of the previous search.
+ *
+ * @param  previous     result of the previous search. It is not changed and
+ *                      has to be released by the caller.
+ * @param  db_end       in: number of sequences in the database at the time of
+ *                      the previous search, 0 for a first search.
+ *                      out: the current number of sequences. It is not
+ *                      changed, if the search budget was used up and the
+ *                      result is partial, so that the next call searches the
+ *                      skipped sequences.
+ *
+ * @see sw_align
+ */
+p_alignment_list sw_align_incremental( p_query p, p_alignment_list previous, size_t * db_end, size_t hitcount,
+        int bit_width, int align_type );
+
+/**
+ * Updates the result of a previous search with the Needleman-Wunsch Algorithm,
+ * after sequences were appended to the database.
+ *
+ * @see sw_align_incremental
+ */
+p_alignment_list nw_align_incremental( p_query p, p_alignment_list previous, size_t * db_end, size_t hitcount,
+        int bit_width, int align_type );
+
+/**
+ * Merges the results of searches of the same query in different parts of the
+ * database into the global best alignments. They are sorted by descending
+ * score, and alignments with equal scores by ascending database ID. Hits,
+ * that are contained in several lists, are kept once.
+ *
+ * The merged lists are released by this function. The result is partial, if
+ * any of the merged lists is partial.
+ *
+ * @param  lists        the alignment lists to merge
+ * @param  list_count   number of lists
+ * @param  hitcount     maximal number of alignments of the merged list
+ * @return pointer to the merged alignment structure
+ *
+ * @see set_search_range
+ * @see free_alignment
+ */
+p_alignment_list merge_alignment_lists( p_alignment_list * lists, size_t list_count, size_t hitcount );
+
+/**
+ * Aligns the query and target sequence of each pair using the Smith-Waterman
+ * Algorithm. No database is used.
+ *
+ * Pairs with the same query are aligned together, by packing their targets
+ * into the SIMD channels. Pairs should therefore share the p_query of equal
+ * query sequences.
+ *
+ * Translated target sequences (TRANS_DB and TRANS_BOTH) are not supported.
+ *
+ * @param  pairs        array of the sequence pairs
+ * @param  pair_count   number of pairs
+ * @param  bit_width    bit width used for the alignment: BIT_WIDTH_8, BIT_WIDTH_16 or BIT_WIDTH_64
+ * @param  align_type   COMPUTE_SCORE, COMPUTE_ALIGNMENT or COMPUTE_STATISTICS
+ * @return pointer to the alignment structure, holding one alignment for each
+ *         pair, in the order of the pairs. The ID of the database sequence of
+ *         an alignment is the index of its pair.
+ *
+ * @see free_alignment
+ */
+p_alignment_list sw_align_pairs( p_align_pair pairs, size_t pair_count, int bit_width, int align_type );
+
+/**
+ * Aligns the query and target sequence of each pair using the
+ * Needleman-Wunsch Algorithm.
+ *
+ * @see sw_align_pairs
+ */
+p_alignment_list nw_align_pairs( p_align_pair pairs, size_t pair_count, int bit_width, int align_type );
+
 /**
  * Release the memory allocated by the functions sw_align, nw_align,
- * nw_sellers_align and nw_ignore_gaps_align.
+ * sw_align_pairs and nw_align_pairs.
  *
  * @param  a   pointer to the alignment structure
  *
@@ -260,6 +1056,206 @@ p_alignment_list nw_align( p_query p, size_t hitcount, int bit_width, int align_
  */
 void free_alignment( p_alignment_list alist );
 
+/**
+ * Release the memory allocated by the functions sw_align_batch and
+ * nw_align_batch.
+ *
+ * @param  alists       array of pointers to the alignment structures
+ * @param  query_count  number of queries used for the search
+ */
+void free_alignment_batch( p_alignment_list * alists, size_t query_count );
+
+/**
+ * Releases a result table.
+ */
+void ssa_result_free( p_ssa_result_table table );
+
 void ssa_exit();
 
+// #############################################################################
+// Search contexts
+// ###############
+/**
+ * Creates a new search context with the default configuration.
+ *
+ * @see ssa_ctx_free
+ */
+p_ssa_context ssa_ctx_create();
+
+/**
+ * Releases a search context and its scoring matrices. The sequences of the
+ * database are not released.
+ */
+void ssa_ctx_free( p_ssa_context ctx );
+
+/**
+ * The following functions work like the functions without the prefix ssa_ctx_,
+ * but configure or use the provided context instead of the default context.
+ *
+ * Query profiles depend on the symbol translation and have to be created in
+ * the context, that uses them.
+ */
+void ssa_ctx_set_chunk_size( p_ssa_context ctx, size_t size );
+
+void ssa_ctx_set_search_budget( p_ssa_context ctx, double seconds, size_t max_sequences );
+
+void ssa_ctx_set_progress_callback( p_ssa_context ctx, ssa_progress_callback callback, void * data );
+
+void ssa_ctx_set_search_range( p_ssa_context ctx, size_t first_id, size_t end_id );
+
+void ssa_ctx_set_deduplication( p_ssa_context ctx, int enabled );
+
+void ssa_ctx_set_prefix_sharing( p_ssa_context ctx, int enabled );
+
+void ssa_ctx_set_bound_pruning( p_ssa_context ctx, int enabled );
+
+size_t ssa_ctx_get_pruned_sequence_count( p_ssa_context ctx );
+
+void ssa_ctx_set_nw_band( p_ssa_context ctx, long width );
+
+void ssa_ctx_get_band_stats( p_ssa_context ctx, size_t * banded, size_t * fallbacks );
+
+void ssa_ctx_set_cigar_format( p_ssa_context ctx, int format );
+
+void ssa_ctx_set_kmer_prefilter( p_ssa_context ctx, size_t k, size_t min_shared, size_t max_candidates );
+
+int ssa_ctx_save_kmer_index( p_ssa_context ctx, const char * file );
+
+int ssa_ctx_load_kmer_index( p_ssa_context ctx, const char * file );
+
+void ssa_ctx_set_ungapped_prefilter( p_ssa_context ctx, long min_score, size_t max_candidates );
+
+void ssa_ctx_get_prefilter_stats( p_ssa_context ctx, size_t * sequences, size_t * candidates );
+
+void ssa_ctx_init_score_matrix( p_ssa_context ctx, int mode, const char* matrix );
+
+void ssa_ctx_init_constant_scores( p_ssa_context ctx, const int8_t p, const int8_t m );
+
+void ssa_ctx_init_gap_penalties( p_ssa_context ctx, const int8_t gap_open, const int8_t gap_extend );
+
+void ssa_ctx_init_symbol_translation( p_ssa_context ctx, int type, int strands, int db_gencode, int q_gencode );
+
+/**
+ * Sets the database of a context. The array is not copied and has to stay
+ * valid, as long as the context is used. The IDs of the sequences have to be
+ * their index in the array.
+ *
+ * Contexts without their own database use the external database library.
+ *
+ * @param ctx       the context
+ * @param sequences array of the database sequences
+ * @param count     number of sequences
+ */
+void ssa_ctx_init_db( p_ssa_context ctx, p_seqinfo sequences, size_t count );
+
+void ssa_ctx_use_database( p_ssa_context ctx, p_ssa_database db );
+
+p_query ssa_ctx_init_sequence_fasta( p_ssa_context ctx, int mode, const char* fasta_seq_file );
+
+p_alignment_list ssa_ctx_sw_align( p_ssa_context ctx, p_query p, size_t hitcount, int bit_width, int align_type );
+
+p_alignment_list ssa_ctx_nw_align( p_ssa_context ctx, p_query p, size_t hitcount, int bit_width, int align_type );
+
+p_alignment_list ssa_ctx_ed_align( p_ssa_context ctx, p_query p, size_t hitcount, int mode );
+
+p_ssa_result_table ssa_ctx_sw_align_table( p_ssa_context ctx, p_query p, size_t hitcount, int bit_width,
+        int align_type );
+
+p_ssa_result_table ssa_ctx_nw_align_table( p_ssa_context ctx, p_query p, size_t hitcount, int bit_width,
+        int align_type );
+
+int ssa_ctx_sw_scores( p_ssa_context ctx, p_query p, int bit_width, int32_t * scores );
+
+int ssa_ctx_nw_scores( p_ssa_context ctx, p_query p, int bit_width, int32_t * scores );
+
+int ssa_ctx_sw_stream( p_ssa_context ctx, p_query p, int bit_width, long min_score, int delivery,
+        ssa_hit_callback callback, void * data );
+
+int ssa_ctx_nw_stream( p_ssa_context ctx, p_query p, int bit_width, long min_score, int delivery,
+        ssa_hit_callback callback, void * data );
+
+p_alignment_list * ssa_ctx_sw_align_batch( p_ssa_context ctx, p_query * queries, size_t query_count,
+        size_t hitcount, int bit_width, int align_type );
+
+p_alignment_list * ssa_ctx_nw_align_batch( p_ssa_context ctx, p_query * queries, size_t query_count,
+        size_t hitcount, int bit_width, int align_type );
+
+p_alignment_list * ssa_ctx_sw_align_batch_callback( p_ssa_context ctx, p_query * queries, size_t query_count,
+        size_t hitcount, int bit_width, int align_type, ssa_batch_callback callback, void * data );
+
+p_alignment_list * ssa_ctx_nw_align_batch_callback( p_ssa_context ctx, p_query * queries, size_t query_count,
+        size_t hitcount, int bit_width, int align_type, ssa_batch_callback callback, void * data );
+
+p_alignment_list ssa_ctx_sw_align_pairs( p_ssa_context ctx, p_align_pair pairs, size_t pair_count, int bit_width,
+        int align_type );
+
+p_alignment_list ssa_ctx_nw_align_pairs( p_ssa_context ctx, p_align_pair pairs, size_t pair_count, int bit_width,
+        int align_type );
+
+p_alignment_list ssa_ctx_sw_align_sharded( p_ssa_context ctx, p_query p, size_t hitcount, int bit_width,
+        int align_type, size_t shard_count );
+
+p_alignment_list ssa_ctx_nw_align_sharded( p_ssa_context ctx, p_query p, size_t hitcount, int bit_width,
+        int align_type, size_t shard_count );
+
+p_alignment_list ssa_ctx_sw_align_incremental( p_ssa_context ctx, p_query p, p_alignment_list previous,
+        size_t * db_end, size_t hitcount, int bit_width, int align_type );
+
+p_alignment_list ssa_ctx_nw_align_incremental( p_ssa_context ctx, p_query p, p_alignment_list previous,
+        size_t * db_end, size_t hitcount, int bit_width, int align_type );
+
+// #############################################################################
+// Asynchronous searches
+// #####################
+/**
+ * Starts a search with the Smith-Waterman Algorithm and returns immediately.
+ *
+ * The search runs in the context ctx, which must not be used otherwise until
+ * the search is finished. The query has to stay valid for the same time.
+ * If callback is set, it is called with callback_data, as soon as the
+ * results are ready or the search was cancelled.
+ *
+ * @return handle of the search, which has to be released with ssa_search_free
+ *
+ * @see ssa_search_poll
+ * @see ssa_search_wait
+ * @see ssa_search_cancel
+ */
+p_ssa_search ssa_ctx_sw_align_async( p_ssa_context ctx, p_query p, size_t hitcount, int bit_width,
+        int align_type, ssa_search_callback callback, void * callback_data );
+
+/**
+ * Starts a search with the Needleman-Wunsch Algorithm and returns immediately.
+ *
+ * @see ssa_ctx_sw_align_async
+ */
+p_ssa_search ssa_ctx_nw_align_async( p_ssa_context ctx, p_query p, size_t hitcount, int bit_width,
+        int align_type, ssa_search_callback callback, void * callback_data );
+
+/**
+ * Returns the state of a search: SSA_SEARCH_RUNNING, SSA_SEARCH_FINISHED or
+ * SSA_SEARCH_CANCELLED.
+ */
+int ssa_search_poll( p_ssa_search search );
+
+/**
+ * Waits until the search is finished or cancelled.
+ *
+ * @return the alignments, or 0 if the search was cancelled. The alignments
+ *         belong to the search and are released by ssa_search_free.
+ */
+p_alignment_list ssa_search_wait( p_ssa_search search );
+
+/**
+ * Cancels a running search. The threads stop at the next chunk of the
+ * database, or at the next alignment, and release their data. Does nothing,
+ * if the search is already finished.
+ */
+void ssa_search_cancel( p_ssa_search search );
+
+/**
+ * Waits for the search and releases it, including its alignments.
+ */
+void ssa_search_free( p_ssa_search search );
+
 #endif /* LIBSSA_H_ */
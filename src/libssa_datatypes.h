@@ -37,15 +37,6 @@ typedef struct {
     size_t len;
 } sequence_t;
 
-typedef struct {
-    p_minheap heap;
-    size_t chunk_count;
-    size_t seq_count;
-    size_t overflow_8_bit_count;
-    size_t overflow_16_bit_count;
-} search_result_t;
-typedef search_result_t * p_search_result;
-
 typedef struct {
     sequence_t seq;
     uint8_t strand;
@@ -60,10 +51,20 @@ typedef struct {
 } search_data_t;
 typedef search_data_t * p_search_data;
 
+/** @typedef    state of the alignment of the hits of a search
+ *
+ * @field order         indices of the pairs, by decreasing cost of their
+ *                      alignment. The threads align them in this order.
+ * @field alignments    the computed alignment of each pair, at the index of
+ *                      the pair
+ */
 typedef struct {
     elem_t * result_sequence_pairs;
     size_t pair_count;
 
+    size_t * order;
+    p_alignment * alignments;
+
     seq_buffer_t queries[6];
     size_t q_count;
 
@@ -84,13 +85,44 @@ typedef struct {
 } sdb_sequence_t;
 typedef sdb_sequence_t * p_sdb_sequence;
 
+/** @typedef    sequences searched together
+ *
+ * @field bound_result  if set, adp_next_chunk leaves out the sequences, that
+ *                      cannot score above the floor of this search result
+ */
 typedef struct {
     p_sdb_sequence * seq;
     size_t size;
     size_t fill_pointer;
+    struct search_result * bound_result;
 } db_chunk_t;
 typedef db_chunk_t * p_db_chunk;
 
+/** @typedef    result of the search of one thread
+ *
+ * @field heap          the best hits found so far
+ * @field add_hit       optional sink for the scores computed by the search
+ *                      algorithms. If not set, the scores are added to heap.
+ * @field hit_data      data used by add_hit
+ * @field shared_floor  if set, the highest heap minimum of all threads of the
+ *                      search. Hits at or below it are not added to heap.
+ *                      With a sink, the fixed score, which the hits passed
+ *                      to the sink have to exceed.
+ */
+typedef struct search_result {
+    p_minheap heap;
+    size_t chunk_count;
+    size_t seq_count;
+    size_t overflow_8_bit_count;
+    size_t overflow_16_bit_count;
+
+    void (*add_hit)( struct search_result * res, uint8_t query_id, p_sdb_sequence db_seq, long score );
+    void * hit_data;
+
+    long * shared_floor;
+} search_result_t;
+typedef search_result_t * p_search_result;
+
 /** @typedef    structure of the query profile
  *
  * @field nt    strands of the sequence
@@ -291,14 +291,30 @@ long SCORELIMIT_7;
 long SCORELIMIT_16;
 long SCORELIMIT_64;
 
-int8_t * score_matrix_8 = NULL; // char
-int16_t * score_matrix_16 = NULL; // short
-int64_t * score_matrix_64 = NULL; // long
+int is_constant_scoring() {
+    return ctx_current->constant_scoring;
+}
 
-static int constant_scoring = 0;
+int64_t mat_get_max_score() {
+    int64_t max_score = 0;
 
-int is_constant_scoring() {
-    return constant_scoring;
+    for( size_t i = 0; i < SCORE_MATRIX_DIM * SCORE_MATRIX_DIM; i++ ) {
+        if( score_matrix_64[i] > max_score ) {
+            max_score = score_matrix_64[i];
+        }
+    }
+    return max_score;
+}
+
+int mat_is_symmetric() {
+    for( int a = 0; a < SCORE_MATRIX_DIM; a++ ) {
+        for( int b = 0; b < a; b++ ) {
+            if( SCORE_MATRIX_64( a, b ) != SCORE_MATRIX_64( b, a ) ) {
+                return 0;
+            }
+        }
+    }
+    return 1;
 }
 
 #if 0
@@ -445,7 +461,7 @@ static void read_line( char line[LINE_MAX], int* symbols, char* order ) {
  * @param mismatchscore     score for mismatching symbols
  */
 void mat_init_constant_scoring( const int8_t matchscore, const int8_t mismatchscore ) {
-    constant_scoring = 1;
+    ctx_current->constant_scoring = 1;
 
     prepare_matrices();
 
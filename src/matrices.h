@@ -23,6 +23,8 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "context.h"
+
 #define SCORE_MATRIX_DIM 32
 
 #define SCORE_MATRIX_8(x, y) (score_matrix_8[(x << 5) + y])
@@ -39,12 +41,25 @@ extern const char mat_pam30[];
 extern const char mat_pam70[];
 extern const char mat_pam250[];
 
-extern int8_t* score_matrix_8;
-extern int16_t * score_matrix_16;
-extern int64_t * score_matrix_64;
+// the scoring matrices of the current context
+#define score_matrix_8 (ctx_current->matrix_8)
+#define score_matrix_16 (ctx_current->matrix_16)
+#define score_matrix_64 (ctx_current->matrix_64)
 
 int is_constant_scoring();
 
+/**
+ * Returns the highest score of the current scoring matrix, or 0, if all scores
+ * are negative.
+ */
+int64_t mat_get_max_score();
+
+/**
+ * Returns 1, if the current scoring matrix scores a pair of symbols the same
+ * in both orders, 0 otherwise.
+ */
+int mat_is_symmetric();
+
 /**
  * Prints the currently initialised scoring matrix to the specified output file.
  *
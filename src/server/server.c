@@ -0,0 +1,929 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+/*
+ * Implements the search server.
+ *
+ * Every connection is served by its own thread, which reads the requests,
+ * checks their queries and puts them into a queue. A single dispatching thread
+ * takes all waiting requests with matching parameters from the queue and
+ * searches their queries in one batch. The results of each query are handed
+ * back to the connection thread as soon as they are complete, which writes
+ * them while the batch is still running.
+ *
+ * Malformed queries are rejected before they reach the search, because the
+ * library ends the process on errors, which would stop the server for all
+ * clients.
+ */
+
+#define _POSIX_C_SOURCE 200809L // sockets, poll and nanosleep
+
+#include "server.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <string.h>
+#include <ctype.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "../context.h"
+#include "../util/util.h"
+#include "../util/util_sequence.h"
+
+// time after which blocking calls check, if the server was stopped
+#define POLL_TIMEOUT_MS 100
+
+/*
+ * A string that grows while text is appended.
+ */
+typedef struct {
+    char * data;
+    size_t len;
+    size_t alloc;
+} string_t;
+
+typedef struct request {
+    srv_params_t params;
+
+    char ** sequences;
+    size_t count;
+
+    p_query * queries;
+    // set by the dispatching thread for each query, as soon as it is complete
+    p_alignment_list * results;
+    int done;
+
+    struct request * next;
+} request_t;
+
+struct server {
+    char * socket_path;
+    int listen_fd;
+    p_ssa_context ctx;
+    size_t batch_delay_ms;
+
+    int running;
+
+    pthread_t accept_thread;
+    pthread_t dispatch_thread;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t queued;
+    pthread_cond_t done;
+    pthread_cond_t closed;
+
+    request_t * queue_head;
+    request_t * queue_tail;
+
+    size_t connection_count;
+    size_t batch_count;
+};
+
+typedef struct {
+    int fd;
+    p_server server;
+
+    char buffer[SRV_MAX_LINE_LENGTH];
+    size_t start;
+    size_t end;
+} reader_t;
+
+static void string_init( string_t * s ) {
+    s->alloc = SRV_MAX_LINE_LENGTH;
+    s->data = xmalloc( s->alloc );
+    s->data[0] = 0;
+    s->len = 0;
+}
+
+static void string_append( string_t * s, const char * format, ... ) {
+    va_list args;
+
+    va_start( args, format );
+    int len = vsnprintf( 0, 0, format, args );
+    va_end( args );
+
+    if( s->len + len + 1 > s->alloc ) {
+        s->alloc = 2 * (s->len + len + 1);
+        s->data = xrealloc( s->data, s->alloc );
+    }
+
+    va_start( args, format );
+    vsnprintf( s->data + s->len, len + 1, format, args );
+    va_end( args );
+
+    s->len += len;
+}
+
+static int is_running( p_server server ) {
+    return __atomic_load_n( &server->running, __ATOMIC_RELAXED );
+}
+
+static int send_all( int fd, const char * data, size_t len ) {
+    while( len ) {
+        ssize_t sent = send( fd, data, len, MSG_NOSIGNAL );
+        if( sent < 0 ) {
+            if( errno == EINTR ) {
+                continue;
+            }
+            return 0;
+        }
+        data += sent;
+        len -= sent;
+    }
+    return 1;
+}
+
+/*
+ * Fills the buffer of the reader. If the reader belongs to a server, the
+ * reading stops, when the server is stopped.
+ *
+ * Returns 0 at the end of the stream.
+ */
+static int fill_buffer( reader_t * r ) {
+    while( r->server ) {
+        struct pollfd pfd = { r->fd, POLLIN, 0 };
+
+        int ready = poll( &pfd, 1, POLL_TIMEOUT_MS );
+        if( ready > 0 ) {
+            break;
+        }
+        if( ((ready < 0) && (errno != EINTR)) || !is_running( r->server ) ) {
+            return 0;
+        }
+    }
+
+    ssize_t len;
+    do {
+        len = read( r->fd, r->buffer, SRV_MAX_LINE_LENGTH );
+    } while( (len < 0) && (errno == EINTR) );
+
+    if( len <= 0 ) {
+        return 0;
+    }
+
+    r->start = 0;
+    r->end = len;
+
+    return 1;
+}
+
+/*
+ * Reads the next line without the line break into line.
+ *
+ * Returns 0 at the end of the stream.
+ */
+static int read_line( reader_t * r, string_t * line ) {
+    line->len = 0;
+    line->data[0] = 0;
+
+    while( 1 ) {
+        if( (r->start == r->end) && !fill_buffer( r ) ) {
+            return line->len > 0;
+        }
+
+        char * begin = r->buffer + r->start;
+        char * newline = memchr( begin, '\n', r->end - r->start );
+        size_t len = newline ? (size_t) (newline - begin) : r->end - r->start;
+
+        string_append( line, "%.*s", (int) len, begin );
+        r->start += len;
+
+        if( newline ) {
+            r->start++;
+
+            if( line->len && (line->data[line->len - 1] == '\r') ) {
+                line->data[--line->len] = 0;
+            }
+            return 1;
+        }
+    }
+}
+
+int srv_parse_header( const char * line, srv_params_t * params ) {
+    char type[8];
+    char align[16];
+    long hit_count;
+    int bit_width;
+
+    if( sscanf( line, "SEARCH %7s %ld %d %15s", type, &hit_count, &bit_width, align ) != 4 ) {
+        return 0;
+    }
+
+    if( !strcmp( type, "SW" ) ) {
+        params->search_type = SMITH_WATERMAN;
+    }
+    else if( !strcmp( type, "NW" ) ) {
+        params->search_type = NEEDLEMAN_WUNSCH;
+    }
+    else {
+        return 0;
+    }
+
+    if( !strcmp( align, "SCORE" ) ) {
+        params->align_type = COMPUTE_SCORE;
+    }
+    else if( !strcmp( align, "ALIGNMENT" ) ) {
+        params->align_type = COMPUTE_ALIGNMENT;
+    }
+    else {
+        return 0;
+    }
+
+    if( (bit_width != BIT_WIDTH_8) && (bit_width != BIT_WIDTH_16) && (bit_width != BIT_WIDTH_64) ) {
+        return 0;
+    }
+    params->bit_width = bit_width;
+
+    if( hit_count <= 0 ) {
+        return 0;
+    }
+    params->hit_count = hit_count;
+
+    return 1;
+}
+
+void srv_format_header( srv_params_t params, char * line, size_t size ) {
+    snprintf( line, size, "SEARCH %s %ld %d %s", (params.search_type == SMITH_WATERMAN) ? "SW" : "NW",
+            params.hit_count, params.bit_width, (params.align_type == COMPUTE_SCORE) ? "SCORE" : "ALIGNMENT" );
+}
+
+static void free_request( request_t * req ) {
+    for( size_t i = 0; i < req->count; i++ ) {
+        free( req->sequences[i] );
+
+        if( req->results ) {
+            free_alignment( req->results[i] );
+        }
+        if( req->queries ) {
+            free_sequence( req->queries[i] );
+        }
+    }
+
+    free( req->sequences );
+    free( req->queries );
+    free( req->results );
+    free( req );
+}
+
+static void add_sequence( request_t * req, string_t * seq ) {
+    req->sequences = xrealloc( req->sequences, (req->count + 1) * sizeof(char *) );
+    req->sequences[req->count++] = seq->data;
+
+    string_init( seq );
+}
+
+/*
+ * Reads the queries of a request up to the END line.
+ *
+ * Returns 0, if the connection was closed before the end of the request.
+ */
+static int read_queries( reader_t * r, request_t * req ) {
+    string_t line;
+    string_t seq;
+
+    string_init( &line );
+    string_init( &seq );
+
+    int complete = 0;
+    while( read_line( r, &line ) ) {
+        if( !strcmp( line.data, "END" ) ) {
+            complete = 1;
+            break;
+        }
+
+        if( line.data[0] == '>' ) {
+            if( seq.len ) {
+                add_sequence( req, &seq );
+            }
+            continue;
+        }
+
+        for( size_t i = 0; i < line.len; i++ ) {
+            if( !isspace( (unsigned char) line.data[i] ) ) {
+                string_append( &seq, "%c", line.data[i] );
+            }
+        }
+    }
+
+    if( seq.len ) {
+        add_sequence( req, &seq );
+    }
+
+    free( line.data );
+    free( seq.data );
+
+    return complete;
+}
+
+/*
+ * Checks, that every query consists only of known symbols, and that a
+ * translated query contains at least one codon.
+ *
+ * Returns 0 and writes the reason into message, if a query is not valid.
+ */
+static int check_queries( p_server server, request_t * req, char * message, size_t size ) {
+    p_ssa_context prev = ctx_current;
+    if( server->ctx ) {
+        prev = ctx_enter( server->ctx );
+    }
+
+    const char * map = ((symtype == AMINOACID) || (symtype == TRANS_DB)) ? map_ncbi_aa : map_ncbi_nt16;
+    size_t min_len = ((symtype == TRANS_QUERY) || (symtype == TRANS_BOTH)) ? 3 : 1;
+
+    int valid = 1;
+    for( size_t i = 0; valid && (i < req->count); i++ ) {
+        const unsigned char * seq = (const unsigned char *) req->sequences[i];
+
+        size_t len = 0;
+        for( ; seq[len]; len++ ) {
+            if( (seq[len] >= 128) || (map[seq[len]] < 0) ) {
+                if( isprint( seq[len] ) ) {
+                    snprintf( message, size, "unknown symbol '%c' in query %ld", seq[len], i );
+                }
+                else {
+                    snprintf( message, size, "unknown symbol 0x%02x in query %ld", seq[len], i );
+                }
+                valid = 0;
+                break;
+            }
+        }
+
+        if( valid && (len < min_len) ) {
+            snprintf( message, size, "query %ld is too short", i );
+            valid = 0;
+        }
+    }
+
+    ctx_leave( prev );
+
+    return valid;
+}
+
+static int send_error( int fd, const char * message ) {
+    string_t s;
+    string_init( &s );
+
+    string_append( &s, "ERROR %s\n", message );
+    int result = send_all( fd, s.data, s.len );
+
+    free( s.data );
+
+    return result;
+}
+
+static int send_query_results( int fd, request_t * req, size_t i, p_alignment_list alist ) {
+    string_t s;
+    string_init( &s );
+
+    // coalesced requests are searched with the largest hit count
+    size_t len = alist->len;
+    if( len > req->params.hit_count ) {
+        len = req->params.hit_count;
+    }
+
+    string_append( &s, "QUERY %ld %ld\n", i, len );
+
+    for( size_t j = 0; j < len; j++ ) {
+        p_alignment a = alist->alignments[j];
+
+        string_append( &s, "%ld %ld %ld %ld %ld %ld", a->score, a->db_seq.ID, a->align_q_start, a->align_q_end,
+                a->align_d_start, a->align_d_end );
+        if( a->alignment ) {
+            string_append( &s, " %s", a->alignment );
+        }
+        string_append( &s, "\n" );
+    }
+
+    int result = send_all( fd, s.data, s.len );
+
+    free( s.data );
+
+    return result;
+}
+
+/*
+ * Sends the results of each query of the request, as soon as the query is
+ * searched, and waits until the whole batch of the request is finished.
+ *
+ * Returns 0, if the connection broke.
+ */
+static int send_results( p_server server, int fd, request_t * req ) {
+    int sent = 1;
+
+    for( size_t i = 0; i < req->count; i++ ) {
+        pthread_mutex_lock( &server->mutex );
+        while( !req->results[i] ) {
+            pthread_cond_wait( &server->done, &server->mutex );
+        }
+        p_alignment_list alist = req->results[i];
+        pthread_mutex_unlock( &server->mutex );
+
+        if( sent ) {
+            sent = send_query_results( fd, req, i, alist );
+        }
+    }
+
+    // the dispatching thread uses the request until the batch is finished
+    pthread_mutex_lock( &server->mutex );
+    while( !req->done ) {
+        pthread_cond_wait( &server->done, &server->mutex );
+    }
+    pthread_mutex_unlock( &server->mutex );
+
+    return sent && send_all( fd, "DONE\n", 5 );
+}
+
+/*
+ * Puts the request into the queue.
+ *
+ * Returns 0, if the server was stopped.
+ */
+static int enqueue( p_server server, request_t * req ) {
+    pthread_mutex_lock( &server->mutex );
+
+    if( !is_running( server ) ) {
+        pthread_mutex_unlock( &server->mutex );
+        return 0;
+    }
+
+    req->results = xmalloc( req->count * sizeof(p_alignment_list) );
+    for( size_t i = 0; i < req->count; i++ ) {
+        req->results[i] = 0;
+    }
+
+    if( server->queue_tail ) {
+        server->queue_tail->next = req;
+    }
+    else {
+        server->queue_head = req;
+    }
+    server->queue_tail = req;
+
+    pthread_cond_signal( &server->queued );
+
+    pthread_mutex_unlock( &server->mutex );
+
+    return 1;
+}
+
+typedef struct {
+    p_server server;
+    int fd;
+} connection_t;
+
+static void * serve_connection( void * data ) {
+    connection_t * conn = data;
+    p_server server = conn->server;
+
+    reader_t r;
+    r.fd = conn->fd;
+    r.server = server;
+    r.start = r.end = 0;
+
+    string_t line;
+    string_init( &line );
+
+    while( read_line( &r, &line ) ) {
+        if( !line.len ) {
+            continue;
+        }
+
+        request_t * req = xmalloc( sizeof(request_t) );
+        req->sequences = 0;
+        req->count = 0;
+        req->queries = 0;
+        req->results = 0;
+        req->done = 0;
+        req->next = 0;
+
+        int valid = srv_parse_header( line.data, &req->params );
+
+        if( !read_queries( &r, req ) ) {
+            free_request( req );
+            break;
+        }
+
+        char message[SRV_MAX_LINE_LENGTH];
+
+        int sent;
+        if( !valid ) {
+            sent = send_error( conn->fd, "invalid request header" );
+        }
+        else if( !req->count ) {
+            sent = send_error( conn->fd, "no query sequence" );
+        }
+        else if( !check_queries( server, req, message, sizeof(message) ) ) {
+            sent = send_error( conn->fd, message );
+        }
+        else if( !enqueue( server, req ) ) {
+            sent = send_error( conn->fd, "server stopped" );
+        }
+        else {
+            sent = send_results( server, conn->fd, req );
+        }
+
+        free_request( req );
+
+        if( !sent ) {
+            break;
+        }
+    }
+
+    free( line.data );
+    close( conn->fd );
+    free( conn );
+
+    pthread_mutex_lock( &server->mutex );
+    server->connection_count--;
+    pthread_cond_broadcast( &server->closed );
+    pthread_mutex_unlock( &server->mutex );
+
+    return NULL;
+}
+
+static void * accept_connections( void * data ) {
+    p_server server = data;
+
+    while( is_running( server ) ) {
+        struct pollfd pfd = { server->listen_fd, POLLIN, 0 };
+
+        if( poll( &pfd, 1, POLL_TIMEOUT_MS ) <= 0 ) {
+            continue;
+        }
+
+        int fd = accept( server->listen_fd, NULL, NULL );
+        if( fd < 0 ) {
+            continue;
+        }
+
+        connection_t * conn = xmalloc( sizeof(connection_t) );
+        conn->server = server;
+        conn->fd = fd;
+
+        pthread_mutex_lock( &server->mutex );
+        server->connection_count++;
+        pthread_mutex_unlock( &server->mutex );
+
+        pthread_t thread;
+        if( pthread_create( &thread, NULL, serve_connection, conn ) ) {
+            print_warning( "Could not start the thread of a connection." );
+
+            close( fd );
+            free( conn );
+
+            pthread_mutex_lock( &server->mutex );
+            server->connection_count--;
+            pthread_mutex_unlock( &server->mutex );
+            continue;
+        }
+        pthread_detach( thread );
+    }
+
+    return NULL;
+}
+
+static int same_batch( srv_params_t a, srv_params_t b ) {
+    return (a.search_type == b.search_type) && (a.bit_width == b.bit_width) && (a.align_type == b.align_type);
+}
+
+/*
+ * Removes the first request and all other requests, that can be searched in
+ * the same batch, from the queue.
+ */
+static request_t * take_batch( p_server server ) {
+    request_t * batch = server->queue_head;
+    request_t * batch_tail = batch;
+
+    request_t * rest = 0;
+    request_t * rest_tail = 0;
+
+    for( request_t * req = batch->next; req; req = req->next ) {
+        if( same_batch( batch->params, req->params ) ) {
+            batch_tail->next = req;
+            batch_tail = req;
+        }
+        else {
+            if( rest_tail ) {
+                rest_tail->next = req;
+            }
+            else {
+                rest = req;
+            }
+            rest_tail = req;
+        }
+    }
+
+    batch_tail->next = 0;
+    if( rest_tail ) {
+        rest_tail->next = 0;
+    }
+
+    server->queue_head = rest;
+    server->queue_tail = rest_tail;
+
+    return batch;
+}
+
+typedef struct {
+    p_server server;
+
+    // request and index in the request of each query of the batch
+    request_t ** requests;
+    size_t * indices;
+} batch_owner_t;
+
+/*
+ * Hands the results of a query to the thread of its connection.
+ */
+static void query_finished( size_t query_index, p_alignment_list alist, void * data ) {
+    batch_owner_t * owner = data;
+
+    pthread_mutex_lock( &owner->server->mutex );
+    owner->requests[query_index]->results[owner->indices[query_index]] = alist;
+    pthread_cond_broadcast( &owner->server->done );
+    pthread_mutex_unlock( &owner->server->mutex );
+}
+
+static void search_batch( p_server server, request_t * batch ) {
+    size_t query_count = 0;
+    size_t hit_count = 0;
+
+    for( request_t * req = batch; req; req = req->next ) {
+        query_count += req->count;
+
+        if( req->params.hit_count > hit_count ) {
+            hit_count = req->params.hit_count;
+        }
+    }
+
+    p_query * queries = xmalloc( query_count * sizeof(p_query) );
+
+    batch_owner_t owner;
+    owner.server = server;
+    owner.requests = xmalloc( query_count * sizeof(request_t *) );
+    owner.indices = xmalloc( query_count * sizeof(size_t) );
+
+    size_t q = 0;
+    for( request_t * req = batch; req; req = req->next ) {
+        req->queries = xmalloc( req->count * sizeof(p_query) );
+
+        for( size_t i = 0; i < req->count; i++ ) {
+            req->queries[i] = init_sequence_fasta( READ_FROM_STRING, req->sequences[i] );
+
+            queries[q] = req->queries[i];
+            owner.requests[q] = req;
+            owner.indices[q] = i;
+            q++;
+        }
+    }
+
+    p_alignment_list * results;
+    if( batch->params.search_type == SMITH_WATERMAN ) {
+        results = sw_align_batch_callback( queries, query_count, hit_count, batch->params.bit_width,
+                batch->params.align_type, &query_finished, &owner );
+    }
+    else {
+        results = nw_align_batch_callback( queries, query_count, hit_count, batch->params.bit_width,
+                batch->params.align_type, &query_finished, &owner );
+    }
+
+    // the lists are owned by the requests
+    free( results );
+    free( queries );
+    free( owner.requests );
+    free( owner.indices );
+}
+
+static void * dispatch_requests( void * data ) {
+    p_server server = data;
+
+    p_ssa_context prev = ctx_current;
+    if( server->ctx ) {
+        prev = ctx_enter( server->ctx );
+    }
+
+    pthread_mutex_lock( &server->mutex );
+
+    while( 1 ) {
+        while( is_running( server ) && !server->queue_head ) {
+            pthread_cond_wait( &server->queued, &server->mutex );
+        }
+
+        if( !server->queue_head ) {
+            break;
+        }
+
+        if( server->batch_delay_ms && is_running( server ) ) {
+            // give concurrent requests the chance to join the batch
+            pthread_mutex_unlock( &server->mutex );
+
+            struct timespec delay = { server->batch_delay_ms / 1000, (server->batch_delay_ms % 1000) * 1000000 };
+            nanosleep( &delay, NULL );
+
+            pthread_mutex_lock( &server->mutex );
+        }
+
+        request_t * batch = take_batch( server );
+
+        pthread_mutex_unlock( &server->mutex );
+
+        search_batch( server, batch );
+
+        pthread_mutex_lock( &server->mutex );
+
+        server->batch_count++;
+
+        while( batch ) {
+            request_t * next = batch->next;
+            batch->next = 0;
+            batch->done = 1;
+            batch = next;
+        }
+        pthread_cond_broadcast( &server->done );
+    }
+
+    pthread_mutex_unlock( &server->mutex );
+
+    ctx_leave( prev );
+
+    return NULL;
+}
+
+p_server srv_start( const char * socket_path, p_ssa_context ctx, size_t batch_delay_ms ) {
+    struct sockaddr_un addr;
+    memset( &addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+
+    if( strlen( socket_path ) >= sizeof(addr.sun_path) ) {
+        print_error( "Socket path too long: %s", socket_path );
+        return 0;
+    }
+    strcpy( addr.sun_path, socket_path );
+
+    int fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if( fd < 0 ) {
+        print_error( "Could not create the socket: %s", strerror( errno ) );
+        return 0;
+    }
+
+    // remove the socket of a previous run
+    unlink( socket_path );
+
+    if( bind( fd, (struct sockaddr *) &addr, sizeof(addr) ) || listen( fd, SOMAXCONN ) ) {
+        print_error( "Could not listen on %s: %s", socket_path, strerror( errno ) );
+        close( fd );
+        return 0;
+    }
+
+    p_server server = xmalloc( sizeof(struct server) );
+
+    server->socket_path = xmalloc( strlen( socket_path ) + 1 );
+    strcpy( server->socket_path, socket_path );
+    server->listen_fd = fd;
+    server->ctx = ctx;
+    server->batch_delay_ms = batch_delay_ms;
+    server->running = 1;
+    server->queue_head = 0;
+    server->queue_tail = 0;
+    server->connection_count = 0;
+    server->batch_count = 0;
+
+    pthread_mutex_init( &server->mutex, NULL );
+    pthread_cond_init( &server->queued, NULL );
+    pthread_cond_init( &server->done, NULL );
+    pthread_cond_init( &server->closed, NULL );
+
+    if( pthread_create( &server->dispatch_thread, NULL, dispatch_requests, server )
+            || pthread_create( &server->accept_thread, NULL, accept_connections, server ) ) {
+        fatal( "Could not start the threads of the server." );
+    }
+
+    return server;
+}
+
+void srv_stop( p_server server ) {
+    if( !server ) {
+        return;
+    }
+
+    pthread_mutex_lock( &server->mutex );
+    __atomic_store_n( &server->running, 0, __ATOMIC_RELAXED );
+    pthread_cond_broadcast( &server->queued );
+    pthread_mutex_unlock( &server->mutex );
+
+    pthread_join( server->accept_thread, NULL );
+    pthread_join( server->dispatch_thread, NULL );
+
+    pthread_mutex_lock( &server->mutex );
+    while( server->connection_count ) {
+        pthread_cond_wait( &server->closed, &server->mutex );
+    }
+    pthread_mutex_unlock( &server->mutex );
+
+    close( server->listen_fd );
+    unlink( server->socket_path );
+
+    pthread_mutex_destroy( &server->mutex );
+    pthread_cond_destroy( &server->queued );
+    pthread_cond_destroy( &server->done );
+    pthread_cond_destroy( &server->closed );
+
+    free( server->socket_path );
+    free( server );
+}
+
+size_t srv_get_batch_count( p_server server ) {
+    pthread_mutex_lock( &server->mutex );
+    size_t count = server->batch_count;
+    pthread_mutex_unlock( &server->mutex );
+
+    return count;
+}
+
+int srv_connect( const char * socket_path ) {
+    struct sockaddr_un addr;
+    memset( &addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+
+    if( strlen( socket_path ) >= sizeof(addr.sun_path) ) {
+        return -1;
+    }
+    strcpy( addr.sun_path, socket_path );
+
+    int fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+    if( fd < 0 ) {
+        return -1;
+    }
+
+    if( connect( fd, (struct sockaddr *) &addr, sizeof(addr) ) ) {
+        close( fd );
+        return -1;
+    }
+
+    return fd;
+}
+
+char * srv_request( int fd, srv_params_t params, const char * fasta ) {
+    char header[SRV_MAX_LINE_LENGTH];
+    srv_format_header( params, header, SRV_MAX_LINE_LENGTH );
+
+    size_t fasta_len = strlen( fasta );
+    int needs_newline = fasta_len && (fasta[fasta_len - 1] != '\n');
+
+    if( !send_all( fd, header, strlen( header ) ) || !send_all( fd, "\n", 1 ) || !send_all( fd, fasta, fasta_len )
+            || (needs_newline && !send_all( fd, "\n", 1 )) || !send_all( fd, "END\n", 4 ) ) {
+        return 0;
+    }
+
+    reader_t r;
+    r.fd = fd;
+    r.server = 0;
+    r.start = r.end = 0;
+
+    string_t line;
+    string_t response;
+    string_init( &line );
+    string_init( &response );
+
+    int complete = 0;
+    while( read_line( &r, &line ) ) {
+        string_append( &response, "%s\n", line.data );
+
+        if( !strcmp( line.data, "DONE" ) || !strncmp( line.data, "ERROR", 5 ) ) {
+            complete = 1;
+            break;
+        }
+    }
+
+    free( line.data );
+
+    if( !complete ) {
+        free( response.data );
+        return 0;
+    }
+
+    return response.data;
+}
@@ -0,0 +1,119 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+/*
+ * Search server, that keeps the database resident and answers requests on a
+ * Unix domain socket.
+ *
+ * A request consists of a header line, the queries in FASTA format and a
+ * terminating line:
+ *
+ *   SEARCH <SW|NW> <hit count> <8|16|64> <SCORE|ALIGNMENT>
+ *   >query 1
+ *   ACGT...
+ *   END
+ *
+ * The response holds the hits of each query, followed by a terminating line:
+ *
+ *   QUERY <query index> <number of hits>
+ *   <score> <DB-ID> <query start> <query end> <DB start> <DB end> [<alignment>]
+ *   DONE
+ *
+ * or a single line "ERROR <message>", for example if a query contains an
+ * unknown symbol. The hits of each query are sent as soon as its search is
+ * complete. A connection can send several requests one after the other.
+ *
+ * Requests with the same search type, bit width and alignment type, that are
+ * waiting at the same time, are searched together in one batch search.
+ */
+
+#ifndef SERVER_H_
+#define SERVER_H_
+
+#include <stddef.h>
+
+#include "../libssa.h"
+
+#define SRV_MAX_LINE_LENGTH 1024
+
+struct server;
+typedef struct server * p_server;
+
+/** @typedef    parameters of a request
+ *
+ * @field search_type   SMITH_WATERMAN or NEEDLEMAN_WUNSCH
+ * @field align_type    COMPUTE_SCORE or COMPUTE_ALIGNMENT
+ */
+typedef struct {
+    int search_type;
+    size_t hit_count;
+    int bit_width;
+    int align_type;
+} srv_params_t;
+
+/**
+ * Parses the header line of a request.
+ *
+ * @return 1 on success, 0 if the line is not a valid header
+ */
+int srv_parse_header( const char * line, srv_params_t * params );
+
+/**
+ * Creates the header line of a request, without the line break.
+ */
+void srv_format_header( srv_params_t params, char * line, size_t size );
+
+/**
+ * Starts the server on the socket at socket_path. The searches run in ctx, or
+ * in the default context, if ctx is 0. The database of the context has to be
+ * initialised and must not change while the server runs.
+ *
+ * @param batch_delay_ms    time to wait for more requests, before a batch is
+ *                          searched
+ * @return the server, or 0 if the socket could not be opened
+ */
+p_server srv_start( const char * socket_path, p_ssa_context ctx, size_t batch_delay_ms );
+
+/**
+ * Stops the server, closes all connections and removes the socket file.
+ */
+void srv_stop( p_server server );
+
+/**
+ * Returns the number of batch searches done by the server.
+ */
+size_t srv_get_batch_count( p_server server );
+
+/**
+ * Connects to the server at socket_path.
+ *
+ * @return the file descriptor of the connection, or -1 on error
+ */
+int srv_connect( const char * socket_path );
+
+/**
+ * Sends a request over the connection fd and reads the response.
+ *
+ * @param fasta     the queries in FASTA format
+ * @return the complete response, which has to be freed by the caller, or 0 if
+ *         the connection broke
+ */
+char * srv_request( int fd, srv_params_t params, const char * fasta );
+
+#endif /* SERVER_H_ */
@@ -0,0 +1,151 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+/*
+ * Sends the queries of a FASTA file to a running ssa_server and prints the
+ * response.
+ *
+ * Run it with:
+ * ./ssa_client -S /tmp/ssa.sock -i tests/testdata/O74807.fasta -t SW -c 10 -b 16
+ */
+
+#include "../libssa.h"
+#include "../util/util.h"
+#include "server.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <string.h>
+#include <unistd.h>
+
+static void print_help() {
+    printf("Usage: ./ssa_client [options]\n");
+    printf("Commandline options:\n");
+
+    printf("  -S             Path of the Unix domain socket of the server\n");
+    printf("  -i             Query file (FASTA format), - for stdin\n");
+    printf("  -c             Number of returned hits\n");
+    printf("  -t             SW oder NW for local or global alignment\n");
+    printf("  -b             Bit-width for the main search (8, 16 or 64)\n");
+    printf("  -a             Compute the alignments, not only the scores\n");
+    printf("\n");
+
+    exit(EXIT_FAILURE);
+}
+
+static char * read_file( const char * filename ) {
+    FILE * fp = strcmp( filename, "-" ) ? fopen( filename, "r" ) : stdin;
+    if( !fp ) {
+        fprintf( stderr, "Could not open %s\n", filename );
+        exit( EXIT_FAILURE );
+    }
+
+    size_t len = 0;
+    size_t alloc = SRV_MAX_LINE_LENGTH;
+    char * data = xmalloc( alloc );
+
+    size_t read;
+    while( (read = fread( data + len, 1, alloc - len - 1, fp )) > 0 ) {
+        len += read;
+        if( len + 1 == alloc ) {
+            alloc *= 2;
+            data = xrealloc( data, alloc );
+        }
+    }
+    data[len] = 0;
+
+    if( fp != stdin ) {
+        fclose( fp );
+    }
+
+    return data;
+}
+
+int main( int argc, char**argv ) {
+    srv_params_t params = { SMITH_WATERMAN, 10, BIT_WIDTH_16, COMPUTE_SCORE };
+    char * socket_path = 0;
+    char * fasta = 0;
+    int c;
+
+    if( argc == 1 ) {
+        print_help();
+    }
+
+    while( (c = getopt( argc, argv, "S:i:c:t:b:a" )) != -1 ) {
+        switch( c ) {
+        case 'S':
+            socket_path = optarg;
+            break;
+        case 'i':
+            fasta = read_file( optarg );
+            break;
+        case 'c':
+            params.hit_count = atoi( optarg );
+            break;
+        case 't':
+            if( strcmp( optarg, "SW" ) == 0 ) {
+                params.search_type = SMITH_WATERMAN;
+            }
+            else if( strcmp( optarg, "NW" ) == 0 ) {
+                params.search_type = NEEDLEMAN_WUNSCH;
+            }
+            else {
+                print_help();
+            }
+            break;
+        case 'b':
+            params.bit_width = atoi( optarg );
+            break;
+        case 'a':
+            params.align_type = COMPUTE_ALIGNMENT;
+            break;
+        default:
+            print_help();
+            break;
+        }
+    }
+
+    if( !socket_path || !fasta ) {
+        fprintf( stderr, "A socket path and a query file are required, try --help.\n" );
+        exit( EXIT_FAILURE );
+    }
+
+    int fd = srv_connect( socket_path );
+    if( fd < 0 ) {
+        fprintf( stderr, "Could not connect to %s\n", socket_path );
+        exit( EXIT_FAILURE );
+    }
+
+    char * response = srv_request( fd, params, fasta );
+    close( fd );
+    free( fasta );
+
+    if( !response ) {
+        fprintf( stderr, "The connection to the server broke.\n" );
+        exit( EXIT_FAILURE );
+    }
+
+    printf( "%s", response );
+
+    int failed = !strncmp( response, "ERROR", 5 );
+    free( response );
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,161 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+/*
+ * Search server, that loads the database once and answers search requests on
+ * a Unix domain socket until it receives SIGINT or SIGTERM.
+ *
+ * On SIGHUP the database file is read again in the background. Running
+ * searches finish with the old version, new searches use the new one.
+ *
+ * Run it with:
+ * ./ssa_server -N 4 -O 3 -E 1 -M BLOSUM62 -d tests/testdata/uniprot_sprot.fasta -S /tmp/ssa.sock
+ */
+
+#define _POSIX_C_SOURCE 200809L // sigwait
+
+#include "../libssa.h"
+#include "server.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+
+static void print_help() {
+    printf("Usage: ./ssa_server [options]\n");
+    printf("Commandline options:\n");
+
+    printf("  -N             Number of used threads\n");
+    printf("  -O             Gap open costs (unsigned)\n");
+    printf("  -E             Gap extension costs (unsigned)\n");
+    printf("  -M             Scoring matrix name (BLOSUM(45|50|62|80|90)|PAM(30|70|250))\n");
+    printf("  -m             Match and mismatch scores of nucleotides, e.g. 5,-4 (instead of -M)\n");
+    printf("  -d             Database file (FASTA format)\n");
+    printf("  -S             Path of the Unix domain socket\n");
+    printf("  -w             Milliseconds to wait for more requests before a batch is searched (default 2)\n");
+    printf("\n");
+
+    exit(EXIT_FAILURE);
+}
+
+int main( int argc, char**argv ) {
+    uint8_t gapO = 0, gapE = 0;
+    char * socket_path = 0;
+    char * db_file = 0;
+    size_t batch_delay_ms = 2;
+    int nucleotides = 0;
+    int c;
+
+    if( argc == 1 ) {
+        print_help();
+    }
+
+    set_output_mode( OUTPUT_WARNING );
+
+    while( (c = getopt( argc, argv, "N:O:E:M:m:d:S:w:" )) != -1 ) {
+        switch( c ) {
+        case 'N':
+            set_thread_count( atoi( optarg ) );
+            break;
+        case 'O':
+            gapO = atoi( optarg );
+            break;
+        case 'E':
+            gapE = atoi( optarg );
+            break;
+        case 'M':
+            init_score_matrix( MATRIX_BUILDIN, optarg );
+            break;
+        case 'm': {
+            int match, mismatch;
+            if( sscanf( optarg, "%d,%d", &match, &mismatch ) != 2 ) {
+                print_help();
+            }
+            init_constant_scores( match, mismatch );
+            nucleotides = 1;
+            break;
+        }
+        case 'd':
+            db_file = optarg;
+            break;
+        case 'S':
+            socket_path = optarg;
+            break;
+        case 'w':
+            batch_delay_ms = atoi( optarg );
+            break;
+        default:
+            print_help();
+            break;
+        }
+    }
+
+    if( !socket_path || !db_file ) {
+        fprintf( stderr, "A database and a socket path are required, try --help.\n" );
+        exit( EXIT_FAILURE );
+    }
+
+    init_symbol_translation( nucleotides ? NUCLEOTIDE : AMINOACID, FORWARD_STRAND, 3, 3 );
+    init_gap_penalties( -gapO, -gapE );
+
+    // the database stays in memory for all requests
+    p_ssa_database db = ssa_database_create();
+    if( !ssa_database_load( db, db_file ) ) {
+        exit( EXIT_FAILURE );
+    }
+    use_database( db );
+
+    // the threads of the server inherit the blocked signals
+    sigset_t signals;
+    sigemptyset( &signals );
+    sigaddset( &signals, SIGINT );
+    sigaddset( &signals, SIGTERM );
+    sigaddset( &signals, SIGHUP );
+    pthread_sigmask( SIG_BLOCK, &signals, NULL );
+
+    p_server server = srv_start( socket_path, 0, batch_delay_ms );
+    if( !server ) {
+        exit( EXIT_FAILURE );
+    }
+
+    printf( "Listening on %s\n", socket_path );
+    fflush( stdout );
+
+    int sig;
+    while( !sigwait( &signals, &sig ) && (sig == SIGHUP) ) {
+        printf( "Reloading %s\n", db_file );
+        fflush( stdout );
+
+        ssa_database_load_async( db, db_file );
+    }
+
+    printf( "Stopping after %ld batches\n", srv_get_batch_count( server ) );
+
+    srv_stop( server );
+
+    use_database( 0 );
+    ssa_database_free( db );
+
+    ssa_exit();
+
+    return 0;
+}
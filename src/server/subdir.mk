@@ -0,0 +1,9 @@
+OBJS += \
+./src/server/server.o
+
+USER_OBJS += \
+./src/server/server.h
+
+TO_CLEAN += \
+./src/server/ssa_server.o \
+./src/server/ssa_client.o
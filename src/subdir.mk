@@ -3,6 +3,10 @@ OBJS += \
 ./src/query.o \
 ./src/libssa.o \
 ./src/db_adapter.o \
+./src/context.o \
+./src/db_snapshot.o \
+./src/db_dedup.o \
+./src/kmer_index.o \
 ./src/cpu_config.o
 
 USER_OBJS += \
@@ -13,6 +17,10 @@ USER_OBJS += \
 ./src/matrices.h \
 ./src/query.h \
 ./src/db_adapter.h \
+./src/context.h \
+./src/db_snapshot.h \
+./src/db_dedup.h \
+./src/kmer_index.h \
 ./src/cpu_config.h
 
 TO_CLEAN +=
\ No newline at end of file
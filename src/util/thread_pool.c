@@ -17,6 +17,18 @@
  Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
  */
 
+/*
+ * Implements a pool of worker threads, that is shared by all contexts.
+ *
+ * The workers are created once and wait for tasks. start_threads adds one task
+ * for each thread to the queue. The tasks form a group, that is kept in the
+ * context of the calling thread, and wait_for_threads waits until all tasks of
+ * this group are finished. Several contexts can therefore run their searches
+ * at the same time on the same workers.
+ *
+ * A task runs with the context of the thread, that started it.
+ */
+
 #include "thread_pool.h"
 
 #include <stdlib.h>
@@ -25,62 +37,233 @@
 #include <sys/sysinfo.h>
 
 #include "../libssa.h"
+#include "../context.h"
 #include "util.h"
 
-size_t max_thread_count = -1;
+typedef struct thread_task {
+    void *(*start_routine)( void * );
+    void * arg;
+    p_ssa_context ctx;
+
+    struct thread_group * group;
+    size_t idx;
+
+    struct thread_task * next;
+} thread_task_t;
+
+struct thread_group {
+    size_t count;
+    size_t pending;
+    void ** results;
+
+    pthread_cond_t finished;
+};
+
+size_t max_thread_count = THREAD_COUNT_UNSET;
 
 static pthread_t * thread_list = 0;
+static size_t worker_count = 0;
 static size_t current_thread_count = 0;
 
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t task_added = PTHREAD_COND_INITIALIZER;
+
+static thread_task_t * queue_head = 0;
+static thread_task_t * queue_tail = 0;
+static int stopping = 0;
+
 size_t get_current_thread_count() {
-    return current_thread_count;
+    struct thread_group * group = ctx_current->search.threads;
+    if( group ) {
+        return group->count;
+    }
+    return ctx_current->thread_count;
+}
+
+size_t get_max_thread_count() {
+    if( max_thread_count == THREAD_COUNT_UNSET ) {
+        max_thread_count = get_nprocs(); //sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    return max_thread_count;
 }
 
-static size_t get_new_thread_count() {
-    if( !current_thread_count || (current_thread_count != max_thread_count) ) {
-        if( max_thread_count == -1 ) {
-            max_thread_count = get_nprocs(); //sysconf(_SC_NPROCESSORS_ONLN);
+static void * worker( void * unused ) {
+    pthread_mutex_lock( &pool_mutex );
+
+    while( 1 ) {
+        while( !queue_head && !stopping ) {
+            pthread_cond_wait( &task_added, &pool_mutex );
+        }
+
+        if( !queue_head ) {
+            // stopping and no tasks left
+            break;
+        }
+
+        thread_task_t * task = queue_head;
+        queue_head = task->next;
+        if( !queue_head ) {
+            queue_tail = 0;
+        }
+
+        pthread_mutex_unlock( &pool_mutex );
+
+        p_ssa_context prev = ctx_enter( task->ctx );
+        void * result = task->start_routine( task->arg );
+        ctx_leave( prev );
+
+        pthread_mutex_lock( &pool_mutex );
+
+        struct thread_group * group = task->group;
+        group->results[task->idx] = result;
+        if( !--group->pending ) {
+            pthread_cond_broadcast( &group->finished );
         }
 
-        current_thread_count = max_thread_count;
+        free( task );
     }
-    return current_thread_count;
+
+    pthread_mutex_unlock( &pool_mutex );
+
+    return NULL;
 }
 
 void init_thread_pool() {
-    if( thread_list ) {
-        if( get_current_thread_count() == max_thread_count ) {
-            return;
-        }
-        exit_thread_pool();
+    pthread_mutex_lock( &pool_mutex );
+
+    size_t thread_count = get_max_thread_count();
+
+    if( (thread_count != current_thread_count) || !worker_count ) {
+        print_info( "Using %ld threads\n", thread_count );
     }
+    current_thread_count = thread_count;
 
-    size_t thread_count = get_new_thread_count();
+    // the searches of this context keep their thread count, even if another context changes it
+    ctx_current->thread_count = thread_count;
 
-    print_info( "Using %ld threads\n", thread_count );
+    // workers are only added, because other contexts might still use them
+    if( thread_count > worker_count ) {
+        thread_list = xrealloc( thread_list, thread_count * sizeof(pthread_t) );
+
+        for( size_t i = worker_count; i < thread_count; i++ ) {
+            pthread_create( &thread_list[i], NULL, worker, NULL );
+        }
+        worker_count = thread_count;
+    }
 
-    thread_list = xmalloc( thread_count * sizeof(pthread_t) );
+    pthread_mutex_unlock( &pool_mutex );
 }
 
 void exit_thread_pool() {
-    if( thread_list ) {
-//        for (int i = 0; i < _max_thread_count; i++) {
-//            pthread_cancel(thread_list[i]); TODO implement termination of unfinished threads
-//        }
+    pthread_mutex_lock( &pool_mutex );
+    stopping = 1;
+    pthread_cond_broadcast( &task_added );
+    pthread_mutex_unlock( &pool_mutex );
+
+    for( size_t i = 0; i < worker_count; i++ ) {
+        pthread_join( thread_list[i], NULL );
+    }
 
+    pthread_mutex_lock( &pool_mutex );
+    if( thread_list ) {
         free( thread_list );
         thread_list = 0;
     }
+    worker_count = 0;
+    stopping = 0;
+    pthread_mutex_unlock( &pool_mutex );
+}
+
+void reset_thread_pool() {
+    // a thread of the parent might have held the mutex during the fork
+    pthread_mutex_init( &pool_mutex, NULL );
+    pthread_cond_init( &task_added, NULL );
+
+    thread_list = 0;
+    worker_count = 0;
+    current_thread_count = 0;
+    queue_head = 0;
+    queue_tail = 0;
+    stopping = 0;
 }
 
 void start_threads( void *(*start_routine)( void * ), void * arg ) {
-    for( size_t i = 0; i < get_current_thread_count(); i++ ) {
-        pthread_create( &thread_list[i], NULL, start_routine, arg );
+    if( ctx_current->search.threads ) {
+        fatal( "Threads of the current context are already running." );
+    }
+
+    if( !worker_count || !ctx_current->thread_count ) {
+        init_thread_pool();
+    }
+
+    struct thread_group * group = xmalloc( sizeof(struct thread_group) );
+    group->count = ctx_current->thread_count;
+    group->pending = group->count;
+    group->results = xmalloc( group->count * sizeof(void *) );
+    pthread_cond_init( &group->finished, NULL );
+
+    ctx_current->search.threads = group;
+
+    pthread_mutex_lock( &pool_mutex );
+
+    for( size_t i = 0; i < group->count; i++ ) {
+        thread_task_t * task = xmalloc( sizeof(thread_task_t) );
+        task->start_routine = start_routine;
+        task->arg = arg;
+        task->ctx = ctx_current;
+        task->group = group;
+        task->idx = i;
+        task->next = 0;
+
+        if( queue_tail ) {
+            queue_tail->next = task;
+        }
+        else {
+            queue_head = task;
+        }
+        queue_tail = task;
+    }
+
+    pthread_cond_broadcast( &task_added );
+    pthread_mutex_unlock( &pool_mutex );
+}
+
+size_t wait_for_threads( void ** thread_results ) {
+    struct thread_group * group = ctx_current->search.threads;
+    if( !group ) {
+        return 0;
+    }
+
+    pthread_mutex_lock( &pool_mutex );
+    while( group->pending ) {
+        pthread_cond_wait( &group->finished, &pool_mutex );
     }
+    pthread_mutex_unlock( &pool_mutex );
+
+    for( size_t i = 0; i < group->count; i++ ) {
+        thread_results[i] = group->results[i];
+    }
+
+    ctx_current->search.threads = 0;
+
+    size_t count = group->count;
+
+    pthread_cond_destroy( &group->finished );
+    free( group->results );
+    free( group );
+
+    return count;
 }
 
-void wait_for_threads( void ** thread_results ) {
-    for( size_t i = 0; i < max_thread_count; i++ ) {
-        pthread_join( thread_list[i], &thread_results[i] );
+size_t count_running_threads() {
+    struct thread_group * group = ctx_current->search.threads;
+    if( !group ) {
+        return 0;
     }
+
+    pthread_mutex_lock( &pool_mutex );
+    size_t pending = group->pending;
+    pthread_mutex_unlock( &pool_mutex );
+
+    return pending;
 }
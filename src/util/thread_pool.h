@@ -21,17 +21,53 @@
 #define THREAD_POOL_H_
 
 #include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Value of max_thread_count, if no thread count was set. The searches then
+ * start one thread per processor.
+ */
+#define THREAD_COUNT_UNSET SIZE_MAX
 
 extern size_t max_thread_count;
 
+/**
+ * Returns the number of threads, that the next init_thread_pool starts.
+ */
+size_t get_max_thread_count();
+
 void init_thread_pool();
 
 void exit_thread_pool();
 
+/**
+ * Forgets the workers of the parent process in a forked child process. The
+ * child starts its own workers on the next search.
+ */
+void reset_thread_pool();
+
+/**
+ * Returns the number of threads of the current context: the size of its
+ * running thread group, or else the number set by the last init_thread_pool of
+ * the context.
+ */
 size_t get_current_thread_count();
 
 void start_threads( void *(*start_routine)( void * ), void * arg );
 
-void wait_for_threads( void ** thread_results );
+/**
+ * Waits for the thread group of the current context and copies the result of
+ * each thread into thread_results, which has to hold get_current_thread_count()
+ * entries, as called before the wait.
+ *
+ * @return the number of threads of the group
+ */
+size_t wait_for_threads( void ** thread_results );
+
+/**
+ * Returns the number of threads started by the current context, which are
+ * not finished yet. Does not block.
+ */
+size_t count_running_threads();
 
 #endif /* THREAD_POOL_H_ */
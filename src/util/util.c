@@ -23,6 +23,7 @@
 #include <mm_malloc.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <limits.h>
 
 #include "../db_adapter.h"
 
@@ -122,3 +123,59 @@ void add_to_minheap( p_minheap heap, uint8_t query_id, p_sdb_sequence db_seq, lo
      */
     minheap_add( heap, &e );
 }
+
+/**
+ * Passes the score of an alignment to the sink of the search result. Without a
+ * sink, the score is added to the heap of the result.
+ */
+void add_to_result( p_search_result res, uint8_t query_id, p_sdb_sequence db_seq, long score ) {
+    if( res->add_hit ) {
+        res->add_hit( res, query_id, db_seq, score );
+        return;
+    }
+
+    if( !res->shared_floor ) {
+        add_to_minheap( res->heap, query_id, db_seq, score );
+        return;
+    }
+
+    // the heap of another thread already holds enough better hits
+    long floor = __atomic_load_n( res->shared_floor, __ATOMIC_RELAXED );
+    if( score <= floor ) {
+        return;
+    }
+
+    add_to_minheap( res->heap, query_id, db_seq, score );
+
+    p_minheap heap = res->heap;
+    if( (heap->count == heap->alloc) && (heap->array[0].score > floor) ) {
+        long heap_min = heap->array[0].score;
+
+        // publish the raised minimum, unless another thread raised the floor further
+        while( (heap_min > floor)
+                && !__atomic_compare_exchange_n( res->shared_floor, &floor, heap_min, 1, __ATOMIC_RELAXED,
+                        __ATOMIC_RELAXED ) ) {
+        }
+    }
+}
+
+/**
+ * Returns the score, which a hit has to exceed to be added to the heap of the
+ * search result: the minimum of the full heap, or the floor shared by the
+ * threads, if it is higher. Returns LONG_MIN, if there is no such score yet.
+ *
+ * If the scores are passed to a sink, the shared floor is the score, that the
+ * sink needs, or LONG_MIN without a shared floor.
+ */
+long result_score_floor( p_search_result res ) {
+    long floor = res->shared_floor ? __atomic_load_n( res->shared_floor, __ATOMIC_RELAXED ) : LONG_MIN;
+
+    if( res->add_hit ) {
+        return floor;
+    }
+
+    if( (res->heap->count == res->heap->alloc) && (res->heap->array[0].score > floor) ) {
+        floor = res->heap->array[0].score;
+    }
+    return floor;
+}
@@ -36,6 +36,9 @@
 
 #define SMITH_WATERMAN 0
 #define NEEDLEMAN_WUNSCH 1
+// unit cost edit distance, the mode is added to EDIT_DISTANCE
+#define EDIT_DISTANCE 2
+#define IS_EDIT_DISTANCE(search_type) ((search_type) >= EDIT_DISTANCE)
 
 #define DEFAULT_MATRIXNAME "blosum62"
 #define DEFAULT_MATCHSCORE 1
@@ -68,4 +71,8 @@ void print_error( const char* format, ... );
 
 void add_to_minheap( p_minheap heap, uint8_t query_id, p_sdb_sequence db_seq, long score );
 
+void add_to_result( p_search_result res, uint8_t query_id, p_sdb_sequence db_seq, long score );
+
+long result_score_floor( p_search_result res );
+
 #endif /* UTIL_H_ */
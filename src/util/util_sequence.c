@@ -175,19 +175,16 @@ const char * sym_ncbi_aa = "-ABCDEFGHIKLMNPQRSTVWXYZU*OJ####";
  */
 static const char ntcompl[16] = { 0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15 };
 
-int symtype = DEFAULT_SYMTYPE;
-int query_strands = DEFAULT_STRAND;
-
 /*
  * Table for translating a nucleic query sequence into a protein sequence.
  * Initialized with the genetic code of the query sequence.
  */
-static char q_translate[16 * 16 * 16];
+#define q_translate (ctx_current->q_translate)
 /*
  * Table for translating a nucleic DB sequence into a protein sequence.
  * Initialized with the genetic code of the DB sequences.
  */
-static char d_translate[16 * 16 * 16];
+#define d_translate (ctx_current->d_translate)
 
 /**
  * Initialises a translation table for a genetic code.
@@ -382,7 +379,7 @@ void us_translate_sequence( int db_sequence, sequence_t dna, int strand, int fra
 }
 
 sequence_t us_prepare_sequence( char * seq, size_t len, int f, int s ) {
-    sequence_t result;
+    sequence_t result = { 0, 0 };
 
     sequence_t db_seq;
     db_seq.seq = seq;
@@ -406,6 +403,8 @@ sequence_t us_prepare_sequence( char * seq, size_t len, int f, int s ) {
         us_map_sequence( db_seq, conv_seq, map_ncbi_nt16 );
 
         us_translate_sequence( 1, conv_seq, s, f, &result );
+
+        free( conv_seq.seq );
     }
     else {
         us_map_sequence( db_seq, conv_seq, map_ncbi_aa );
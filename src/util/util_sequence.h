@@ -23,6 +23,7 @@
 #include <stddef.h>
 
 #include "../libssa_datatypes.h"
+#include "../context.h"
 
 extern const char map_ncbi_aa[256];
 extern const char map_ncbi_nt16[256];
@@ -36,12 +37,14 @@ extern const char * sym_ncbi_aa;
 
 /* Describes, if the DB sequences should be translated prior to the alignments.
  * One of: 0 - 4
+ * Set in the current context.
  * @see sdb_init_symbol_translation in libsdb.h */
-extern int symtype;
+#define symtype (ctx_current->sym_type)
 /* Describes which strands are used in the alignments
  * One of: 1 - 3
+ * Set in the current context.
  * @see sdb_init_symbol_translation in libsdb.h */
-extern int query_strands;
+#define query_strands (ctx_current->strands)
 
 /**
  * Initialises the translation tables for query and DB sequences, using the
@@ -19,6 +19,8 @@
 
 #include "../../tests.h"
 
+#include <string.h>
+
 #include "../../../src/util/util.h"
 #include "../../../src/libssa.h"
 #include "../../../src/util/minheap.h"
@@ -113,10 +115,110 @@ START_TEST (test_search_64_more_sequences_nw)
         exit_searcher_test( res );
     }END_TEST
 
+#define PREFIX_BASE_COUNT 10
+#define PREFIX_VARIANTS 8
+#define PREFIX_DB_COUNT (PREFIX_BASE_COUNT * PREFIX_VARIANTS)
+
+/*
+ * Creates variants of the first sequences of the external database, that
+ * differ in one residue or in their length, so that they share prefixes of
+ * different lengths.
+ */
+static p_seqinfo create_prefix_db() {
+    ssa_db_init( "./tests/testdata/AF091148.fas" );
+
+    p_seqinfo db = xmalloc( PREFIX_DB_COUNT * sizeof(seqinfo_t) );
+
+    for( size_t b = 0; b < PREFIX_BASE_COUNT; b++ ) {
+        p_seqinfo base = ssa_db_get_sequence( b );
+
+        for( size_t v = 0; v < PREFIX_VARIANTS; v++ ) {
+            p_seqinfo seq = &db[v * PREFIX_BASE_COUNT + b];
+
+            seq->ID = v * PREFIX_BASE_COUNT + b;
+            seq->seqlen = (v & 1) ? base->seqlen - 3 * v : base->seqlen;
+            seq->seq = xmalloc( base->seqlen + 1 );
+            memcpy( seq->seq, base->seq, base->seqlen + 1 );
+            seq->seq[seq->seqlen] = 0;
+
+            if( v > 1 ) {
+                size_t pos = seq->seqlen * v / (PREFIX_VARIANTS + 1);
+                seq->seq[pos] = (seq->seq[pos] == 'A') ? 'C' : 'A';
+            }
+        }
+    }
+    return db;
+}
+
+static p_alignment_list search_prefix_db( p_seqinfo db, int search_type, int prefix_sharing ) {
+    p_ssa_context ctx = ssa_ctx_create();
+    ssa_ctx_init_constant_scores( ctx, 2, -1 );
+    ssa_ctx_init_gap_penalties( ctx, -3, -1 );
+    ssa_ctx_init_symbol_translation( ctx, NUCLEOTIDE, BOTH_STRANDS, 3, 3 );
+    ssa_ctx_set_chunk_size( ctx, 30 );
+    ssa_ctx_init_db( ctx, db, PREFIX_DB_COUNT );
+    ssa_ctx_set_prefix_sharing( ctx, prefix_sharing );
+
+    p_query query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_FILE, "./tests/testdata/one_seq.fas" );
+
+    p_alignment_list alist;
+    if( search_type == SMITH_WATERMAN ) {
+        alist = ssa_ctx_sw_align( ctx, query, PREFIX_DB_COUNT, BIT_WIDTH_64, COMPUTE_SCORE );
+    }
+    else {
+        alist = ssa_ctx_nw_align( ctx, query, PREFIX_DB_COUNT, BIT_WIDTH_64, COMPUTE_SCORE );
+    }
+
+    free_sequence( query );
+    ssa_ctx_free( ctx );
+
+    return alist;
+}
+
+static void check_prefix_sharing( int search_type ) {
+    set_thread_count( 1 );
+
+    p_seqinfo db = create_prefix_db();
+
+    p_alignment_list expected = search_prefix_db( db, search_type, 0 );
+    p_alignment_list alist = search_prefix_db( db, search_type, 1 );
+
+    ck_assert_int_eq( PREFIX_DB_COUNT, alist->len );
+    ck_assert_int_eq( expected->len, alist->len );
+
+    for( size_t i = 0; i < expected->len; i++ ) {
+        ck_assert_int_eq( expected->alignments[i]->score, alist->alignments[i]->score );
+        ck_assert_int_eq( expected->alignments[i]->db_seq.ID, alist->alignments[i]->db_seq.ID );
+        ck_assert_int_eq( expected->alignments[i]->db_seq.strand, alist->alignments[i]->db_seq.strand );
+    }
+
+    free_alignment( expected );
+    free_alignment( alist );
+
+    for( size_t i = 0; i < PREFIX_DB_COUNT; i++ ) {
+        free( db[i].seq );
+    }
+    free( db );
+
+    ssa_exit();
+}
+
+START_TEST (test_search_64_prefix_sharing_sw)
+    {
+        check_prefix_sharing( SMITH_WATERMAN );
+    }END_TEST
+
+START_TEST (test_search_64_prefix_sharing_nw)
+    {
+        check_prefix_sharing( NEEDLEMAN_WUNSCH );
+    }END_TEST
+
 void addSearcher64TC( Suite *s ) {
     TCase *tc_core = tcase_create( "searcher 64" );
     tcase_add_test( tc_core, test_search_64_more_sequences_sw );
     tcase_add_test( tc_core, test_search_64_more_sequences_nw );
+    tcase_add_test( tc_core, test_search_64_prefix_sharing_sw );
+    tcase_add_test( tc_core, test_search_64_prefix_sharing_nw );
 
     suite_add_tcase( s, tc_core );
 }
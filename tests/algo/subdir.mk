@@ -1,6 +1,20 @@
 TESTS += \
 ./tests/algo/test_searcher.o \
 ./tests/algo/test_manager.o \
+./tests/algo/test_batcher.o \
+./tests/algo/test_pair_aligner.o \
+./tests/algo/test_async_search.o \
+./tests/algo/test_anytime.o \
+./tests/algo/test_sharded_search.o \
+./tests/algo/test_incremental.o \
+./tests/algo/test_ungapped_filter.o \
+./tests/algo/test_bound_pruning.o \
+./tests/algo/test_dense_scores.o \
+./tests/algo/test_hit_stream.o \
+./tests/algo/test_result_table.o \
+./tests/algo/test_align_stats.o \
+./tests/algo/test_edit_distance.o \
+./tests/algo/test_banded_nw.o \
 ./tests/algo/test_aligner.o \
 ./tests/algo/test_align.o \
 ./tests/algo/test_cigar.o
@@ -0,0 +1,177 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+
+#include "../tests.h"
+
+#include <string.h>
+
+#include "../../src/libssa.h"
+#include "../../src/cpu_config.h"
+#include "../../src/util/util.h"
+
+/*
+ * Checks, that the statistics of an alignment are consistent with its score
+ * and coordinates, for the scoring of init_stats_test.
+ */
+static void check_stats( p_alignment a ) {
+    long score = 5 * (long) a->align_matches - 4 * (long) a->align_mismatches - 4 * (long) a->align_gap_opens
+            - 2 * (long) a->align_gap_columns;
+
+    ck_assert_int_eq( a->score, score );
+    ck_assert_int_eq( a->align_matches + a->align_mismatches + a->align_gap_columns, a->align_columns );
+    ck_assert_int_le( a->align_gap_opens, a->align_gap_columns );
+
+    // each column consumes a symbol of the query, of the database sequence or of both
+    size_t q_symbols = a->align_q_end - a->align_q_start + 1;
+    size_t d_symbols = a->align_d_end - a->align_d_start + 1;
+    ck_assert_int_eq( 2 * (a->align_matches + a->align_mismatches) + a->align_gap_columns, q_symbols + d_symbols );
+
+    ck_assert_int_lt( a->align_q_end, a->query.len );
+    ck_assert_int_lt( a->align_d_end, a->db_seq.len );
+}
+
+static p_query init_stats_test( size_t thread_count ) {
+    set_thread_count( thread_count );
+
+    init_db( "tests/testdata/AF091148.fas" );
+
+    init_constant_scores( 5, -4 );
+    init_gap_penalties( -4, -2 );
+    init_symbol_translation( NUCLEOTIDE, FORWARD_STRAND, 3, 3 );
+
+    return init_sequence_fasta( READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+}
+
+static void exit_stats_test( p_query query ) {
+    free_sequence( query );
+    ssa_exit();
+}
+
+static void check_search( p_query query, int search_type, size_t hit_count ) {
+    p_alignment_list (*align_func)( p_query, size_t, int, int ) =
+            (search_type == SMITH_WATERMAN) ? &sw_align : &nw_align;
+
+    p_alignment_list stats = align_func( query, hit_count, BIT_WIDTH_16, COMPUTE_STATISTICS );
+    p_alignment_list alignments = align_func( query, hit_count, BIT_WIDTH_16, COMPUTE_ALIGNMENT );
+
+    ck_assert_int_eq( hit_count, stats->len );
+    ck_assert_int_eq( hit_count, alignments->len );
+
+    for( size_t i = 0; i < hit_count; i++ ) {
+        p_alignment a = stats->alignments[i];
+
+        ck_assert_ptr_eq( 0, a->alignment );
+        ck_assert_int_eq( alignments->alignments[i]->score, a->score );
+        check_stats( a );
+
+        if( search_type == NEEDLEMAN_WUNSCH ) {
+            ck_assert_int_eq( 0, a->align_q_start );
+            ck_assert_int_eq( a->query.len - 1, a->align_q_end );
+            ck_assert_int_eq( 0, a->align_d_start );
+            ck_assert_int_eq( a->db_seq.len - 1, a->align_d_end );
+        }
+    }
+
+    free_alignment( stats );
+    free_alignment( alignments );
+}
+
+START_TEST (test_stats_sw)
+    {
+        p_query query = init_stats_test( 2 );
+
+        check_search( query, SMITH_WATERMAN, 100 );
+
+        exit_stats_test( query );
+    }END_TEST
+
+START_TEST (test_stats_nw)
+    {
+        p_query query = init_stats_test( 2 );
+
+        check_search( query, NEEDLEMAN_WUNSCH, 100 );
+
+        exit_stats_test( query );
+    }END_TEST
+
+START_TEST (test_stats_kernels)
+    {
+        p_query query = init_stats_test( 1 );
+
+        // the SSE2 kernel
+        set_max_compute_capability( COMPUTE_ON_SSE2 );
+        check_search( query, SMITH_WATERMAN, 20 );
+        check_search( query, NEEDLEMAN_WUNSCH, 20 );
+
+        reset_compute_capability();
+
+        exit_stats_test( query );
+    }END_TEST
+
+START_TEST (test_stats_pairs)
+    {
+        init_constant_scores( 5, -4 );
+        init_gap_penalties( -4, -2 );
+        init_symbol_translation( NUCLEOTIDE, FORWARD_STRAND, 3, 3 );
+
+        char * seq = "ATGCCCAAGCTGAATAGCGTAGAGGGGTTTTCATCATTTGAGGACGATGTATAA";
+        p_query query = init_sequence_fasta( READ_FROM_STRING, seq );
+
+        align_pair_t pairs[3] = {
+                { query, seq, strlen( seq ) },
+                // one deletion in the target
+                { query, "ATGCCCAAGCTGAATAGCGTAGAGGGTTTTCATCATTTGAGGACGATGTATAA", 53 },
+                // one mismatch
+                { query, "ATGCCCAAGCTGAATAGCGTAGAGGGGTTTTCATCATTTGAGGACGATGTATAT", 54 } };
+
+        p_alignment_list alist = nw_align_pairs( pairs, 3, BIT_WIDTH_64, COMPUTE_STATISTICS );
+
+        ck_assert_int_eq( 3, alist->len );
+        for( int i = 0; i < 3; i++ ) {
+            check_stats( alist->alignments[i] );
+        }
+
+        ck_assert_int_eq( 54, alist->alignments[0]->align_matches );
+        ck_assert_int_eq( 54, alist->alignments[0]->align_columns );
+        ck_assert_int_eq( 0, alist->alignments[0]->align_gap_opens );
+
+        ck_assert_int_eq( 53, alist->alignments[1]->align_matches );
+        ck_assert_int_eq( 0, alist->alignments[1]->align_mismatches );
+        ck_assert_int_eq( 1, alist->alignments[1]->align_gap_opens );
+        ck_assert_int_eq( 1, alist->alignments[1]->align_gap_columns );
+
+        ck_assert_int_eq( 53, alist->alignments[2]->align_matches );
+        ck_assert_int_eq( 1, alist->alignments[2]->align_mismatches );
+        ck_assert_int_eq( 0, alist->alignments[2]->align_gap_columns );
+
+        free_alignment( alist );
+        free_sequence( query );
+        ssa_exit();
+    }END_TEST
+
+void addAlignStatsTC( Suite *s ) {
+    TCase *tc_core = tcase_create( "align_stats" );
+    tcase_add_test( tc_core, test_stats_sw );
+    tcase_add_test( tc_core, test_stats_nw );
+    tcase_add_test( tc_core, test_stats_kernels );
+    tcase_add_test( tc_core, test_stats_pairs );
+
+    suite_add_tcase( s, tc_core );
+}
@@ -66,7 +66,21 @@ static p_alignment_list do_aligner_test_step_two( int search_type, p_query query
 
     a_set_alignment_pairs( pair_count, result_sequence_pairs );
 
-    p_alignment_list alist = a_align( NULL );
+    a_align( NULL );
+
+    // the alignments in the order of the hits, like do_align collects them
+    p_alignment * alignments = a_get_alignments();
+
+    p_alignment_list alist = xmalloc( sizeof(alignment_list_t) );
+    alist->alignments = xmalloc( (pair_count + 1) * sizeof(p_alignment) );
+    alist->len = 0;
+    alist->partial = 0;
+
+    for( int i = 0; i < pair_count; i++ ) {
+        if( alignments[i] ) {
+            alist->alignments[alist->len++] = alignments[i];
+        }
+    }
 
     ck_assert_int_eq( hit_count, alist->len );
 
@@ -217,12 +231,82 @@ START_TEST (test_aligner_simple_nw)
         exit_aligner_test( alist, query );
     }END_TEST
 
+START_TEST (test_aligner_cost_order)
+    {
+        p_query query = setup_aligner_test( "ATGCCCAAGCTGAATAGCGTAGAGGGGTTTTCATCATTTGAGGACGATGTATAA", "test.fas", 3 );
+
+        // the sequences have the lengths 129, 232, 129, 129 and 120
+        elem_t pairs[5];
+        for( int i = 0; i < 5; i++ ) {
+            pairs[i] = new_elem( i, 0, 0, 0, 10 - i );
+        }
+
+        p_alignment_list alist = do_aligner_test_step_two( SMITH_WATERMAN, query, 5, 5, pairs );
+
+        size_t order[5];
+        a_order_by_cost( pairs, 5, ctx_current->search.adp->queries, order );
+
+        ck_assert_int_eq( 1, order[0] );
+        ck_assert_int_eq( 0, order[1] );
+        ck_assert_int_eq( 2, order[2] );
+        ck_assert_int_eq( 3, order[3] );
+        ck_assert_int_eq( 4, order[4] );
+
+        // the alignments are kept in the order of the pairs
+        p_alignment * alignments = a_get_alignments();
+        for( int i = 0; i < 5; i++ ) {
+            ck_assert_int_eq( i, alignments[i]->db_seq.ID );
+            ck_assert_int_eq( i, alist->alignments[i]->db_seq.ID );
+        }
+
+        a_free_data();
+        exit_aligner_test( alist, query );
+    }END_TEST
+
+/*
+ * The alignments, whose matrices are filled tile by tile by all threads of the
+ * alignment phase, are the same as the alignments computed by single threads.
+ */
+START_TEST (test_aligner_split_matrices)
+    {
+        p_ssa_context ctx = create_test_db_context( 4, "tests/testdata/AF091148.fas", NUCLEOTIDE );
+        p_query query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+
+        p_alignment_list whole = ssa_ctx_nw_align( ctx, query, 20, BIT_WIDTH_64, COMPUTE_ALIGNMENT );
+
+        cigar_split_min_cells = 0;
+        p_alignment_list split = ssa_ctx_nw_align( ctx, query, 20, BIT_WIDTH_64, COMPUTE_ALIGNMENT );
+        cigar_split_min_cells = CIGAR_SPLIT_MIN_CELLS;
+
+        ck_assert_int_eq( whole->len, split->len );
+
+        // hits of equal scores can be reported in another order
+        size_t compared = 0;
+        for( size_t i = 0; i < split->len; i++ ) {
+            for( size_t j = 0; j < whole->len; j++ ) {
+                if( whole->alignments[j]->db_seq.ID == split->alignments[i]->db_seq.ID ) {
+                    ck_assert_str_eq( whole->alignments[j]->alignment, split->alignments[i]->alignment );
+                    compared++;
+                }
+            }
+        }
+        ck_assert_int_gt( compared, 0 );
+
+        free_alignment( whole );
+        free_alignment( split );
+        free_sequence( query );
+        ssa_ctx_free( ctx );
+        ssa_exit();
+    }END_TEST
+
 void addAlignerTC( Suite *s ) {
     TCase *tc_core = tcase_create( "aligner" );
     tcase_add_test( tc_core, test_aligner_simple_sw );
     tcase_add_test( tc_core, test_aligner_simple_sw_2 );
     tcase_add_test( tc_core, test_aligner_simple_nw );
     tcase_add_test( tc_core, test_aligner_more_sequences_sw );
+    tcase_add_test( tc_core, test_aligner_cost_order );
+    tcase_add_test( tc_core, test_aligner_split_matrices );
 
     suite_add_tcase( s, tc_core );
 }
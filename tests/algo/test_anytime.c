@@ -0,0 +1,217 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#define _POSIX_C_SOURCE 199309L // nanosleep
+
+#include "../tests.h"
+
+#include <time.h>
+
+#include "../../src/libssa.h"
+
+#define HIT_COUNT 5
+
+typedef struct {
+    int calls;
+    double last_fraction;
+    int fraction_decreased;
+    size_t max_len;
+    long best_score;
+    int aligned;
+} progress_data_t;
+
+static void record_progress( p_ssa_progress progress, double fraction, void * data ) {
+    progress_data_t * p = data;
+
+    p->calls++;
+    if( fraction < p->last_fraction ) {
+        p->fraction_decreased = 1;
+    }
+    p->last_fraction = fraction;
+
+    if( progress->len > p->max_len ) {
+        p->max_len = progress->len;
+    }
+    if( progress->len ) {
+        p->best_score = progress->hits[0].score;
+    }
+
+    // the sequences of the hits are only fetched on request
+    if( progress->len && !p->aligned ) {
+        p_alignment_list alist = ssa_progress_get_alignments( progress );
+
+        ck_assert_int_eq( progress->len, alist->len );
+        for( size_t i = 0; i < alist->len; i++ ) {
+            ck_assert_int_eq( progress->hits[i].db_id, alist->alignments[i]->db_seq.ID );
+            ck_assert_int_eq( progress->hits[i].score, alist->alignments[i]->score );
+            ck_assert_ptr_ne( 0, alist->alignments[i]->db_seq.seq );
+            ck_assert_ptr_ne( 0, alist->alignments[i]->query.seq );
+        }
+
+        free_alignment( alist );
+        p->aligned = 1;
+    }
+}
+
+static int callbacks_running = 0;
+static int callbacks_overlapped = 0;
+
+static void slow_progress( p_ssa_progress progress, double fraction, void * data ) {
+    if( __atomic_add_fetch( &callbacks_running, 1, __ATOMIC_SEQ_CST ) > 1 ) {
+        callbacks_overlapped = 1;
+    }
+
+    struct timespec delay = { 0, 2000000 };
+    nanosleep( &delay, NULL );
+    record_progress( progress, fraction, data );
+
+    __atomic_sub_fetch( &callbacks_running, 1, __ATOMIC_SEQ_CST );
+}
+
+static p_ssa_context init_anytime_test( size_t thread_count, p_query * query ) {
+    p_ssa_context ctx = create_test_db_context( thread_count, "tests/testdata/AF091148.fas", NUCLEOTIDE );
+    ssa_ctx_set_chunk_size( ctx, 50 );
+
+    *query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+
+    return ctx;
+}
+
+static void exit_anytime_test( p_ssa_context ctx, p_query query ) {
+    free_sequence( query );
+    ssa_ctx_free( ctx );
+    ssa_exit();
+}
+
+START_TEST (test_budget_max_sequences)
+    {
+        p_query query;
+        p_ssa_context ctx = init_anytime_test( 2, &query );
+
+        p_alignment_list full = ssa_ctx_sw_align( ctx, query, HIT_COUNT, BIT_WIDTH_16, COMPUTE_SCORE );
+        ck_assert_int_eq( 0, full->partial );
+
+        ssa_ctx_set_search_budget( ctx, 0, 100 );
+
+        p_alignment_list part = ssa_ctx_sw_align( ctx, query, HIT_COUNT, BIT_WIDTH_16, COMPUTE_SCORE );
+        ck_assert_int_eq( 1, part->partial );
+        ck_assert_int_eq( HIT_COUNT, part->len );
+
+        for( size_t i = 0; i < part->len; i++ ) {
+            ck_assert_int_le( part->alignments[i]->score, full->alignments[i]->score );
+            ck_assert_int_lt( part->alignments[i]->db_seq.ID, 100 );
+        }
+
+        // a budget larger than the database does not mark the result as partial
+        ssa_ctx_set_search_budget( ctx, 0, 1000000 );
+
+        p_alignment_list all = ssa_ctx_sw_align( ctx, query, HIT_COUNT, BIT_WIDTH_16, COMPUTE_SCORE );
+        ck_assert_int_eq( 0, all->partial );
+        for( size_t i = 0; i < all->len; i++ ) {
+            ck_assert_int_eq( full->alignments[i]->score, all->alignments[i]->score );
+        }
+
+        free_alignment( full );
+        free_alignment( part );
+        free_alignment( all );
+
+        exit_anytime_test( ctx, query );
+    }END_TEST
+
+START_TEST (test_budget_time)
+    {
+        p_query query;
+        p_ssa_context ctx = init_anytime_test( 1, &query );
+
+        // a tiny time limit stops the search after the first chunk
+        ssa_ctx_set_search_budget( ctx, 1e-9, 0 );
+
+        p_alignment_list alist = ssa_ctx_sw_align( ctx, query, HIT_COUNT, BIT_WIDTH_64, COMPUTE_ALIGNMENT );
+        ck_assert_int_eq( 1, alist->partial );
+        ck_assert_int_eq( HIT_COUNT, alist->len );
+        ck_assert_ptr_ne( 0, alist->alignments[0]->alignment );
+
+        free_alignment( alist );
+
+        exit_anytime_test( ctx, query );
+    }END_TEST
+
+START_TEST (test_progress_callback)
+    {
+        p_query query;
+        p_ssa_context ctx = init_anytime_test( 2, &query );
+
+        progress_data_t p = { 0, 0, 0, 0, 0, 0 };
+        ssa_ctx_set_progress_callback( ctx, &record_progress, &p );
+
+        p_alignment_list alist = ssa_ctx_sw_align( ctx, query, HIT_COUNT, BIT_WIDTH_16, COMPUTE_SCORE );
+
+        ck_assert_int_gt( p.calls, 1 );
+        ck_assert_int_eq( 0, p.fraction_decreased );
+        ck_assert( p.last_fraction == 1 );
+        ck_assert_int_le( p.max_len, HIT_COUNT );
+        ck_assert_int_eq( alist->alignments[0]->score, p.best_score );
+        ck_assert_int_eq( 1, p.aligned );
+
+        free_alignment( alist );
+
+        // without a callback nothing is reported
+        ssa_ctx_set_progress_callback( ctx, 0, 0 );
+        int calls = p.calls;
+
+        alist = ssa_ctx_sw_align( ctx, query, HIT_COUNT, BIT_WIDTH_16, COMPUTE_SCORE );
+        ck_assert_int_eq( calls, p.calls );
+
+        free_alignment( alist );
+
+        exit_anytime_test( ctx, query );
+    }END_TEST
+
+START_TEST (test_progress_slow_callback)
+    {
+        p_query query;
+        p_ssa_context ctx = init_anytime_test( 4, &query );
+
+        progress_data_t p = { 0, 0, 0, 0, 0, 0 };
+        ssa_ctx_set_progress_callback( ctx, &slow_progress, &p );
+
+        p_alignment_list alist = ssa_ctx_sw_align( ctx, query, HIT_COUNT, BIT_WIDTH_16, COMPUTE_SCORE );
+
+        // the callback runs in one thread at a time, and the last chunk is reported
+        ck_assert_int_eq( 0, callbacks_overlapped );
+        ck_assert_int_ge( p.calls, 1 );
+        ck_assert_int_le( p.calls, (1403 + 49) / 50 );
+        ck_assert_int_eq( 0, p.fraction_decreased );
+        ck_assert( p.last_fraction == 1 );
+        ck_assert_int_eq( alist->alignments[0]->score, p.best_score );
+
+        free_alignment( alist );
+
+        exit_anytime_test( ctx, query );
+    }END_TEST
+
+void addAnytimeTC( Suite *s ) {
+    TCase *tc_core = tcase_create( "anytime" );
+    tcase_add_test( tc_core, test_budget_max_sequences );
+    tcase_add_test( tc_core, test_budget_time );
+    tcase_add_test( tc_core, test_progress_callback );
+    tcase_add_test( tc_core, test_progress_slow_callback );
+
+    suite_add_tcase( s, tc_core );
+}
@@ -0,0 +1,149 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#include "../tests.h"
+
+#include "../../src/libssa.h"
+
+typedef struct {
+    int calls;
+    int state;
+} callback_data_t;
+
+static void count_callback( p_ssa_search search, void * data ) {
+    callback_data_t * cb = data;
+
+    cb->calls++;
+    cb->state = ssa_search_poll( search );
+}
+
+static p_ssa_context init_async_test( size_t thread_count, size_t chunk_size, p_query * query ) {
+    p_ssa_context ctx = create_test_db_context( thread_count, "tests/testdata/AF091148.fas", NUCLEOTIDE );
+    ssa_ctx_set_chunk_size( ctx, chunk_size );
+
+    *query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+
+    return ctx;
+}
+
+static void exit_async_test( p_ssa_context ctx, p_query query ) {
+    free_sequence( query );
+    ssa_ctx_free( ctx );
+    ssa_exit();
+}
+
+static void compare_with_sync( p_ssa_context ctx, p_query query, p_alignment_list alist, int align_type ) {
+    p_alignment_list expected = ssa_ctx_sw_align( ctx, query, 5, BIT_WIDTH_16, align_type );
+
+    ck_assert_int_eq( expected->len, alist->len );
+
+    for( size_t i = 0; i < expected->len; i++ ) {
+        ck_assert_int_eq( expected->alignments[i]->score, alist->alignments[i]->score );
+        ck_assert_int_eq( expected->alignments[i]->db_seq.ID, alist->alignments[i]->db_seq.ID );
+    }
+
+    free_alignment( expected );
+}
+
+START_TEST (test_async_wait)
+    {
+        p_query query;
+        p_ssa_context ctx = init_async_test( 1, 100, &query );
+
+        callback_data_t cb = { 0, SSA_SEARCH_RUNNING };
+
+        p_ssa_search search = ssa_ctx_sw_align_async( ctx, query, 5, BIT_WIDTH_16, COMPUTE_ALIGNMENT,
+                &count_callback, &cb );
+
+        p_alignment_list alist = ssa_search_wait( search );
+
+        ck_assert_int_eq( 1, cb.calls );
+        ck_assert_int_eq( SSA_SEARCH_FINISHED, cb.state );
+        ck_assert_int_eq( SSA_SEARCH_FINISHED, ssa_search_poll( search ) );
+        ck_assert_int_eq( 5, alist->len );
+        ck_assert_ptr_ne( 0, alist->alignments[0]->alignment );
+
+        compare_with_sync( ctx, query, alist, COMPUTE_ALIGNMENT );
+
+        // cancelling a finished search has no effect
+        ssa_search_cancel( search );
+        ck_assert_int_eq( SSA_SEARCH_FINISHED, ssa_search_poll( search ) );
+
+        ssa_search_free( search );
+
+        exit_async_test( ctx, query );
+    }END_TEST
+
+START_TEST (test_async_poll)
+    {
+        p_query query;
+        p_ssa_context ctx = init_async_test( 2, 50, &query );
+
+        p_ssa_search search = ssa_ctx_sw_align_async( ctx, query, 5, BIT_WIDTH_16, COMPUTE_SCORE, 0, 0 );
+
+        while( ssa_search_poll( search ) == SSA_SEARCH_RUNNING ) {
+            // busy waiting
+        }
+
+        p_alignment_list alist = ssa_search_wait( search );
+        ck_assert_int_eq( 5, alist->len );
+
+        ssa_search_free( search );
+
+        exit_async_test( ctx, query );
+    }END_TEST
+
+START_TEST (test_async_cancel)
+    {
+        p_query query;
+        p_ssa_context ctx = init_async_test( 1, 1, &query );
+
+        callback_data_t cb = { 0, SSA_SEARCH_RUNNING };
+
+        // the 64 bit search of single sequence chunks is slow enough to be cancelled
+        p_ssa_search search = ssa_ctx_sw_align_async( ctx, query, 5, BIT_WIDTH_64, COMPUTE_ALIGNMENT,
+                &count_callback, &cb );
+
+        ssa_search_cancel( search );
+
+        ck_assert_ptr_eq( 0, ssa_search_wait( search ) );
+        ck_assert_int_eq( SSA_SEARCH_CANCELLED, ssa_search_poll( search ) );
+        ck_assert_int_eq( 1, cb.calls );
+        ck_assert_int_eq( SSA_SEARCH_CANCELLED, cb.state );
+
+        ssa_search_free( search );
+
+        // the context can be used again
+        search = ssa_ctx_sw_align_async( ctx, query, 5, BIT_WIDTH_16, COMPUTE_SCORE, 0, 0 );
+
+        compare_with_sync( ctx, query, ssa_search_wait( search ), COMPUTE_SCORE );
+
+        ssa_search_free( search );
+
+        exit_async_test( ctx, query );
+    }END_TEST
+
+void addAsyncSearchTC( Suite *s ) {
+    TCase *tc_core = tcase_create( "async_search" );
+    tcase_add_test( tc_core, test_async_wait );
+    tcase_add_test( tc_core, test_async_poll );
+    tcase_add_test( tc_core, test_async_cancel );
+
+    suite_add_tcase( s, tc_core );
+}
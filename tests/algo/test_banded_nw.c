@@ -0,0 +1,274 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#include "../tests.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../src/libssa.h"
+#include "../../src/context.h"
+#include "../../src/cpu_config.h"
+#include "../../src/matrices.h"
+#include "../../src/util/util.h"
+#include "../../src/algo/align.h"
+#include "../../src/algo/64/search_64.h"
+#include "../../src/algo/banded/search_banded.h"
+
+static void init_band_scoring() {
+    init_constant_scores( 5, -4 );
+    init_gap_penalties( -4, -2 );
+}
+
+static sequence_t random_sequence( size_t len ) {
+    sequence_t seq;
+    seq.len = len;
+    seq.seq = malloc( len + 1 );
+
+    for( size_t i = 0; i < len; i++ ) {
+        seq.seq[i] = 1 + rand() % 4;
+    }
+    return seq;
+}
+
+/*
+ * Copies seq with a few substitutions, insertions and deletions.
+ */
+static sequence_t mutate( sequence_t seq, size_t edits ) {
+    sequence_t m;
+    m.seq = malloc( seq.len + edits + 1 );
+    m.len = 0;
+
+    for( size_t i = 0; i < seq.len; i++ ) {
+        int r = rand() % seq.len;
+
+        if( r >= edits ) {
+            m.seq[m.len++] = seq.seq[i];
+        }
+        else if( r % 3 == 0 ) {
+            m.seq[m.len++] = 1 + (seq.seq[i] % 4);
+        }
+        else if( r % 3 == 1 ) {
+            m.seq[m.len++] = seq.seq[i];
+            m.seq[m.len++] = 1 + rand() % 4;
+        }
+    }
+    return m;
+}
+
+static void band_scores( sequence_t q, sequence_t * d, size_t count, long lo, long hi, int64_t * scores ) {
+    if( is_avx2_enabled() ) {
+        nw_band_32_avx2( q, d, count, lo, hi, scores );
+    }
+    else {
+        nw_band_32_sse2( q, d, count, lo, hi, scores );
+    }
+}
+
+static void check_kernels( long width, size_t edits ) {
+    int64_t * hearray = xmalloc( 2 * 600 * sizeof(int64_t) );
+    int64_t max_score = mat_get_max_score();
+
+    for( int round = 0; round < 20; round++ ) {
+        sequence_t q = random_sequence( 100 + rand() % 400 );
+
+        size_t count = is_avx2_enabled() ? BAND_CHANNELS_AVX2 : BAND_CHANNELS_SSE2;
+        sequence_t d[BAND_CHANNELS_AVX2];
+        size_t dlen_min = SIZE_MAX;
+        size_t dlen_max = 0;
+
+        for( size_t c = 0; c < count; c++ ) {
+            d[c] = mutate( q, edits );
+            dlen_min = MIN( dlen_min, d[c].len );
+            dlen_max = MAX( dlen_max, d[c].len );
+        }
+
+        long lo;
+        long hi;
+        bd_band_limits( width, q.len, dlen_min, dlen_max, &lo, &hi );
+
+        int64_t scores[BAND_CHANNELS_AVX2];
+        band_scores( q, d, count, lo, hi, scores );
+
+        for( size_t c = 0; c < count; c++ ) {
+            int64_t full = full_nw( &d[c], &q, hearray );
+
+            // the band contains only a part of the alignments
+            ck_assert_int_le( scores[c], full );
+
+            if( scores[c] >= bd_outside_bound( q.len, d[c].len, lo, hi, max_score ) ) {
+                ck_assert_int_eq( full, scores[c] );
+            }
+
+            free( d[c].seq );
+        }
+        free( q.seq );
+    }
+
+    free( hearray );
+}
+
+START_TEST (test_band_kernels)
+    {
+        init_band_scoring();
+        srand( 11 );
+
+        // a band covering the whole matrix
+        check_kernels( 1000, 20 );
+        check_kernels( 32, 5 );
+        check_kernels( 4, 30 );
+
+        set_max_compute_capability( COMPUTE_ON_SSE2 );
+        check_kernels( 1000, 20 );
+        check_kernels( 8, 10 );
+        reset_compute_capability();
+    }END_TEST
+
+START_TEST (test_band_bound)
+    {
+        init_band_scoring();
+
+        long lo;
+        long hi;
+        bd_band_limits( 10, 100, 95, 103, &lo, &hi );
+        ck_assert_int_eq( -15, lo );
+        ck_assert_int_eq( 13, hi );
+
+        // an alignment leaving the band needs gaps of 2 * 14 - 3 columns
+        ck_assert_int_eq( (5 * (203 - 25) + 2 * (-8 - 50)) / 2, bd_outside_bound( 100, 103, lo, hi, 5 ) );
+
+        // no alignment can leave a band covering the matrix
+        bd_band_limits( 200, 100, 100, 100, &lo, &hi );
+        ck_assert( INT64_MIN == bd_outside_bound( 100, 100, lo, hi, 5 ) );
+
+        set_nw_band( 8 );
+        ck_assert_int_eq( 8, bd_first_width() );
+        ck_assert_int_eq( 0, bd_next_width( 8, 1000 ) );
+
+        set_nw_band( NW_BAND_ADAPTIVE );
+        ck_assert_int_eq( BAND_ADAPTIVE_START, bd_first_width() );
+        ck_assert_int_eq( 2 * BAND_ADAPTIVE_START, bd_next_width( BAND_ADAPTIVE_START, 1000 ) );
+        ck_assert_int_eq( 0, bd_next_width( 256, 500 ) );
+
+        set_nw_band( 0 );
+    }END_TEST
+
+START_TEST (test_band_traceback)
+    {
+        init_band_scoring();
+        srand( 5 );
+
+        for( int round = 0; round < 10; round++ ) {
+            sequence_t q = random_sequence( 50 + rand() % 150 );
+            sequence_t d = mutate( q, 10 );
+
+            packed_cigar_t full = compute_packed_cigar( NEEDLEMAN_WUNSCH, q, d, init_region_for_global( q, d ) );
+            char * full_text = cigar_to_string( full, 1, 0 );
+
+            // with a band covering the matrix, the directions are the same
+            int64_t score;
+            packed_cigar_t banded = compute_banded_packed_cigar( q, d, -(long) q.len - 1, d.len + 1, &score );
+            char * banded_text = cigar_to_string( banded, 1, 0 );
+
+            ck_assert_str_eq( full_text, banded_text );
+            int64_t * hearray = xmalloc( 2 * q.len * sizeof(int64_t) );
+            ck_assert_int_eq( full_nw( &d, &q, hearray ), score );
+            free( hearray );
+
+            free( full_text );
+            free( banded_text );
+            free( q.seq );
+            free( d.seq );
+        }
+    }END_TEST
+
+static p_query init_band_search( size_t thread_count ) {
+    set_thread_count( thread_count );
+
+    init_db( "tests/testdata/AF091148.fas" );
+
+    init_band_scoring();
+    init_symbol_translation( NUCLEOTIDE, FORWARD_STRAND, 3, 3 );
+
+    return init_sequence_fasta( READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+}
+
+static void compare_band_search( p_query query, long width, int bit_width, int align_type ) {
+    set_nw_band( 0 );
+    p_alignment_list expected = nw_align( query, 50, bit_width, align_type );
+
+    set_nw_band( width );
+    p_alignment_list alist = nw_align( query, 50, bit_width, align_type );
+
+    size_t banded;
+    size_t fallbacks;
+    get_band_stats( &banded, &fallbacks );
+
+    set_nw_band( 0 );
+
+    ck_assert_int_eq( ctx_db_get_sequence_count(), banded + fallbacks );
+    ck_assert_int_eq( expected->len, alist->len );
+
+    for( size_t i = 0; i < expected->len; i++ ) {
+        ck_assert_int_eq( expected->alignments[i]->score, alist->alignments[i]->score );
+
+        if( align_type == COMPUTE_ALIGNMENT ) {
+            ck_assert_ptr_ne( 0, alist->alignments[i]->alignment );
+        }
+    }
+
+    free_alignment( expected );
+    free_alignment( alist );
+}
+
+START_TEST (test_band_search)
+    {
+        p_query query = init_band_search( 2 );
+
+        compare_band_search( query, 8, BIT_WIDTH_16, COMPUTE_SCORE );
+        compare_band_search( query, 64, BIT_WIDTH_64, COMPUTE_SCORE );
+        compare_band_search( query, NW_BAND_ADAPTIVE, BIT_WIDTH_8, COMPUTE_SCORE );
+        compare_band_search( query, NW_BAND_ADAPTIVE, BIT_WIDTH_16, COMPUTE_ALIGNMENT );
+
+        free_sequence( query );
+        ssa_exit();
+    }END_TEST
+
+START_TEST (test_band_search_sse2)
+    {
+        p_query query = init_band_search( 1 );
+
+        set_max_compute_capability( COMPUTE_ON_SSE2 );
+        compare_band_search( query, 16, BIT_WIDTH_16, COMPUTE_SCORE );
+        reset_compute_capability();
+
+        free_sequence( query );
+        ssa_exit();
+    }END_TEST
+
+void addBandedNWTC( Suite *s ) {
+    TCase *tc_core = tcase_create( "banded_nw" );
+    tcase_add_test( tc_core, test_band_kernels );
+    tcase_add_test( tc_core, test_band_bound );
+    tcase_add_test( tc_core, test_band_traceback );
+    tcase_add_test( tc_core, test_band_search );
+    tcase_add_test( tc_core, test_band_search_sse2 );
+
+    suite_add_tcase( s, tc_core );
+}
@@ -0,0 +1,247 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#include "../tests.h"
+
+#include "../../src/libssa.h"
+#include "../../src/algo/batcher.h"
+
+#define QUERY_COUNT 5
+
+static char * query_strings[QUERY_COUNT] = {
+        "ATGCCCAAGCTGAATAGCGTAGAGGGGTTTTCATCATTTGAGGACGATGTATAA",
+        "GTCGAGTCGAGCGAAGATGAGCTTC",
+        "AGAGTTTGATCCTGGCTCAG",
+        "TTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTT",
+        "ACGTACGTACGTACGGGATCCA" };
+
+/*
+ * Small scoring matrix, where the score of a substitution depends on the
+ * direction. The batch search has to detect it and search every query on its
+ * own.
+ */
+static char * asymmetric_matrix = "   A  R  N  D  L\n"
+        "A  4 -1 -2 -2 -1\n"
+        "R -3  5  0 -2 -2\n"
+        "N -2  1  6  1 -3\n"
+        "D -2 -2 -1  6 -4\n"
+        "L  0 -2 -3 -4  4\n";
+
+static void init_batcher_test( p_query * queries, size_t thread_count, int type, int strands, int matrix_mode,
+        const char * matrix ) {
+    if( matrix ) {
+        init_score_matrix( matrix_mode, matrix );
+    }
+    else {
+        init_constant_scores( 5, -4 );
+    }
+    init_gap_penalties( -4, -2 );
+    init_symbol_translation( type, strands, 3, 3 );
+
+    set_thread_count( thread_count );
+
+    init_db( "tests/testdata/AF091148.fas" );
+
+    for( int i = 0; i < QUERY_COUNT; i++ ) {
+        queries[i] = init_sequence_fasta( READ_FROM_STRING, query_strings[i] );
+    }
+}
+
+static void exit_batcher_test( p_query * queries ) {
+    for( int i = 0; i < QUERY_COUNT; i++ ) {
+        free_sequence( queries[i] );
+    }
+    ssa_exit();
+}
+
+static int is_query_sequence( p_query query, char * seq ) {
+    for( int i = 0; i < 2; i++ ) {
+        if( query->nt[i].seq == seq ) {
+            return 1;
+        }
+    }
+    for( int i = 0; i < 6; i++ ) {
+        if( query->aa[i].seq == seq ) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * Compares the results of the batch search with the results of the single
+ * query search. Alignments with equal scores might be reported in a different
+ * order, therefore only the scores are compared.
+ */
+static void compare_batch_with( p_alignment_list (*align_func)( p_query, size_t, int, int ),
+        p_alignment_list * (*batch_func)( p_query *, size_t, size_t, int, int ), int bit_width, size_t thread_count,
+        int type, int strands, int matrix_mode, const char * matrix ) {
+    p_query queries[QUERY_COUNT];
+    init_batcher_test( queries, thread_count, type, strands, matrix_mode, matrix );
+
+    size_t hit_count = 10;
+
+    p_alignment_list * alists = batch_func( queries, QUERY_COUNT, hit_count, bit_width, COMPUTE_SCORE );
+
+    for( int i = 0; i < QUERY_COUNT; i++ ) {
+        p_alignment_list expected = align_func( queries[i], hit_count, BIT_WIDTH_64, COMPUTE_SCORE );
+
+        ck_assert_int_eq( expected->len, alists[i]->len );
+
+        for( size_t j = 0; j < expected->len; j++ ) {
+            ck_assert_int_eq( expected->alignments[j]->score, alists[i]->alignments[j]->score );
+            ck_assert( is_query_sequence( queries[i], alists[i]->alignments[j]->query.seq ) );
+        }
+
+        free_alignment( expected );
+    }
+
+    free_alignment_batch( alists, QUERY_COUNT );
+
+    exit_batcher_test( queries );
+}
+
+static void compare_batch( p_alignment_list (*align_func)( p_query, size_t, int, int ),
+        p_alignment_list * (*batch_func)( p_query *, size_t, size_t, int, int ), int bit_width, size_t thread_count ) {
+    compare_batch_with( align_func, batch_func, bit_width, thread_count, NUCLEOTIDE, FORWARD_STRAND, 0, NULL );
+}
+
+START_TEST (test_batch_sw_8)
+    {
+        compare_batch( &sw_align, &sw_align_batch, BIT_WIDTH_8, 1 );
+    }END_TEST
+
+START_TEST (test_batch_sw_16)
+    {
+        compare_batch( &sw_align, &sw_align_batch, BIT_WIDTH_16, 2 );
+    }END_TEST
+
+START_TEST (test_batch_sw_64)
+    {
+        compare_batch( &sw_align, &sw_align_batch, BIT_WIDTH_64, 4 );
+    }END_TEST
+
+START_TEST (test_batch_nw_8)
+    {
+        compare_batch( &nw_align, &nw_align_batch, BIT_WIDTH_8, 4 );
+    }END_TEST
+
+START_TEST (test_batch_nw_16)
+    {
+        compare_batch( &nw_align, &nw_align_batch, BIT_WIDTH_16, 1 );
+    }END_TEST
+
+START_TEST (test_batch_alignment)
+    {
+        p_query queries[QUERY_COUNT];
+        init_batcher_test( queries, 3, NUCLEOTIDE, FORWARD_STRAND, 0, NULL );
+
+        p_alignment_list * alists = sw_align_batch( queries, QUERY_COUNT, 3, BIT_WIDTH_16, COMPUTE_ALIGNMENT );
+
+        for( int i = 0; i < QUERY_COUNT; i++ ) {
+            ck_assert_int_eq( 3, alists[i]->len );
+
+            for( size_t j = 0; j < alists[i]->len; j++ ) {
+                p_alignment a = alists[i]->alignments[j];
+
+                ck_assert_ptr_ne( 0, a->alignment );
+                ck_assert_int_ne( 0, a->alignment_len );
+
+                if( j ) {
+                    ck_assert( alists[i]->alignments[j - 1]->score >= a->score );
+                }
+            }
+        }
+
+        free_alignment_batch( alists, QUERY_COUNT );
+
+        exit_batcher_test( queries );
+    }END_TEST
+
+typedef struct {
+    p_alignment_list lists[QUERY_COUNT];
+    int calls;
+} batch_calls_t;
+
+static void record_query( size_t query_index, p_alignment_list alist, void * data ) {
+    batch_calls_t * calls = data;
+
+    __atomic_add_fetch( &calls->calls, 1, __ATOMIC_SEQ_CST );
+    calls->lists[query_index] = alist;
+}
+
+START_TEST (test_batch_callback)
+    {
+        p_query queries[QUERY_COUNT];
+        init_batcher_test( queries, 3, NUCLEOTIDE, FORWARD_STRAND, 0, NULL );
+
+        batch_calls_t calls;
+        calls.calls = 0;
+
+        p_alignment_list * alists = sw_align_batch_callback( queries, QUERY_COUNT, 3, BIT_WIDTH_16,
+                COMPUTE_ALIGNMENT, &record_query, &calls );
+
+        // every query is reported once, with its final list
+        ck_assert_int_eq( QUERY_COUNT, calls.calls );
+        for( int i = 0; i < QUERY_COUNT; i++ ) {
+            ck_assert_ptr_eq( alists[i], calls.lists[i] );
+        }
+
+        free_alignment_batch( alists, QUERY_COUNT );
+
+        exit_batcher_test( queries );
+    }END_TEST
+
+START_TEST (test_batch_both_strands)
+    {
+        compare_batch_with( &sw_align, &sw_align_batch, BIT_WIDTH_16, 3, NUCLEOTIDE, BOTH_STRANDS, 0, NULL );
+        compare_batch_with( &nw_align, &nw_align_batch, BIT_WIDTH_8, 2, NUCLEOTIDE, BOTH_STRANDS, 0, NULL );
+    }END_TEST
+
+START_TEST (test_batch_translated)
+    {
+        compare_batch_with( &sw_align, &sw_align_batch, BIT_WIDTH_16, 4, TRANS_BOTH, BOTH_STRANDS, MATRIX_BUILDIN,
+                BLOSUM62 );
+        compare_batch_with( &nw_align, &nw_align_batch, BIT_WIDTH_64, 2, TRANS_BOTH, BOTH_STRANDS, MATRIX_BUILDIN,
+                BLOSUM62 );
+    }END_TEST
+
+START_TEST (test_batch_asymmetric_matrix)
+    {
+        compare_batch_with( &sw_align, &sw_align_batch, BIT_WIDTH_8, 2, TRANS_BOTH, BOTH_STRANDS, READ_FROM_STRING,
+                asymmetric_matrix );
+        compare_batch_with( &nw_align, &nw_align_batch, BIT_WIDTH_16, 2, TRANS_BOTH, BOTH_STRANDS,
+                READ_FROM_STRING, asymmetric_matrix );
+    }END_TEST
+
+void addBatcherTC( Suite *s ) {
+    TCase *tc_core = tcase_create( "batcher" );
+    tcase_add_test( tc_core, test_batch_sw_8 );
+    tcase_add_test( tc_core, test_batch_sw_16 );
+    tcase_add_test( tc_core, test_batch_sw_64 );
+    tcase_add_test( tc_core, test_batch_nw_8 );
+    tcase_add_test( tc_core, test_batch_nw_16 );
+    tcase_add_test( tc_core, test_batch_alignment );
+    tcase_add_test( tc_core, test_batch_callback );
+    tcase_add_test( tc_core, test_batch_both_strands );
+    tcase_add_test( tc_core, test_batch_translated );
+    tcase_add_test( tc_core, test_batch_asymmetric_matrix );
+
+    suite_add_tcase( s, tc_core );
+}
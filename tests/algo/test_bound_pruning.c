@@ -0,0 +1,155 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#include "../tests.h"
+
+#include <limits.h>
+
+#include "../../src/libssa.h"
+#include "../../src/context.h"
+#include "../../src/util/util.h"
+
+#define BP_QUERY_ID 100
+
+static p_alignment_list search( p_ssa_context ctx, p_query query, int search_type, size_t hit_count,
+        int bit_width ) {
+    if( search_type == SMITH_WATERMAN ) {
+        return ssa_ctx_sw_align( ctx, query, hit_count, bit_width, COMPUTE_SCORE );
+    }
+    return ssa_ctx_nw_align( ctx, query, hit_count, bit_width, COMPUTE_SCORE );
+}
+
+/*
+ * The pruned search has to find the same scores as the full search.
+ */
+static void compare_pruned( p_ssa_context ctx, p_query query, int search_type, size_t hit_count, int bit_width ) {
+    ssa_ctx_set_bound_pruning( ctx, 0 );
+    p_alignment_list exact = search( ctx, query, search_type, hit_count, bit_width );
+    ck_assert_int_eq( 0, ssa_ctx_get_pruned_sequence_count( ctx ) );
+
+    // without pruning, no thread reads the floor, so it is not shared
+    ck_assert( ctx->search.score_floor == LONG_MIN );
+
+    ssa_ctx_set_bound_pruning( ctx, 1 );
+    p_alignment_list alist = search( ctx, query, search_type, hit_count, bit_width );
+    ck_assert( ctx->search.score_floor > LONG_MIN );
+
+    ck_assert_int_eq( exact->len, alist->len );
+    for( size_t i = 0; i < exact->len; i++ ) {
+        ck_assert_int_eq( exact->alignments[i]->score, alist->alignments[i]->score );
+    }
+
+    free_alignment( alist );
+    free_alignment( exact );
+}
+
+START_TEST (test_bound_pruning_scores)
+    {
+        p_ssa_context ctx = create_test_db_context( 2, "tests/testdata/AF091148.fas", NUCLEOTIDE );
+        p_query query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+
+        compare_pruned( ctx, query, SMITH_WATERMAN, 1, BIT_WIDTH_16 );
+        compare_pruned( ctx, query, SMITH_WATERMAN, 10, BIT_WIDTH_16 );
+        compare_pruned( ctx, query, SMITH_WATERMAN, 5, BIT_WIDTH_64 );
+        compare_pruned( ctx, query, NEEDLEMAN_WUNSCH, 1, BIT_WIDTH_16 );
+        compare_pruned( ctx, query, NEEDLEMAN_WUNSCH, 5, BIT_WIDTH_64 );
+
+        free_sequence( query );
+        ssa_ctx_free( ctx );
+        ssa_exit();
+    }END_TEST
+
+START_TEST (test_bound_pruning_skips)
+    {
+        p_ssa_context ctx = create_test_db_context( 1, "tests/testdata/AF091148.fas", NUCLEOTIDE );
+
+        // a sequence of the database as query: every shorter sequence scores less than the query itself
+        p_seqinfo info = ctx_db_get_sequence( BP_QUERY_ID );
+        p_query query = create_db_query( ctx, BP_QUERY_ID );
+
+        compare_pruned( ctx, query, SMITH_WATERMAN, 1, BIT_WIDTH_16 );
+        ck_assert( ssa_ctx_get_pruned_sequence_count( ctx ) > 0 );
+
+        ssa_ctx_set_bound_pruning( ctx, 1 );
+        p_alignment_list alist = ssa_ctx_sw_align( ctx, query, 1, BIT_WIDTH_16, COMPUTE_ALIGNMENT );
+
+        ck_assert_int_eq( 1, alist->len );
+        ck_assert_int_eq( BP_QUERY_ID, alist->alignments[0]->db_seq.ID );
+        ck_assert_int_eq( 5 * info->seqlen, alist->alignments[0]->score );
+
+        free_alignment( alist );
+
+        compare_pruned( ctx, query, NEEDLEMAN_WUNSCH, 1, BIT_WIDTH_64 );
+        ck_assert( ssa_ctx_get_pruned_sequence_count( ctx ) > 0 );
+
+        free_sequence( query );
+        ssa_ctx_free( ctx );
+        ssa_exit();
+    }END_TEST
+
+START_TEST (test_bound_pruning_kernels)
+    {
+        p_ssa_context ctx = create_test_db_context( 1, "tests/testdata/AF091148.fas", NUCLEOTIDE );
+
+        // the whole database in one chunk: the channels of the SIMD kernels are retired instead
+        ssa_ctx_set_chunk_size( ctx, 2000 );
+
+        p_query query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+
+        compare_pruned( ctx, query, SMITH_WATERMAN, 3, BIT_WIDTH_8 );
+        compare_pruned( ctx, query, SMITH_WATERMAN, 3, BIT_WIDTH_16 );
+        compare_pruned( ctx, query, NEEDLEMAN_WUNSCH, 3, BIT_WIDTH_8 );
+        compare_pruned( ctx, query, NEEDLEMAN_WUNSCH, 3, BIT_WIDTH_16 );
+
+        free_sequence( query );
+        ssa_ctx_free( ctx );
+        ssa_exit();
+    }END_TEST
+
+START_TEST (test_bound_pruning_translated)
+    {
+        p_ssa_context ctx = create_test_db_context( 1, "tests/testdata/AF091148.fas", NUCLEOTIDE );
+        ssa_ctx_init_symbol_translation( ctx, TRANS_DB, BOTH_STRANDS, 1, 1 );
+        ssa_ctx_init_score_matrix( ctx, MATRIX_BUILDIN, BLOSUM62 );
+        ssa_ctx_init_gap_penalties( ctx, -3, -1 );
+
+        // every sequence in its own chunk: each one is pruned against the hits before it
+        ssa_ctx_set_chunk_size( ctx, 1 );
+
+        // part of the translation of the sequence BP_QUERY_ID, much shorter than its nucleotides
+        p_query query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_STRING, "LDWIKRYLLK" );
+
+        compare_pruned( ctx, query, NEEDLEMAN_WUNSCH, 1, BIT_WIDTH_64 );
+        compare_pruned( ctx, query, NEEDLEMAN_WUNSCH, 5, BIT_WIDTH_16 );
+        compare_pruned( ctx, query, SMITH_WATERMAN, 1, BIT_WIDTH_16 );
+
+        free_sequence( query );
+        ssa_ctx_free( ctx );
+        ssa_exit();
+    }END_TEST
+
+void addBoundPruningTC( Suite *s ) {
+    TCase *tc_core = tcase_create( "bound_pruning" );
+    tcase_add_test( tc_core, test_bound_pruning_scores );
+    tcase_add_test( tc_core, test_bound_pruning_skips );
+    tcase_add_test( tc_core, test_bound_pruning_kernels );
+    tcase_add_test( tc_core, test_bound_pruning_translated );
+
+    suite_add_tcase( s, tc_core );
+}
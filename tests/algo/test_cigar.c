@@ -19,7 +19,9 @@
 
 #include "../tests.h"
 
+#include <pthread.h>
 #include <string.h>
+#include <stdint.h>
 
 #include "../../src/algo/align.h"
 #include "../../src/algo/searcher.h"
@@ -133,10 +135,137 @@ START_TEST (test_generate_cigar_simple_sw)
         teardown_cigar( cigar );
     }END_TEST
 
+START_TEST (test_generate_cigar_packed)
+    {
+        setup_cigar( "TACGGGTAT", "GGACGTACG", 9, 9 );
+
+        region_t region = init_region_for_global( a_seq, b_seq );
+
+        packed_cigar_t packed = compute_packed_cigar( NEEDLEMAN_WUNSCH, a_seq, b_seq, region );
+
+        ck_assert_int_eq( 7, packed.len );
+        ck_assert_int_eq( CIGAR_PACK( CIGAR_OP_X, 1 ), packed.ops[0] );
+        ck_assert_int_eq( CIGAR_PACK( CIGAR_OP_EQ, 3 ), packed.ops[2] );
+        ck_assert_int_eq( CIGAR_PACK( CIGAR_OP_D, 2 ), packed.ops[3] );
+        ck_assert_int_eq( 5, packed.matches );
+        ck_assert_int_eq( 11, packed.columns );
+
+        size_t len;
+        char * text = cigar_to_string( packed, 1, &len );
+        ck_assert_str_eq( "XI3=2D2=XI", text );
+        ck_assert_int_eq( 10, len );
+        free( text );
+
+        // the runs of '=' and 'X' are merged without extended operations
+
+        text = cigar_to_string( packed, 0, &len );
+        ck_assert_str_eq( "MI3M2D3MI", text );
+        ck_assert_int_eq( 9, len );
+        free( text );
+
+        cigar_p cigar = compute_cigar_string( NEEDLEMAN_WUNSCH, a_seq, b_seq, region );
+        teardown_cigar( cigar );
+    }END_TEST
+
+/*
+ * Creates a sequence of length len, and a copy of it with substitutions and
+ * short gaps.
+ */
+static void create_related_sequences( char * a, char * b, size_t len, size_t * b_len ) {
+    const char * symbols = "ACGT";
+    uint32_t state = 12345;
+
+    size_t k = 0;
+    for( size_t i = 0; i < len; i++ ) {
+        state = state * 1103515245 + 12345;
+        a[i] = symbols[(state >> 16) & 3];
+
+        uint32_t change = (state >> 8) % 20;
+        if( change == 0 ) {
+            continue;
+        }
+        b[k++] = (change == 1) ? symbols[(state >> 20) & 3] : a[i];
+        if( change == 2 ) {
+            b[k++] = symbols[(state >> 24) & 3];
+        }
+    }
+    a[len] = 0;
+    b[k] = 0;
+    *b_len = k;
+}
+
+static int helpers_stop;
+
+static void * help_loop( void * unused ) {
+    while( !__atomic_load_n( &helpers_stop, __ATOMIC_ACQUIRE ) ) {
+        cigar_help();
+    }
+    return NULL;
+}
+
+/*
+ * The matrix filled tile by tile, with or without helping threads, gives the
+ * same CIGAR as the matrix filled at once.
+ */
+static void compare_split( int search_type, size_t helper_count ) {
+    size_t len = 3 * CIGAR_TILE_SIZE + 100;
+    char a[len + 1];
+    char b[2 * len + 1];
+    size_t b_len;
+    create_related_sequences( a, b, len, &b_len );
+
+    setup_cigar( a, b, len, b_len );
+
+    region_t region = init_region_for_global( a_seq, b_seq );
+    if( search_type == SMITH_WATERMAN ) {
+        region = find_region_for_local( a_seq, b_seq );
+    }
+
+    cigar_split_min_cells = SIZE_MAX;
+    packed_cigar_t whole = compute_packed_cigar( search_type, a_seq, b_seq, region );
+    uint32_t * whole_ops = xmalloc( whole.len * sizeof(uint32_t) );
+    memcpy( whole_ops, whole.ops, whole.len * sizeof(uint32_t) );
+
+    helpers_stop = 0;
+    pthread_t helpers[helper_count + 1];
+    for( size_t i = 0; i < helper_count; i++ ) {
+        pthread_create( &helpers[i], NULL, help_loop, NULL );
+    }
+
+    cigar_split_min_cells = 0;
+    packed_cigar_t split = compute_packed_cigar( search_type, a_seq, b_seq, region );
+
+    __atomic_store_n( &helpers_stop, 1, __ATOMIC_RELEASE );
+    for( size_t i = 0; i < helper_count; i++ ) {
+        pthread_join( helpers[i], NULL );
+    }
+    cigar_split_min_cells = CIGAR_SPLIT_MIN_CELLS;
+
+    ck_assert_int_eq( whole.len, split.len );
+    ck_assert_int_eq( whole.columns, split.columns );
+    ck_assert_int_eq( whole.matches, split.matches );
+    ck_assert_int_eq( 0, memcmp( whole_ops, split.ops, whole.len * sizeof(uint32_t) ) );
+
+    free( whole_ops );
+    free( a_seq.seq );
+    free( b_seq.seq );
+    mat_free();
+}
+
+START_TEST (test_generate_cigar_split)
+    {
+        compare_split( NEEDLEMAN_WUNSCH, 0 );
+        compare_split( SMITH_WATERMAN, 0 );
+        compare_split( NEEDLEMAN_WUNSCH, 3 );
+        compare_split( SMITH_WATERMAN, 3 );
+    }END_TEST
+
 void addCigarTC( Suite *s ) {
     TCase *tc_core = tcase_create( "cigar" );
     tcase_add_test( tc_core, test_generate_cigar_simple_nw );
     tcase_add_test( tc_core, test_generate_cigar_simple_sw );
+    tcase_add_test( tc_core, test_generate_cigar_packed );
+    tcase_add_test( tc_core, test_generate_cigar_split );
 
     suite_add_tcase( s, tc_core );
 }
@@ -0,0 +1,149 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+
+#include "../tests.h"
+
+#include <limits.h>
+
+#include "../../src/libssa.h"
+#include "../../src/util/util.h"
+
+static p_ssa_context create_dense_context( size_t thread_count ) {
+    p_ssa_context ctx = create_test_db_context( thread_count, "tests/testdata/AF091148.fas", NUCLEOTIDE );
+    ssa_ctx_set_chunk_size( ctx, 100 );
+
+    return ctx;
+}
+
+static int32_t * dense_search( p_ssa_context ctx, p_query query, int search_type, int bit_width ) {
+    int32_t * scores = xmalloc( ssa_db_get_sequence_count() * sizeof(int32_t) );
+
+    int finished;
+    if( search_type == SMITH_WATERMAN ) {
+        finished = ssa_ctx_sw_scores( ctx, query, bit_width, scores );
+    }
+    else {
+        finished = ssa_ctx_nw_scores( ctx, query, bit_width, scores );
+    }
+    ck_assert_int_eq( 1, finished );
+
+    return scores;
+}
+
+/*
+ * The dense scores have to be the scores of a search, that returns a hit for
+ * every sequence.
+ */
+static void compare_with_heap( p_ssa_context ctx, p_query query, int search_type, int bit_width ) {
+    size_t db_count = ssa_db_get_sequence_count();
+
+    p_alignment_list alist;
+    if( search_type == SMITH_WATERMAN ) {
+        alist = ssa_ctx_sw_align( ctx, query, db_count, bit_width, COMPUTE_SCORE );
+    }
+    else {
+        alist = ssa_ctx_nw_align( ctx, query, db_count, bit_width, COMPUTE_SCORE );
+    }
+    ck_assert_int_eq( db_count, alist->len );
+
+    int32_t * scores = dense_search( ctx, query, search_type, bit_width );
+
+    for( size_t i = 0; i < alist->len; i++ ) {
+        p_alignment a = alist->alignments[i];
+        ck_assert_int_eq( a->score, scores[a->db_seq.ID] );
+    }
+
+    free( scores );
+    free_alignment( alist );
+}
+
+START_TEST (test_dense_scores_sw)
+    {
+        p_ssa_context ctx = create_dense_context( 2 );
+        p_query query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+
+        compare_with_heap( ctx, query, SMITH_WATERMAN, BIT_WIDTH_8 );
+        compare_with_heap( ctx, query, SMITH_WATERMAN, BIT_WIDTH_16 );
+        compare_with_heap( ctx, query, SMITH_WATERMAN, BIT_WIDTH_64 );
+
+        free_sequence( query );
+        ssa_ctx_free( ctx );
+        ssa_exit();
+    }END_TEST
+
+START_TEST (test_dense_scores_nw)
+    {
+        p_ssa_context ctx = create_dense_context( 3 );
+        p_query query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+
+        compare_with_heap( ctx, query, NEEDLEMAN_WUNSCH, BIT_WIDTH_8 );
+        compare_with_heap( ctx, query, NEEDLEMAN_WUNSCH, BIT_WIDTH_16 );
+
+        free_sequence( query );
+        ssa_ctx_free( ctx );
+        ssa_exit();
+    }END_TEST
+
+START_TEST (test_dense_scores_range_and_dedup)
+    {
+        p_ssa_context ctx = create_dense_context( 2 );
+        p_query query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+
+        int32_t * all = dense_search( ctx, query, SMITH_WATERMAN, BIT_WIDTH_16 );
+
+        // the sequences outside of the range are not searched
+        ssa_ctx_set_search_range( ctx, 100, 300 );
+        int32_t * range = dense_search( ctx, query, SMITH_WATERMAN, BIT_WIDTH_16 );
+
+        for( size_t i = 0; i < ssa_db_get_sequence_count(); i++ ) {
+            if( (i < 100) || (i >= 300) ) {
+                ck_assert_int_eq( INT32_MIN, range[i] );
+            }
+            else {
+                ck_assert_int_eq( all[i], range[i] );
+            }
+        }
+
+        // identical sequences get the score of the searched one
+        ssa_ctx_set_search_range( ctx, 0, 0 );
+        ssa_ctx_set_deduplication( ctx, 1 );
+        int32_t * dedup = dense_search( ctx, query, SMITH_WATERMAN, BIT_WIDTH_16 );
+
+        for( size_t i = 0; i < ssa_db_get_sequence_count(); i++ ) {
+            ck_assert_int_eq( all[i], dedup[i] );
+        }
+
+        free( dedup );
+        free( range );
+        free( all );
+
+        free_sequence( query );
+        ssa_ctx_free( ctx );
+        ssa_exit();
+    }END_TEST
+
+void addDenseScoresTC( Suite *s ) {
+    TCase *tc_core = tcase_create( "dense_scores" );
+    tcase_add_test( tc_core, test_dense_scores_sw );
+    tcase_add_test( tc_core, test_dense_scores_nw );
+    tcase_add_test( tc_core, test_dense_scores_range_and_dedup );
+
+    suite_add_tcase( s, tc_core );
+}
@@ -0,0 +1,247 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#include "../tests.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "../../src/libssa.h"
+#include "../../src/cpu_config.h"
+#include "../../src/algo/ed/search_ed.h"
+
+/*
+ * Edit distance computed with the full DP matrix.
+ */
+static int64_t reference_distance( sequence_t q, sequence_t d, int mode ) {
+    int64_t * column = malloc( (q.len + 1) * sizeof(int64_t) );
+
+    for( size_t i = 0; i <= q.len; i++ ) {
+        column[i] = i;
+    }
+    int64_t best = q.len;
+
+    for( size_t j = 0; j < d.len; j++ ) {
+        int64_t diag = column[0];
+        column[0] = (mode == ED_SEMI_GLOBAL) ? 0 : j + 1;
+
+        for( size_t i = 1; i <= q.len; i++ ) {
+            int64_t up = column[i];
+            int64_t v = diag + (q.seq[i - 1] != d.seq[j]);
+
+            if( up + 1 < v ) {
+                v = up + 1;
+            }
+            if( column[i - 1] + 1 < v ) {
+                v = column[i - 1] + 1;
+            }
+
+            diag = up;
+            column[i] = v;
+        }
+
+        if( column[q.len] < best ) {
+            best = column[q.len];
+        }
+    }
+
+    int64_t result = (mode == ED_GLOBAL) ? column[q.len] : best;
+    free( column );
+
+    return result;
+}
+
+/*
+ * Maps lower case letters to the symbols 0 to 25.
+ */
+static sequence_t to_sequence( const char * s ) {
+    sequence_t seq;
+    seq.len = strlen( s );
+    seq.seq = malloc( seq.len + 1 );
+
+    for( size_t i = 0; i < seq.len; i++ ) {
+        seq.seq[i] = s[i] - 'a';
+    }
+    return seq;
+}
+
+static sequence_t random_sequence( size_t len ) {
+    sequence_t seq;
+    seq.len = len;
+    seq.seq = malloc( len + 1 );
+
+    for( size_t i = 0; i < len; i++ ) {
+        seq.seq[i] = rand() % 4;
+    }
+    return seq;
+}
+
+static int64_t distance( const char * query, const char * target, int mode ) {
+    sequence_t q = to_sequence( query );
+    sequence_t d = to_sequence( target );
+
+    ed_query_t eq;
+    ed_init_query( &eq, &q );
+
+    uint64_t work[2 * 4];
+    int64_t result = ed_distance( &eq, &d, mode, work, INT64_MAX );
+
+    ed_free_query( &eq );
+    free( q.seq );
+    free( d.seq );
+
+    return result;
+}
+
+START_TEST (test_ed_examples)
+    {
+        ck_assert_int_eq( 3, distance( "kitten", "sitting", ED_GLOBAL ) );
+        ck_assert_int_eq( 0, distance( "kitten", "kitten", ED_GLOBAL ) );
+        ck_assert_int_eq( 6, distance( "kitten", "", ED_GLOBAL ) );
+        ck_assert_int_eq( 7, distance( "", "sitting", ED_GLOBAL ) );
+
+        ck_assert_int_eq( 0, distance( "abc", "xxabcxx", ED_SEMI_GLOBAL ) );
+        ck_assert_int_eq( 1, distance( "abd", "xxabcxx", ED_SEMI_GLOBAL ) );
+        ck_assert_int_eq( 1, distance( "abc", "xxacxx", ED_SEMI_GLOBAL ) );
+
+        ck_assert_int_eq( 0, distance( "abc", "abcxxx", ED_PREFIX ) );
+        ck_assert_int_eq( 1, distance( "abc", "xabcxx", ED_PREFIX ) );
+        ck_assert_int_eq( 3, distance( "abc", "", ED_PREFIX ) );
+    }END_TEST
+
+START_TEST (test_ed_random)
+    {
+        srand( 42 );
+
+        size_t lengths[] = { 1, 7, 63, 64, 65, 127, 128, 200 };
+
+        for( int mode = ED_GLOBAL; mode <= ED_PREFIX; mode++ ) {
+            for( size_t l = 0; l < sizeof(lengths) / sizeof(size_t); l++ ) {
+                sequence_t q = random_sequence( lengths[l] );
+
+                ed_query_t eq;
+                ed_init_query( &eq, &q );
+
+                uint64_t * work = malloc( 2 * eq.words * sizeof(uint64_t) );
+
+                sequence_t d[ED_CHANNELS_AVX2];
+                sequence_t * dp[ED_CHANNELS_AVX2];
+                int64_t expected[ED_CHANNELS_AVX2];
+
+                for( int c = 0; c < ED_CHANNELS_AVX2; c++ ) {
+                    d[c] = random_sequence( 20 + rand() % 250 );
+                    dp[c] = &d[c];
+                    expected[c] = reference_distance( q, d[c], mode );
+
+                    ck_assert_int_eq( expected[c], ed_distance( &eq, &d[c], mode, work, INT64_MAX ) );
+                }
+
+                if( eq.words == 1 ) {
+                    int64_t distances[ED_CHANNELS_AVX2];
+
+                    // three channels leave one channel empty
+                    ed_distance_avx2( &eq, dp, 3, mode, distances );
+
+                    for( int c = 0; c < 3; c++ ) {
+                        ck_assert_int_eq( expected[c], distances[c] );
+                    }
+                }
+
+                for( int c = 0; c < ED_CHANNELS_AVX2; c++ ) {
+                    free( d[c].seq );
+                }
+                free( work );
+                ed_free_query( &eq );
+                free( q.seq );
+            }
+        }
+    }END_TEST
+
+START_TEST (test_ed_early_stop)
+    {
+        srand( 7 );
+
+        sequence_t q = random_sequence( 100 );
+        sequence_t d = random_sequence( 300 );
+
+        ed_query_t eq;
+        ed_init_query( &eq, &q );
+        uint64_t work[2 * 2];
+
+        int64_t exact = reference_distance( q, d, ED_GLOBAL );
+
+        // a stopped computation returns a bound above the limit
+        ck_assert_int_gt( ed_distance( &eq, &d, ED_GLOBAL, work, 10 ), 10 );
+        ck_assert_int_eq( exact, ed_distance( &eq, &d, ED_GLOBAL, work, exact ) );
+
+        ed_free_query( &eq );
+        free( q.seq );
+        free( d.seq );
+    }END_TEST
+
+static void check_search( int mode, size_t thread_count ) {
+    set_thread_count( thread_count );
+    init_db( "tests/testdata/AF091148.fas" );
+    init_symbol_translation( NUCLEOTIDE, FORWARD_STRAND, 3, 3 );
+
+    p_query query = init_sequence_fasta( READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+
+    p_alignment_list alist = ed_align( query, 20, mode );
+
+    ck_assert_int_eq( 20, alist->len );
+
+    for( size_t i = 0; i < alist->len; i++ ) {
+        p_alignment a = alist->alignments[i];
+
+        sequence_t q = { a->query.seq, a->query.len };
+        sequence_t d = { a->db_seq.seq, a->db_seq.len };
+
+        ck_assert_int_eq( -reference_distance( q, d, mode ), a->score );
+
+        if( i ) {
+            ck_assert_int_ge( alist->alignments[i - 1]->score, a->score );
+        }
+    }
+
+    free_alignment( alist );
+    free_sequence( query );
+    ssa_exit();
+}
+
+START_TEST (test_ed_search)
+    {
+        check_search( ED_GLOBAL, 1 );
+        check_search( ED_SEMI_GLOBAL, 2 );
+        check_search( ED_PREFIX, 2 );
+
+        // the scalar kernel for short queries
+        set_max_compute_capability( COMPUTE_ON_SSE41 );
+        check_search( ED_SEMI_GLOBAL, 1 );
+        reset_compute_capability();
+    }END_TEST
+
+void addEditDistanceTC( Suite *s ) {
+    TCase *tc_core = tcase_create( "edit_distance" );
+    tcase_add_test( tc_core, test_ed_examples );
+    tcase_add_test( tc_core, test_ed_random );
+    tcase_add_test( tc_core, test_ed_early_stop );
+    tcase_add_test( tc_core, test_ed_search );
+
+    suite_add_tcase( s, tc_core );
+}
@@ -0,0 +1,180 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+
+#include "../tests.h"
+
+#include <pthread.h>
+#include <limits.h>
+
+#include "../../src/libssa.h"
+#include "../../src/context.h"
+#include "../../src/util/util.h"
+
+typedef struct {
+    pthread_mutex_t mutex;
+    pthread_t caller;
+    int other_thread;
+
+    size_t hit_count;
+    int32_t * scores;
+} stream_data_t;
+
+static void collect_hit( const ssa_hit_t * hit, void * data ) {
+    stream_data_t * sd = data;
+
+    pthread_mutex_lock( &sd->mutex );
+    if( !pthread_equal( sd->caller, pthread_self() ) ) {
+        sd->other_thread = 1;
+    }
+
+    sd->hit_count++;
+    if( hit->score > sd->scores[hit->db_id] ) {
+        sd->scores[hit->db_id] = hit->score;
+    }
+    pthread_mutex_unlock( &sd->mutex );
+}
+
+static p_ssa_context create_stream_context( size_t thread_count ) {
+    p_ssa_context ctx = create_test_db_context( thread_count, "tests/testdata/AF091148.fas", NUCLEOTIDE );
+    ssa_ctx_set_chunk_size( ctx, 100 );
+
+    return ctx;
+}
+
+/*
+ * Streams the hits of a search and compares them with the dense scores of the
+ * same search.
+ */
+static stream_data_t compare_stream( p_ssa_context ctx, p_query query, int search_type, int bit_width,
+        long min_score, int delivery ) {
+    size_t db_count = ssa_db_get_sequence_count();
+
+    int32_t * expected = xmalloc( db_count * sizeof(int32_t) );
+    if( search_type == SMITH_WATERMAN ) {
+        ssa_ctx_sw_scores( ctx, query, bit_width, expected );
+    }
+    else {
+        ssa_ctx_nw_scores( ctx, query, bit_width, expected );
+    }
+
+    stream_data_t sd;
+    pthread_mutex_init( &sd.mutex, NULL );
+    sd.caller = pthread_self();
+    sd.other_thread = 0;
+    sd.hit_count = 0;
+    sd.scores = xmalloc( db_count * sizeof(int32_t) );
+    for( size_t i = 0; i < db_count; i++ ) {
+        sd.scores[i] = INT32_MIN;
+    }
+
+    int finished;
+    if( search_type == SMITH_WATERMAN ) {
+        finished = ssa_ctx_sw_stream( ctx, query, bit_width, min_score, delivery, &collect_hit, &sd );
+    }
+    else {
+        finished = ssa_ctx_nw_stream( ctx, query, bit_width, min_score, delivery, &collect_hit, &sd );
+    }
+    ck_assert_int_eq( 1, finished );
+
+    size_t expected_count = 0;
+    for( size_t i = 0; i < db_count; i++ ) {
+        if( expected[i] >= min_score ) {
+            ck_assert_int_eq( expected[i], sd.scores[i] );
+            expected_count++;
+        }
+        else {
+            ck_assert_int_eq( INT32_MIN, sd.scores[i] );
+        }
+    }
+    ck_assert_int_eq( expected_count, sd.hit_count );
+
+    free( sd.scores );
+    free( expected );
+    pthread_mutex_destroy( &sd.mutex );
+
+    return sd;
+}
+
+START_TEST (test_stream_from_workers)
+    {
+        p_ssa_context ctx = create_stream_context( 3 );
+        p_query query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+
+        compare_stream( ctx, query, SMITH_WATERMAN, BIT_WIDTH_16, 40, STREAM_FROM_WORKERS );
+        compare_stream( ctx, query, SMITH_WATERMAN, BIT_WIDTH_8, 40, STREAM_FROM_WORKERS );
+        compare_stream( ctx, query, NEEDLEMAN_WUNSCH, BIT_WIDTH_16, -200, STREAM_FROM_WORKERS );
+
+        free_sequence( query );
+        ssa_ctx_free( ctx );
+        ssa_exit();
+    }END_TEST
+
+START_TEST (test_stream_from_caller)
+    {
+        p_ssa_context ctx = create_stream_context( 3 );
+        p_query query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+
+        // more hits than fit into the ring buffers
+        stream_data_t sd = compare_stream( ctx, query, SMITH_WATERMAN, BIT_WIDTH_16, LONG_MIN,
+                STREAM_FROM_CALLER );
+        ck_assert_int_eq( ssa_db_get_sequence_count(), sd.hit_count );
+        ck_assert_int_eq( 0, sd.other_thread );
+
+        sd = compare_stream( ctx, query, NEEDLEMAN_WUNSCH, BIT_WIDTH_8, -200, STREAM_FROM_CALLER );
+        ck_assert_int_eq( 0, sd.other_thread );
+
+        free_sequence( query );
+        ssa_ctx_free( ctx );
+        ssa_exit();
+    }END_TEST
+
+START_TEST (test_stream_bound_pruning)
+    {
+        p_ssa_context ctx = create_stream_context( 2 );
+        p_query query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+
+        ssa_ctx_set_bound_pruning( ctx, 1 );
+
+        // a sequence of the database as query: the shorter sequences cannot reach its own score
+        p_seqinfo info = ctx_db_get_sequence( 100 );
+        p_query db_query = create_db_query( ctx, 100 );
+
+        compare_stream( ctx, db_query, SMITH_WATERMAN, BIT_WIDTH_16, 5 * info->seqlen, STREAM_FROM_CALLER );
+        ck_assert_int_gt( ssa_ctx_get_pruned_sequence_count( ctx ), 0 );
+
+        free_sequence( db_query );
+
+        // the minimum score retires the channels of the kernels
+        compare_stream( ctx, query, SMITH_WATERMAN, BIT_WIDTH_8, 80, STREAM_FROM_WORKERS );
+        compare_stream( ctx, query, NEEDLEMAN_WUNSCH, BIT_WIDTH_16, -100, STREAM_FROM_WORKERS );
+
+        free_sequence( query );
+        ssa_ctx_free( ctx );
+        ssa_exit();
+    }END_TEST
+
+void addHitStreamTC( Suite *s ) {
+    TCase *tc_core = tcase_create( "hit_stream" );
+    tcase_add_test( tc_core, test_stream_from_workers );
+    tcase_add_test( tc_core, test_stream_from_caller );
+    tcase_add_test( tc_core, test_stream_bound_pruning );
+
+    suite_add_tcase( s, tc_core );
+}
@@ -0,0 +1,185 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#include "../tests.h"
+
+#include "../../src/libssa.h"
+#include "../../src/context.h"
+#include "../../src/util/util.h"
+
+static p_seqinfo db_copy;
+static size_t db_copy_count;
+
+/*
+ * Copies the sequences of the external database, so that a context can search
+ * a growing part of them.
+ */
+static p_ssa_context init_incremental_test( p_query * query ) {
+    set_thread_count( 2 );
+
+    init_db( "tests/testdata/AF091148.fas" );
+
+    db_copy_count = ctx_db_get_sequence_count();
+    db_copy = xmalloc( db_copy_count * sizeof(seqinfo_t) );
+    for( size_t i = 0; i < db_copy_count; i++ ) {
+        db_copy[i] = *ctx_db_get_sequence( i );
+    }
+
+    p_ssa_context ctx = create_test_context( NUCLEOTIDE );
+    ssa_ctx_set_chunk_size( ctx, 100 );
+
+    *query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+
+    return ctx;
+}
+
+static void exit_incremental_test( p_ssa_context ctx, p_query query ) {
+    free_sequence( query );
+    ssa_ctx_free( ctx );
+    free( db_copy );
+    ssa_exit();
+}
+
+static void compare_scores( p_alignment_list expected, p_alignment_list alist ) {
+    ck_assert_int_eq( expected->len, alist->len );
+
+    for( size_t i = 0; i < expected->len; i++ ) {
+        ck_assert_int_eq( expected->alignments[i]->score, alist->alignments[i]->score );
+    }
+}
+
+static void check_incremental( int search_type, int bit_width, int align_type ) {
+    p_query query;
+    p_ssa_context ctx = init_incremental_test( &query );
+
+    size_t first_part = db_copy_count / 2;
+    size_t db_end = 0;
+
+    ssa_ctx_init_db( ctx, db_copy, first_part );
+
+    p_alignment_list previous;
+    if( search_type == SMITH_WATERMAN ) {
+        previous = ssa_ctx_sw_align_incremental( ctx, query, 0, &db_end, 10, bit_width, align_type );
+    }
+    else {
+        previous = ssa_ctx_nw_align_incremental( ctx, query, 0, &db_end, 10, bit_width, align_type );
+    }
+    ck_assert_int_eq( first_part, db_end );
+
+    // append the remaining sequences
+    ssa_ctx_init_db( ctx, db_copy, db_copy_count );
+
+    p_alignment_list alist;
+    p_alignment_list expected;
+    if( search_type == SMITH_WATERMAN ) {
+        alist = ssa_ctx_sw_align_incremental( ctx, query, previous, &db_end, 10, bit_width, align_type );
+        expected = ssa_ctx_sw_align( ctx, query, 10, bit_width, align_type );
+    }
+    else {
+        alist = ssa_ctx_nw_align_incremental( ctx, query, previous, &db_end, 10, bit_width, align_type );
+        expected = ssa_ctx_nw_align( ctx, query, 10, bit_width, align_type );
+    }
+    ck_assert_int_eq( db_copy_count, db_end );
+
+    compare_scores( expected, alist );
+
+    // without new sequences, the previous result is returned again
+    p_alignment_list unchanged;
+    if( search_type == SMITH_WATERMAN ) {
+        unchanged = ssa_ctx_sw_align_incremental( ctx, query, alist, &db_end, 10, bit_width, align_type );
+    }
+    else {
+        unchanged = ssa_ctx_nw_align_incremental( ctx, query, alist, &db_end, 10, bit_width, align_type );
+    }
+    ck_assert_int_eq( db_copy_count, db_end );
+
+    compare_scores( expected, unchanged );
+    for( size_t i = 0; i < alist->len; i++ ) {
+        ck_assert_int_eq( alist->alignments[i]->db_seq.ID, unchanged->alignments[i]->db_seq.ID );
+        ck_assert_int_eq( alist->alignments[i]->db_seq.strand, unchanged->alignments[i]->db_seq.strand );
+        ck_assert_int_eq( alist->alignments[i]->query.strand, unchanged->alignments[i]->query.strand );
+    }
+
+    free_alignment( previous );
+    free_alignment( alist );
+    free_alignment( expected );
+    free_alignment( unchanged );
+
+    exit_incremental_test( ctx, query );
+}
+
+START_TEST (test_incremental_sw_score)
+    {
+        check_incremental( SMITH_WATERMAN, BIT_WIDTH_16, COMPUTE_SCORE );
+    }END_TEST
+
+START_TEST (test_incremental_sw_alignment)
+    {
+        check_incremental( SMITH_WATERMAN, BIT_WIDTH_8, COMPUTE_ALIGNMENT );
+    }END_TEST
+
+START_TEST (test_incremental_nw_64)
+    {
+        check_incremental( NEEDLEMAN_WUNSCH, BIT_WIDTH_64, COMPUTE_ALIGNMENT );
+    }END_TEST
+
+START_TEST (test_incremental_budget)
+    {
+        p_query query;
+        p_ssa_context ctx = init_incremental_test( &query );
+        ssa_ctx_init_db( ctx, db_copy, db_copy_count );
+
+        size_t db_end = 0;
+
+        // the budget stops the search after the first chunks
+        ssa_ctx_set_search_budget( ctx, 0, 200 );
+        p_alignment_list partial = ssa_ctx_sw_align_incremental( ctx, query, 0, &db_end, 10, BIT_WIDTH_16,
+                COMPUTE_SCORE );
+        ck_assert_int_eq( 1, partial->partial );
+        ck_assert_int_eq( 0, db_end );
+
+        // the next call searches the skipped sequences
+        ssa_ctx_set_search_budget( ctx, 0, 0 );
+        p_alignment_list alist = ssa_ctx_sw_align_incremental( ctx, query, partial, &db_end, 10, BIT_WIDTH_16,
+                COMPUTE_SCORE );
+        ck_assert_int_eq( 0, alist->partial );
+        ck_assert_int_eq( db_copy_count, db_end );
+
+        p_alignment_list expected = ssa_ctx_sw_align( ctx, query, 10, BIT_WIDTH_16, COMPUTE_SCORE );
+        compare_scores( expected, alist );
+        for( size_t i = 0; i < alist->len; i++ ) {
+            ck_assert_int_eq( expected->alignments[i]->db_seq.ID, alist->alignments[i]->db_seq.ID );
+        }
+
+        free_alignment( partial );
+        free_alignment( alist );
+        free_alignment( expected );
+
+        exit_incremental_test( ctx, query );
+    }END_TEST
+
+void addIncrementalTC( Suite *s ) {
+    TCase *tc_core = tcase_create( "incremental" );
+    tcase_add_test( tc_core, test_incremental_sw_score );
+    tcase_add_test( tc_core, test_incremental_sw_alignment );
+    tcase_add_test( tc_core, test_incremental_nw_64 );
+    tcase_add_test( tc_core, test_incremental_budget );
+
+    suite_add_tcase( s, tc_core );
+}
@@ -0,0 +1,154 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#include "../tests.h"
+
+#include <string.h>
+
+#include "../../src/libssa.h"
+
+#define PAIR_COUNT 6
+
+static char * query_1 = "ATGCCCAAGCTGAATAGCGTAGAGGGGTTTTCATCATTTGAGGACGATGTATAA";
+static char * query_2 = "GTCGAGTCGAGCGAAGATGAGCTTC";
+
+static char * targets[PAIR_COUNT] = {
+        "ATGCCCAAGCTGAATAGCGTAGAGGGGTTTTCATCATTTGAGGACGATGTATAA",
+        "GTCGAGTCGAGCGAAGATGAGCTTC",
+        "ATGCCCAAGCTGAATAGCGTAGAGGGTTTTCATCATTTGAGGACGATGTATAA",
+        "TTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTTT",
+        "GTCGAGTCGAGCGAAGATGAGCTTCGTCGAGTCGAGCGAAGATGAGCTTC",
+        "ACGT" };
+
+static p_query queries[2];
+
+static void init_pair_test( align_pair_t * pairs ) {
+    init_constant_scores( 5, -4 );
+    init_gap_penalties( -4, -2 );
+    init_symbol_translation( NUCLEOTIDE, FORWARD_STRAND, 3, 3 );
+
+    queries[0] = init_sequence_fasta( READ_FROM_STRING, query_1 );
+    queries[1] = init_sequence_fasta( READ_FROM_STRING, query_2 );
+
+    for( int i = 0; i < PAIR_COUNT; i++ ) {
+        // alternate the queries, to test the grouping
+        pairs[i].query = queries[(i % 2)];
+        pairs[i].target = targets[i];
+        pairs[i].target_len = strlen( targets[i] );
+    }
+}
+
+static void exit_pair_test() {
+    free_sequence( queries[0] );
+    free_sequence( queries[1] );
+    ssa_exit();
+}
+
+static void compare_bit_widths( p_alignment_list (*align_func)( p_align_pair, size_t, int, int ) ) {
+    align_pair_t pairs[PAIR_COUNT];
+    init_pair_test( pairs );
+
+    p_alignment_list alist_64 = align_func( pairs, PAIR_COUNT, BIT_WIDTH_64, COMPUTE_SCORE );
+    p_alignment_list alist_16 = align_func( pairs, PAIR_COUNT, BIT_WIDTH_16, COMPUTE_SCORE );
+    p_alignment_list alist_8 = align_func( pairs, PAIR_COUNT, BIT_WIDTH_8, COMPUTE_SCORE );
+
+    ck_assert_int_eq( PAIR_COUNT, alist_64->len );
+    ck_assert_int_eq( PAIR_COUNT, alist_16->len );
+    ck_assert_int_eq( PAIR_COUNT, alist_8->len );
+
+    for( int i = 0; i < PAIR_COUNT; i++ ) {
+        ck_assert_int_eq( i, alist_64->alignments[i]->db_seq.ID );
+        ck_assert_int_eq( i, alist_8->alignments[i]->db_seq.ID );
+        ck_assert_ptr_eq( pairs[i].query->nt[0].seq, alist_8->alignments[i]->query.seq );
+
+        ck_assert_int_eq( alist_64->alignments[i]->score, alist_16->alignments[i]->score );
+        ck_assert_int_eq( alist_64->alignments[i]->score, alist_8->alignments[i]->score );
+    }
+
+    free_alignment( alist_64 );
+    free_alignment( alist_16 );
+    free_alignment( alist_8 );
+
+    exit_pair_test();
+}
+
+START_TEST (test_pairs_sw)
+    {
+        compare_bit_widths( &sw_align_pairs );
+    }END_TEST
+
+START_TEST (test_pairs_nw)
+    {
+        compare_bit_widths( &nw_align_pairs );
+    }END_TEST
+
+START_TEST (test_pairs_identical)
+    {
+        align_pair_t pairs[PAIR_COUNT];
+        init_pair_test( pairs );
+
+        p_alignment_list alist = sw_align_pairs( pairs, 2, BIT_WIDTH_8, COMPUTE_ALIGNMENT );
+
+        ck_assert_int_eq( 2, alist->len );
+
+        ck_assert_int_eq( 5 * strlen( query_1 ), alist->alignments[0]->score );
+        ck_assert_str_eq( "54M", alist->alignments[0]->alignment );
+        ck_assert_int_eq( 5 * strlen( query_2 ), alist->alignments[1]->score );
+        ck_assert_str_eq( "25M", alist->alignments[1]->alignment );
+
+        free_alignment( alist );
+
+        exit_pair_test();
+    }END_TEST
+
+START_TEST (test_pairs_empty_target)
+    {
+        align_pair_t pairs[PAIR_COUNT];
+        init_pair_test( pairs );
+
+        pairs[0].target = "";
+        pairs[0].target_len = 0;
+
+        p_alignment_list alist = nw_align_pairs( pairs, 2, BIT_WIDTH_16, COMPUTE_SCORE );
+
+        // a single gap over the whole query
+        ck_assert_int_eq( -4 - 2 * (long) strlen( query_1 ), alist->alignments[0]->score );
+        ck_assert_int_eq( 5 * strlen( query_2 ), alist->alignments[1]->score );
+
+        free_alignment( alist );
+
+        alist = sw_align_pairs( pairs, 2, BIT_WIDTH_16, COMPUTE_SCORE );
+
+        ck_assert_int_eq( 0, alist->alignments[0]->score );
+        ck_assert_int_eq( 5 * strlen( query_2 ), alist->alignments[1]->score );
+
+        free_alignment( alist );
+
+        exit_pair_test();
+    }END_TEST
+
+void addPairAlignerTC( Suite *s ) {
+    TCase *tc_core = tcase_create( "pair_aligner" );
+    tcase_add_test( tc_core, test_pairs_sw );
+    tcase_add_test( tc_core, test_pairs_nw );
+    tcase_add_test( tc_core, test_pairs_identical );
+    tcase_add_test( tc_core, test_pairs_empty_target );
+
+    suite_add_tcase( s, tc_core );
+}
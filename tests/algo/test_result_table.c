@@ -0,0 +1,273 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+
+#include "../tests.h"
+
+#include <string.h>
+
+#include "../../src/libssa.h"
+#include "../../src/util/util.h"
+
+static p_alignment find_alignment( p_alignment_list alist, size_t id ) {
+    for( size_t i = 0; i < alist->len; i++ ) {
+        if( alist->alignments[i]->db_seq.ID == id ) {
+            return alist->alignments[i];
+        }
+    }
+    return 0;
+}
+
+/*
+ * The table has to hold the same hits as the alignment list of the same
+ * search.
+ */
+static void compare_with_list( p_ssa_context ctx, p_query query, int search_type, size_t hit_count,
+        int align_type ) {
+    p_alignment_list alist;
+    p_ssa_result_table table;
+
+    if( search_type == SMITH_WATERMAN ) {
+        alist = ssa_ctx_sw_align( ctx, query, hit_count, BIT_WIDTH_16, align_type );
+        table = ssa_ctx_sw_align_table( ctx, query, hit_count, BIT_WIDTH_16, align_type );
+    }
+    else {
+        alist = ssa_ctx_nw_align( ctx, query, hit_count, BIT_WIDTH_16, align_type );
+        table = ssa_ctx_nw_align_table( ctx, query, hit_count, BIT_WIDTH_16, align_type );
+    }
+
+    ck_assert_int_eq( alist->len, table->len );
+    ck_assert_int_eq( 0, table->partial );
+
+    for( size_t i = 0; i < alist->len; i++ ) {
+        ck_assert_int_eq( alist->alignments[i]->score, table->scores[i] );
+
+        // the threads can select different hits with the lowest score
+        p_alignment a = find_alignment( alist, table->db_ids[i] );
+        if( !a ) {
+            ck_assert_int_eq( alist->alignments[alist->len - 1]->score, table->scores[i] );
+            continue;
+        }
+
+        ck_assert_int_eq( a->score, table->scores[i] );
+        ck_assert_int_eq( a->query.strand, table->q_strands[i] );
+
+        size_t len;
+        char * seq = ssa_result_get_db_sequence( table, i, &len );
+        ck_assert_int_eq( a->db_seq.len, len );
+        ck_assert( !memcmp( a->db_seq.seq, seq, len ) );
+        free( seq );
+
+        if( align_type == COMPUTE_SCORE ) {
+            ck_assert_int_eq( SSA_NO_CIGAR, table->cigar_offsets[i] );
+            continue;
+        }
+
+        ck_assert_int_eq( a->align_q_start, table->q_starts[i] );
+        ck_assert_int_eq( a->align_q_end, table->q_ends[i] );
+        ck_assert_int_eq( a->align_d_start, table->d_starts[i] );
+        ck_assert_int_eq( a->align_d_end, table->d_ends[i] );
+
+        ck_assert_int_ne( SSA_NO_CIGAR, table->cigar_offsets[i] );
+        ck_assert_int_eq( a->alignment_len, table->cigar_lengths[i] );
+        ck_assert( !memcmp( a->alignment, table->cigar_pool + table->cigar_offsets[i], a->alignment_len ) );
+        ck_assert_int_eq( 0, table->cigar_pool[table->cigar_offsets[i] + a->alignment_len] );
+    }
+
+    ssa_result_free( table );
+    free_alignment( alist );
+}
+
+START_TEST (test_result_table_scores)
+    {
+        p_ssa_context ctx = create_test_db_context( 2, "tests/testdata/AF091148.fas", NUCLEOTIDE );
+        p_query query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+
+        compare_with_list( ctx, query, SMITH_WATERMAN, 20, COMPUTE_SCORE );
+        compare_with_list( ctx, query, NEEDLEMAN_WUNSCH, 20, COMPUTE_SCORE );
+
+        free_sequence( query );
+        ssa_ctx_free( ctx );
+        ssa_exit();
+    }END_TEST
+
+START_TEST (test_result_table_alignments)
+    {
+        p_ssa_context ctx = create_test_db_context( 3, "tests/testdata/AF091148.fas", NUCLEOTIDE );
+        p_query query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+
+        compare_with_list( ctx, query, SMITH_WATERMAN, 50, COMPUTE_ALIGNMENT );
+        compare_with_list( ctx, query, NEEDLEMAN_WUNSCH, 10, COMPUTE_ALIGNMENT );
+
+        free_sequence( query );
+        ssa_ctx_free( ctx );
+        ssa_exit();
+    }END_TEST
+
+static void compare_row( p_alignment_list alist, p_ssa_result_table table, size_t row ) {
+    p_alignment a = find_alignment( alist, table->db_ids[row] );
+    if( !a ) {
+        return;
+    }
+
+    ck_assert_int_eq( a->align_q_start, table->q_starts[row] );
+    ck_assert_int_eq( a->align_d_end, table->d_ends[row] );
+    ck_assert_int_eq( a->alignment_len, table->cigar_lengths[row] );
+    ck_assert_str_eq( a->alignment, table->cigar_pool + table->cigar_offsets[row] );
+}
+
+START_TEST (test_result_table_lazy_alignments)
+    {
+        p_ssa_context ctx = create_test_db_context( 2, "tests/testdata/AF091148.fas", NUCLEOTIDE );
+        p_query query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+
+        p_alignment_list alist = ssa_ctx_sw_align( ctx, query, 30, BIT_WIDTH_16, COMPUTE_ALIGNMENT );
+        p_ssa_result_table table = ssa_ctx_sw_align_table( ctx, query, 30, BIT_WIDTH_16, COMPUTE_SCORE );
+        ck_assert_int_eq( 30, table->len );
+        ck_assert_int_eq( 0, table->cigar_pool_size );
+
+        // a single row
+        ssa_result_compute_alignment( table, 3 );
+        compare_row( alist, table, 3 );
+        ck_assert_int_eq( SSA_NO_CIGAR, table->cigar_offsets[2] );
+        ck_assert_int_eq( SSA_NO_CIGAR, table->cigar_offsets[4] );
+
+        size_t pool_size = table->cigar_pool_size;
+        ssa_result_compute_alignment( table, 3 );
+        ck_assert_int_eq( pool_size, table->cigar_pool_size );
+
+        // the first page
+        ssa_result_compute_alignments( table, 0, 10 );
+        for( size_t i = 0; i < 10; i++ ) {
+            compare_row( alist, table, i );
+        }
+        ck_assert_int_eq( SSA_NO_CIGAR, table->cigar_offsets[10] );
+
+        // the rest in the background, the range is limited to the table
+        ssa_result_compute_alignments_async( table, 10, 100 );
+        ck_assert_int_eq( alist->alignments[29]->score, table->scores[29] );
+        ssa_result_wait( table );
+
+        for( size_t i = 0; i < table->len; i++ ) {
+            compare_row( alist, table, i );
+        }
+
+        // the table can be released, while alignments are computed
+        ssa_result_compute_alignments_async( table, 0, 30 );
+        ssa_result_free( table );
+
+        free_alignment( alist );
+
+        free_sequence( query );
+        ssa_ctx_free( ctx );
+        ssa_exit();
+    }END_TEST
+
+START_TEST (test_result_table_snapshot)
+    {
+        set_thread_count( 2 );
+
+        p_ssa_database db = ssa_database_create();
+        ssa_database_load( db, "tests/testdata/AF091148.fas" );
+
+        p_ssa_context ctx = create_test_context( NUCLEOTIDE );
+        ssa_ctx_use_database( ctx, db );
+
+        p_query query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+
+        p_alignment_list alist = ssa_ctx_sw_align( ctx, query, 20, BIT_WIDTH_16, COMPUTE_ALIGNMENT );
+        p_ssa_result_table table = ssa_ctx_sw_align_table( ctx, query, 20, BIT_WIDTH_16, COMPUTE_SCORE );
+
+        // the table keeps the version of the search
+        ssa_database_load( db, "tests/testdata/AF091148_selection.fas" );
+
+        for( size_t i = 0; i < table->len; i++ ) {
+            p_alignment a = find_alignment( alist, table->db_ids[i] );
+            if( !a ) {
+                continue;
+            }
+
+            size_t len;
+            char * seq = ssa_result_get_db_sequence( table, i, &len );
+            ck_assert_int_eq( a->db_seq.len, len );
+            ck_assert( !memcmp( a->db_seq.seq, seq, len ) );
+            free( seq );
+        }
+
+        ssa_result_compute_alignment( table, 0 );
+        compare_row( alist, table, 0 );
+
+        ssa_result_compute_alignments( table, 1, 9 );
+        ssa_result_compute_alignments_async( table, 10, 10 );
+        ssa_result_wait( table );
+        for( size_t i = 0; i < table->len; i++ ) {
+            compare_row( alist, table, i );
+        }
+
+        ssa_result_free( table );
+        free_alignment( alist );
+
+        free_sequence( query );
+        ssa_ctx_free( ctx );
+        ssa_database_free( db );
+        ssa_exit();
+    }END_TEST
+
+START_TEST (test_result_table_search_while_aligning)
+    {
+        p_ssa_context ctx = create_test_db_context( 2, "tests/testdata/AF091148.fas", NUCLEOTIDE );
+        p_query query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+
+        p_alignment_list alist = ssa_ctx_sw_align( ctx, query, 50, BIT_WIDTH_16, COMPUTE_ALIGNMENT );
+        p_ssa_result_table table = ssa_ctx_sw_align_table( ctx, query, 50, BIT_WIDTH_16, COMPUTE_SCORE );
+
+        // the context searches again, while the alignments of its table are computed
+        ssa_result_compute_alignments_async( table, 0, table->len );
+
+        for( int i = 0; i < 3; i++ ) {
+            p_alignment_list again = ssa_ctx_sw_align( ctx, query, 50, BIT_WIDTH_16, COMPUTE_ALIGNMENT );
+            ck_assert_int_eq( alist->len, again->len );
+            ck_assert_int_eq( alist->alignments[0]->score, again->alignments[0]->score );
+            free_alignment( again );
+        }
+
+        ssa_result_wait( table );
+        for( size_t i = 0; i < table->len; i++ ) {
+            ck_assert_int_ne( SSA_NO_CIGAR, table->cigar_offsets[i] );
+            compare_row( alist, table, i );
+        }
+
+        ssa_result_free( table );
+        free_alignment( alist );
+
+        free_sequence( query );
+        ssa_ctx_free( ctx );
+        ssa_exit();
+    }END_TEST
+
+void addResultTableTC( Suite *s ) {
+    TCase *tc_core = tcase_create( "result_table" );
+    tcase_add_test( tc_core, test_result_table_scores );
+    tcase_add_test( tc_core, test_result_table_alignments );
+    tcase_add_test( tc_core, test_result_table_lazy_alignments );
+    tcase_add_test( tc_core, test_result_table_snapshot );
+    tcase_add_test( tc_core, test_result_table_search_while_aligning );
+
+    suite_add_tcase( s, tc_core );
+}
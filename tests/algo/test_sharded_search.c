@@ -0,0 +1,207 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#include "../tests.h"
+
+#include <string.h>
+
+#include "../../src/libssa.h"
+
+static p_query init_sharded_test() {
+    init_constant_scores( 5, -4 );
+    init_gap_penalties( -4, -2 );
+    init_symbol_translation( NUCLEOTIDE, FORWARD_STRAND, 3, 3 );
+
+    set_thread_count( 2 );
+    set_chunk_size( 100 );
+
+    init_db( "tests/testdata/AF091148.fas" );
+
+    return init_sequence_fasta( READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+}
+
+static void exit_sharded_test( p_query query ) {
+    set_search_range( 0, 0 );
+    set_chunk_size( 1000 );
+
+    free_sequence( query );
+    ssa_exit();
+}
+
+/*
+ * Searches the whole database and orders the result like a merged list.
+ */
+static p_alignment_list full_search( p_query query, size_t hit_count, int align_type ) {
+    p_alignment_list alist = sw_align( query, hit_count, BIT_WIDTH_16, align_type );
+
+    return merge_alignment_lists( &alist, 1, hit_count );
+}
+
+static void compare_lists( p_alignment_list expected, p_alignment_list actual ) {
+    ck_assert_int_eq( expected->len, actual->len );
+
+    for( size_t i = 0; i < expected->len; i++ ) {
+        ck_assert_int_eq( expected->alignments[i]->score, actual->alignments[i]->score );
+        ck_assert_int_eq( expected->alignments[i]->db_seq.ID, actual->alignments[i]->db_seq.ID );
+        ck_assert_int_eq( expected->alignments[i]->db_seq.len, actual->alignments[i]->db_seq.len );
+    }
+}
+
+START_TEST (test_search_range)
+    {
+        p_query query = init_sharded_test();
+
+        size_t count = ssa_db_get_sequence_count();
+
+        // with all sequences as hits, equal scores can not lead to different hits
+        p_alignment_list expected = full_search( query, count, COMPUTE_SCORE );
+
+        p_alignment_list lists[3];
+        size_t bounds[4] = { 0, count / 3, count / 2, 0 };
+
+        for( int i = 0; i < 3; i++ ) {
+            set_search_range( bounds[i], bounds[i + 1] );
+
+            lists[i] = sw_align( query, count, BIT_WIDTH_16, COMPUTE_SCORE );
+
+            size_t end = bounds[i + 1] ? bounds[i + 1] : count;
+            ck_assert_int_eq( end - bounds[i], lists[i]->len );
+
+            for( size_t j = 0; j < lists[i]->len; j++ ) {
+                ck_assert_int_ge( lists[i]->alignments[j]->db_seq.ID, bounds[i] );
+                ck_assert_int_lt( lists[i]->alignments[j]->db_seq.ID, end );
+            }
+        }
+
+        p_alignment_list merged = merge_alignment_lists( lists, 3, count );
+        ck_assert_ptr_eq( 0, lists[0] );
+
+        compare_lists( expected, merged );
+
+        free_alignment( merged );
+        free_alignment( expected );
+
+        exit_sharded_test( query );
+    }END_TEST
+
+START_TEST (test_merge_top_k)
+    {
+        p_query query = init_sharded_test();
+
+        size_t count = ssa_db_get_sequence_count();
+
+        p_alignment_list lists[2];
+        set_search_range( 0, count / 2 );
+        lists[0] = sw_align( query, 10, BIT_WIDTH_16, COMPUTE_SCORE );
+        set_search_range( count / 2, 0 );
+        lists[1] = sw_align( query, 10, BIT_WIDTH_16, COMPUTE_SCORE );
+        set_search_range( 0, 0 );
+
+        p_alignment_list merged = merge_alignment_lists( lists, 2, 10 );
+        p_alignment_list expected = sw_align( query, 10, BIT_WIDTH_16, COMPUTE_SCORE );
+
+        ck_assert_int_eq( 10, merged->len );
+        for( size_t i = 0; i < merged->len; i++ ) {
+            ck_assert_int_eq( expected->alignments[i]->score, merged->alignments[i]->score );
+
+            if( i && (merged->alignments[i - 1]->score == merged->alignments[i]->score) ) {
+                ck_assert_int_lt( merged->alignments[i - 1]->db_seq.ID, merged->alignments[i]->db_seq.ID );
+            }
+        }
+
+        free_alignment( merged );
+        free_alignment( expected );
+
+        exit_sharded_test( query );
+    }END_TEST
+
+START_TEST (test_sharded_search)
+    {
+        p_query query = init_sharded_test();
+
+        size_t count = ssa_db_get_sequence_count();
+
+        p_alignment_list expected = full_search( query, count, COMPUTE_SCORE );
+        p_alignment_list sharded = sw_align_sharded( query, count, BIT_WIDTH_16, COMPUTE_SCORE, 3 );
+
+        compare_lists( expected, sharded );
+
+        free_alignment( sharded );
+        free_alignment( expected );
+
+        // the alignments are sent back to the coordinator
+        expected = sw_align( query, 5, BIT_WIDTH_16, COMPUTE_ALIGNMENT );
+        sharded = sw_align_sharded( query, 5, BIT_WIDTH_16, COMPUTE_ALIGNMENT, 2 );
+
+        ck_assert_int_eq( 5, sharded->len );
+        for( size_t i = 0; i < sharded->len; i++ ) {
+            ck_assert_int_eq( expected->alignments[i]->score, sharded->alignments[i]->score );
+            ck_assert_ptr_ne( 0, sharded->alignments[i]->alignment );
+            ck_assert_int_eq( expected->alignments[0]->query.len, sharded->alignments[i]->query.len );
+            ck_assert_int_eq( 0, memcmp( expected->alignments[0]->query.seq, sharded->alignments[i]->query.seq,
+                    sharded->alignments[i]->query.len ) );
+        }
+
+        free_alignment( sharded );
+        free_alignment( expected );
+
+        exit_sharded_test( query );
+    }END_TEST
+
+START_TEST (test_more_shards_than_sequences)
+    {
+        p_query query = init_sharded_test();
+
+        // no shard may be empty, it would search the whole database
+        set_search_range( 0, 1 );
+        p_alignment_list sharded = sw_align_sharded( query, 10, BIT_WIDTH_16, COMPUTE_SCORE, 2 );
+
+        ck_assert_int_eq( 1, sharded->len );
+        ck_assert_int_eq( 0, sharded->alignments[0]->db_seq.ID );
+
+        free_alignment( sharded );
+
+        // the hits of overlapping ranges are merged once
+        p_alignment_list lists[2];
+        set_search_range( 0, 20 );
+        lists[0] = sw_align( query, 20, BIT_WIDTH_16, COMPUTE_SCORE );
+        set_search_range( 10, 30 );
+        lists[1] = sw_align( query, 20, BIT_WIDTH_16, COMPUTE_SCORE );
+
+        p_alignment_list merged = merge_alignment_lists( lists, 2, 100 );
+        ck_assert_int_eq( 30, merged->len );
+        for( size_t i = 1; i < merged->len; i++ ) {
+            ck_assert( (merged->alignments[i - 1]->score != merged->alignments[i]->score)
+                    || (merged->alignments[i - 1]->db_seq.ID != merged->alignments[i]->db_seq.ID) );
+        }
+
+        free_alignment( merged );
+
+        exit_sharded_test( query );
+    }END_TEST
+
+void addShardedSearchTC( Suite *s ) {
+    TCase *tc_core = tcase_create( "sharded_search" );
+    tcase_add_test( tc_core, test_search_range );
+    tcase_add_test( tc_core, test_merge_top_k );
+    tcase_add_test( tc_core, test_sharded_search );
+    tcase_add_test( tc_core, test_more_shards_than_sequences );
+
+    suite_add_tcase( s, tc_core );
+}
@@ -0,0 +1,158 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#include "../tests.h"
+
+#include "../../src/libssa.h"
+#include "../../src/context.h"
+
+#define UF_DB_SEQ_COUNT 1403
+#define UF_QUERY_ID 100
+
+START_TEST (test_ungapped_best_candidate)
+    {
+        p_ssa_context ctx = create_test_db_context( 2, "tests/testdata/AF091148.fas", NUCLEOTIDE );
+        p_query query = create_db_query( ctx, UF_QUERY_ID );
+
+        p_alignment_list exact = ssa_ctx_sw_align( ctx, query, 5, BIT_WIDTH_16, COMPUTE_SCORE );
+
+        // the query itself has the best ungapped score
+        ssa_ctx_set_ungapped_prefilter( ctx, -1, 1 );
+        p_alignment_list alist = ssa_ctx_sw_align( ctx, query, 5, BIT_WIDTH_16, COMPUTE_ALIGNMENT );
+
+        size_t sequences;
+        size_t candidates;
+        ssa_ctx_get_prefilter_stats( ctx, &sequences, &candidates );
+        ck_assert_int_eq( UF_DB_SEQ_COUNT, sequences );
+        ck_assert_int_eq( 1, candidates );
+
+        ck_assert_int_eq( 1, alist->len );
+        ck_assert_int_eq( UF_QUERY_ID, alist->alignments[0]->db_seq.ID );
+        ck_assert_int_eq( exact->alignments[0]->score, alist->alignments[0]->score );
+
+        free_alignment( alist );
+
+        // the best hits of the exact search are among the best ungapped candidates
+        ssa_ctx_set_ungapped_prefilter( ctx, -1, 50 );
+        alist = ssa_ctx_sw_align( ctx, query, 5, BIT_WIDTH_16, COMPUTE_SCORE );
+
+        ssa_ctx_get_prefilter_stats( ctx, &sequences, &candidates );
+        ck_assert_int_eq( 50, candidates );
+        ck_assert_int_eq( 5, alist->len );
+        ck_assert( alignment_list_recall( exact, alist ) > 0 );
+
+        free_alignment( alist );
+
+        // without a limit every sequence is a candidate
+        ssa_ctx_set_ungapped_prefilter( ctx, 0, 0 );
+        alist = ssa_ctx_sw_align( ctx, query, 5, BIT_WIDTH_16, COMPUTE_SCORE );
+
+        ssa_ctx_get_prefilter_stats( ctx, &sequences, &candidates );
+        ck_assert_int_eq( UF_DB_SEQ_COUNT, candidates );
+        ck_assert( alignment_list_recall( exact, alist ) == 1 );
+
+        free_alignment( alist );
+        free_alignment( exact );
+        free_sequence( query );
+        ssa_ctx_free( ctx );
+        ssa_exit();
+    }END_TEST
+
+START_TEST (test_ungapped_min_score)
+    {
+        p_ssa_context ctx = create_test_db_context( 2, "tests/testdata/AF091148.fas", NUCLEOTIDE );
+        p_query query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+
+        size_t sequences;
+        size_t candidates;
+
+        ssa_ctx_set_ungapped_prefilter( ctx, 40, 0 );
+        p_alignment_list alist = ssa_ctx_sw_align( ctx, query, 1000, BIT_WIDTH_16, COMPUTE_SCORE );
+
+        ssa_ctx_get_prefilter_stats( ctx, &sequences, &candidates );
+        size_t low_candidates = candidates;
+        ck_assert( low_candidates > 0 );
+        ck_assert( low_candidates < UF_DB_SEQ_COUNT );
+        ck_assert_int_eq( low_candidates, alist->len );
+
+        // the ungapped score is a lower bound of the gapped score
+        for( size_t i = 0; i < alist->len; i++ ) {
+            ck_assert( alist->alignments[i]->score >= 40 );
+        }
+
+        free_alignment( alist );
+
+        ssa_ctx_set_ungapped_prefilter( ctx, 50, 0 );
+        alist = ssa_ctx_sw_align( ctx, query, 1000, BIT_WIDTH_64, COMPUTE_SCORE );
+
+        ssa_ctx_get_prefilter_stats( ctx, &sequences, &candidates );
+        ck_assert( candidates > 0 );
+        ck_assert( candidates < low_candidates );
+        ck_assert_int_eq( candidates, alist->len );
+
+        for( size_t i = 0; i < alist->len; i++ ) {
+            ck_assert( alist->alignments[i]->score >= 50 );
+        }
+
+        free_alignment( alist );
+
+        // disabled again
+        ssa_ctx_set_ungapped_prefilter( ctx, -1, 0 );
+        alist = ssa_ctx_sw_align( ctx, query, 1000, BIT_WIDTH_16, COMPUTE_SCORE );
+        ck_assert_int_eq( 1000, alist->len );
+
+        free_alignment( alist );
+        free_sequence( query );
+        ssa_ctx_free( ctx );
+        ssa_exit();
+    }END_TEST
+
+START_TEST (test_ungapped_with_kmer_prefilter)
+    {
+        p_ssa_context ctx = create_test_db_context( 2, "tests/testdata/AF091148.fas", NUCLEOTIDE );
+        p_query query = create_db_query( ctx, UF_QUERY_ID );
+
+        // the ungapped prefilter ranks the candidates of the k-mer prefilter
+        ssa_ctx_set_kmer_prefilter( ctx, 0, 1, 20 );
+        ssa_ctx_set_ungapped_prefilter( ctx, -1, 5 );
+        p_alignment_list alist = ssa_ctx_sw_align( ctx, query, 5, BIT_WIDTH_8, COMPUTE_SCORE );
+
+        size_t sequences;
+        size_t candidates;
+        ssa_ctx_get_prefilter_stats( ctx, &sequences, &candidates );
+        ck_assert_int_eq( 20, sequences );
+        ck_assert_int_eq( 5, candidates );
+
+        ck_assert_int_eq( 5, alist->len );
+        ck_assert_int_eq( UF_QUERY_ID, alist->alignments[0]->db_seq.ID );
+
+        free_alignment( alist );
+        free_sequence( query );
+        ssa_ctx_free( ctx );
+        ssa_exit();
+    }END_TEST
+
+void addUngappedFilterTC( Suite *s ) {
+    TCase *tc_core = tcase_create( "ungapped_filter" );
+    tcase_add_test( tc_core, test_ungapped_best_candidate );
+    tcase_add_test( tc_core, test_ungapped_min_score );
+    tcase_add_test( tc_core, test_ungapped_with_kmer_prefilter );
+
+    suite_add_tcase( s, tc_core );
+}
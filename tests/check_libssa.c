@@ -56,7 +56,26 @@ Suite* libssa_suite( void ) {
     addSearcherTC( s );
     addAlignerTC( s );
     addManagerTC( s );
+    addBatcherTC( s );
+    addPairAlignerTC( s );
+    addAsyncSearchTC( s );
+    addAnytimeTC( s );
+    addShardedSearchTC( s );
+    addIncrementalTC( s );
+    addUngappedFilterTC( s );
+    addBoundPruningTC( s );
+    addDenseScoresTC( s );
+    addHitStreamTC( s );
+    addResultTableTC( s );
+    addAlignStatsTC( s );
+    addEditDistanceTC( s );
+    addBandedNWTC( s );
     addLibssaTC( s );
+    addContextTC( s );
+    addServerTC( s );
+    addDbSnapshotTC( s );
+    addDbDedupTC( s );
+    addKmerIndexTC( s );
     addBiggerDatabasesTC( s );
 
     return s;
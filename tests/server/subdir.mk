@@ -0,0 +1,4 @@
+TESTS += \
+./tests/server/test_server.o
+
+USR_OBJS +=
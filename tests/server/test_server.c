@@ -0,0 +1,226 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#define _POSIX_C_SOURCE 200809L // snprintf, getpid
+
+#include "../tests.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "../../src/libssa.h"
+#include "../../src/server/server.h"
+#include "../../src/util/util.h"
+
+#define CLIENT_COUNT 4
+#define HIT_COUNT 5
+
+static char * queries[CLIENT_COUNT] = {
+        ">q0\nATGCCCAAGCTGAATAGCGTAGAGGGGTTTTCATCATTTGAGGACGATGTATAA\n",
+        ">q1\nCTGAATAGCGTAGAGGGG\nTTTTCATCATTTGAGG\n",
+        ">q2\nGGGTTTTCATCATTTGAGGACGATG\n",
+        ">q3\nATGCCCAAGCTGAATAGCGTAG\n>q4\nCATTTGAGGACGATGTATAA\n" };
+
+static char socket_path[64];
+
+static void init_server_test() {
+    init_constant_scores( 5, -4 );
+    init_gap_penalties( -4, -2 );
+    init_symbol_translation( NUCLEOTIDE, FORWARD_STRAND, 3, 3 );
+
+    set_thread_count( 2 );
+
+    init_db( "tests/testdata/AF091148.fas" );
+
+    snprintf( socket_path, sizeof(socket_path), "/tmp/libssa_test_%d.sock", (int) getpid() );
+}
+
+static srv_params_t score_params() {
+    srv_params_t params = { SMITH_WATERMAN, HIT_COUNT, BIT_WIDTH_16, COMPUTE_SCORE };
+    return params;
+}
+
+/*
+ * Compares the scores of the response with a local batch search of the same
+ * queries.
+ */
+static void check_response( const char * response, char ** sequences, size_t count ) {
+    p_query q[count];
+    for( size_t i = 0; i < count; i++ ) {
+        q[i] = init_sequence_fasta( READ_FROM_STRING, sequences[i] );
+    }
+
+    p_alignment_list * expected = sw_align_batch( q, count, HIT_COUNT, BIT_WIDTH_16, COMPUTE_SCORE );
+
+    const char * line = response;
+    for( size_t i = 0; i < count; i++ ) {
+        long index;
+        long len;
+        ck_assert_int_eq( 2, sscanf( line, "QUERY %ld %ld", &index, &len ) );
+        ck_assert_int_eq( i, index );
+        ck_assert_int_eq( expected[i]->len, len );
+
+        for( size_t j = 0; j < len; j++ ) {
+            line = strchr( line, '\n' ) + 1;
+
+            long score;
+            ck_assert_int_eq( 1, sscanf( line, "%ld", &score ) );
+            ck_assert_int_eq( expected[i]->alignments[j]->score, score );
+        }
+        line = strchr( line, '\n' ) + 1;
+    }
+    ck_assert_str_eq( "DONE\n", line );
+
+    free_alignment_batch( expected, count );
+    for( size_t i = 0; i < count; i++ ) {
+        free_sequence( q[i] );
+    }
+}
+
+START_TEST (test_parse_header)
+    {
+        srv_params_t params;
+
+        ck_assert_int_eq( 1, srv_parse_header( "SEARCH NW 7 64 ALIGNMENT", &params ) );
+        ck_assert_int_eq( NEEDLEMAN_WUNSCH, params.search_type );
+        ck_assert_int_eq( 7, params.hit_count );
+        ck_assert_int_eq( BIT_WIDTH_64, params.bit_width );
+        ck_assert_int_eq( COMPUTE_ALIGNMENT, params.align_type );
+
+        char line[SRV_MAX_LINE_LENGTH];
+        srv_format_header( params, line, SRV_MAX_LINE_LENGTH );
+        ck_assert_str_eq( "SEARCH NW 7 64 ALIGNMENT", line );
+
+        ck_assert_int_eq( 0, srv_parse_header( "SEARCH XX 7 64 SCORE", &params ) );
+        ck_assert_int_eq( 0, srv_parse_header( "SEARCH SW 0 64 SCORE", &params ) );
+        ck_assert_int_eq( 0, srv_parse_header( "SEARCH SW 7 32 SCORE", &params ) );
+        ck_assert_int_eq( 0, srv_parse_header( "SEARCH SW 7 16", &params ) );
+    }END_TEST
+
+START_TEST (test_server_request)
+    {
+        init_server_test();
+
+        p_server server = srv_start( socket_path, 0, 0 );
+        ck_assert_ptr_ne( 0, server );
+
+        int fd = srv_connect( socket_path );
+        ck_assert_int_ge( fd, 0 );
+
+        // an invalid request does not close the connection
+        srv_params_t params = score_params();
+        params.bit_width = 12;
+        char * response = srv_request( fd, params, queries[0] );
+        ck_assert_int_eq( 0, strncmp( response, "ERROR", 5 ) );
+        free( response );
+
+        // malformed queries are rejected, without stopping the server
+        response = srv_request( fd, score_params(), ">bad\nACGT#ACGT\n" );
+        ck_assert_int_eq( 0, strncmp( response, "ERROR", 5 ) );
+        free( response );
+
+        response = srv_request( fd, score_params(), ">bad\nACGT\xff\n" );
+        ck_assert_int_eq( 0, strncmp( response, "ERROR", 5 ) );
+        free( response );
+
+        response = srv_request( fd, score_params(), queries[0] );
+        char * sequences[1] = { "ATGCCCAAGCTGAATAGCGTAGAGGGGTTTTCATCATTTGAGGACGATGTATAA" };
+        check_response( response, sequences, 1 );
+        free( response );
+
+        // several queries in one request
+        response = srv_request( fd, score_params(), queries[3] );
+        char * two_sequences[2] = { "ATGCCCAAGCTGAATAGCGTAG", "CATTTGAGGACGATGTATAA" };
+        check_response( response, two_sequences, 2 );
+        free( response );
+
+        close( fd );
+
+        srv_stop( server );
+        ck_assert_int_ne( 0, access( socket_path, F_OK ) );
+
+        ssa_exit();
+    }END_TEST
+
+typedef struct {
+    int index;
+    char * response;
+} client_job_t;
+
+static void * run_client( void * data ) {
+    client_job_t * job = data;
+
+    int fd = srv_connect( socket_path );
+    if( fd >= 0 ) {
+        job->response = srv_request( fd, score_params(), queries[job->index] );
+        close( fd );
+    }
+
+    return NULL;
+}
+
+START_TEST (test_server_coalescing)
+    {
+        init_server_test();
+
+        // wait long enough for all clients to queue their requests
+        p_server server = srv_start( socket_path, 0, 300 );
+        ck_assert_ptr_ne( 0, server );
+
+        pthread_t threads[CLIENT_COUNT];
+        client_job_t jobs[CLIENT_COUNT];
+
+        for( int i = 0; i < CLIENT_COUNT; i++ ) {
+            jobs[i].index = i;
+            jobs[i].response = 0;
+            pthread_create( &threads[i], NULL, run_client, &jobs[i] );
+        }
+        for( int i = 0; i < CLIENT_COUNT; i++ ) {
+            pthread_join( threads[i], NULL );
+        }
+
+        ck_assert_int_lt( srv_get_batch_count( server ), CLIENT_COUNT );
+
+        char * sequences[CLIENT_COUNT][2] = {
+                { "ATGCCCAAGCTGAATAGCGTAGAGGGGTTTTCATCATTTGAGGACGATGTATAA" },
+                { "CTGAATAGCGTAGAGGGGTTTTCATCATTTGAGG" },
+                { "GGGTTTTCATCATTTGAGGACGATG" },
+                { "ATGCCCAAGCTGAATAGCGTAG", "CATTTGAGGACGATGTATAA" } };
+
+        for( int i = 0; i < CLIENT_COUNT; i++ ) {
+            ck_assert_ptr_ne( 0, jobs[i].response );
+            check_response( jobs[i].response, sequences[i], (i == 3) ? 2 : 1 );
+            free( jobs[i].response );
+        }
+
+        srv_stop( server );
+
+        ssa_exit();
+    }END_TEST
+
+void addServerTC( Suite *s ) {
+    TCase *tc_core = tcase_create( "server" );
+    tcase_add_test( tc_core, test_parse_header );
+    tcase_add_test( tc_core, test_server_request );
+    tcase_add_test( tc_core, test_server_coalescing );
+
+    suite_add_tcase( s, tc_core );
+}
@@ -8,6 +8,10 @@ TESTS += \
 ./tests/test_matrices.o \
 ./tests/test_util.o \
 ./tests/test_libssa.o \
+./tests/test_context.o \
+./tests/test_db_snapshot.o \
+./tests/test_db_dedup.o \
+./tests/test_kmer_index.o \
 ./tests/test_cpu_config.o
 
 USR_OBJS += \
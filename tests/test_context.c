@@ -0,0 +1,202 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#include "tests.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#include "../src/libssa.h"
+#include "../src/context.h"
+#include "../src/util/util_sequence.h"
+#include "../src/algo/gap_costs.h"
+
+#define PROTEIN_DB_COUNT 4
+#define SEARCH_REPEATS 3
+
+static char * protein_strings[PROTEIN_DB_COUNT] = {
+        "MKTAYIAKQRQISFVKSHFSRQLEERLGLIEVQAPILSRVGDGTQDNLSGAEKAVQVKVKALPDAQ",
+        "MSTNPKPQRKTKRNTNRRPQDVKFPGGGQIVGGVYLLPRRGPRLGVRATRKTSERSQPRGRRQPIP",
+        "MKVLAAGIVGLLLAGCSSHKEEPVTPAQAAPAEVKETAKVEAAPAVAAPKAAEPAKAAVKAEAPK",
+        "GSHMASMTGGQQMGRDLYDDDDKDPSSRSAATMVSKGEELFTGVVPILVELDGDVNGHKFSVSGEG" };
+
+static seqinfo_t protein_db[PROTEIN_DB_COUNT];
+
+static void init_protein_db() {
+    for( size_t i = 0; i < PROTEIN_DB_COUNT; i++ ) {
+        protein_db[i].ID = i;
+        protein_db[i].seq = protein_strings[i];
+        protein_db[i].seqlen = strlen( protein_strings[i] );
+    }
+}
+
+static void init_default_context() {
+    init_constant_scores( 5, -4 );
+    init_gap_penalties( -4, -2 );
+    init_symbol_translation( NUCLEOTIDE, FORWARD_STRAND, 3, 3 );
+
+    set_thread_count( 2 );
+
+    init_db( "tests/testdata/AF091148.fas" );
+}
+
+static p_ssa_context create_protein_context() {
+    init_protein_db();
+
+    p_ssa_context ctx = ssa_ctx_create();
+    ssa_ctx_init_score_matrix( ctx, MATRIX_BUILDIN, BLOSUM62 );
+    ssa_ctx_init_gap_penalties( ctx, -11, -1 );
+    ssa_ctx_init_symbol_translation( ctx, AMINOACID, FORWARD_STRAND, 1, 1 );
+    ssa_ctx_init_db( ctx, protein_db, PROTEIN_DB_COUNT );
+
+    return ctx;
+}
+
+START_TEST (test_context_configuration)
+    {
+        init_default_context();
+
+        p_ssa_context ctx = create_protein_context();
+
+        ck_assert_int_eq( -4, gapO );
+        ck_assert_int_eq( -2, gapE );
+        ck_assert_int_eq( NUCLEOTIDE, symtype );
+
+        p_ssa_context prev = ctx_enter( ctx );
+
+        ck_assert_int_eq( -11, gapO );
+        ck_assert_int_eq( -1, gapE );
+        ck_assert_int_eq( AMINOACID, symtype );
+        ck_assert_int_eq( PROTEIN_DB_COUNT, ctx_db_get_sequence_count() );
+
+        ctx_leave( prev );
+
+        ck_assert_int_eq( -4, gapO );
+        ck_assert_int_ne( PROTEIN_DB_COUNT, ctx_db_get_sequence_count() );
+
+        ssa_ctx_free( ctx );
+        ssa_exit();
+    }END_TEST
+
+START_TEST (test_context_own_db)
+    {
+        init_default_context();
+
+        p_ssa_context ctx = create_protein_context();
+
+        p_query query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_STRING, protein_strings[2] );
+
+        p_alignment_list alist = ssa_ctx_sw_align( ctx, query, 2, BIT_WIDTH_16, COMPUTE_ALIGNMENT );
+
+        ck_assert_int_eq( 2, alist->len );
+        ck_assert_int_eq( 2, alist->alignments[0]->db_seq.ID );
+        ck_assert_int_gt( alist->alignments[0]->score, alist->alignments[1]->score );
+        ck_assert_int_eq( protein_db[2].seqlen, alist->alignments[0]->db_seq.len );
+
+        free_alignment( alist );
+        free_sequence( query );
+
+        ssa_ctx_free( ctx );
+        ssa_exit();
+    }END_TEST
+
+typedef struct {
+    p_ssa_context ctx;
+    p_query query;
+    int bit_width;
+    p_alignment_list results[SEARCH_REPEATS];
+} search_job_t;
+
+static void * run_search_job( void * data ) {
+    search_job_t * job = data;
+
+    for( int i = 0; i < SEARCH_REPEATS; i++ ) {
+        job->results[i] = ssa_ctx_sw_align( job->ctx, job->query, 5, job->bit_width, COMPUTE_SCORE );
+    }
+
+    return NULL;
+}
+
+/*
+ * With more than one thread, alignments with equal scores might be reported in
+ * a different order, therefore only the scores are compared.
+ */
+static void compare_alignment_lists( p_alignment_list expected, p_alignment_list actual ) {
+    ck_assert_int_eq( expected->len, actual->len );
+
+    for( size_t i = 0; i < expected->len; i++ ) {
+        ck_assert_int_eq( expected->alignments[i]->score, actual->alignments[i]->score );
+    }
+}
+
+START_TEST (test_concurrent_contexts)
+    {
+        init_default_context();
+
+        p_ssa_context nt_ctx = ssa_ctx_create();
+        ssa_ctx_init_constant_scores( nt_ctx, 5, -4 );
+        ssa_ctx_init_gap_penalties( nt_ctx, -4, -2 );
+        ssa_ctx_init_symbol_translation( nt_ctx, NUCLEOTIDE, FORWARD_STRAND, 3, 3 );
+        ssa_ctx_set_chunk_size( nt_ctx, 100 );
+
+        p_ssa_context aa_ctx = create_protein_context();
+
+        search_job_t jobs[2];
+        jobs[0].ctx = nt_ctx;
+        jobs[0].query = ssa_ctx_init_sequence_fasta( nt_ctx, READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+        jobs[0].bit_width = BIT_WIDTH_8;
+        jobs[1].ctx = aa_ctx;
+        jobs[1].query = ssa_ctx_init_sequence_fasta( aa_ctx, READ_FROM_STRING, protein_strings[0] );
+        jobs[1].bit_width = BIT_WIDTH_64;
+
+        p_alignment_list expected[2];
+        for( int j = 0; j < 2; j++ ) {
+            expected[j] = ssa_ctx_sw_align( jobs[j].ctx, jobs[j].query, 5, jobs[j].bit_width, COMPUTE_SCORE );
+        }
+
+        pthread_t threads[2];
+        for( int j = 0; j < 2; j++ ) {
+            pthread_create( &threads[j], NULL, run_search_job, &jobs[j] );
+        }
+        for( int j = 0; j < 2; j++ ) {
+            pthread_join( threads[j], NULL );
+        }
+
+        for( int j = 0; j < 2; j++ ) {
+            for( int i = 0; i < SEARCH_REPEATS; i++ ) {
+                compare_alignment_lists( expected[j], jobs[j].results[i] );
+                free_alignment( jobs[j].results[i] );
+            }
+            free_alignment( expected[j] );
+            free_sequence( jobs[j].query );
+        }
+
+        ssa_ctx_free( nt_ctx );
+        ssa_ctx_free( aa_ctx );
+        ssa_exit();
+    }END_TEST
+
+void addContextTC( Suite *s ) {
+    TCase *tc_core = tcase_create( "context" );
+    tcase_add_test( tc_core, test_context_configuration );
+    tcase_add_test( tc_core, test_context_own_db );
+    tcase_add_test( tc_core, test_concurrent_contexts );
+
+    suite_add_tcase( s, tc_core );
+}
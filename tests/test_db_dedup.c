@@ -0,0 +1,226 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#include "tests.h"
+
+#include <string.h>
+#include <ctype.h>
+
+#include "../src/libssa.h"
+#include "../src/context.h"
+#include "../src/db_dedup.h"
+#include "../src/util/util.h"
+
+#define COPIES 4
+
+static p_seqinfo dup_db;
+static size_t base_count;
+static size_t dup_count;
+
+/*
+ * Creates a database with COPIES copies of each sequence of the external
+ * database. The third copy is in lower case letters.
+ */
+static void init_dup_db() {
+    init_db( "tests/testdata/AF091148_selection.fas" );
+
+    base_count = ctx_db_get_sequence_count();
+    dup_count = COPIES * base_count;
+    dup_db = xmalloc( dup_count * sizeof(seqinfo_t) );
+
+    for( size_t c = 0; c < COPIES; c++ ) {
+        for( size_t i = 0; i < base_count; i++ ) {
+            p_seqinfo info = ctx_db_get_sequence( i );
+            p_seqinfo copy = &dup_db[c * base_count + i];
+
+            *copy = *info;
+            copy->ID = c * base_count + i;
+            copy->seq = xmalloc( info->seqlen + 1 );
+            for( size_t j = 0; j <= info->seqlen; j++ ) {
+                copy->seq[j] = (c == 2) ? tolower( info->seq[j] ) : info->seq[j];
+            }
+        }
+    }
+}
+
+static void free_dup_db() {
+    for( size_t i = 0; i < dup_count; i++ ) {
+        free( dup_db[i].seq );
+    }
+    free( dup_db );
+}
+
+static p_ssa_context create_dup_context( int deduplicate ) {
+    p_ssa_context ctx = create_test_context( NUCLEOTIDE );
+    ssa_ctx_set_chunk_size( ctx, 10 );
+    ssa_ctx_init_db( ctx, dup_db, dup_count );
+    ssa_ctx_set_deduplication( ctx, deduplicate );
+
+    return ctx;
+}
+
+static void compare_searches( int search_type, int bit_width, int align_type, size_t hit_count ) {
+    p_ssa_context plain = create_dup_context( 0 );
+    p_ssa_context dedup = create_dup_context( 1 );
+
+    p_query query = ssa_ctx_init_sequence_fasta( plain, READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+
+    p_alignment_list expected;
+    p_alignment_list alist;
+    if( search_type == SMITH_WATERMAN ) {
+        expected = ssa_ctx_sw_align( plain, query, hit_count, bit_width, align_type );
+        alist = ssa_ctx_sw_align( dedup, query, hit_count, bit_width, align_type );
+    }
+    else {
+        expected = ssa_ctx_nw_align( plain, query, hit_count, bit_width, align_type );
+        alist = ssa_ctx_nw_align( dedup, query, hit_count, bit_width, align_type );
+    }
+
+    ck_assert_int_eq( expected->len, alist->len );
+    for( size_t i = 0; i < expected->len; i++ ) {
+        ck_assert_int_eq( expected->alignments[i]->score, alist->alignments[i]->score );
+        ck_assert_int_eq( dup_db[alist->alignments[i]->db_seq.ID].seqlen, alist->alignments[i]->db_seq.len );
+    }
+
+    free_alignment( expected );
+    free_alignment( alist );
+    free_sequence( query );
+
+    ssa_ctx_free( plain );
+    ssa_ctx_free( dedup );
+}
+
+START_TEST (test_dedup_index)
+    {
+        init_dup_db();
+
+        p_ssa_context ctx = create_dup_context( 1 );
+        p_ssa_context prev = ctx_enter( ctx );
+
+        p_dedup_index index = dd_get_index();
+        ck_assert_int_eq( dup_count, index->count );
+        ck_assert( index->group_count <= base_count );
+
+        // every copy is in the group of its original
+        for( size_t i = 0; i < base_count; i++ ) {
+            size_t id = i;
+            for( size_t c = 1; c < COPIES; c++ ) {
+                id = index->next[id];
+                ck_assert( id != DD_NO_MEMBER );
+                ck_assert_int_eq( dup_db[i].seqlen, dup_db[id].seqlen );
+            }
+            ck_assert( dd_is_searched( index, i, 0 ) || (index->prev[i] < i) );
+            ck_assert( !dd_is_searched( index, i + base_count, 0 ) );
+        }
+
+        // the index is reused, until the database changes
+        ck_assert_ptr_eq( index, dd_get_index() );
+
+        ck_assert_int_eq( index->group_count, dd_count_searched( index, 0, dup_count ) );
+        ck_assert_int_eq( index->group_count, dd_count_searched( index, base_count, dup_count ) );
+
+        ctx_leave( prev );
+        ssa_ctx_free( ctx );
+
+        free_dup_db();
+        ssa_exit();
+    }END_TEST
+
+START_TEST (test_dedup_search)
+    {
+        set_thread_count( 2 );
+        init_dup_db();
+
+        compare_searches( SMITH_WATERMAN, BIT_WIDTH_16, COMPUTE_SCORE, 30 );
+        compare_searches( SMITH_WATERMAN, BIT_WIDTH_8, COMPUTE_ALIGNMENT, 7 );
+        compare_searches( NEEDLEMAN_WUNSCH, BIT_WIDTH_64, COMPUTE_SCORE, 30 );
+
+        free_dup_db();
+        ssa_exit();
+    }END_TEST
+
+START_TEST (test_dedup_range)
+    {
+        set_thread_count( 1 );
+        init_dup_db();
+
+        p_ssa_context ctx = create_dup_context( 1 );
+        p_query query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+
+        // the first copy is outside of the range, so the second one is searched
+        ssa_ctx_set_search_range( ctx, base_count, 3 * base_count );
+
+        p_alignment_list alist = ssa_ctx_sw_align( ctx, query, 2 * base_count, BIT_WIDTH_16, COMPUTE_SCORE );
+        ck_assert_int_eq( 2 * base_count, alist->len );
+
+        for( size_t i = 0; i < alist->len; i++ ) {
+            ck_assert( alist->alignments[i]->db_seq.ID >= base_count );
+            ck_assert( alist->alignments[i]->db_seq.ID < 3 * base_count );
+        }
+
+        free_alignment( alist );
+        free_sequence( query );
+        ssa_ctx_free( ctx );
+
+        free_dup_db();
+        ssa_exit();
+    }END_TEST
+
+START_TEST (test_dedup_pruning)
+    {
+        set_thread_count( 1 );
+        init_dup_db();
+
+        p_ssa_context ctx = create_dup_context( 1 );
+        ssa_ctx_set_bound_pruning( ctx, 1 );
+
+        // the longest sequence as query: the shorter sequences score less than the query itself
+        size_t longest = 0;
+        for( size_t i = 0; i < base_count; i++ ) {
+            if( dup_db[i].seqlen > dup_db[longest].seqlen ) {
+                longest = i;
+            }
+        }
+        p_query query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_STRING, dup_db[longest].seq );
+
+        p_alignment_list alist = ssa_ctx_sw_align( ctx, query, 1, BIT_WIDTH_16, COMPUTE_SCORE );
+        ck_assert_int_eq( 5 * dup_db[longest].seqlen, alist->alignments[0]->score );
+
+        // only the searched member of a group can be pruned
+        size_t pruned = ssa_ctx_get_pruned_sequence_count( ctx );
+        ck_assert( pruned > 0 );
+        ck_assert( pruned < base_count );
+
+        free_alignment( alist );
+        free_sequence( query );
+        ssa_ctx_free( ctx );
+
+        free_dup_db();
+        ssa_exit();
+    }END_TEST
+
+void addDbDedupTC( Suite *s ) {
+    TCase *tc_core = tcase_create( "db_dedup" );
+    tcase_add_test( tc_core, test_dedup_index );
+    tcase_add_test( tc_core, test_dedup_search );
+    tcase_add_test( tc_core, test_dedup_range );
+    tcase_add_test( tc_core, test_dedup_pruning );
+
+    suite_add_tcase( s, tc_core );
+}
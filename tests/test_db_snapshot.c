@@ -0,0 +1,185 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#include "tests.h"
+
+#include <string.h>
+#include <pthread.h>
+
+#include "../src/libssa.h"
+#include "../src/db_snapshot.h"
+
+#define BIG_DB "tests/testdata/AF091148.fas"
+#define BIG_DB_COUNT 1403
+#define SMALL_DB "tests/testdata/AF091148_selection.fas"
+#define SMALL_DB_COUNT 36
+
+static p_ssa_context create_nt_context( p_ssa_database db ) {
+    p_ssa_context ctx = create_test_context( NUCLEOTIDE );
+    ssa_ctx_use_database( ctx, db );
+
+    return ctx;
+}
+
+START_TEST (test_snapshot_versions)
+    {
+        p_ssa_database db = dbs_create();
+        ck_assert_int_eq( 0, dbs_get_version( db ) );
+        ck_assert_ptr_eq( 0, dbs_acquire( db ) );
+
+        ck_assert_int_eq( 0, dbs_load( db, "tests/testdata/does_not_exist.fas" ) );
+
+        ck_assert_int_eq( 1, dbs_load( db, BIG_DB ) );
+        ck_assert_int_eq( 1, dbs_get_version( db ) );
+        ck_assert_int_eq( BIG_DB_COUNT, dbs_get_sequence_count( db ) );
+
+        p_db_snapshot old = dbs_acquire( db );
+        ck_assert_int_eq( 2, old->refcount );
+
+        dbs_load_async( db, SMALL_DB );
+        ck_assert_int_eq( 1, dbs_wait( db ) );
+        ck_assert_int_eq( 2, dbs_get_version( db ) );
+        ck_assert_int_eq( SMALL_DB_COUNT, dbs_get_sequence_count( db ) );
+
+        // the old version stays valid, until it is released
+        ck_assert_int_eq( 1, old->refcount );
+        ck_assert_int_eq( BIG_DB_COUNT, old->count );
+        ck_assert_int_eq( BIG_DB_COUNT - 1, old->sequences[BIG_DB_COUNT - 1].ID );
+        ck_assert_int_eq( old->sequences[0].seqlen, strlen( old->sequences[0].seq ) );
+
+        dbs_release( db, old );
+
+        dbs_free( db );
+    }END_TEST
+
+START_TEST (test_snapshot_search)
+    {
+        set_thread_count( 2 );
+        init_constant_scores( 5, -4 );
+        init_gap_penalties( -4, -2 );
+        init_symbol_translation( NUCLEOTIDE, FORWARD_STRAND, 3, 3 );
+        init_db( BIG_DB );
+
+        p_query query = init_sequence_fasta( READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+        p_alignment_list expected = sw_align( query, 5, BIT_WIDTH_16, COMPUTE_ALIGNMENT );
+
+        p_ssa_database db = ssa_database_create();
+        ssa_database_load( db, BIG_DB );
+
+        use_database( db );
+        p_alignment_list alist = sw_align( query, 5, BIT_WIDTH_16, COMPUTE_ALIGNMENT );
+        use_database( 0 );
+
+        ck_assert_int_eq( expected->len, alist->len );
+        for( size_t i = 0; i < alist->len; i++ ) {
+            ck_assert_int_eq( expected->alignments[i]->score, alist->alignments[i]->score );
+            ck_assert_int_eq( expected->alignments[i]->db_seq.len, alist->alignments[i]->db_seq.len );
+        }
+
+        free_alignment( alist );
+        free_alignment( expected );
+        free_sequence( query );
+
+        ssa_database_free( db );
+        ssa_exit();
+    }END_TEST
+
+typedef struct {
+    p_ssa_context ctx;
+    p_query query;
+    int stop;
+    int searches;
+    int invalid;
+} search_loop_t;
+
+static void * search_loop( void * data ) {
+    search_loop_t * s = data;
+
+    while( !__atomic_load_n( &s->stop, __ATOMIC_RELAXED ) || !s->searches ) {
+        p_alignment_list alist = ssa_ctx_sw_align( s->ctx, s->query, 3, BIT_WIDTH_16, COMPUTE_ALIGNMENT );
+
+        // every search sees one complete version of the database
+        for( size_t i = 0; i < alist->len; i++ ) {
+            if( (alist->alignments[i]->db_seq.ID >= BIG_DB_COUNT) || !alist->alignments[i]->alignment ) {
+                s->invalid++;
+            }
+        }
+        if( alist->len != 3 ) {
+            s->invalid++;
+        }
+
+        free_alignment( alist );
+        s->searches++;
+    }
+
+    return NULL;
+}
+
+START_TEST (test_hot_swap)
+    {
+        set_thread_count( 2 );
+
+        p_ssa_database db = ssa_database_create();
+        ssa_database_load( db, BIG_DB );
+
+        p_ssa_context ctx = create_nt_context( db );
+
+        search_loop_t s;
+        s.ctx = ctx;
+        s.query = ssa_ctx_init_sequence_fasta( ctx, READ_FROM_FILE, "tests/testdata/one_seq.fas" );
+        s.stop = 0;
+        s.searches = 0;
+        s.invalid = 0;
+
+        pthread_t thread;
+        pthread_create( &thread, NULL, search_loop, &s );
+
+        // swap the database under the running searches
+        for( int i = 0; i < 4; i++ ) {
+            ssa_database_load_async( db, (i % 2) ? BIG_DB : SMALL_DB );
+            ck_assert_int_eq( 1, ssa_database_wait( db ) );
+        }
+        ck_assert_int_eq( 5, ssa_database_get_version( db ) );
+
+        __atomic_store_n( &s.stop, 1, __ATOMIC_RELAXED );
+        pthread_join( thread, NULL );
+
+        ck_assert_int_gt( s.searches, 0 );
+        ck_assert_int_eq( 0, s.invalid );
+
+        // new searches use the latest version
+        ssa_database_load( db, SMALL_DB );
+        p_alignment_list alist = ssa_ctx_sw_align( ctx, s.query, BIG_DB_COUNT, BIT_WIDTH_16, COMPUTE_SCORE );
+        ck_assert_int_eq( SMALL_DB_COUNT, alist->len );
+        free_alignment( alist );
+
+        free_sequence( s.query );
+        ssa_ctx_free( ctx );
+        ssa_database_free( db );
+        ssa_exit();
+    }END_TEST
+
+void addDbSnapshotTC( Suite *s ) {
+    TCase *tc_core = tcase_create( "db_snapshot" );
+    tcase_add_test( tc_core, test_snapshot_versions );
+    tcase_add_test( tc_core, test_snapshot_search );
+    tcase_add_test( tc_core, test_hot_swap );
+
+    suite_add_tcase( s, tc_core );
+}
@@ -0,0 +1,182 @@
+/*
+ Copyright (C) 2014-2015 Jakob Frielingsdorf
+
+ This program is free software: you can redistribute it and/or modify
+ it under the terms of the GNU Affero General Public License as
+ published by the Free Software Foundation, either version 3 of the
+ License, or (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU Affero General Public License for more details.
+
+ You should have received a copy of the GNU Affero General Public License
+ along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+ Contact: Jakob Frielingsdorf <jfrielingsdorf@gmail.com>
+ */
+
+#include "tests.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "../src/libssa.h"
+#include "../src/context.h"
+#include "../src/kmer_index.h"
+
+#define KMER_DB "tests/testdata/AF091148.fas"
+#define KMER_QUERY_ID 100
+#define KMER_INDEX_FILE "tests/testdata/tmp_kmer_index.bin"
+
+START_TEST (test_kmer_index_build)
+    {
+        p_ssa_context ctx = create_test_db_context( 2, KMER_DB, NUCLEOTIDE );
+        ssa_ctx_set_kmer_prefilter( ctx, 6, 1, 0 );
+
+        p_ssa_context prev = ctx_enter( ctx );
+        p_kmer_index index = ki_get_index();
+
+        ck_assert_int_eq( 6, index->k );
+        ck_assert_int_eq( 4096, index->kmer_count );
+        ck_assert_int_eq( ctx_db_get_sequence_count(), index->seq_count );
+
+        // the IDs of each k-mer are sorted and unique
+        for( size_t i = 0; i < index->kmer_count; i++ ) {
+            for( uint64_t j = index->offsets[i] + 1; j < index->offsets[i + 1]; j++ ) {
+                ck_assert( index->ids[j - 1] < index->ids[j] );
+            }
+        }
+
+        // the first k-mer of a sequence contains its ID
+        p_seqinfo info = ctx_db_get_sequence( KMER_QUERY_ID );
+        uint32_t kmer = 0;
+        const char * bases = "ACGT";
+        for( size_t i = 0; i < 6; i++ ) {
+            kmer = (kmer << 2) | (strchr( bases, toupper( info->seq[i] ) ) - bases);
+        }
+        int found = 0;
+        for( uint64_t j = index->offsets[kmer]; j < index->offsets[kmer + 1]; j++ ) {
+            found |= (index->ids[j] == KMER_QUERY_ID);
+        }
+        ck_assert( found );
+
+        // the index is reused by the following searches
+        ck_assert_ptr_eq( index, ki_get_index() );
+
+        ctx_leave( prev );
+        ssa_ctx_free( ctx );
+        ssa_exit();
+    }END_TEST
+
+START_TEST (test_kmer_prefilter_search)
+    {
+        p_ssa_context ctx = create_test_db_context( 2, KMER_DB, NUCLEOTIDE );
+        p_query query = create_db_query( ctx, KMER_QUERY_ID );
+
+        p_alignment_list exact = ssa_ctx_sw_align( ctx, query, 5, BIT_WIDTH_16, COMPUTE_SCORE );
+
+        size_t sequences;
+        size_t candidates;
+
+        ssa_ctx_set_kmer_prefilter( ctx, 0, 1, 20 );
+        p_alignment_list alist = ssa_ctx_sw_align( ctx, query, 5, BIT_WIDTH_16, COMPUTE_SCORE );
+
+        ssa_ctx_get_prefilter_stats( ctx, &sequences, &candidates );
+        ck_assert_int_eq( 1403, sequences );
+        ck_assert_int_eq( 20, candidates );
+
+        ck_assert_int_eq( 5, alist->len );
+        ck_assert_int_eq( exact->alignments[0]->score, alist->alignments[0]->score );
+        ck_assert( alignment_list_recall( exact, alist ) > 0 );
+        ck_assert( alignment_list_recall( exact, exact ) == 1 );
+
+        free_alignment( alist );
+
+        // the query itself is the best candidate
+        ssa_ctx_set_kmer_prefilter( ctx, 0, 1, 1 );
+        alist = ssa_ctx_sw_align( ctx, query, 5, BIT_WIDTH_16, COMPUTE_ALIGNMENT );
+
+        ck_assert_int_eq( 1, alist->len );
+        ck_assert_int_eq( exact->alignments[0]->score, alist->alignments[0]->score );
+
+        free_alignment( alist );
+
+        // without a limit all sequences sharing a k-mer are candidates
+        ssa_ctx_set_kmer_prefilter( ctx, 0, 1, 0 );
+        alist = ssa_ctx_sw_align( ctx, query, 5, BIT_WIDTH_16, COMPUTE_SCORE );
+
+        ssa_ctx_get_prefilter_stats( ctx, &sequences, &candidates );
+        ck_assert( candidates > 20 );
+        ck_assert( candidates <= 1403 );
+        ck_assert( alignment_list_recall( exact, alist ) == 1 );
+
+        free_alignment( alist );
+        free_alignment( exact );
+        free_sequence( query );
+        ssa_ctx_free( ctx );
+        ssa_exit();
+    }END_TEST
+
+START_TEST (test_kmer_index_file)
+    {
+        p_ssa_context ctx = create_test_db_context( 2, KMER_DB, NUCLEOTIDE );
+        ssa_ctx_set_kmer_prefilter( ctx, 7, 1, 10 );
+
+        ck_assert_int_eq( 1, ssa_ctx_save_kmer_index( ctx, KMER_INDEX_FILE ) );
+
+        p_ssa_context other = ssa_ctx_create();
+        ssa_ctx_init_constant_scores( other, 5, -4 );
+        ssa_ctx_init_gap_penalties( other, -4, -2 );
+        ssa_ctx_init_symbol_translation( other, NUCLEOTIDE, FORWARD_STRAND, 3, 3 );
+        ssa_ctx_set_kmer_prefilter( other, 0, 1, 10 );
+
+        ck_assert_int_eq( 0, ssa_ctx_load_kmer_index( other, "tests/testdata/does_not_exist.bin" ) );
+        ck_assert_int_eq( 1, ssa_ctx_load_kmer_index( other, KMER_INDEX_FILE ) );
+
+        p_ssa_context prev = ctx_enter( ctx );
+        p_kmer_index saved = ki_get_index();
+        ctx_enter( other );
+        p_kmer_index loaded = ki_get_index();
+        ctx_leave( prev );
+
+        // the loaded index is used, instead of building a new one
+        ck_assert_ptr_eq( loaded, other->kmer_cache );
+        ck_assert_int_eq( 7, loaded->k );
+        ck_assert_int_eq( saved->offsets[saved->kmer_count], loaded->offsets[loaded->kmer_count] );
+        ck_assert( !memcmp( saved->ids, loaded->ids, saved->offsets[saved->kmer_count] * sizeof(uint32_t) ) );
+
+        p_query query = create_db_query( ctx, KMER_QUERY_ID );
+        p_alignment_list expected = ssa_ctx_sw_align( ctx, query, 5, BIT_WIDTH_16, COMPUTE_SCORE );
+        p_alignment_list alist = ssa_ctx_sw_align( other, query, 5, BIT_WIDTH_16, COMPUTE_SCORE );
+
+        ck_assert_int_eq( expected->len, alist->len );
+        for( size_t i = 0; i < expected->len; i++ ) {
+            ck_assert_int_eq( expected->alignments[i]->score, alist->alignments[i]->score );
+        }
+
+        free_alignment( expected );
+        free_alignment( alist );
+        free_sequence( query );
+
+        // the index does not fit to another database
+        init_db( "tests/testdata/AF091148_selection.fas" );
+        ck_assert_int_eq( 0, ssa_ctx_load_kmer_index( other, KMER_INDEX_FILE ) );
+
+        remove( KMER_INDEX_FILE );
+
+        ssa_ctx_free( other );
+        ssa_ctx_free( ctx );
+        ssa_exit();
+    }END_TEST
+
+void addKmerIndexTC( Suite *s ) {
+    TCase *tc_core = tcase_create( "kmer_index" );
+    tcase_add_test( tc_core, test_kmer_index_build );
+    tcase_add_test( tc_core, test_kmer_prefilter_search );
+    tcase_add_test( tc_core, test_kmer_index_file );
+
+    suite_add_tcase( s, tc_core );
+}
@@ -19,6 +19,8 @@
 
 #include "tests.h"
 
+#include <string.h>
+
 #include "../src/libssa.h"
 #include "../src/util/util_sequence.h"
 #include "../src/util/util.h"
@@ -92,6 +94,54 @@ START_TEST (test_simple_one_thread)
         exit_libssa_test( alist, query );
     }END_TEST
 
+START_TEST (test_cigar_formats)
+    {
+        // one thread, so that hits of the same score are in the same order
+        p_query query = init_libssa_test( 1, "tests/testdata/AF091148.fas", "tests/testdata/one_seq.fas" );
+
+        p_alignment_list text = sw_align( query, 5, BIT_WIDTH_64, COMPUTE_ALIGNMENT );
+
+        set_cigar_format( CIGAR_FORMAT_EXTENDED );
+        p_alignment_list extended = sw_align( query, 5, BIT_WIDTH_64, COMPUTE_ALIGNMENT );
+
+        set_cigar_format( CIGAR_FORMAT_PACKED );
+        p_alignment_list packed = sw_align( query, 5, BIT_WIDTH_64, COMPUTE_ALIGNMENT );
+
+        set_cigar_format( CIGAR_FORMAT_TEXT );
+
+        ck_assert_int_eq( 5, packed->len );
+        for( size_t i = 0; i < packed->len; i++ ) {
+            p_alignment a = packed->alignments[i];
+
+            ck_assert_int_eq( text->alignments[i]->db_seq.ID, a->db_seq.ID );
+            ck_assert( !a->alignment );
+            ck_assert( !text->alignments[i]->cigar_ops );
+
+            // the packed operations hold the columns of the alignment
+            size_t columns = 0;
+            for( size_t k = 0; k < a->cigar_ops_len; k++ ) {
+                columns += SSA_CIGAR_LEN( a->cigar_ops[k] );
+            }
+            ck_assert_int_eq( a->align_columns, columns );
+
+            char * standard = alignment_cigar_string( a, 0 );
+            ck_assert_str_eq( text->alignments[i]->alignment, standard );
+            ck_assert_int_eq( strlen( standard ), text->alignments[i]->alignment_len );
+            free( standard );
+
+            char * full = alignment_cigar_string( a, 1 );
+            ck_assert_str_eq( extended->alignments[i]->alignment, full );
+            ck_assert( !strchr( full, 'M' ) );
+            free( full );
+        }
+
+        ck_assert( !alignment_cigar_string( text->alignments[0], 0 ) );
+
+        free_alignment( text );
+        free_alignment( extended );
+        exit_libssa_test( packed, query );
+    }END_TEST
+
 START_TEST (test_sw_multiple_threads)
     {
         p_query query = init_libssa_test( 4, "tests/testdata/AF091148.fas", "tests/testdata/one_seq.fas" );
@@ -259,6 +309,7 @@ START_TEST (test_init_functions)
 void addLibssaTC( Suite *s ) {
     TCase *tc_core = tcase_create( "libssa" );
     tcase_add_test( tc_core, test_simple_one_thread );
+    tcase_add_test( tc_core, test_cigar_formats );
     tcase_add_test( tc_core, test_sw_multiple_threads );
     tcase_add_test( tc_core, test_nw_multiple_threads );
     tcase_add_test( tc_core, test_1000_threads );
@@ -126,6 +126,21 @@ START_TEST (test_init_constant_scoring)
         mat_free();
     }END_TEST
 
+START_TEST (test_is_symmetric)
+    {
+        mat_init_buildin(BLOSUM62);
+        ck_assert_int_eq( 1, mat_is_symmetric() );
+        mat_free();
+
+        mat_init_constant_scoring(4, -2);
+        ck_assert_int_eq( 1, mat_is_symmetric() );
+        mat_free();
+
+        mat_init_from_string("   A  R\nA  4 -1\nR -2  5\n");
+        ck_assert_int_eq( 0, mat_is_symmetric() );
+        mat_free();
+    }END_TEST
+
 void addMatricesTC(Suite *s) {
     TCase *tc_core = tcase_create("matrices");
     tcase_add_test(tc_core, test_free);
@@ -133,6 +148,7 @@ void addMatricesTC(Suite *s) {
     tcase_add_test(tc_core, test_init_from_file);
     tcase_add_test(tc_core, test_init_from_string);
     tcase_add_test(tc_core, test_init_constant_scoring);
+    tcase_add_test(tc_core, test_is_symmetric);
 
     suite_add_tcase(s, tc_core);
 }
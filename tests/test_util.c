@@ -23,11 +23,13 @@
 #include <string.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <limits.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
 
 #include "../src/db_adapter.h"
+#include "../src/context.h"
 #include "../src/util/util.h"
 #include "../src/util/util_sequence.h"
 #include "../src/libssa_extern_db.h"
@@ -84,6 +86,41 @@ void fill_translated_sequence( sequence_t* s, char * seq, size_t len ) {
     us_map_sequence( new_seq, *s, map_ncbi_nt16 );
 }
 
+/**
+ * Creates a context with the scores used by most tests, for the forward strand
+ * of the given symbol type.
+ */
+p_ssa_context create_test_context( int symbol_type ) {
+    p_ssa_context ctx = ssa_ctx_create();
+    ssa_ctx_init_constant_scores( ctx, 5, -4 );
+    ssa_ctx_init_gap_penalties( ctx, -4, -2 );
+    ssa_ctx_init_symbol_translation( ctx, symbol_type, FORWARD_STRAND, 3, 3 );
+
+    return ctx;
+}
+
+/**
+ * Sets the thread count, loads the database from db_file, and creates a
+ * context like create_test_context.
+ */
+p_ssa_context create_test_db_context( size_t thread_count, const char * db_file, int symbol_type ) {
+    set_thread_count( thread_count );
+
+    init_db( db_file );
+
+    return create_test_context( symbol_type );
+}
+
+/**
+ * Uses the sequence of the database with the given ID as query, so that it has
+ * to be the best hit.
+ */
+p_query create_db_query( p_ssa_context ctx, size_t id ) {
+    p_seqinfo info = ctx_db_get_sequence( id );
+
+    return ssa_ctx_init_sequence_fasta( ctx, READ_FROM_STRING, info->seq );
+}
+
 START_TEST (test_xmalloc)
     {
         uint8_t * arr = xmalloc( 5 );
@@ -149,6 +186,61 @@ START_TEST (test_add_to_minheap)
         minheap_exit( heap );
     }END_TEST
 
+static void init_shared_result( search_result_t * res, size_t hit_count, long * floor ) {
+    res->heap = minheap_init( hit_count );
+    res->chunk_count = 0;
+    res->seq_count = 0;
+    res->overflow_8_bit_count = 0;
+    res->overflow_16_bit_count = 0;
+    res->add_hit = 0;
+    res->hit_data = 0;
+    res->shared_floor = floor;
+}
+
+START_TEST (test_add_to_result_shared_floor)
+    {
+        long floor = LONG_MIN;
+
+        search_result_t res1;
+        search_result_t res2;
+        init_shared_result( &res1, 2, &floor );
+        init_shared_result( &res2, 2, &floor );
+
+        sdb_sequence_t db_seq = { 0, { 0, 0 }, 0, 0 };
+
+        // the floor is published, when a heap is full
+        add_to_result( &res1, 0, &db_seq, 10 );
+        ck_assert_int_eq( LONG_MIN, floor );
+        ck_assert_int_eq( LONG_MIN, result_score_floor( &res1 ) );
+
+        add_to_result( &res1, 0, &db_seq, 20 );
+        ck_assert_int_eq( 10, floor );
+
+        // the other thread rejects hits at or below the floor, before its heap is full
+        add_to_result( &res2, 0, &db_seq, 10 );
+        add_to_result( &res2, 0, &db_seq, 5 );
+        ck_assert_int_eq( 0, res2.heap->count );
+        ck_assert_int_eq( 10, result_score_floor( &res2 ) );
+
+        add_to_result( &res2, 0, &db_seq, 30 );
+        add_to_result( &res2, 0, &db_seq, 40 );
+        ck_assert_int_eq( 2, res2.heap->count );
+        ck_assert_int_eq( 30, floor );
+
+        // the own heap minimum counts, if it is higher
+        ck_assert_int_eq( 30, result_score_floor( &res1 ) );
+        ck_assert_int_eq( 30, result_score_floor( &res2 ) );
+
+        // the floor does not fall
+        add_to_result( &res1, 0, &db_seq, 35 );
+        ck_assert_int_eq( 30, floor );
+        ck_assert_int_eq( 2, res1.heap->count );
+        ck_assert_int_eq( 20, res1.heap->array[0].score );
+
+        minheap_exit( res1.heap );
+        minheap_exit( res2.heap );
+    }END_TEST
+
 START_TEST (test_fatal)
     {
         pid_t pid = fork();
@@ -189,6 +281,7 @@ void addUtilTC( Suite *s ) {
     tcase_add_test( tc_core, test_xmalloc );
     tcase_add_test( tc_core, test_xrealloc );
     tcase_add_test( tc_core, test_add_to_minheap );
+    tcase_add_test( tc_core, test_add_to_result_shared_floor );
     tcase_add_test( tc_core, test_fatal );
     tcase_add_test( tc_core, test_output );
 
@@ -51,8 +51,27 @@ void add_nw_8_AVX2_TC( Suite *s );
 void addSearcher64TC( Suite *s );
 void addSearcherTC( Suite *s );
 void addManagerTC( Suite *s );
+void addBatcherTC( Suite *s );
+void addPairAlignerTC( Suite *s );
+void addAsyncSearchTC( Suite *s );
+void addAnytimeTC( Suite *s );
+void addShardedSearchTC( Suite *s );
+void addIncrementalTC( Suite *s );
+void addUngappedFilterTC( Suite *s );
+void addBoundPruningTC( Suite *s );
+void addDenseScoresTC( Suite *s );
+void addHitStreamTC( Suite *s );
+void addResultTableTC( Suite *s );
+void addAlignStatsTC( Suite *s );
+void addEditDistanceTC( Suite *s );
+void addBandedNWTC( Suite *s );
+void addServerTC( Suite *s );
+void addDbSnapshotTC( Suite *s );
+void addDbDedupTC( Suite *s );
+void addKmerIndexTC( Suite *s );
 void addAlignerTC( Suite *s );
 void addLibssaTC( Suite *s );
+void addContextTC( Suite *s );
 void addBiggerDatabasesTC( Suite *s );
 
 // some utility functions
@@ -63,5 +82,10 @@ char* concat( char *s1, char *s2 );
 void ck_converted_prot_eq( char* ref, sequence_t seq );
 void fill_translated_sequence( sequence_t* s, char * seq, size_t len );
 
+// contexts of the searches of the tests: constant scores 5/-4, gap penalties -4/-2 and the forward strand
+p_ssa_context create_test_context( int symbol_type );
+p_ssa_context create_test_db_context( size_t thread_count, const char * db_file, int symbol_type );
+p_query create_db_query( p_ssa_context ctx, size_t id );
+
 #endif /* CHECK_LIBSSA_H_ */
 
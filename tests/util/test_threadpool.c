@@ -22,6 +22,7 @@
 #include <sys/sysinfo.h>
 
 #include "../../src/util/thread_pool.h"
+#include "../../src/context.h"
 #include "../../src/libssa.h"
 #include "../../src/util/util.h"
 
@@ -43,6 +44,7 @@ struct int_result {
 
 static void * simple_test_thread( void * size_arg ) {
     struct int_result * counter = xmalloc( sizeof(struct int_result) );
+    counter->val = 0;
 
     for( int i = 0; i < *((size_t*) size_arg); ++i ) {
         counter->val++;
@@ -201,6 +203,40 @@ START_TEST (test_reuse_threadpool)
         teardown_pool();
     }END_TEST
 
+START_TEST (test_thread_count_per_context)
+    {
+        int n = 2;
+        setup_pool( n );
+
+        size_t count = 1000;
+        start_threads( &simple_test_thread, &count );
+
+        // another context changes the thread count, while the threads are running
+        p_ssa_context other = ctx_create();
+        p_ssa_context prev = ctx_enter( other );
+        set_thread_count( 6 );
+        init_thread_pool();
+        ck_assert_int_eq( 6, get_current_thread_count() );
+        ctx_leave( prev );
+        ctx_free( other );
+
+        ck_assert_int_eq( n, get_current_thread_count() );
+
+        struct int_result * result_list[n];
+
+        ck_assert_int_eq( n, wait_for_threads( (void **) &result_list ) );
+
+        for( int i = 0; i < n; ++i ) {
+            ck_assert_int_eq( count, result_list[i]->val );
+        }
+
+        // the next search of this context keeps its thread count, until it initialises the pool again
+        start_threads( &simple_test_thread, &count );
+        ck_assert_int_eq( n, wait_for_threads( (void **) &result_list ) );
+
+        teardown_pool();
+    }END_TEST
+
 void addThreadPoolTC( Suite *s ) {
     TCase *tc_core = tcase_create( "threadpool" );
     tcase_add_test( tc_core, test_one_thread );
@@ -209,6 +245,7 @@ void addThreadPoolTC( Suite *s ) {
     tcase_add_test( tc_core, test_1000_threads );
     tcase_add_test( tc_core, test_changing_nr_of_threads );
     tcase_add_test( tc_core, test_reuse_threadpool );
+    tcase_add_test( tc_core, test_thread_count_per_context );
 
     suite_add_tcase( s, tc_core );
 }